@@ -1,6 +1,7 @@
 #include "QuaternionCamera.hpp"
 
 #include <algorithm>
+#include <cmath>
 
 QuaternionCamera::QuaternionCamera()
     : position(1.5f, -1.5f, 1.5f),
@@ -94,8 +95,13 @@ glm::mat4 QuaternionCamera::getViewMatrix() const {
 }
 
 glm::mat4 QuaternionCamera::getProjectionMatrix(float aspectRatio) const {
-  glm::mat4 proj = glm::perspective(fov, aspectRatio, nearPlane, farPlane);
-  proj[1][1] *= -1;  // Flip Y for Vulkan
+  // Limit of glm::perspective with near and far swapped as far goes to infinity: clip z = near, clip w = -view z
+  const float focal = 1.0f / std::tan(fov * 0.5f);
+  glm::mat4 proj(0.0f);
+  proj[0][0] = focal / aspectRatio;
+  proj[1][1] = -focal;  // Flip Y for Vulkan
+  proj[2][3] = -1.0f;
+  proj[3][2] = nearPlane;
   return proj;
 }
 
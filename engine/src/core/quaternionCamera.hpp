@@ -28,6 +28,8 @@ class QuaternionCamera {
 
   // Get matrices
   glm::mat4 getViewMatrix() const;
+  // Reverse-Z with an infinite far plane: depth 1 at the near plane, 0 at infinity. Depth buffers clear to 0 and test
+  // with GREATER, the far plane only bounds view-depth ranges such as the light clusters
   glm::mat4 getProjectionMatrix(float aspectRatio) const;
 
   // Setters
@@ -45,6 +47,8 @@ class QuaternionCamera {
   glm::vec3 getUp() const { return up; }
   glm::quat getOrientation() const { return orientation; }
   float getFov() const { return glm::degrees(fov); }
+  float getNearPlane() const { return nearPlane; }
+  float getFarPlane() const { return farPlane; }
 
  private:
   // Camera properties
@@ -0,0 +1,481 @@
+#include "BlockCompressor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TAK_BC_SSE2 1
+#endif
+
+namespace BlockCompressor {
+
+namespace {
+// Interpolation weights of 4 bit BC7 indices, out of 64, weight[15 - i] == 64 - weight[i]
+const int kWeights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Least significant bit first, the block has to be zeroed before writing
+struct BitWriter {
+  uint8_t* data;
+  uint32_t position = 0;
+  void write(uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++, position++) {
+      data[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1u) << (position & 7));
+    }
+  }
+};
+
+struct BitReader {
+  const uint8_t* data;
+  uint32_t position = 0;
+  uint32_t read(uint32_t bits) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bits; i++, position++) {
+      value |= ((data[position >> 3] >> (position & 7)) & 1u) << i;
+    }
+    return value;
+  }
+};
+
+// ============= BC4 =============
+void bc4Palette(int r0, int r1, int palette[8]) {
+  palette[0] = r0;
+  palette[1] = r1;
+  if (r0 > r1) {
+    for (int i = 2; i < 8; i++) {
+      palette[i] = ((8 - i) * r0 + (i - 1) * r1 + 3) / 7;
+    }
+  } else {
+    for (int i = 2; i < 6; i++) {
+      palette[i] = ((6 - i) * r0 + (i - 1) * r1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+// 8 value mode between the block's max and min, a constant block uses index 0 everywhere
+void encodeBC4(const uint8_t texels[64], uint32_t channel, uint8_t* block) {
+  uint8_t lo = 255;
+  uint8_t hi = 0;
+  for (uint32_t t = 0; t < 16; t++) {
+    lo = std::min(lo, texels[t * 4 + channel]);
+    hi = std::max(hi, texels[t * 4 + channel]);
+  }
+  block[0] = hi;
+  block[1] = lo;
+  memset(block + 2, 0, 6);
+  if (hi == lo) {
+    return;
+  }
+  int palette[8];
+  bc4Palette(hi, lo, palette);
+  uint64_t bits = 0;
+  for (uint32_t t = 0; t < 16; t++) {
+    const int value = texels[t * 4 + channel];
+    uint32_t best = 0;
+    int bestError = INT_MAX;
+    for (uint32_t i = 0; i < 8; i++) {
+      const int error = std::abs(palette[i] - value);
+      if (error < bestError) {
+        bestError = error;
+        best = i;
+      }
+    }
+    bits |= static_cast<uint64_t>(best) << (3 * t);
+  }
+  for (uint32_t i = 0; i < 6; i++) {
+    block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+void decodeBC4(const uint8_t* block, uint32_t channel, uint8_t texels[64]) {
+  int palette[8];
+  bc4Palette(block[0], block[1], palette);
+  uint64_t bits = 0;
+  for (uint32_t i = 0; i < 6; i++) {
+    bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+  }
+  for (uint32_t t = 0; t < 16; t++) {
+    texels[t * 4 + channel] = static_cast<uint8_t>(palette[(bits >> (3 * t)) & 7]);
+  }
+}
+
+// ============= BC7 mode 6 =============
+struct Bc7Endpoints {
+  int quantized[2][4];  // 7 bit per channel
+  int pbit[2];
+  int value[2][4];  // quantized << 1 | pbit
+};
+
+// Nearest 7 bit + p-bit representation of an endpoint, the p-bit is shared by its four channels
+void quantizeEndpoint(const float color[4], Bc7Endpoints& endpoints, int e) {
+  float bestError = FLT_MAX;
+  for (int p = 0; p < 2; p++) {
+    int q[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      q[c] = std::clamp(static_cast<int>(std::lround((color[c] - p) * 0.5f)), 0, 127);
+      const float d = static_cast<float>((q[c] << 1) | p) - color[c];
+      error += d * d;
+    }
+    if (error < bestError) {
+      bestError = error;
+      endpoints.pbit[e] = p;
+      for (int c = 0; c < 4; c++) {
+        endpoints.quantized[e][c] = q[c];
+        endpoints.value[e][c] = (q[c] << 1) | p;
+      }
+    }
+  }
+}
+
+// Nearest palette entry per texel, returns the summed squared RGBA error
+float findIndices(const float texels[4][16], const Bc7Endpoints& endpoints, uint8_t indices[16]) {
+  float palette[4][16];
+  for (int k = 0; k < 16; k++) {
+    for (int c = 0; c < 4; c++) {
+      palette[c][k] = static_cast<float>(((64 - kWeights4[k]) * endpoints.value[0][c] + kWeights4[k] * endpoints.value[1][c] + 32) >> 6);
+    }
+  }
+  float total = 0.0f;
+#if defined(TAK_BC_SSE2)
+  // Four texels at a time against every palette entry, ties keep the lower index like the scalar path
+  for (int t = 0; t < 16; t += 4) {
+    const __m128 r = _mm_loadu_ps(&texels[0][t]);
+    const __m128 g = _mm_loadu_ps(&texels[1][t]);
+    const __m128 b = _mm_loadu_ps(&texels[2][t]);
+    const __m128 a = _mm_loadu_ps(&texels[3][t]);
+    __m128 bestError = _mm_set1_ps(FLT_MAX);
+    __m128i bestIndex = _mm_setzero_si128();
+    for (int k = 0; k < 16; k++) {
+      const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[0][k]));
+      const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[1][k]));
+      const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[2][k]));
+      const __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[3][k]));
+      const __m128 error =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+      const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+      bestError = _mm_min_ps(error, bestError);
+      bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+    }
+    alignas(16) int32_t index[4];
+    alignas(16) float error[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(index), bestIndex);
+    _mm_store_ps(error, bestError);
+    for (int j = 0; j < 4; j++) {
+      indices[t + j] = static_cast<uint8_t>(index[j]);
+      total += error[j];
+    }
+  }
+#else
+  for (int t = 0; t < 16; t++) {
+    float bestError = FLT_MAX;
+    for (int k = 0; k < 16; k++) {
+      float error = 0.0f;
+      for (int c = 0; c < 4; c++) {
+        const float d = texels[c][t] - palette[c][k];
+        error += d * d;
+      }
+      if (error < bestError) {
+        bestError = error;
+        indices[t] = static_cast<uint8_t>(k);
+      }
+    }
+    total += bestError;
+  }
+#endif
+  return total;
+}
+
+// Endpoints on the principal axis of the texels, spanning their projections
+void fitPrincipalAxis(const float texels[4][16], float e0[4], float e1[4]) {
+  float mean[4] = {};
+  float lo[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+  float hi[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int c = 0; c < 4; c++) {
+    for (int t = 0; t < 16; t++) {
+      mean[c] += texels[c][t];
+      lo[c] = std::min(lo[c], texels[c][t]);
+      hi[c] = std::max(hi[c], texels[c][t]);
+    }
+    mean[c] /= 16.0f;
+  }
+  float covariance[4][4] = {};
+  for (int t = 0; t < 16; t++) {
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        covariance[i][j] += (texels[i][t] - mean[i]) * (texels[j][t] - mean[j]);
+      }
+    }
+  }
+  // Power iteration from the bounding box diagonal
+  float axis[4];
+  for (int c = 0; c < 4; c++) {
+    axis[c] = hi[c] - lo[c];
+  }
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {};
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        next[i] += covariance[i][j] * axis[j];
+      }
+    }
+    const float scale = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2]), std::abs(next[3])});
+    if (scale < 1e-6f) {
+      break;
+    }
+    for (int c = 0; c < 4; c++) {
+      axis[c] = next[c] / scale;
+    }
+  }
+  const float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+  if (length < 1e-6f) {
+    // Constant block
+    for (int c = 0; c < 4; c++) {
+      e0[c] = e1[c] = mean[c];
+    }
+    return;
+  }
+  float tMin = FLT_MAX;
+  float tMax = -FLT_MAX;
+  for (int t = 0; t < 16; t++) {
+    float projection = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      projection += (texels[c][t] - mean[c]) * axis[c] / length;
+    }
+    tMin = std::min(tMin, projection);
+    tMax = std::max(tMax, projection);
+  }
+  for (int c = 0; c < 4; c++) {
+    e0[c] = std::clamp(mean[c] + axis[c] / length * tMin, 0.0f, 255.0f);
+    e1[c] = std::clamp(mean[c] + axis[c] / length * tMax, 0.0f, 255.0f);
+  }
+}
+
+// Least squares endpoints for fixed indices, false when all texels use the same weight
+bool refitEndpoints(const float texels[4][16], const uint8_t indices[16], float e0[4], float e1[4]) {
+  float a = 0.0f, b = 0.0f, c = 0.0f;
+  float x0[4] = {};
+  float x1[4] = {};
+  for (int t = 0; t < 16; t++) {
+    const float w = kWeights4[indices[t]] / 64.0f;
+    a += (1.0f - w) * (1.0f - w);
+    b += (1.0f - w) * w;
+    c += w * w;
+    for (int ch = 0; ch < 4; ch++) {
+      x0[ch] += (1.0f - w) * texels[ch][t];
+      x1[ch] += w * texels[ch][t];
+    }
+  }
+  const float det = a * c - b * b;
+  if (std::abs(det) < 1e-6f) {
+    return false;
+  }
+  for (int ch = 0; ch < 4; ch++) {
+    e0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / det, 0.0f, 255.0f);
+    e1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / det, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+void encodeBC7(const uint8_t rgba[64], uint8_t* block) {
+  float texels[4][16];
+  for (int t = 0; t < 16; t++) {
+    for (int c = 0; c < 4; c++) {
+      texels[c][t] = rgba[t * 4 + c];
+    }
+  }
+  float e0[4], e1[4];
+  fitPrincipalAxis(texels, e0, e1);
+  Bc7Endpoints best;
+  quantizeEndpoint(e0, best, 0);
+  quantizeEndpoint(e1, best, 1);
+  uint8_t bestIndices[16];
+  float bestError = findIndices(texels, best, bestIndices);
+
+  // Two rounds of refitting the endpoints to the chosen indices
+  for (int iteration = 0; iteration < 2 && bestError > 0.0f; iteration++) {
+    if (!refitEndpoints(texels, bestIndices, e0, e1)) {
+      break;
+    }
+    Bc7Endpoints candidate;
+    quantizeEndpoint(e0, candidate, 0);
+    quantizeEndpoint(e1, candidate, 1);
+    uint8_t indices[16];
+    const float error = findIndices(texels, candidate, indices);
+    if (error >= bestError) {
+      break;
+    }
+    best = candidate;
+    memcpy(bestIndices, indices, sizeof(indices));
+    bestError = error;
+  }
+
+  // The top bit of the first texel's index is implied 0, swapping the endpoints mirrors the weights
+  if (bestIndices[0] & 8) {
+    std::swap(best.quantized[0], best.quantized[1]);
+    std::swap(best.pbit[0], best.pbit[1]);
+    for (uint8_t& index : bestIndices) {
+      index = static_cast<uint8_t>(15 - index);
+    }
+  }
+
+  memset(block, 0, 16);
+  BitWriter writer{block};
+  writer.write(1u << 6, 7);  // mode 6
+  for (int c = 0; c < 4; c++) {
+    writer.write(best.quantized[0][c], 7);
+    writer.write(best.quantized[1][c], 7);
+  }
+  writer.write(best.pbit[0], 1);
+  writer.write(best.pbit[1], 1);
+  writer.write(bestIndices[0], 3);
+  for (int t = 1; t < 16; t++) {
+    writer.write(bestIndices[t], 4);
+  }
+}
+
+void decodeBC7(const uint8_t* block, uint8_t texels[64]) {
+  if ((block[0] & 0x7f) != 0x40) {
+    memset(texels, 0, 64);
+    return;
+  }
+  BitReader reader{block};
+  reader.read(7);
+  int quantized[2][4];
+  for (int c = 0; c < 4; c++) {
+    quantized[0][c] = static_cast<int>(reader.read(7));
+    quantized[1][c] = static_cast<int>(reader.read(7));
+  }
+  const int pbit[2] = {static_cast<int>(reader.read(1)), static_cast<int>(reader.read(1))};
+  for (int t = 0; t < 16; t++) {
+    const int w = kWeights4[reader.read(t == 0 ? 3 : 4)];
+    for (int c = 0; c < 4; c++) {
+      const int v0 = (quantized[0][c] << 1) | pbit[0];
+      const int v1 = (quantized[1][c] << 1) | pbit[1];
+      texels[t * 4 + c] = static_cast<uint8_t>(((64 - w) * v0 + w * v1 + 32) >> 6);
+    }
+  }
+}
+}  // namespace
+
+uint32_t blockBytes(Format format) { return format == Format::BC4 ? 8 : 16; }
+
+size_t compressedSize(uint32_t width, uint32_t height, Format format) {
+  return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void encodeBlock(const uint8_t texels[64], Format format, uint8_t* block) {
+  switch (format) {
+    case Format::BC4:
+      encodeBC4(texels, 0, block);
+      break;
+    case Format::BC5:
+      encodeBC4(texels, 0, block);
+      encodeBC4(texels, 1, block + 8);
+      break;
+    case Format::BC7:
+      encodeBC7(texels, block);
+      break;
+  }
+}
+
+void decodeBlock(const uint8_t* block, Format format, uint8_t texels[64]) {
+  if (format == Format::BC7) {
+    decodeBC7(block, texels);
+    return;
+  }
+  for (int t = 0; t < 16; t++) {
+    texels[t * 4 + 0] = texels[t * 4 + 1] = texels[t * 4 + 2] = 0;
+    texels[t * 4 + 3] = 255;
+  }
+  decodeBC4(block, 0, texels);
+  if (format == Format::BC5) {
+    decodeBC4(block + 8, 1, texels);
+  }
+}
+
+std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, Format format, uint32_t threadCount) {
+  const uint32_t blocksX = (width + 3) / 4;
+  const uint32_t blocksY = (height + 3) / 4;
+  const uint32_t bytes = blockBytes(format);
+  std::vector<uint8_t> blocks(compressedSize(width, height, format));
+
+  std::atomic<uint32_t> nextRow{0};
+  auto worker = [&]() {
+    uint8_t texels[64];
+    for (uint32_t by = nextRow++; by < blocksY; by = nextRow++) {
+      for (uint32_t bx = 0; bx < blocksX; bx++) {
+        for (uint32_t y = 0; y < 4; y++) {
+          const uint32_t sy = std::min(by * 4 + y, height - 1);
+          for (uint32_t x = 0; x < 4; x++) {
+            const uint32_t sx = std::min(bx * 4 + x, width - 1);
+            memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+          }
+        }
+        encodeBlock(texels, format, blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * bytes);
+      }
+    }
+  };
+
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::max(1u, std::min(threadCount, blocksY));
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < threadCount; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();  // the calling thread takes rows as well
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return blocks;
+}
+
+std::vector<uint8_t> decompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, Format format) {
+  const uint32_t blocksX = (width + 3) / 4;
+  const uint32_t blocksY = (height + 3) / 4;
+  std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+  uint8_t texels[64];
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      decodeBlock(blocks + (static_cast<size_t>(by) * blocksX + bx) * blockBytes(format), format, texels);
+      for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+          memcpy(rgba.data() + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+        }
+      }
+    }
+  }
+  return rgba;
+}
+
+float rmsError(const uint8_t* reference, const uint8_t* result, size_t texelCount, Format format) {
+  const uint32_t channels = format == Format::BC4 ? 1 : (format == Format::BC5 ? 2 : 4);
+  double sum = 0.0;
+  for (size_t i = 0; i < texelCount; i++) {
+    for (uint32_t c = 0; c < channels; c++) {
+      const double d = static_cast<double>(reference[i * 4 + c]) - result[i * 4 + c];
+      sum += d * d;
+    }
+  }
+  return texelCount > 0 ? static_cast<float>(std::sqrt(sum / (texelCount * channels))) : 0.0f;
+}
+
+int simdWidth() {
+#if defined(TAK_BC_SSE2)
+  return 4;
+#else
+  return 1;
+#endif
+}
+
+}  // namespace BlockCompressor
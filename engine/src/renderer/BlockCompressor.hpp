@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BC4 / BC5 / BC7 block compression of RGBA8 images on the CPU
+// Blocks are 4x4 texels, partial blocks at the right and bottom edge repeat the last column/row
+namespace BlockCompressor {
+
+enum class Format {
+  BC4,  // R, 8 bytes per block (single channel data such as occlusion)
+  BC5,  // R and G, 16 bytes per block (tangent space normals, z is reconstructed in the shader)
+  BC7,  // RGBA, 16 bytes per block, mode 6 only (one subset, 7.7.7.7 endpoints with p-bits, 4 bit indices)
+};
+
+uint32_t blockBytes(Format format);
+size_t compressedSize(uint32_t width, uint32_t height, Format format);
+
+// One block from 16 RGBA8 texels, row by row
+void encodeBlock(const uint8_t texels[64], Format format, uint8_t* block);
+// Channels the format does not store decode as 0 (alpha as 255), BC7 blocks other than mode 6 decode to zero
+void decodeBlock(const uint8_t* block, Format format, uint8_t texels[64]);
+
+// Whole image, split across threads by rows of blocks
+// threadCount 0 uses std::thread::hardware_concurrency
+std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, Format format, uint32_t threadCount = 0);
+std::vector<uint8_t> decompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, Format format);
+
+// Root mean square difference over the channels the format stores, in 8 bit units
+float rmsError(const uint8_t* reference, const uint8_t* result, size_t texelCount, Format format);
+
+// Texels per SIMD iteration of the BC7 index search in this build
+int simdWidth();
+
+}  // namespace BlockCompressor
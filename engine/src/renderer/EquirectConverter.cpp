@@ -0,0 +1,307 @@
+#include "EquirectConverter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TAK_EQUIRECT_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TAK_EQUIRECT_SSE2 1
+#endif
+
+namespace EquirectConverter {
+
+namespace {
+struct FaceOrientation {
+  glm::vec3 forward;
+  glm::vec3 up;
+  glm::vec3 right;
+};
+
+// Define orientation for each face (+X, -X, +Y, -Y, +Z, -Z)
+const FaceOrientation kFaceOrientations[6] = {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, -1}},  // +X
+    {{-1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  // -X
+    {{0, 1, 0}, {0, 0, -1}, {1, 0, 0}},  // +Y
+    {{0, -1, 0}, {0, 0, 1}, {1, 0, 0}},  // -Y
+    {{0, 0, 1}, {0, 1, 0}, {1, 0, 0}},   // +Z
+    {{0, 0, -1}, {0, 1, 0}, {-1, 0, 0}}  // -Z
+};
+
+constexpr float kPi = 3.14159265358979323846f;
+
+// Bilinear tap at source pixel coordinates, neighbours are clamped to the last row/column
+void sampleBilinear(const void* srcPixels, int srcWidth, int srcHeight, float srcX, float srcY, bool isHDR, void* dstPixel) {
+  int x0 = static_cast<int>(srcX);
+  int y0 = static_cast<int>(srcY);
+  int x1 = std::min(x0 + 1, srcWidth - 1);
+  int y1 = std::min(y0 + 1, srcHeight - 1);
+  float fx = srcX - x0;
+  float fy = srcY - y0;
+  size_t i00 = (static_cast<size_t>(y0) * srcWidth + x0) * 4;
+  size_t i10 = (static_cast<size_t>(y0) * srcWidth + x1) * 4;
+  size_t i01 = (static_cast<size_t>(y1) * srcWidth + x0) * 4;
+  size_t i11 = (static_cast<size_t>(y1) * srcWidth + x1) * 4;
+  for (int c = 0; c < 4; ++c) {
+    if (isHDR) {
+      const float* src = static_cast<const float*>(srcPixels);
+      float value = src[i00 + c] * (1 - fx) * (1 - fy) + src[i10 + c] * fx * (1 - fy) + src[i01 + c] * (1 - fx) * fy + src[i11 + c] * fx * fy;
+      static_cast<float*>(dstPixel)[c] = value;
+    } else {
+      const uint8_t* src = static_cast<const uint8_t*>(srcPixels);
+      float value = src[i00 + c] * (1 - fx) * (1 - fy) + src[i10 + c] * fx * (1 - fy) + src[i01 + c] * (1 - fx) * fy + src[i11 + c] * fx * fy;
+      static_cast<uint8_t*>(dstPixel)[c] = static_cast<uint8_t>(std::min(value + 0.5f, 255.0f));
+    }
+  }
+}
+
+#if defined(TAK_EQUIRECT_AVX2) || defined(TAK_EQUIRECT_SSE2)
+// Thin wrappers so the row kernel below is written once for both vector widths
+#if defined(TAK_EQUIRECT_AVX2)
+using Vec = __m256;
+constexpr int kLanes = 8;
+inline Vec set1(float v) { return _mm256_set1_ps(v); }
+inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+inline Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+inline Vec vmin(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+inline Vec vmax(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+inline Vec vsqrt(Vec a) { return _mm256_sqrt_ps(a); }
+inline Vec vand(Vec a, Vec b) { return _mm256_and_ps(a, b); }
+inline Vec vandnot(Vec a, Vec b) { return _mm256_andnot_ps(a, b); }
+inline Vec vor(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+inline Vec cmpgt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline Vec cmplt(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Vec ramp() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+inline void store(float* dst, Vec v) { _mm256_store_ps(dst, v); }
+#else
+using Vec = __m128;
+constexpr int kLanes = 4;
+inline Vec set1(float v) { return _mm_set1_ps(v); }
+inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+inline Vec vmin(Vec a, Vec b) { return _mm_min_ps(a, b); }
+inline Vec vmax(Vec a, Vec b) { return _mm_max_ps(a, b); }
+inline Vec vsqrt(Vec a) { return _mm_sqrt_ps(a); }
+inline Vec vand(Vec a, Vec b) { return _mm_and_ps(a, b); }
+inline Vec vandnot(Vec a, Vec b) { return _mm_andnot_ps(a, b); }
+inline Vec vor(Vec a, Vec b) { return _mm_or_ps(a, b); }
+inline Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+inline Vec cmplt(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+inline Vec ramp() { return _mm_setr_ps(0, 1, 2, 3); }
+inline void store(float* dst, Vec v) { _mm_store_ps(dst, v); }
+#endif
+
+inline Vec select(Vec mask, Vec a, Vec b) { return vor(vand(mask, a), vandnot(mask, b)); }
+
+// atan2 from a degree 9 odd polynomial on [0, 1] (Abramowitz & Stegun 4.4.49, |error| <= 1e-5 rad) plus octant fix-up
+Vec fastAtan2(Vec y, Vec x) {
+  const Vec signMask = set1(-0.0f);
+  Vec ax = vandnot(signMask, x);
+  Vec ay = vandnot(signMask, y);
+  Vec a = div(vmin(ax, ay), vmax(vmax(ax, ay), set1(FLT_MIN)));
+  Vec s = mul(a, a);
+  Vec p = set1(0.0208351f);
+  p = add(mul(p, s), set1(-0.0851330f));
+  p = add(mul(p, s), set1(0.1801410f));
+  p = add(mul(p, s), set1(-0.3302995f));
+  p = add(mul(p, s), set1(0.9998660f));
+  Vec r = mul(p, a);
+  r = select(cmpgt(ay, ax), sub(set1(kPi * 0.5f), r), r);
+  r = select(cmplt(x, set1(0.0f)), sub(set1(kPi), r), r);
+  return vor(r, vand(y, signMask));  // r >= 0 here, copy the sign of y
+}
+
+inline __m128 lerp4(__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); }
+
+inline __m128 loadTexel(const void* srcPixels, size_t index, bool isHDR) {
+  if (isHDR) {
+    return _mm_loadu_ps(static_cast<const float*>(srcPixels) + index);
+  }
+  int packed;
+  std::memcpy(&packed, static_cast<const uint8_t*>(srcPixels) + index, sizeof(packed));
+  __m128i zero = _mm_setzero_si128();
+  __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+  return _mm_cvtepi32_ps(wide);
+}
+
+inline void storeTexel(void* dstFaceData, size_t index, __m128 value, bool isHDR) {
+  if (isHDR) {
+    _mm_storeu_ps(static_cast<float*>(dstFaceData) + index, value);
+    return;
+  }
+  __m128i rounded = _mm_cvtps_epi32(value);  // round to nearest, values are already in [0, 255]
+  __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), _mm_setzero_si128());
+  int packed = _mm_cvtsi128_si32(bytes);
+  std::memcpy(static_cast<uint8_t*>(dstFaceData) + index, &packed, sizeof(packed));
+}
+#endif
+}  // namespace
+
+void convertFaceScalar(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex, int faceSize, bool isHDR) {
+  const FaceOrientation& orient = kFaceOrientations[faceIndex];
+  const size_t pixelSize = isHDR ? sizeof(float) * 4 : 4;
+  for (int y = 0; y < faceSize; ++y) {
+    for (int x = 0; x < faceSize; ++x) {
+      // Calculate normalized coordinates [-1, 1]
+      float u = (2.0f * x / (faceSize - 1)) - 1.0f;
+      float v = (2.0f * y / (faceSize - 1)) - 1.0f;
+
+      // Calculate direction vector for this pixel
+      glm::vec3 dir = glm::normalize(orient.forward + orient.right * u + orient.up * -v);  // Flip Y
+
+      // Convert direction to spherical coordinates
+      float theta = std::atan2(dir.z, dir.x);  // Horizontal angle
+      float phi = std::asin(dir.y);            // Vertical angle
+
+      // Convert to equirectangular UV coordinates
+      float equirectU = (theta + kPi) / (2.0f * kPi);
+      float equirectV = (phi + kPi * 0.5f) / kPi;
+
+      sampleBilinear(srcPixels, srcWidth, srcHeight, equirectU * (srcWidth - 1), equirectV * (srcHeight - 1), isHDR,
+                     static_cast<uint8_t*>(dstFaceData) + (static_cast<size_t>(y) * faceSize + x) * pixelSize);
+    }
+  }
+}
+
+void convertRowsSimd(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex, int faceSize, bool isHDR,
+                     int rowBegin, int rowEnd) {
+#if defined(TAK_EQUIRECT_AVX2) || defined(TAK_EQUIRECT_SSE2)
+  const FaceOrientation& orient = kFaceOrientations[faceIndex];
+  const float uScale = 2.0f / (faceSize - 1);
+  const Vec maxX = set1(static_cast<float>(srcWidth - 1));
+  const Vec maxY = set1(static_cast<float>(srcHeight - 1));
+  const Vec zero = set1(0.0f);
+  alignas(32) float srcX[kLanes];
+  alignas(32) float srcY[kLanes];
+
+  for (int y = rowBegin; y < rowEnd; ++y) {
+    // Direction = base + right * u, atan2 does not care about its length so it is never normalized
+    float v = (2.0f * y / (faceSize - 1)) - 1.0f;
+    glm::vec3 base = orient.forward - orient.up * v;
+    for (int x = 0; x < faceSize; x += kLanes) {
+      Vec u = sub(mul(add(set1(static_cast<float>(x)), ramp()), set1(uScale)), set1(1.0f));
+      Vec dx = add(set1(base.x), mul(set1(orient.right.x), u));
+      Vec dy = add(set1(base.y), mul(set1(orient.right.y), u));
+      Vec dz = add(set1(base.z), mul(set1(orient.right.z), u));
+
+      Vec theta = fastAtan2(dz, dx);
+      Vec phi = fastAtan2(dy, vsqrt(add(mul(dx, dx), mul(dz, dz))));  // asin(dy / |d|)
+
+      Vec equirectU = mul(add(theta, set1(kPi)), set1(0.5f / kPi));
+      Vec equirectV = mul(add(phi, set1(kPi * 0.5f)), set1(1.0f / kPi));
+      store(srcX, vmin(vmax(mul(equirectU, maxX), zero), maxX));
+      store(srcY, vmin(vmax(mul(equirectV, maxY), zero), maxY));
+
+      // Taps are gathered per pixel, all four channels of a texel in one register
+      int lanes = std::min(kLanes, faceSize - x);
+      for (int lane = 0; lane < lanes; ++lane) {
+        int x0 = static_cast<int>(srcX[lane]);
+        int y0 = static_cast<int>(srcY[lane]);
+        int x1 = std::min(x0 + 1, srcWidth - 1);
+        int y1 = std::min(y0 + 1, srcHeight - 1);
+        __m128 fx = _mm_set1_ps(srcX[lane] - x0);
+        __m128 fy = _mm_set1_ps(srcY[lane] - y0);
+        __m128 p00 = loadTexel(srcPixels, (static_cast<size_t>(y0) * srcWidth + x0) * 4, isHDR);
+        __m128 p10 = loadTexel(srcPixels, (static_cast<size_t>(y0) * srcWidth + x1) * 4, isHDR);
+        __m128 p01 = loadTexel(srcPixels, (static_cast<size_t>(y1) * srcWidth + x0) * 4, isHDR);
+        __m128 p11 = loadTexel(srcPixels, (static_cast<size_t>(y1) * srcWidth + x1) * 4, isHDR);
+        __m128 value = lerp4(lerp4(p00, p10, fx), lerp4(p01, p11, fx), fy);
+        storeTexel(dstFaceData, (static_cast<size_t>(y) * faceSize + x + lane) * 4, value, isHDR);
+      }
+    }
+  }
+#else
+  // No SIMD in this build, same math one pixel at a time
+  const FaceOrientation& orient = kFaceOrientations[faceIndex];
+  const size_t pixelSize = isHDR ? sizeof(float) * 4 : 4;
+  for (int y = rowBegin; y < rowEnd; ++y) {
+    float v = (2.0f * y / (faceSize - 1)) - 1.0f;
+    for (int x = 0; x < faceSize; ++x) {
+      float u = (2.0f * x / (faceSize - 1)) - 1.0f;
+      glm::vec3 dir = orient.forward + orient.right * u - orient.up * v;
+      float theta = std::atan2(dir.z, dir.x);
+      float phi = std::atan2(dir.y, std::sqrt(dir.x * dir.x + dir.z * dir.z));
+      float srcX = std::clamp((theta + kPi) / (2.0f * kPi) * (srcWidth - 1), 0.0f, static_cast<float>(srcWidth - 1));
+      float srcY = std::clamp((phi + kPi * 0.5f) / kPi * (srcHeight - 1), 0.0f, static_cast<float>(srcHeight - 1));
+      sampleBilinear(srcPixels, srcWidth, srcHeight, srcX, srcY, isHDR,
+                     static_cast<uint8_t*>(dstFaceData) + (static_cast<size_t>(y) * faceSize + x) * pixelSize);
+    }
+  }
+#endif
+}
+
+void convertCubemap(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaces, int faceSize, bool isHDR, uint32_t threadCount) {
+  const int bandRows = 32;
+  const int bandsPerFace = (faceSize + bandRows - 1) / bandRows;
+  const uint32_t taskCount = static_cast<uint32_t>(6 * bandsPerFace);
+  const size_t faceBytes = static_cast<size_t>(faceSize) * faceSize * (isHDR ? sizeof(float) * 4 : 4);
+
+  std::atomic<uint32_t> nextTask{0};
+  auto worker = [&]() {
+    for (uint32_t task = nextTask++; task < taskCount; task = nextTask++) {
+      int face = static_cast<int>(task) / bandsPerFace;
+      int rowBegin = (static_cast<int>(task) % bandsPerFace) * bandRows;
+      int rowEnd = std::min(rowBegin + bandRows, faceSize);
+      convertRowsSimd(srcPixels, srcWidth, srcHeight, static_cast<uint8_t*>(dstFaces) + face * faceBytes, face, faceSize, isHDR, rowBegin,
+                      rowEnd);
+    }
+  };
+
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::min(threadCount, taskCount);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < threadCount; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();  // the calling thread takes bands as well
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+float maxRelativeError(const void* reference, const void* result, size_t pixelCount, bool isHDR) {
+  const size_t count = pixelCount * 4;
+  float range = 255.0f;
+  float maxError = 0.0f;
+  if (isHDR) {
+    const float* a = static_cast<const float*>(reference);
+    const float* b = static_cast<const float*>(result);
+    range = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+      range = std::max(range, std::abs(a[i]));
+      maxError = std::max(maxError, std::abs(a[i] - b[i]));
+    }
+  } else {
+    const uint8_t* a = static_cast<const uint8_t*>(reference);
+    const uint8_t* b = static_cast<const uint8_t*>(result);
+    for (size_t i = 0; i < count; ++i) {
+      maxError = std::max(maxError, static_cast<float>(std::abs(a[i] - b[i])));
+    }
+  }
+  return range > 0.0f ? maxError / range : maxError;
+}
+
+int simdWidth() {
+#if defined(TAK_EQUIRECT_AVX2) || defined(TAK_EQUIRECT_SSE2)
+  return kLanes;
+#else
+  return 1;
+#endif
+}
+
+}  // namespace EquirectConverter
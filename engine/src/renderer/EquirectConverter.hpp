@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Equirectangular panorama -> cubemap face conversion on the CPU
+// Pixels are RGBA, float when isHDR, 8 bit unorm otherwise. Face order +X, -X, +Y, -Y, +Z, -Z
+namespace EquirectConverter {
+
+// Scalar reference, one pixel at a time with std::atan2 / std::asin
+void convertFaceScalar(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex, int faceSize, bool isHDR);
+
+// Rows [rowBegin, rowEnd) of one face, 8 (AVX2) or 4 (SSE2) pixels per iteration with polynomial atan2
+void convertRowsSimd(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex, int faceSize, bool isHDR,
+                     int rowBegin, int rowEnd);
+
+// All six faces into dstFaces (faces packed back to back), split across threads by face and row band
+// threadCount 0 uses std::thread::hardware_concurrency
+void convertCubemap(const void* srcPixels, int srcWidth, int srcHeight, void* dstFaces, int faceSize, bool isHDR, uint32_t threadCount = 0);
+
+// Largest per-channel difference between two conversions, in units of the largest channel value of reference
+float maxRelativeError(const void* reference, const void* result, size_t pixelCount, bool isHDR);
+
+// Pixels processed per SIMD iteration in this build
+int simdWidth();
+
+}  // namespace EquirectConverter
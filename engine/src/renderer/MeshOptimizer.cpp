@@ -0,0 +1,582 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+namespace MeshOptimizer {
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+  VertexCacheStats stats{};
+  if (indices.size() < 3) {
+    return stats;
+  }
+  // timestamp of the vertex entering the cache, a vertex is resident while fewer than cacheSize misses happened since
+  std::vector<uint32_t> cachedAt(vertexCount, 0);
+  std::vector<bool> referenced(vertexCount, false);
+  uint32_t misses = 0;
+  uint32_t uniqueVertices = 0;
+  for (uint32_t index : indices) {
+    if (!referenced[index]) {
+      referenced[index] = true;
+      uniqueVertices++;
+    }
+    if (cachedAt[index] == 0 || misses - cachedAt[index] + 1 > cacheSize) {
+      misses++;
+      cachedAt[index] = misses;
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+  return stats;
+}
+
+// ============= Vertex cache =============
+namespace {
+constexpr uint32_t kCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+float vertexScore(int32_t cachePosition, uint32_t remainingValence) {
+  if (remainingValence == 0) {
+    return -1.0f;  // no triangles left, never picked again
+  }
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // Vertices of the last triangle get a fixed score so the strip-like walk does not favour one of them
+      score = kLastTriScore;
+    } else {
+      float scaler = 1.0f / (kCacheSize - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+    }
+  }
+  // Favour vertices with few triangles left so they get finished and leave the cache
+  score += kValenceBoostScale * std::pow(static_cast<float>(remainingValence), -kValenceBoostPower);
+  return score;
+}
+}  // namespace
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+  // vertex -> triangle adjacency (CSR)
+  std::vector<uint32_t> valence(vertexCount, 0);
+  for (uint32_t index : indices) {
+    valence[index]++;
+  }
+  std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+  for (size_t t = 0; t < triangleCount; t++) {
+    for (uint32_t c = 0; c < 3; c++) {
+      adjacency[fill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<uint32_t> remaining = valence;  // live triangles per vertex
+  std::vector<int32_t> cachePosition(vertexCount, -1);
+  std::vector<float> score(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    score[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangleScore(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+  }
+  std::vector<bool> emitted(triangleCount, false);
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::array<uint32_t, kCacheSize + 3> cache{};
+  uint32_t cacheCount = 0;
+  size_t scanCursor = 0;  // triangles before it are all emitted, used when the cache has no candidate left
+
+  int64_t bestTriangle = -1;
+  for (size_t t = 0; t < triangleCount; t++) {
+    if (bestTriangle < 0 || triangleScore[t] > triangleScore[bestTriangle]) {
+      bestTriangle = static_cast<int64_t>(t);
+    }
+  }
+
+  while (bestTriangle >= 0) {
+    const size_t tri = static_cast<size_t>(bestTriangle);
+    emitted[tri] = true;
+    std::array<uint32_t, kCacheSize + 3> newCache{};
+    uint32_t newCount = 0;
+    for (uint32_t c = 0; c < 3; c++) {
+      uint32_t v = indices[tri * 3 + c];
+      result.push_back(v);
+      newCache[newCount++] = v;
+      // drop the triangle from the vertex's live list
+      uint32_t begin = adjacencyOffset[v];
+      uint32_t end = begin + remaining[v];
+      for (uint32_t a = begin; a < end; a++) {
+        if (adjacency[a] == tri) {
+          std::swap(adjacency[a], adjacency[end - 1]);
+          break;
+        }
+      }
+      remaining[v]--;
+    }
+    // LRU: emitted vertices move to the front, the rest keep their order
+    for (uint32_t i = 0; i < cacheCount; i++) {
+      uint32_t v = cache[i];
+      if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+        newCache[newCount++] = v;
+      }
+    }
+    // Update scores of everything that was or is in the cache
+    for (uint32_t i = 0; i < newCount; i++) {
+      uint32_t v = newCache[i];
+      cachePosition[v] = i < kCacheSize ? static_cast<int32_t>(i) : -1;
+      score[v] = vertexScore(cachePosition[v], remaining[v]);
+    }
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (uint32_t i = 0; i < newCount; i++) {
+      uint32_t v = newCache[i];
+      for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v] + remaining[v]; a++) {
+        uint32_t t = adjacency[a];
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          bestTriangle = t;
+        }
+      }
+    }
+    cacheCount = std::min(newCount, kCacheSize);
+    std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+
+    if (bestTriangle < 0) {
+      // Cache ran dry (disconnected piece finished), continue with the next triangle not yet emitted
+      while (scanCursor < triangleCount && emitted[scanCursor]) {
+        scanCursor++;
+      }
+      if (scanCursor < triangleCount) {
+        bestTriangle = static_cast<int64_t>(scanCursor);
+      }
+    }
+  }
+  indices.swap(result);
+}
+
+// ============= Overdraw =============
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+  const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+  const float originalAcmr = analyzeVertexCache(indices, vertexCount).acmr;
+
+  // Hard boundaries: a triangle whose three vertices all miss the cache starts a new cluster
+  std::vector<size_t> clusterStart;
+  {
+    const uint32_t cacheSize = 16;
+    std::vector<uint32_t> cachedAt(vertexCount, 0);
+    uint32_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+      uint32_t triangleMisses = 0;
+      for (uint32_t c = 0; c < 3; c++) {
+        uint32_t v = indices[t * 3 + c];
+        if (cachedAt[v] == 0 || misses - cachedAt[v] + 1 > cacheSize) {
+          misses++;
+          cachedAt[v] = misses;
+          triangleMisses++;
+        }
+      }
+      if (t == 0 || triangleMisses == 3) {
+        clusterStart.push_back(t);
+      }
+    }
+  }
+  if (clusterStart.size() < 2) {
+    return;
+  }
+
+  glm::vec3 meshCentroid(0.0f);
+  for (const glm::vec3& p : positions) {
+    meshCentroid += p;
+  }
+  meshCentroid /= static_cast<float>(std::max<size_t>(positions.size(), 1));
+
+  // Clusters facing away from the mesh center are likely to occlude the rest, draw them first
+  const size_t clusterCount = clusterStart.size();
+  std::vector<float> sortKey(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++) {
+    size_t begin = clusterStart[c];
+    size_t end = c + 1 < clusterCount ? clusterStart[c + 1] : triangleCount;
+    glm::vec3 centroid(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (size_t t = begin; t < end; t++) {
+      const glm::vec3& p0 = positions[indices[t * 3]];
+      const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+      const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);  // length = 2 * area
+      float triangleArea = glm::length(n);
+      centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+      normal += n;
+      area += triangleArea;
+    }
+    centroid = area > 0.0f ? centroid / area : positions[indices[begin * 3]];
+    float normalLength = glm::length(normal);
+    sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+  }
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (size_t c : order) {
+    size_t begin = clusterStart[c] * 3;
+    size_t end = (c + 1 < clusterCount ? clusterStart[c + 1] : triangleCount) * 3;
+    sorted.insert(sorted.end(), indices.begin() + begin, indices.begin() + end);
+  }
+  if (analyzeVertexCache(sorted, vertexCount).acmr <= originalAcmr * threshold) {
+    indices.swap(sorted);
+  }
+}
+
+// ============= Vertex fetch =============
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount) {
+  const uint32_t unassigned = ~0u;
+  std::vector<uint32_t> remap(vertexCount, unassigned);
+  uint32_t next = 0;
+  for (uint32_t& index : indices) {
+    if (remap[index] == unassigned) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  for (uint32_t& r : remap) {
+    if (r == unassigned) {
+      r = next++;
+    }
+  }
+  return remap;
+}
+
+// ============= Simplification =============
+namespace {
+// Symmetric 4x4 error quadric, evaluates the weighted sum of squared distances to a set of planes
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+  double weight = 0;  // summed plane weights, error / weight is a mean squared distance
+  void addPlane(double a, double b, double c, double d, double w) {
+    a00 += w * a * a, a01 += w * a * b, a02 += w * a * c, a03 += w * a * d;
+    a11 += w * b * b, a12 += w * b * c, a13 += w * b * d;
+    a22 += w * c * c, a23 += w * c * d;
+    a33 += w * d * d;
+    weight += w;
+  }
+  void add(const Quadric& q) {
+    a00 += q.a00, a01 += q.a01, a02 += q.a02, a03 += q.a03, a11 += q.a11, a12 += q.a12, a13 += q.a13, a22 += q.a22, a23 += q.a23, a33 += q.a33;
+    weight += q.weight;
+  }
+  double error(const glm::vec3& p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y + a22 * z * z +
+               2 * a23 * z + a33;
+    return e > 0.0 ? e : 0.0;
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double error;     // area weighted, orders the collapses
+  double distance;  // squared, normalized by the quadric weight
+};
+
+// Moving `from` to `to` must not flip any remaining triangle around `from`
+bool collapseFlips(uint32_t from, uint32_t to, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& adjacencyOffset,
+                   const std::vector<uint32_t>& adjacency, const std::vector<glm::vec3>& positions) {
+  for (uint32_t a = adjacencyOffset[from]; a < adjacencyOffset[from + 1]; a++) {
+    uint32_t t = adjacency[a];
+    uint32_t i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+    if (i0 == to || i1 == to || i2 == to) {
+      continue;  // this triangle collapses away
+    }
+    glm::vec3 p0 = positions[i0], p1 = positions[i1], p2 = positions[i2];
+    glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+    if (i0 == from) p0 = positions[to];
+    if (i1 == from) p1 = positions[to];
+    if (i2 == from) p2 = positions[to];
+    glm::vec3 after = glm::cross(p1 - p0, p2 - p0);
+    if (glm::dot(before, after) <= 0.0f) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+std::vector<uint32_t> simplify(const std::vector<uint32_t>& sourceIndices, const std::vector<glm::vec3>& positions, size_t targetIndexCount,
+                               float* resultError) {
+  const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+  std::vector<uint32_t> indices = sourceIndices;
+  double maxError = 0.0;
+
+  // Vertex quadrics from the planes of their triangles, area weighted
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    const glm::vec3& p0 = positions[indices[t]];
+    const glm::vec3& p1 = positions[indices[t + 1]];
+    const glm::vec3& p2 = positions[indices[t + 2]];
+    glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(n);
+    if (length <= 0.0f) {
+      continue;
+    }
+    n /= length;
+    double d = -glm::dot(n, p0);
+    for (uint32_t c = 0; c < 3; c++) {
+      quadrics[indices[t + c]].addPlane(n.x, n.y, n.z, d, length * 0.5);
+    }
+  }
+
+  // Border edges are used by one triangle only, their vertices never move
+  std::vector<bool> locked(vertexCount, false);
+  {
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+      for (uint32_t c = 0; c < 3; c++) {
+        uint32_t a = indices[t + c], b = indices[t + (c + 1) % 3];
+        edges.push_back({(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b), 1});
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+      size_t j = i;
+      while (j < edges.size() && edges[j].first == edges[i].first) j++;
+      if (j - i == 1) {
+        locked[static_cast<uint32_t>(edges[i].first >> 32)] = true;
+        locked[static_cast<uint32_t>(edges[i].first & 0xffffffffu)] = true;
+      }
+      i = j;
+    }
+  }
+
+  std::vector<uint32_t> remap(vertexCount);
+  while (indices.size() > targetIndexCount) {
+    // vertex -> triangle adjacency of the current mesh
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (uint32_t index : indices) adjacencyOffset[index + 1]++;
+    for (uint32_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < indices.size() / 3; t++) {
+      for (uint32_t c = 0; c < 3; c++) adjacency[fill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+    }
+
+    // Cheapest direction for every edge
+    std::vector<Collapse> collapses;
+    collapses.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+      for (uint32_t c = 0; c < 3; c++) {
+        uint32_t a = indices[t + c], b = indices[t + (c + 1) % 3];
+        if (a > b) continue;  // interior edges are seen from both triangles, border edges are locked anyway
+        Quadric q = quadrics[a];
+        q.add(quadrics[b]);
+        double errorAB = locked[a] ? DBL_MAX : q.error(positions[b]);
+        double errorBA = locked[b] ? DBL_MAX : q.error(positions[a]);
+        if (errorAB == DBL_MAX && errorBA == DBL_MAX) continue;
+        double error = std::min(errorAB, errorBA);
+        double distance = q.weight > 0.0 ? error / q.weight : 0.0;
+        collapses.push_back(errorAB <= errorBA ? Collapse{a, b, error, distance} : Collapse{b, a, error, distance});
+      }
+    }
+    if (collapses.empty()) {
+      break;
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.error < r.error; });
+
+    // Apply the cheapest independent collapses of this pass, each removes about two triangles
+    size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+    size_t collapseBudget = std::max<size_t>(1, std::min(collapses.size() / 3, (trianglesToRemove + 1) / 2));
+    std::iota(remap.begin(), remap.end(), 0);
+    std::vector<bool> touched(vertexCount, false);
+    size_t applied = 0;
+    for (const Collapse& collapse : collapses) {
+      if (applied >= collapseBudget) break;
+      if (touched[collapse.from] || touched[collapse.to]) continue;
+      if (collapseFlips(collapse.from, collapse.to, indices, adjacencyOffset, adjacency, positions)) continue;
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].add(quadrics[collapse.from]);
+      maxError = std::max(maxError, collapse.distance);
+      // Neighbours of both ends are frozen for this pass so flip checks stay valid
+      for (uint32_t v : {collapse.from, collapse.to}) {
+        for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; a++) {
+          uint32_t t = adjacency[a];
+          touched[indices[t * 3]] = touched[indices[t * 3 + 1]] = touched[indices[t * 3 + 2]] = true;
+        }
+      }
+      applied++;
+    }
+    if (applied == 0) {
+      break;
+    }
+
+    // Remap and drop triangles that became degenerate
+    size_t write = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+      uint32_t i0 = remap[indices[t]], i1 = remap[indices[t + 1]], i2 = remap[indices[t + 2]];
+      if (i0 != i1 && i1 != i2 && i0 != i2) {
+        indices[write++] = i0;
+        indices[write++] = i1;
+        indices[write++] = i2;
+      }
+    }
+    indices.resize(write);
+  }
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(maxError));
+  }
+  return indices;
+}
+
+// ============= Meshlets =============
+namespace {
+void computeMeshletBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions) {
+  const uint32_t first = meshlet.firstIndex;
+  const uint32_t count = meshlet.triangleCount * 3;
+
+  // Ritter: start from the two points farthest apart along the longest axis of the box, then grow
+  glm::vec3 minP(FLT_MAX), maxP(-FLT_MAX);
+  uint32_t minIndex[3] = {}, maxIndex[3] = {};
+  for (uint32_t i = first; i < first + count; i++) {
+    const glm::vec3& p = positions[indices[i]];
+    for (int a = 0; a < 3; a++) {
+      if (p[a] < minP[a]) minP[a] = p[a], minIndex[a] = indices[i];
+      if (p[a] > maxP[a]) maxP[a] = p[a], maxIndex[a] = indices[i];
+    }
+  }
+  int axis = 0;
+  for (int a = 1; a < 3; a++) {
+    if (glm::length(positions[maxIndex[a]] - positions[minIndex[a]]) > glm::length(positions[maxIndex[axis]] - positions[minIndex[axis]])) {
+      axis = a;
+    }
+  }
+  glm::vec3 center = (positions[minIndex[axis]] + positions[maxIndex[axis]]) * 0.5f;
+  float radius = glm::length(positions[maxIndex[axis]] - positions[minIndex[axis]]) * 0.5f;
+  for (uint32_t i = first; i < first + count; i++) {
+    const glm::vec3& p = positions[indices[i]];
+    float distance = glm::length(p - center);
+    if (distance > radius) {
+      float newRadius = (radius + distance) * 0.5f;
+      center += (p - center) * ((newRadius - radius) / distance);
+      radius = newRadius;
+    }
+  }
+  meshlet.center = center;
+  meshlet.radius = radius;
+
+  // Normal cone, axis is the normalized sum of unit normals and the cutoff comes from the widest normal
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet.triangleCount);
+  glm::vec3 axisSum(0.0f);
+  for (uint32_t i = first; i < first + count; i += 3) {
+    const glm::vec3& p0 = positions[indices[i]];
+    glm::vec3 n = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+    float length = glm::length(n);
+    if (length > 0.0f) {
+      normals.push_back(n / length);
+      axisSum += normals.back();
+    }
+  }
+  meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+  meshlet.coneCutoff = 1.0f;
+  float axisLength = glm::length(axisSum);
+  if (normals.empty() || axisLength <= 0.0f) {
+    return;
+  }
+  meshlet.coneAxis = axisSum / axisLength;
+  float minDot = 1.0f;
+  for (const glm::vec3& n : normals) {
+    minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+  }
+  // Cones wider than ~85 degrees are hardly ever back-facing as a whole, not worth the test
+  if (minDot > 0.1f) {
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+  }
+}
+}  // namespace
+
+std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, uint32_t maxVertices,
+                                   uint32_t maxTriangles) {
+  std::vector<Meshlet> meshlets;
+  std::vector<uint32_t> usedBy(positions.size(), UINT32_MAX);  // meshlet that last referenced the vertex
+  Meshlet current{};
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+    uint32_t newVertices = 0;
+    for (uint32_t c = 0; c < 3; c++) {
+      uint32_t v = indices[t + c];
+      bool duplicate = (c > 0 && indices[t] == v) || (c > 1 && indices[t + 1] == v);
+      if (usedBy[v] != meshletId && !duplicate) {
+        newVertices++;
+      }
+    }
+    if (current.triangleCount > 0 && (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)) {
+      computeMeshletBounds(current, indices, positions);
+      meshlets.push_back(current);
+      current = Meshlet{};
+      current.firstIndex = static_cast<uint32_t>(t);
+      meshletId++;
+      newVertices = 0;
+      for (uint32_t c = 0; c < 3; c++) {
+        uint32_t v = indices[t + c];
+        bool duplicate = (c > 0 && indices[t] == v) || (c > 1 && indices[t + 1] == v);
+        newVertices += duplicate ? 0 : 1;
+      }
+    }
+    for (uint32_t c = 0; c < 3; c++) {
+      usedBy[indices[t + c]] = meshletId;
+    }
+    current.vertexCount += newVertices;
+    current.triangleCount++;
+  }
+  if (current.triangleCount > 0) {
+    computeMeshletBounds(current, indices, positions);
+    meshlets.push_back(current);
+  }
+  return meshlets;
+}
+
+bool sameTriangles(const std::vector<uint32_t>& original, const std::vector<uint32_t>& optimized, const std::vector<uint32_t>& remap) {
+  if (original.size() != optimized.size()) {
+    return false;
+  }
+  // Rotate each triangle so the smallest index comes first, this keeps the winding
+  auto canonical = [](uint32_t a, uint32_t b, uint32_t c) {
+    if (b < a && b < c) return std::array<uint32_t, 3>{b, c, a};
+    if (c < a && c < b) return std::array<uint32_t, 3>{c, a, b};
+    return std::array<uint32_t, 3>{a, b, c};
+  };
+  std::vector<std::array<uint32_t, 3>> before;
+  std::vector<std::array<uint32_t, 3>> after;
+  before.reserve(original.size() / 3);
+  after.reserve(optimized.size() / 3);
+  for (size_t i = 0; i + 2 < original.size(); i += 3) {
+    before.push_back(canonical(remap[original[i]], remap[original[i + 1]], remap[original[i + 2]]));
+    after.push_back(canonical(optimized[i], optimized[i + 1], optimized[i + 2]));
+  }
+  std::sort(before.begin(), before.end());
+  std::sort(after.begin(), after.end());
+  return before == after;
+}
+
+}  // namespace MeshOptimizer
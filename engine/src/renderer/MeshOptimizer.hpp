@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Load-time index/vertex reordering for a single primitive
+// All indices are local to the primitive (0..vertexCount-1)
+namespace MeshOptimizer {
+
+struct VertexCacheStats {
+  float acmr = 0.0f;  // average cache miss ratio: transformed vertices per triangle (0.5 best, 3.0 worst)
+  float atvr = 0.0f;  // average transform to vertex ratio: transformed vertices per referenced vertex (1.0 best)
+};
+
+// FIFO post-transform cache simulation
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders triangles for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+// Splits the cache-optimized order into clusters at cache flushes and sorts them outward-facing first (Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw"), keeps the old order if ACMR grows by more than threshold
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+
+// Renumbers vertices in first-use order, returns remap[oldVertex] = newVertex, unreferenced vertices go last
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+// Quadric error metric edge collapse (Garland & Heckbert) onto existing vertices, so the vertex buffer is shared by all levels
+// Border edges (single triangle, includes uv/normal seams since those vertices are split) are locked to keep silhouettes and seams
+// Returns the simplified indices, resultError receives the largest collapse error as a distance in position units: the area
+// weighted RMS distance of the collapsed vertex to the planes it merged, independent of mesh scale and tessellation
+std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, size_t targetIndexCount,
+                               float* resultError = nullptr);
+
+// Cluster of consecutive triangles of an index list with its culling bounds
+struct Meshlet {
+  uint32_t firstIndex;  // into the index list the meshlet was built from
+  uint32_t triangleCount;
+  uint32_t vertexCount;
+  glm::vec3 center;  // bounding sphere
+  float radius;
+  glm::vec3 coneAxis;  // average triangle normal
+  float coneCutoff;    // back-facing for a viewer at v if dot(center - v, coneAxis) >= coneCutoff * |center - v| + radius, 1 disables
+};
+
+// Splits the (cache-optimized) index list into runs of at most maxVertices unique vertices and maxTriangles triangles,
+// so each meshlet stays a contiguous index range that can be copied into an ordinary indexed draw
+std::vector<Meshlet> buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, uint32_t maxVertices = 64,
+                                   uint32_t maxTriangles = 124);
+
+// True if optimized (after remap) contains exactly the triangles of original, same winding, any order/rotation
+bool sameTriangles(const std::vector<uint32_t>& original, const std::vector<uint32_t>& optimized, const std::vector<uint32_t>& remap);
+
+}  // namespace MeshOptimizer
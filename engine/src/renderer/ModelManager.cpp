@@ -2,9 +2,123 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Material slots a texture is referenced from, decides its block compressed format
+enum TextureUsage : uint32_t {
+  TEXTURE_USAGE_COLOR = 0x1,      // base color, emissive, specular-glossiness: sRGB
+  TEXTURE_USAGE_NORMAL = 0x2,     // tangent space xy, BC5
+  TEXTURE_USAGE_OCCLUSION = 0x4,  // red channel only, BC4
+  TEXTURE_USAGE_DATA = 0x8,       // metallic-roughness and other linear RGBA
+};
+
+// Block compressed mip chain as stored in <model>.bctex
+struct CachedTexture {
+  uint32_t textureIndex;
+  BlockCompressor::Format format;
+  uint64_t sourceHash;
+  TextureManager::MipChain chain;
+};
+
+const uint32_t textureCacheMagic = 0x43424b54;  // "TKBC"
+const uint32_t textureCacheVersion = 1;
+
+// The cache entry of a texture is only valid for the same pixels encoded the same way
+uint64_t textureSourceHash(const tinygltf::Image& image, BlockCompressor::Format format, bool srgb) {
+  uint64_t hash = 14695981039346656037ull;  // FNV-1a
+  auto hashBytes = [&hash](const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  const int32_t header[6] = {image.width, image.height, image.component, image.bits, static_cast<int32_t>(format), srgb ? 1 : 0};
+  hashBytes(header, sizeof(header));
+  hashBytes(image.image.data(), image.image.size());
+  return hash;
+}
+
+std::unordered_map<uint32_t, CachedTexture> readTextureCache(const std::string& cachePath) {
+  std::unordered_map<uint32_t, CachedTexture> entries;
+  std::ifstream cacheFile(cachePath, std::ios::binary);
+  uint32_t magic = 0, version = 0, entryCount = 0;
+  if (!(cacheFile.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && cacheFile.read(reinterpret_cast<char*>(&version), sizeof(version)) &&
+        cacheFile.read(reinterpret_cast<char*>(&entryCount), sizeof(entryCount)) && magic == textureCacheMagic && version == textureCacheVersion)) {
+    return entries;
+  }
+  for (uint32_t e = 0; e < entryCount && cacheFile; e++) {
+    CachedTexture entry;
+    uint32_t format = 0, vkFormat = 0, levelCount = 0;
+    cacheFile.read(reinterpret_cast<char*>(&entry.textureIndex), sizeof(entry.textureIndex));
+    cacheFile.read(reinterpret_cast<char*>(&format), sizeof(format));
+    cacheFile.read(reinterpret_cast<char*>(&entry.sourceHash), sizeof(entry.sourceHash));
+    cacheFile.read(reinterpret_cast<char*>(&vkFormat), sizeof(vkFormat));
+    cacheFile.read(reinterpret_cast<char*>(&entry.chain.width), sizeof(entry.chain.width));
+    cacheFile.read(reinterpret_cast<char*>(&entry.chain.height), sizeof(entry.chain.height));
+    cacheFile.read(reinterpret_cast<char*>(&levelCount), sizeof(levelCount));
+    if (!cacheFile || levelCount > 32) {
+      break;
+    }
+    entry.format = static_cast<BlockCompressor::Format>(format);
+    entry.chain.format = static_cast<VkFormat>(vkFormat);
+    entry.chain.levels.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+      const uint32_t width = std::max(1u, entry.chain.width >> level);
+      const uint32_t height = std::max(1u, entry.chain.height >> level);
+      entry.chain.levels[level].resize(BlockCompressor::compressedSize(width, height, entry.format));
+      cacheFile.read(reinterpret_cast<char*>(entry.chain.levels[level].data()), entry.chain.levels[level].size());
+    }
+    entries[entry.textureIndex] = std::move(entry);
+  }
+  if (!cacheFile) {
+    spdlog::warn("Texture compression cache {} is truncated, rebuilding", cachePath);
+    entries.clear();
+  }
+  return entries;
+}
 
-ModelManager::Model ModelManager::createModelFromFile(const std::string& filename, float scale) {
+void writeTextureCache(const std::string& cachePath, const std::vector<CachedTexture>& entries) {
+  std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+  if (!cacheFile) {
+    spdlog::warn("Could not write texture compression cache {}", cachePath);
+    return;
+  }
+  const uint32_t entryCount = static_cast<uint32_t>(entries.size());
+  cacheFile.write(reinterpret_cast<const char*>(&textureCacheMagic), sizeof(textureCacheMagic));
+  cacheFile.write(reinterpret_cast<const char*>(&textureCacheVersion), sizeof(textureCacheVersion));
+  cacheFile.write(reinterpret_cast<const char*>(&entryCount), sizeof(entryCount));
+  for (const CachedTexture& entry : entries) {
+    const uint32_t format = static_cast<uint32_t>(entry.format);
+    const uint32_t vkFormat = static_cast<uint32_t>(entry.chain.format);
+    const uint32_t levelCount = static_cast<uint32_t>(entry.chain.levels.size());
+    cacheFile.write(reinterpret_cast<const char*>(&entry.textureIndex), sizeof(entry.textureIndex));
+    cacheFile.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    cacheFile.write(reinterpret_cast<const char*>(&entry.sourceHash), sizeof(entry.sourceHash));
+    cacheFile.write(reinterpret_cast<const char*>(&vkFormat), sizeof(vkFormat));
+    cacheFile.write(reinterpret_cast<const char*>(&entry.chain.width), sizeof(entry.chain.width));
+    cacheFile.write(reinterpret_cast<const char*>(&entry.chain.height), sizeof(entry.chain.height));
+    cacheFile.write(reinterpret_cast<const char*>(&levelCount), sizeof(levelCount));
+    for (const std::vector<uint8_t>& level : entry.chain.levels) {
+      cacheFile.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+  }
+}
+
+}  // namespace
+
+ModelManager::Model ModelManager::createModelFromFile(const std::string& filename, float scale, uint32_t vertexFormats) {
   ModelManager::Model model;
   tinygltf::Model gltfModel;
   tinygltf::TinyGLTF gltfContext;
@@ -52,7 +166,7 @@ ModelManager::Model ModelManager::createModelFromFile(const std::string& filenam
     }
   }
   // load texture,sampler, and materials
-  loadTextures(model, gltfModel);
+  loadTextures(model, gltfModel, filename);
   loadMaterials(model, gltfModel);
   // load node
   tak::LoaderInfo loaderInfo{};
@@ -93,20 +207,42 @@ ModelManager::Model ModelManager::createModelFromFile(const std::string& filenam
       node->update();
     }
   }
+  if (optimizeMeshes) {
+    optimizeMeshData(model, loaderInfo, filename);
+  }
+  if (generateLods) {
+    generateMeshLods(model, loaderInfo);
+  }
+  if (generateMeshlets) {
+    buildMeshlets(model, loaderInfo);
+  }
   // fill vertex buffer
   size_t vertexBufferSize = vertexCount * sizeof(tak::Vertex);
-  size_t indexBufferSize = indexCount * sizeof(uint32_t);
+  size_t indexBufferSize = loaderInfo.indexBuffer.size() * sizeof(uint32_t);  // includes the LOD ranges
   assert(vertexBufferSize > 0);
   // gpu local buffer (TODO: make this batch to use one command buffer)
-  model.vertices = bufferManager->createGPULocalBuffer(loaderInfo.vertexBuffer.data(), vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-  model.indices = bufferManager->createGPULocalBuffer(loaderInfo.indexBuffer.data(), indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  // storage/transfer-src so compute pre-passes (e.g. skinning) can read and copy the source vertices
+  if (vertexFormats & VERTEX_FORMAT_FULL) {
+    model.vertices = bufferManager->createGPULocalBuffer(loaderInfo.vertexBuffer.data(), vertexBufferSize,
+                                                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  }
+  if (vertexFormats & VERTEX_FORMAT_PACKED) {
+    createPackedVertexBuffers(model, loaderInfo.vertexBuffer);
+  }
+  // storage/transfer-src so the meshlet culling pass can read the source indices and seed its output
+  model.indices = bufferManager->createGPULocalBuffer(loaderInfo.indexBuffer.data(), indexBufferSize,
+                                                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  if (!model.meshlets.clusters.empty()) {
+    model.meshlets.buffer = bufferManager->createGPULocalBuffer(model.meshlets.clusters.data(), model.meshlets.clusters.size() * sizeof(tak::Meshlet),
+                                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  }
 
   getSceneDimensions(model);
 
   return model;
 }
 
-void ModelManager::updateAnimation(ModelManager::Model& model, int index, float time) {
+void ModelManager::updateAnimation(ModelManager::Model& model, int index, float time, uint32_t maxJointDepth) {
   if (model.animations.empty()) {
     spdlog::info(".glTF does not contain animation.");
     return;
@@ -119,6 +255,10 @@ void ModelManager::updateAnimation(ModelManager::Model& model, int index, float
 
   bool updated = false;
   for (auto& channel : animation.channels) {
+    // Reduced joint set: deeper joints keep their last pose relative to their parent
+    if (channel.node->depth - animation.rootDepth > maxJointDepth) {
+      continue;
+    }
     tak::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
     if (sampler.inputs.size() > sampler.outputsVec4.size()) {
       continue;
@@ -151,10 +291,85 @@ void ModelManager::updateAnimation(ModelManager::Model& model, int index, float
   }
 }
 
-void ModelManager::loadTextures(Model& model, tinygltf::Model& gltfModel) {
+float ModelManager::projectedScreenSize(const Model& model, const glm::mat4& clipFromModel) {
+  // Largest extent of the mesh aabbs on screen as a fraction of the viewport, 0 when the model is outside the frustum
+  glm::vec2 ndcMin(FLT_MAX);
+  glm::vec2 ndcMax(-FLT_MAX);
+  bool visible = false;
+  for (auto node : model.linearNodes) {
+    if (!node->mesh || !node->mesh->aabb.valid) {
+      continue;
+    }
+    const tak::BoundingBox& aabb = node->mesh->aabb;
+    uint32_t outsideAll = 0x3f;  // frustum planes every corner is outside of
+    bool crossesNearPlane = false;
+    glm::vec2 meshMin(FLT_MAX);
+    glm::vec2 meshMax(-FLT_MAX);
+    for (uint32_t corner = 0; corner < 8; corner++) {
+      glm::vec3 p((corner & 1) ? aabb.max.x : aabb.min.x, (corner & 2) ? aabb.max.y : aabb.min.y, (corner & 4) ? aabb.max.z : aabb.min.z);
+      glm::vec4 clip = clipFromModel * glm::vec4(p, 1.0f);
+      uint32_t outside = 0;
+      outside |= (clip.x < -clip.w) ? 0x01 : 0;
+      outside |= (clip.x > clip.w) ? 0x02 : 0;
+      outside |= (clip.y < -clip.w) ? 0x04 : 0;
+      outside |= (clip.y > clip.w) ? 0x08 : 0;
+      outside |= (clip.z < 0.0f) ? 0x10 : 0;
+      outside |= (clip.z > clip.w) ? 0x20 : 0;
+      outsideAll &= outside;
+      if (clip.w <= 1e-4f) {
+        crossesNearPlane = true;
+        continue;
+      }
+      glm::vec2 ndc = glm::vec2(clip) / clip.w;
+      meshMin = glm::min(meshMin, ndc);
+      meshMax = glm::max(meshMax, ndc);
+    }
+    if (outsideAll != 0) {
+      continue;
+    }
+    visible = true;
+    if (crossesNearPlane) {
+      return 1.0f;  // camera is inside or right in front of the mesh
+    }
+    ndcMin = glm::min(ndcMin, glm::max(meshMin, glm::vec2(-1.0f)));
+    ndcMax = glm::max(ndcMax, glm::min(meshMax, glm::vec2(1.0f)));
+  }
+  if (!visible) {
+    return 0.0f;
+  }
+  glm::vec2 extent = (ndcMax - ndcMin) * 0.5f;
+  return std::max(extent.x, extent.y);
+}
+
+bool ModelManager::updateAnimationLod(Model& model, int index, float time, float deltaTime, const glm::mat4& clipFromModel, AnimationLodState& state,
+                                      const AnimationLodSettings& settings) {
+  state.screenSize = projectedScreenSize(model, clipFromModel);
+  state.visible = state.screenSize > 0.0f;
+  state.sinceUpdate += deltaTime;
+  if (!state.visible) {
+    return false;
+  }
+  // Update interval grows linearly from every frame at fullRateSize to 1 / minUpdateRate for a vanishing model
+  float coverage = std::min(state.screenSize / settings.fullRateSize, 1.0f);
+  float interval = (1.0f - coverage) / settings.minUpdateRate;
+  if (state.sinceUpdate < interval) {
+    return false;
+  }
+  state.sinceUpdate = 0.0f;
+  state.reducedJoints = state.screenSize < settings.reducedJointSize;
+  updateAnimation(model, index, time, state.reducedJoints ? settings.reducedJointDepth : UINT32_MAX);
+  return true;
+}
+
+void ModelManager::loadTextures(Model& model, tinygltf::Model& gltfModel, const std::string& filename) {
+  auto tStart = std::chrono::high_resolution_clock::now();
   // samplers
   model.textureSamplers = textureManager->loadTextureSamplers(gltfModel);
   // textures
+  TextureManager::TextureSampler texSamplerDefault = {VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                                                      VK_SAMPLER_ADDRESS_MODE_REPEAT};
+  std::vector<const tinygltf::Image*> images;
+  std::vector<TextureManager::TextureSampler> samplers;
   for (tinygltf::Texture& tex : gltfModel.textures) {
     int source = tex.source;
     // If this texture uses the KHR_texture_basisu, we need to get the source index from the extension structure
@@ -163,16 +378,205 @@ void ModelManager::loadTextures(Model& model, tinygltf::Model& gltfModel) {
       auto value = ext->second.Get("source");
       source = value.Get<int>();
     }
-    tinygltf::Image image = gltfModel.images[source];
+    const tinygltf::Image& image = gltfModel.images[source];
     spdlog::info("Image #{} validated: '{}' ({}), {}x{}, {} components, {} bytes", source, image.name.empty() ? "unnamed" : image.name,
                  image.uri.empty() ? "embedded" : image.uri, image.width, image.height, image.component, image.image.size());
-    if (tex.sampler > -1) {
-      model.textures.push_back(textureManager->createTextureFromGLTFImage(image, model.filePath, model.textureSamplers[tex.sampler], context->graphicsQueue));
+    images.push_back(&image);
+    samplers.push_back(tex.sampler > -1 ? model.textureSamplers[tex.sampler] : texSamplerDefault);
+  }
+
+  // Material usage decides the encoding: color is sRGB (mips averaged in linear space), normals need two channels and
+  // occlusion one, everything else keeps all four
+  std::vector<uint32_t> usage(images.size(), 0);
+  auto markUsage = [&](int index, uint32_t flag) {
+    if (index >= 0 && index < static_cast<int>(usage.size())) {
+      usage[index] |= flag;
+    }
+  };
+  for (tinygltf::Material& mat : gltfModel.materials) {
+    if (mat.values.find("baseColorTexture") != mat.values.end()) {
+      markUsage(mat.values.at("baseColorTexture").TextureIndex(), TEXTURE_USAGE_COLOR);
+    }
+    if (mat.values.find("metallicRoughnessTexture") != mat.values.end()) {
+      markUsage(mat.values.at("metallicRoughnessTexture").TextureIndex(), TEXTURE_USAGE_DATA);
+    }
+    if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) {
+      markUsage(mat.additionalValues.at("normalTexture").TextureIndex(), TEXTURE_USAGE_NORMAL);
+    }
+    if (mat.additionalValues.find("occlusionTexture") != mat.additionalValues.end()) {
+      markUsage(mat.additionalValues.at("occlusionTexture").TextureIndex(), TEXTURE_USAGE_OCCLUSION);
+    }
+    if (mat.additionalValues.find("emissiveTexture") != mat.additionalValues.end()) {
+      markUsage(mat.additionalValues.at("emissiveTexture").TextureIndex(), TEXTURE_USAGE_COLOR);
+    }
+    auto ext = mat.extensions.find("KHR_materials_pbrSpecularGlossiness");
+    if (ext != mat.extensions.end()) {
+      for (const char* name : {"diffuseTexture", "specularGlossinessTexture"}) {
+        if (ext->second.Has(name)) {
+          markUsage(ext->second.Get(name).Get("index").Get<int>(), TEXTURE_USAGE_COLOR);
+        }
+      }
+    }
+  }
+  std::vector<bool> srgb(images.size(), false);
+  std::vector<std::optional<BlockCompressor::Format>> blockFormats(images.size());
+  std::vector<uint32_t> jobs;  // textures decoded into a mip chain, the rest uploads straight from the tinygltf image
+  for (uint32_t i = 0; i < images.size(); i++) {
+    srgb[i] = (usage[i] & TEXTURE_USAGE_COLOR) != 0;
+    if (compressTextures && !TextureManager::isKtx2Image(*images[i])) {
+      const BlockCompressor::Format format = usage[i] == TEXTURE_USAGE_NORMAL      ? BlockCompressor::Format::BC5
+                                             : usage[i] == TEXTURE_USAGE_OCCLUSION ? BlockCompressor::Format::BC4
+                                                                                   : BlockCompressor::Format::BC7;
+      if (textureManager->blockCompressedFormat(format) != VK_FORMAT_UNDEFINED) {
+        blockFormats[i] = format;
+      }
+    }
+    if (streamTextures || blockFormats[i] || TextureManager::isKtx2Image(*images[i])) {
+      jobs.push_back(i);
+    }
+  }
+  model.textures.resize(images.size());
+  if (streamTextures) {
+    model.textureMipChains.resize(images.size());
+  }
+
+  // Block compressed chains of earlier loads, an entry is used when the source image and chosen format still match
+  const std::string cachePath = filename + ".bctex";
+  std::unordered_map<uint32_t, CachedTexture> cache;
+  if (std::any_of(blockFormats.begin(), blockFormats.end(), [](const auto& format) { return format.has_value(); })) {
+    cache = readTextureCache(cachePath);
+  }
+
+  // Transcode workers: whole images, libktx transcodes all levels of a texture in one call
+  std::vector<TextureManager::MipChain> chains(images.size());
+  std::vector<uint64_t> sourceHashes(images.size(), 0);
+  std::vector<bool> fromCache(images.size(), false);
+  std::vector<std::exception_ptr> errors(images.size());
+  std::vector<bool> done(images.size(), false);
+  std::mutex doneMutex;
+  std::condition_variable doneCondition;
+  std::atomic<uint32_t> nextJob{0};
+  uint32_t threadCount = transcodeThreads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : transcodeThreads;
+  threadCount = std::min(threadCount, std::max(1u, static_cast<uint32_t>(jobs.size())));
+  // Remaining cores split the blocks of each image
+  const uint32_t encodeThreads = transcodeThreads == 1 ? 1 : std::max(1u, std::thread::hardware_concurrency() / threadCount);
+  auto runJob = [&](uint32_t index) {
+    const tinygltf::Image& image = *images[index];
+    if (!blockFormats[index]) {
+      chains[index] = textureManager->loadMipChain(image, model.filePath, srgb[index]);
+      return;
+    }
+    sourceHashes[index] = textureSourceHash(image, *blockFormats[index], srgb[index]);
+    auto cached = cache.find(index);
+    if (cached != cache.end() && cached->second.sourceHash == sourceHashes[index]) {
+      chains[index] = std::move(cached->second.chain);
+      fromCache[index] = true;
     } else {
-      TextureManager::TextureSampler texSamplerDefault = {VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT,
-                                                          VK_SAMPLER_ADDRESS_MODE_REPEAT};
-      model.textures.push_back(textureManager->createTextureFromGLTFImage(image, model.filePath, texSamplerDefault, context->graphicsQueue));
+      chains[index] = TextureManager::compressMipChain(textureManager->loadMipChain(image, model.filePath, srgb[index]), *blockFormats[index],
+                                                       encodeThreads);
+    }
+  };
+  auto worker = [&]() {
+    for (uint32_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+      const uint32_t index = jobs[job];
+      try {
+        runJob(index);
+      } catch (...) {
+        errors[index] = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done[index] = true;
+      }
+      doneCondition.notify_one();
+    }
+  };
+  std::vector<std::thread> threads;
+  if (threadCount > 1) {
+    for (uint32_t i = 0; i < threadCount; i++) {
+      threads.emplace_back(worker);
+    }
+  }
+  auto joinWorkers = [&]() {
+    nextJob = static_cast<uint32_t>(jobs.size());
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+  };
+
+  model.textureLoad = {};
+  try {
+    // Images without a job upload while the workers transcode, one submission generates all their mip chains
+    TextureManager::UploadBatch batch = textureManager->beginUploadBatch();
+    try {
+      size_t job = 0;
+      for (uint32_t i = 0; i < images.size(); i++) {
+        if (job < jobs.size() && jobs[job] == i) {
+          job++;
+          continue;
+        }
+        textureManager->uploadGLTFImage(model.textures[i], *images[i], samplers[i], srgb[i], batch);
+      }
+    } catch (...) {
+      textureManager->abandonUploadBatch(batch);
+      throw;
+    }
+    textureManager->endUploadBatch(batch);
+    // Then every chain in job order, each as soon as it is ready
+    for (uint32_t index : jobs) {
+      if (threads.empty()) {
+        runJob(index);
+      } else {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&]() { return static_cast<bool>(done[index]); });
+        lock.unlock();
+        if (errors[index]) {
+          std::rethrow_exception(errors[index]);
+        }
+      }
+      TextureManager::MipChain& chain = chains[index];
+      model.textures[index] =
+          textureManager->createTextureFromMipChain(chain, streamTextures ? chain.firstLevelOfSize(streamTailSize) : 0, samplers[index]);
+      if (blockFormats[index]) {
+        model.textureLoad.blockCompressed++;
+        model.textureLoad.compressedFromCache += fromCache[index] ? 1 : 0;
+        for (uint32_t level = 0; level < chain.levels.size(); level++) {
+          model.textureLoad.compressedBytes += chain.levels[level].size();
+          model.textureLoad.uncompressedBytes += static_cast<VkDeviceSize>(std::max(1u, chain.width >> level)) * std::max(1u, chain.height >> level) * 4;
+        }
+      }
+      if (streamTextures) {
+        model.textureMipChains[index] = std::move(chain);
+      } else if (!blockFormats[index]) {
+        chain = TextureManager::MipChain{};
+      }
+    }
+  } catch (...) {
+    joinWorkers();
+    throw;
+  }
+  joinWorkers();
+
+  if (model.textureLoad.blockCompressed > model.textureLoad.compressedFromCache) {
+    std::vector<CachedTexture> entries;
+    for (uint32_t i = 0; i < images.size(); i++) {
+      if (blockFormats[i]) {
+        entries.push_back({i, *blockFormats[i], sourceHashes[i], streamTextures ? model.textureMipChains[i] : std::move(chains[i])});
+      }
     }
+    writeTextureCache(cachePath, entries);
+  }
+
+  model.textureLoad.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+  model.textureLoad.transcodeJobs = static_cast<uint32_t>(jobs.size());
+  model.textureLoad.threads = threadCount;
+  spdlog::info("Loaded {} textures in {:.1f} ms, {} transcoded on {} threads", images.size(), model.textureLoad.milliseconds, jobs.size(),
+               model.textureLoad.threads);
+  if (model.textureLoad.blockCompressed > 0) {
+    spdlog::info("Block compressed {} textures ({} cached): {:.1f} MB instead of {:.1f} MB", model.textureLoad.blockCompressed,
+                 model.textureLoad.compressedFromCache, model.textureLoad.compressedBytes / (1024.0f * 1024.0f),
+                 model.textureLoad.uncompressedBytes / (1024.0f * 1024.0f));
   }
 }
 
@@ -403,6 +807,7 @@ void ModelManager::loadAnimations(Model& model, tinygltf::Model& gltfModel) {
       }
 
       animation.channels.push_back(channel);
+      animation.rootDepth = std::min(animation.rootDepth, channel.node->depth);
     }
 
     model.animations.push_back(animation);
@@ -452,6 +857,315 @@ tak::Node* ModelManager::nodeFromIndex(uint32_t index, const Model& model) {
   return nodeFound;
 }
 
+void ModelManager::generateMeshLods(Model& model, tak::LoaderInfo& loaderInfo) {
+  const float levelRatios[] = {0.5f, 0.25f, 0.125f};
+  const float minReduction = 0.9f;  // stop once a level removes less than 10% of the previous one
+  size_t fullIndices = 0;
+  size_t lodIndices = 0;
+  uint32_t lodCount = 0;
+  for (auto node : model.linearNodes) {
+    if (!node->mesh) {
+      continue;
+    }
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (!primitive->hasIndices || primitive->indexCount < 3 || primitive->vertexCount == 0) {
+        continue;
+      }
+      std::vector<uint32_t> indices(primitive->indexCount);
+      for (uint32_t i = 0; i < primitive->indexCount; i++) {
+        indices[i] = loaderInfo.indexBuffer[primitive->firstIndex + i] - primitive->firstVertex;
+      }
+      std::vector<glm::vec3> positions(primitive->vertexCount);
+      for (uint32_t v = 0; v < primitive->vertexCount; v++) {
+        positions[v] = loaderInfo.vertexBuffer[primitive->firstVertex + v].pos;
+      }
+
+      primitive->lods.clear();
+      primitive->lods.push_back({primitive->firstIndex, primitive->indexCount, 0.0f});
+      float error = 0.0f;
+      for (float ratio : levelRatios) {
+        size_t target = static_cast<size_t>(primitive->indexCount * ratio) / 3 * 3;
+        float levelError = 0.0f;
+        // Each level starts from the previous one, errors add up since the collapses are relative to it
+        std::vector<uint32_t> simplified = MeshOptimizer::simplify(indices, positions, target, &levelError);
+        if (simplified.size() < 3 || simplified.size() > indices.size() * minReduction) {
+          break;
+        }
+        error += levelError;
+        indices = std::move(simplified);
+        MeshOptimizer::optimizeVertexCache(indices, primitive->vertexCount);
+
+        primitive->lods.push_back({static_cast<uint32_t>(loaderInfo.indexBuffer.size()), static_cast<uint32_t>(indices.size()), error});
+        for (uint32_t index : indices) {
+          loaderInfo.indexBuffer.push_back(index + primitive->firstVertex);
+        }
+        lodIndices += indices.size();
+        lodCount++;
+      }
+      if (primitive->lods.size() == 1) {
+        primitive->lods.clear();
+      }
+      fullIndices += primitive->indexCount;
+    }
+  }
+  if (lodCount > 0) {
+    spdlog::info("Generated {} mesh LODs, index buffer +{:.1f}%", lodCount, 100.0 * lodIndices / std::max<size_t>(fullIndices, 1));
+  }
+}
+
+void ModelManager::buildMeshlets(Model& model, const tak::LoaderInfo& loaderInfo) {
+  std::vector<VkDrawIndexedIndirectCommand> draws;
+  size_t fullDetailClusters = 0;
+  size_t fullDetailTriangles = 0;
+  for (auto node : model.linearNodes) {
+    if (!node->mesh || node->skin) {
+      continue;
+    }
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (!primitive->hasIndices || primitive->indexCount < 3 || primitive->vertexCount == 0) {
+        continue;
+      }
+      std::vector<glm::vec3> positions(primitive->vertexCount);
+      for (uint32_t v = 0; v < primitive->vertexCount; v++) {
+        positions[v] = loaderInfo.vertexBuffer[primitive->firstVertex + v].pos;
+      }
+      // Double sided and blended surfaces are visible from behind, only the frustum test applies to them
+      const tak::Material& material = model.materials[primitive->materialIndex];
+      bool coneCulling = !material.doubleSided && material.alphaMode != tak::Material::ALPHAMODE_BLEND;
+
+      primitive->firstMeshlet = static_cast<uint32_t>(model.meshlets.clusters.size());
+      primitive->meshletDraw = static_cast<uint32_t>(draws.size());
+      std::vector<tak::Primitive::Lod> levels = primitive->lods;
+      if (levels.empty()) {
+        levels.push_back({primitive->firstIndex, primitive->indexCount, 0.0f});
+      }
+      for (uint32_t lod = 0; lod < levels.size(); lod++) {
+        std::vector<uint32_t> indices(levels[lod].indexCount);
+        for (uint32_t i = 0; i < levels[lod].indexCount; i++) {
+          indices[i] = loaderInfo.indexBuffer[levels[lod].firstIndex + i] - primitive->firstVertex;
+        }
+        for (const MeshOptimizer::Meshlet& meshlet : MeshOptimizer::buildMeshlets(indices, positions)) {
+          tak::Meshlet cluster{};
+          cluster.sphere = glm::vec4(meshlet.center, meshlet.radius);
+          cluster.cone = glm::vec4(meshlet.coneAxis, coneCulling ? meshlet.coneCutoff : 1.0f);
+          cluster.firstIndex = levels[lod].firstIndex + meshlet.firstIndex;
+          cluster.indexCount = meshlet.triangleCount * 3;
+          cluster.drawIndex = primitive->meshletDraw;
+          cluster.meshIndex = node->mesh->index;
+          cluster.lod = lod;
+          model.meshlets.clusters.push_back(cluster);
+          if (lod == 0) {
+            fullDetailClusters++;
+            fullDetailTriangles += meshlet.triangleCount;
+          }
+        }
+      }
+      primitive->meshletCount = static_cast<uint32_t>(model.meshlets.clusters.size()) - primitive->firstMeshlet;
+      // The culling pass compacts the surviving indices into the primitive's own full detail range
+      draws.push_back({0, 1, primitive->firstIndex, 0, 0});
+    }
+  }
+  if (draws.empty()) {
+    return;
+  }
+  model.meshlets.drawCount = static_cast<uint32_t>(draws.size());
+  model.meshlets.drawTemplate = bufferManager->createGPULocalBuffer(draws.data(), draws.size() * sizeof(VkDrawIndexedIndirectCommand),
+                                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  spdlog::info("Meshlets: {} clusters over {} primitives ({:.1f} triangles per full detail cluster)", model.meshlets.clusters.size(), draws.size(),
+               static_cast<float>(fullDetailTriangles) / std::max<size_t>(1, fullDetailClusters));
+}
+
+void ModelManager::optimizeMeshData(Model& model, tak::LoaderInfo& loaderInfo, const std::string& filename) {
+  const uint32_t cacheMagic = 0x4f4d4b54;  // "TKMO"
+  const uint32_t cacheVersion = 1;
+  struct PrimitiveRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+  };
+  std::vector<PrimitiveRange> ranges;
+  for (auto node : model.linearNodes) {
+    if (!node->mesh) {
+      continue;
+    }
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (primitive->hasIndices && primitive->indexCount >= 3 && primitive->vertexCount > 0) {
+        ranges.push_back({primitive->firstIndex, primitive->indexCount, primitive->firstVertex, primitive->vertexCount});
+      }
+    }
+  }
+  if (ranges.empty()) {
+    return;
+  }
+
+  // The cache is keyed by the source geometry, a re-exported model simply misses it
+  uint64_t sourceHash = 14695981039346656037ull;  // FNV-1a
+  auto hashBytes = [&sourceHash](const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+      sourceHash = (sourceHash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  hashBytes(loaderInfo.indexBuffer.data(), loaderInfo.indexBuffer.size() * sizeof(uint32_t));
+  for (const tak::Vertex& v : loaderInfo.vertexBuffer) {
+    hashBytes(&v.pos, sizeof(v.pos));
+  }
+
+  // Cached result: per primitive the vertex remap followed by the optimized local indices
+  const std::string cachePath = filename + ".meshopt";
+  std::vector<std::vector<uint32_t>> cachedRemaps;
+  std::vector<std::vector<uint32_t>> cachedIndices;
+  {
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    uint32_t magic = 0, version = 0, rangeCount = 0;
+    uint64_t hash = 0;
+    if (cacheFile.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && cacheFile.read(reinterpret_cast<char*>(&version), sizeof(version)) &&
+        cacheFile.read(reinterpret_cast<char*>(&hash), sizeof(hash)) && cacheFile.read(reinterpret_cast<char*>(&rangeCount), sizeof(rangeCount)) &&
+        magic == cacheMagic && version == cacheVersion && hash == sourceHash && rangeCount == ranges.size()) {
+      cachedRemaps.resize(ranges.size());
+      cachedIndices.resize(ranges.size());
+      for (size_t r = 0; r < ranges.size() && cacheFile; r++) {
+        cachedRemaps[r].resize(ranges[r].vertexCount);
+        cachedIndices[r].resize(ranges[r].indexCount);
+        cacheFile.read(reinterpret_cast<char*>(cachedRemaps[r].data()), cachedRemaps[r].size() * sizeof(uint32_t));
+        cacheFile.read(reinterpret_cast<char*>(cachedIndices[r].data()), cachedIndices[r].size() * sizeof(uint32_t));
+      }
+      if (!cacheFile) {
+        spdlog::warn("Mesh optimization cache {} is truncated, rebuilding", cachePath);
+        cachedRemaps.clear();
+        cachedIndices.clear();
+      }
+    }
+  }
+  model.optimization.fromCache = !cachedRemaps.empty();
+
+  std::vector<std::vector<uint32_t>> remaps(ranges.size());
+  std::vector<std::vector<uint32_t>> optimizedIndices(ranges.size());
+  float acmrBefore = 0.0f, acmrAfter = 0.0f, atvrBefore = 0.0f, atvrAfter = 0.0f;
+  size_t triangleCount = 0, vertexCount = 0;
+  model.optimization.geometryPreserved = true;
+  for (size_t r = 0; r < ranges.size(); r++) {
+    const PrimitiveRange& range = ranges[r];
+    std::vector<uint32_t> original(range.indexCount);
+    for (uint32_t i = 0; i < range.indexCount; i++) {
+      original[i] = loaderInfo.indexBuffer[range.firstIndex + i] - range.firstVertex;
+    }
+    if (model.optimization.fromCache) {
+      remaps[r] = std::move(cachedRemaps[r]);
+      optimizedIndices[r] = std::move(cachedIndices[r]);
+    } else {
+      std::vector<glm::vec3> positions(range.vertexCount);
+      for (uint32_t v = 0; v < range.vertexCount; v++) {
+        positions[v] = loaderInfo.vertexBuffer[range.firstVertex + v].pos;
+      }
+      optimizedIndices[r] = original;
+      MeshOptimizer::optimizeVertexCache(optimizedIndices[r], range.vertexCount);
+      MeshOptimizer::optimizeOverdraw(optimizedIndices[r], positions);
+      remaps[r] = MeshOptimizer::optimizeVertexFetch(optimizedIndices[r], range.vertexCount);
+    }
+    // Never ship a reordering that lost or flipped a triangle, keep the authoring order instead
+    std::vector<bool> remapped(range.vertexCount, false);
+    bool validRemap = true;
+    for (uint32_t target : remaps[r]) {
+      validRemap = validRemap && target < range.vertexCount && !remapped[target];
+      if (validRemap) {
+        remapped[target] = true;
+      }
+    }
+    if (!validRemap || !MeshOptimizer::sameTriangles(original, optimizedIndices[r], remaps[r])) {
+      spdlog::error("Mesh optimization changed the triangles of primitive {} in {}, keeping the original order", r, filename);
+      model.optimization.geometryPreserved = false;
+      optimizedIndices[r] = original;
+      remaps[r].resize(range.vertexCount);
+      for (uint32_t v = 0; v < range.vertexCount; v++) {
+        remaps[r][v] = v;
+      }
+    }
+
+    MeshOptimizer::VertexCacheStats before = MeshOptimizer::analyzeVertexCache(original, range.vertexCount);
+    MeshOptimizer::VertexCacheStats after = MeshOptimizer::analyzeVertexCache(optimizedIndices[r], range.vertexCount);
+    size_t triangles = range.indexCount / 3;
+    acmrBefore += before.acmr * triangles;
+    acmrAfter += after.acmr * triangles;
+    atvrBefore += before.atvr * range.vertexCount;
+    atvrAfter += after.atvr * range.vertexCount;
+    triangleCount += triangles;
+    vertexCount += range.vertexCount;
+
+    // Apply: vertices move to their first-use position, indices go back to the shared buffer
+    std::vector<tak::Vertex> vertices(loaderInfo.vertexBuffer.begin() + range.firstVertex,
+                                      loaderInfo.vertexBuffer.begin() + range.firstVertex + range.vertexCount);
+    for (uint32_t v = 0; v < range.vertexCount; v++) {
+      loaderInfo.vertexBuffer[range.firstVertex + remaps[r][v]] = vertices[v];
+    }
+    for (uint32_t i = 0; i < range.indexCount; i++) {
+      loaderInfo.indexBuffer[range.firstIndex + i] = optimizedIndices[r][i] + range.firstVertex;
+    }
+  }
+  model.optimization.before = {acmrBefore / triangleCount, atvrBefore / vertexCount};
+  model.optimization.after = {acmrAfter / triangleCount, atvrAfter / vertexCount};
+  spdlog::info("Mesh optimization{}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} ({} primitives)", model.optimization.fromCache ? " (cached)" : "",
+               model.optimization.before.acmr, model.optimization.after.acmr, model.optimization.before.atvr, model.optimization.after.atvr, ranges.size());
+
+  if (!model.optimization.fromCache && model.optimization.geometryPreserved) {
+    std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+    if (!cacheFile) {
+      spdlog::warn("Could not write mesh optimization cache {}", cachePath);
+      return;
+    }
+    uint32_t rangeCount = static_cast<uint32_t>(ranges.size());
+    cacheFile.write(reinterpret_cast<const char*>(&cacheMagic), sizeof(cacheMagic));
+    cacheFile.write(reinterpret_cast<const char*>(&cacheVersion), sizeof(cacheVersion));
+    cacheFile.write(reinterpret_cast<const char*>(&sourceHash), sizeof(sourceHash));
+    cacheFile.write(reinterpret_cast<const char*>(&rangeCount), sizeof(rangeCount));
+    for (size_t r = 0; r < ranges.size(); r++) {
+      cacheFile.write(reinterpret_cast<const char*>(remaps[r].data()), remaps[r].size() * sizeof(uint32_t));
+      cacheFile.write(reinterpret_cast<const char*>(optimizedIndices[r].data()), optimizedIndices[r].size() * sizeof(uint32_t));
+    }
+  }
+}
+
+void ModelManager::createPackedVertexBuffers(Model& model, const std::vector<tak::Vertex>& vertices) {
+  // Optional streams are only stored per vertex if the model actually uses them
+  // (loadNode gives unskinned vertices a (1, 0, 0, 0) weight, so look at the skins instead)
+  model.packed.hasSkin = !model.skins.empty();
+  for (const tak::Vertex& v : vertices) {
+    model.packed.hasColor |= v.color != glm::vec4(1.0f);
+  }
+  std::vector<glm::vec3> positions(vertices.size());
+  std::vector<tak::PackedVertex::Surface> surface(vertices.size());
+  std::vector<tak::PackedVertex::Skin> skin(model.packed.hasSkin ? vertices.size() : 1);
+  std::vector<tak::PackedVertex::Color> color(model.packed.hasColor ? vertices.size() : 1, tak::PackedVertex::Color(255));
+  for (size_t i = 0; i < vertices.size(); i++) {
+    positions[i] = vertices[i].pos;
+    surface[i] = tak::PackedVertex::packSurface(vertices[i]);
+    if (model.packed.hasSkin) {
+      skin[i] = tak::PackedVertex::packSkin(vertices[i]);
+    }
+    if (model.packed.hasColor) {
+      color[i] = tak::PackedVertex::packColor(vertices[i]);
+    }
+  }
+  // Storage usage as well, compute skinning decodes the streams
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  model.packed.positions = bufferManager->createGPULocalBuffer(positions.data(), positions.size() * sizeof(glm::vec3), usage);
+  model.packed.surface = bufferManager->createGPULocalBuffer(surface.data(), surface.size() * sizeof(tak::PackedVertex::Surface), usage);
+  model.packed.skin = bufferManager->createGPULocalBuffer(skin.data(), skin.size() * sizeof(tak::PackedVertex::Skin), usage);
+  model.packed.color = bufferManager->createGPULocalBuffer(color.data(), color.size() * sizeof(tak::PackedVertex::Color), usage);
+
+  VkDeviceSize packedSize = model.packed.positions.size + model.packed.surface.size + model.packed.skin.size + model.packed.color.size;
+  spdlog::info("Packed vertices: {} KB instead of {} KB (skin stream: {}, color stream: {})", packedSize / 1024,
+               vertices.size() * sizeof(tak::Vertex) / 1024, model.packed.hasSkin, model.packed.hasColor);
+}
+
+void ModelManager::bindPackedVertexBuffers(const Model& model, VkCommandBuffer cmdbuf) {
+  const std::array<VkBuffer, 4> buffers = {model.packed.positions.buffer, model.packed.surface.buffer, model.packed.skin.buffer,
+                                           model.packed.color.buffer};
+  const std::array<VkDeviceSize, 4> offsets = {0, 0, 0, 0};
+  vkCmdBindVertexBuffers(cmdbuf, 0, static_cast<uint32_t>(buffers.size()), buffers.data(), offsets.data());
+}
+
 void ModelManager::getSceneDimensions(Model& model) {
   // Calculate binary volume hierarchy for all nodes in the scene
   for (auto node : model.linearNodes) {
@@ -489,6 +1203,7 @@ void ModelManager::calculateBoundingBox(tak::Node* node, tak::Node* parent, Mode
   if (node->mesh) {
     if (node->mesh->bb.valid) {
       node->aabb = node->mesh->bb.getAABB(node->getMatrix());
+      node->mesh->aabb = node->aabb;
       if (node->children.size() == 0) {
         node->bvh.min = node->aabb.min;
         node->bvh.max = node->aabb.max;
@@ -521,6 +1236,7 @@ void ModelManager::loadNode(tak::Node* parent, const tinygltf::Node& node, uint3
   tak::Node* newNode = new tak::Node{};
   newNode->index = nodeIndex;
   newNode->parent = parent;
+  newNode->depth = parent ? parent->depth + 1 : 0;
   newNode->name = node.name;
   newNode->skinIndex = node.skin;
 
@@ -735,6 +1451,7 @@ void ModelManager::loadNode(tak::Node* parent, const tinygltf::Node& node, uint3
 
       uint32_t materialIndex = primitive.material > -1 ? primitive.material : static_cast<uint32_t>(model.materials.size() - 1);
       tak::Primitive* newPrimitive = new tak::Primitive(indexStart, indexCount, vertexCount, materialIndex);
+      newPrimitive->firstVertex = vertexStart;
       newPrimitive->setBoundingBox(posMin, posMax);
       newMesh->primitives.push_back(newPrimitive);
     }
@@ -802,10 +1519,18 @@ void ModelManager::loadSkins(Model& model, tinygltf::Model& gltfModel) {
 void ModelManager::destroyModel(Model& model) {
   bufferManager->destroyBuffer(model.vertices);
   bufferManager->destroyBuffer(model.indices);
+  bufferManager->destroyBuffer(model.packed.positions);
+  bufferManager->destroyBuffer(model.packed.surface);
+  bufferManager->destroyBuffer(model.packed.skin);
+  bufferManager->destroyBuffer(model.packed.color);
+  bufferManager->destroyBuffer(model.meshlets.buffer);
+  bufferManager->destroyBuffer(model.meshlets.drawTemplate);
+  model.meshlets.clusters.clear();
   for (int i = 0; i < model.textures.size(); i++) {
     textureManager->destroyTexture(model.textures[i]);
   }
   model.textureSamplers.resize(0);
+  model.textureMipChains.clear();
 
   for (auto node : model.nodes) {
     delete node;  // children nodes deletes recursively
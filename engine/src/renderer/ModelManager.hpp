@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "ModelStructs.hpp"
+#include "renderer/MeshOptimizer.hpp"
 #include "defines.hpp"
 
 class ModelManager {
@@ -13,18 +14,59 @@ class ModelManager {
       : context(ctx), bufferManager(bufferMgr), textureManager(textureMgr), cmdUtils(cmdUtil) {}
   ~ModelManager() {}
 
+  // Vertex streams created at load, see tak::PackedVertex for the compressed layout
+  enum VertexFormatFlags : uint32_t { VERTEX_FORMAT_FULL = 0x1, VERTEX_FORMAT_PACKED = 0x2 };
+
   //  Complete model
   struct Model {
-    BufferManager::Buffer vertices;
+    BufferManager::Buffer vertices;  // tak::Vertex, only with VERTEX_FORMAT_FULL
     BufferManager::Buffer indices;
     glm::mat4 aabb;
 
+    // Compressed streams, only with VERTEX_FORMAT_PACKED
+    struct PackedVertices {
+      BufferManager::Buffer positions;
+      BufferManager::Buffer surface;
+      BufferManager::Buffer skin;   // single default element if !hasSkin
+      BufferManager::Buffer color;  // single default element if !hasColor
+      bool hasSkin = false;
+      bool hasColor = false;
+    } packed;
+
+    // Cluster culling input, only with generateMeshlets (skinned primitives are left out, their bounds move)
+    struct Meshlets {
+      std::vector<tak::Meshlet> clusters;
+      BufferManager::Buffer buffer;        // tak::Meshlet array
+      BufferManager::Buffer drawTemplate;  // VkDrawIndexedIndirectCommand per culled primitive with indexCount 0
+      uint32_t drawCount = 0;
+    } meshlets;
+
+    // Load-time triangle/vertex reordering, triangle weighted over all indexed primitives
+    struct MeshOptimization {
+      MeshOptimizer::VertexCacheStats before;
+      MeshOptimizer::VertexCacheStats after;
+      bool fromCache = false;          // reordering was read from <model>.meshopt
+      bool geometryPreserved = false;  // every primitive still has exactly its original triangles
+    } optimization;
+
+    // Texture decode and upload of the last load, see transcodeThreads
+    struct TextureLoadStats {
+      float milliseconds = 0.0f;
+      uint32_t transcodeJobs = 0;          // images decoded into a mip chain by the transcode workers
+      uint32_t threads = 0;                // transcode workers, 1 for the serial path on the loading thread
+      uint32_t blockCompressed = 0;        // png/jpg images uploaded as BC4/BC5/BC7, see compressTextures
+      uint32_t compressedFromCache = 0;    // of those, read from <model>.bctex instead of encoded
+      VkDeviceSize compressedBytes = 0;    // all levels of the block compressed textures
+      VkDeviceSize uncompressedBytes = 0;  // the same levels as RGBA8
+    } textureLoad;
+
     std::vector<tak::Node*> nodes;
     std::vector<tak::Node*> linearNodes;
     std::vector<tak::Skin*> skins;
 
     std::vector<TextureManager::Texture> textures;
     std::vector<TextureManager::TextureSampler> textureSamplers;
+    std::vector<TextureManager::MipChain> textureMipChains;  // per texture, only with streamTextures
     std::vector<tak::Material> materials;
 
     std::vector<tak::Animation> animations;
@@ -38,14 +80,47 @@ class ModelManager {
     std::string filePath;
   };
 
+  // Animation LOD: update rate and joint set follow the projected screen size of the model
+  struct AnimationLodSettings {
+    float fullRateSize = 0.25f;      // projected size (fraction of the viewport) at and above which every frame is evaluated
+    float minUpdateRate = 10.0f;     // Hz, rate a visible model converges to as it shrinks
+    float reducedJointSize = 0.08f;  // below this only joints up to reducedJointDepth below the animation root are animated
+    uint32_t reducedJointDepth = 3;
+  };
+  struct AnimationLodState {
+    float screenSize = 0.0f;   // last projected size, 0 when off-screen
+    float sinceUpdate = 0.0f;  // seconds since the last evaluation
+    bool visible = true;
+    bool reducedJoints = false;
+  };
+
+  bool optimizeMeshes = true;  // vertex cache / overdraw / vertex fetch reordering at load, cached next to the model
+  bool generateLods = true;    // simplified index ranges per primitive (tak::Primitive::lods), appended to the index buffer
+  bool generateMeshlets = true;  // ~64 vertex / 124 triangle clusters with bounds for GPU culling (Model::meshlets)
+  // Keep every mip level on the CPU and upload only those up to streamTailSize, TextureStreamer brings in the rest on demand
+  bool streamTextures = false;
+  uint32_t streamTailSize = 128;
+  // KTX2 images (every image with streamTextures) are transcoded on this many threads while the loading thread uploads the
+  // finished ones, 0 uses std::thread::hardware_concurrency, 1 is the serial baseline on the loading thread
+  uint32_t transcodeThreads = 0;
+  // png/jpg images become BC7 (color, other data), BC5 (normal maps) or BC4 (occlusion) when the device has
+  // textureCompressionBC, encoded on the transcode workers and cached next to the model
+  bool compressTextures = true;
+
   // Model management
-  Model createModelFromFile(const std::string& filename, float scale = 1.0f);
-  void updateAnimation(ModelManager::Model& model, int index, float time);
+  Model createModelFromFile(const std::string& filename, float scale = 1.0f, uint32_t vertexFormats = VERTEX_FORMAT_FULL);
+  // Binds the four tak::PackedVertex streams to bindings 0-3
+  void bindPackedVertexBuffers(const Model& model, VkCommandBuffer cmdbuf);
+  void updateAnimation(ModelManager::Model& model, int index, float time, uint32_t maxJointDepth = UINT32_MAX);
+  // Evaluates the animation only when the LOD schedule asks for it, returns true if the pose changed
+  bool updateAnimationLod(Model& model, int index, float time, float deltaTime, const glm::mat4& clipFromModel, AnimationLodState& state,
+                          const AnimationLodSettings& settings = {});
+  float projectedScreenSize(const Model& model, const glm::mat4& clipFromModel);
   void drawNode(tak::Node* node, VkCommandBuffer cmdbuf);
   void destroyModel(Model& model);
 
  private:
-  void loadTextures(Model& model, tinygltf::Model& gltfModel);
+  void loadTextures(Model& model, tinygltf::Model& gltfModel, const std::string& filename);
   void loadMaterials(Model& model, tinygltf::Model& gltfModel);
   void loadNode(tak::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, Model& model, const tinygltf::Model& gltfModel, tak::LoaderInfo& loaderInfo,
                 float globalscale);
@@ -55,6 +130,10 @@ class ModelManager {
   tak::Node* findNode(tak::Node* parent, uint32_t index);
   tak::Node* nodeFromIndex(uint32_t index, const Model& model);
   void getSceneDimensions(Model& model);
+  void createPackedVertexBuffers(Model& model, const std::vector<tak::Vertex>& vertices);
+  void optimizeMeshData(Model& model, tak::LoaderInfo& loaderInfo, const std::string& filename);
+  void generateMeshLods(Model& model, tak::LoaderInfo& loaderInfo);
+  void buildMeshlets(Model& model, const tak::LoaderInfo& loaderInfo);
   void calculateBoundingBox(tak::Node* node, tak::Node* parent, Model& model);
 
   std::shared_ptr<VulkanContext> context;
@@ -5,7 +5,9 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_precision.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "renderer/BufferManager.hpp"
@@ -79,6 +81,86 @@ struct Vertex {
     return attributeDescriptions;
   }
 };
+
+// Compressed vertex streams (40 bytes for a skinned vertex with color instead of 120)
+// binding 0: position, kept alone so depth-only passes fetch 12 bytes per vertex
+// binding 1: surface, half uvs and octahedral normal/tangent
+// binding 2: skin, 8-bit joints and unorm8 weights
+// binding 3: color, unorm8
+// Models without skins or vertex colors store a single default element and bind those streams with stride 0
+struct PackedVertex {
+  struct Surface {
+    uint32_t uv0;                // half2
+    uint32_t uv1;                // half2
+    glm::i16vec4 normalTangent;  // octahedral normal in xy, octahedral tangent in zw, tangent.w < 0 in the lowest bit of w
+  };
+  struct Skin {
+    glm::u8vec4 joint0;
+    glm::u8vec4 weight0;
+  };
+  using Color = glm::u8vec4;
+
+  static glm::vec2 octEncode(glm::vec3 n) {
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f) {
+      glm::vec2 signNotZero(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+      p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero;
+    }
+    return p;
+  }
+  static int16_t toSnorm16(float v) { return static_cast<int16_t>(std::round(glm::clamp(v, -1.0f, 1.0f) * 32767.0f)); }
+
+  static Surface packSurface(const Vertex& v) {
+    Surface surface{};
+    surface.uv0 = glm::packHalf2x16(v.uv0);
+    surface.uv1 = glm::packHalf2x16(v.uv1);
+    glm::vec2 normal = octEncode(glm::length(v.normal) > 0.0f ? v.normal : glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::vec3 tangentDir = glm::vec3(v.tangent);
+    glm::vec2 tangent = octEncode(glm::length(tangentDir) > 0.0f ? tangentDir : glm::vec3(1.0f, 0.0f, 0.0f));
+    int16_t tangentY = static_cast<int16_t>((toSnorm16(tangent.y) & ~1) | (v.tangent.w < 0.0f ? 1 : 0));
+    surface.normalTangent = glm::i16vec4(toSnorm16(normal.x), toSnorm16(normal.y), toSnorm16(tangent.x), tangentY);
+    return surface;
+  }
+  static Skin packSkin(const Vertex& v) {
+    Skin skin{};
+    skin.joint0 = glm::u8vec4(glm::min(v.joint0, glm::uvec4(255)));
+    // Quantize weights so they still sum to exactly 255, the rounding error goes to the largest weight
+    float sum = v.weight0.x + v.weight0.y + v.weight0.z + v.weight0.w;
+    if (sum > 0.0f) {
+      glm::vec4 w = v.weight0 / sum * 255.0f;
+      glm::uvec4 q = glm::uvec4(glm::round(w));
+      int32_t error = 255 - static_cast<int32_t>(q.x + q.y + q.z + q.w);
+      uint32_t largest = 0;
+      for (uint32_t i = 1; i < 4; i++) {
+        if (w[i] > w[largest]) largest = i;
+      }
+      q[largest] = static_cast<uint32_t>(static_cast<int32_t>(q[largest]) + error);
+      skin.weight0 = glm::u8vec4(q);
+    }
+    return skin;
+  }
+  static Color packColor(const Vertex& v) { return Color(glm::round(glm::clamp(v.color, 0.0f, 1.0f) * 255.0f)); }
+
+  static std::array<VkVertexInputBindingDescription, 4> getBindingDescriptions(bool hasSkin, bool hasColor) {
+    return {VkVertexInputBindingDescription{0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX},
+            VkVertexInputBindingDescription{1, sizeof(Surface), VK_VERTEX_INPUT_RATE_VERTEX},
+            VkVertexInputBindingDescription{2, hasSkin ? static_cast<uint32_t>(sizeof(Skin)) : 0, VK_VERTEX_INPUT_RATE_VERTEX},
+            VkVertexInputBindingDescription{3, hasColor ? static_cast<uint32_t>(sizeof(Color)) : 0, VK_VERTEX_INPUT_RATE_VERTEX}};
+  }
+
+  // Same locations as Vertex, normal and tangent share location 1 (decoded in the vertex shader)
+  static std::array<VkVertexInputAttributeDescription, 7> getAttributeDescriptions() {
+    return {VkVertexInputAttributeDescription{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0},
+            VkVertexInputAttributeDescription{1, 1, VK_FORMAT_R16G16B16A16_SINT, offsetof(Surface, normalTangent)},
+            VkVertexInputAttributeDescription{2, 1, VK_FORMAT_R16G16_SFLOAT, offsetof(Surface, uv0)},
+            VkVertexInputAttributeDescription{3, 1, VK_FORMAT_R16G16_SFLOAT, offsetof(Surface, uv1)},
+            VkVertexInputAttributeDescription{4, 2, VK_FORMAT_R8G8B8A8_UINT, offsetof(Skin, joint0)},
+            VkVertexInputAttributeDescription{5, 2, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Skin, weight0)},
+            VkVertexInputAttributeDescription{6, 3, VK_FORMAT_R8G8B8A8_UNORM, 0}};
+  }
+};
+
 struct LoaderInfo {
   std::vector<uint32_t> indexBuffer;
   std::vector<Vertex> vertexBuffer;
@@ -168,8 +250,21 @@ struct Primitive {
   uint32_t indexCount;
   uint32_t vertexCount;
   uint32_t materialIndex;
+  uint32_t firstVertex = 0;  // offset of this primitive's vertices in the model's shared vertex buffer
   bool hasIndices;
   BoundingBox bb;
+  // Simplified index ranges in the model's index buffer, lods[0] is the full mesh, empty if no LODs were generated
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;  // object space deviation from the full mesh
+  };
+  std::vector<Lod> lods;
+  uint32_t currentLod = 0;  // last selected level, kept for hysteresis
+  // Cluster culling, meshlets of every level in Model::meshlets, meshletCount 0 if the primitive is drawn directly
+  uint32_t firstMeshlet = 0;
+  uint32_t meshletCount = 0;
+  uint32_t meshletDraw = 0;  // indirect draw command written by the culling pass
   Primitive(uint32_t firstIndex, uint32_t indexCount, uint32_t vertexCount, uint32_t materialIndex)
       : firstIndex(firstIndex), indexCount(indexCount), vertexCount(vertexCount), materialIndex(materialIndex) {
     hasIndices = indexCount > 0;
@@ -180,6 +275,17 @@ struct Primitive {
     bb.valid = true;
   }
 };
+// GPU meshlet record (std430), bounds are in the space of the owning mesh before Mesh::matrix
+struct Meshlet {
+  glm::vec4 sphere;     // xyz center, w radius
+  glm::vec4 cone;       // xyz axis, w cutoff (1 = never culled as back-facing)
+  uint32_t firstIndex;  // absolute, in the model index buffer
+  uint32_t indexCount;
+  uint32_t drawIndex;  // Primitive::meshletDraw
+  uint32_t meshIndex;
+  uint32_t lod;  // index into Primitive::lods, 0 if the primitive has no LODs
+  uint32_t padding[3];
+};
 struct Mesh {
   std::vector<Primitive*> primitives;
   BoundingBox bb;
@@ -188,6 +294,7 @@ struct Mesh {
   std::vector<glm::mat4> jointMatrix = std::vector<glm::mat4>(MAX_NUM_JOINTS);  // consider not setting the size here, can I use vector?
   uint32_t jointcount{0};
   uint32_t index;
+  uint32_t version{0};  // bumped whenever matrix or jointMatrix change, renderers compare it to upload deltas only
   Mesh(glm::mat4 matrix) { this->matrix = matrix; }
   ~Mesh() {
     for (Primitive* p : primitives) delete p;
@@ -211,6 +318,7 @@ struct Skin {
 struct Node {
   Node* parent;
   uint32_t index;
+  uint32_t depth{0};  // distance from the scene root, used to pick the reduced joint set for animation LOD
   std::vector<Node*> children;
   glm::mat4 matrix;
   std::string name;
@@ -251,8 +359,9 @@ struct Node {
     useCachedMatrix = false;
     if (mesh) {
       glm::mat4 m = getMatrix();
+      bool changed = mesh->matrix != m;
+      mesh->matrix = m;
       if (skin) {
-        mesh->matrix = m;
         // Update join matrices
         glm::mat4 inverseTransform = glm::inverse(m);
         size_t numJoints = std::min((uint32_t)skin->joints.size(), MAX_NUM_JOINTS);
@@ -260,11 +369,16 @@ struct Node {
           Node* jointNode = skin->joints[i];
           glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
           jointMat = inverseTransform * jointMat;
-          mesh->jointMatrix[i] = jointMat;
+          if (mesh->jointMatrix[i] != jointMat) {
+            mesh->jointMatrix[i] = jointMat;
+            changed = true;
+          }
         }
+        changed |= mesh->jointcount != numJoints;
         mesh->jointcount = static_cast<uint32_t>(numJoints);
-      } else {
-        mesh->matrix = m;
+      }
+      if (changed) {
+        mesh->version++;
       }
     }
     for (auto& child : children) {
@@ -395,5 +509,6 @@ struct Animation {
   std::vector<AnimationChannel> channels;
   float start = std::numeric_limits<float>::max();
   float end = std::numeric_limits<float>::min();
+  uint32_t rootDepth = std::numeric_limits<uint32_t>::max();  // shallowest animated node
 };
 }  // namespace tak
\ No newline at end of file
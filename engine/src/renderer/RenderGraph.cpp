@@ -0,0 +1,456 @@
+#include "RenderGraph.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT;
+}
+
+// Pass declaration
+
+RenderGraph::Pass& RenderGraph::Pass::read(TextureHandle texture, Usage usage) { return add(texture.index, true, usage, true, false); }
+RenderGraph::Pass& RenderGraph::Pass::read(BufferHandle buffer, Usage usage) { return add(buffer.index, false, usage, true, false); }
+RenderGraph::Pass& RenderGraph::Pass::write(TextureHandle texture, Usage usage) { return add(texture.index, true, usage, false, true); }
+RenderGraph::Pass& RenderGraph::Pass::write(BufferHandle buffer, Usage usage) { return add(buffer.index, false, usage, false, true); }
+RenderGraph::Pass& RenderGraph::Pass::modify(TextureHandle texture, Usage usage) { return add(texture.index, true, usage, true, true); }
+
+RenderGraph::Pass& RenderGraph::Pass::sideEffect() {
+  hasSideEffect = true;
+  return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::execute(std::function<void(VkCommandBuffer)> passCallback) {
+  callback = std::move(passCallback);
+  return *this;
+}
+
+RenderGraph::Pass& RenderGraph::Pass::add(uint32_t resource, bool texture, Usage usage, bool reads, bool writes) {
+  if (resource == UINT32_MAX) {
+    throw std::runtime_error("Render graph pass " + name + " uses an invalid handle");
+  }
+  for (const Access& access : accesses) {
+    if (access.resource == resource && access.texture == texture) {
+      throw std::runtime_error("Render graph pass " + name + " declares a resource twice");
+    }
+  }
+  accesses.push_back({resource, texture, usage, reads, writes});
+  return *this;
+}
+
+// Declaration
+
+RenderGraph::TextureHandle RenderGraph::importTexture(const std::string& name, TextureManager::Texture& texture) {
+  TextureResource resource;
+  resource.name = name;
+  resource.imported = &texture;
+  textures.push_back(std::move(resource));
+  return {static_cast<uint32_t>(textures.size() - 1)};
+}
+
+RenderGraph::TextureHandle RenderGraph::createTexture(const std::string& name, const TextureDesc& desc) {
+  TextureResource resource;
+  resource.name = name;
+  resource.desc = desc;
+  textures.push_back(std::move(resource));
+  return {static_cast<uint32_t>(textures.size() - 1)};
+}
+
+RenderGraph::BufferHandle RenderGraph::importBuffer(const std::string& name) {
+  buffers.push_back({name});
+  return {static_cast<uint32_t>(buffers.size() - 1)};
+}
+
+RenderGraph::Pass& RenderGraph::addPass(const std::string& name) {
+  passes.push_back(std::make_unique<Pass>());
+  passes.back()->name = name;
+  return *passes.back();
+}
+
+// Compilation
+
+RenderGraph::UsageInfo RenderGraph::usageInfo(Usage usage) {
+  switch (usage) {
+    case Usage::ComputeSampled:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+    case Usage::ComputeSampledDepth:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+    case Usage::ComputeStorage:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+    case Usage::FragmentSampled:
+      return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+    case Usage::ColorAttachment:
+      return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    case Usage::DepthAttachment:
+      return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+    case Usage::DepthReadOnly:
+      return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT};
+    case Usage::ComputeBufferRead:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0};
+    case Usage::ComputeBufferWrite:
+      return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0};
+    case Usage::FragmentBufferRead:
+      return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0};
+  }
+  throw std::runtime_error("Unknown render graph usage");
+}
+
+VkImageAspectFlags RenderGraph::aspectOf(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+      return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+TextureManager::Texture& RenderGraph::textureOf(uint32_t index) {
+  TextureResource& resource = textures[index];
+  return resource.imported ? *resource.imported : resource.transient;
+}
+
+void RenderGraph::cull() {
+  // Walk back from the side effects: a pass lives if a later live pass reads something it writes. Resources read before
+  // their first write carry the previous frame's contents, so the walk runs twice and starts the second time with what the
+  // beginning of the frame needs.
+  std::vector<bool> textureNeeded(textures.size(), false);
+  std::vector<bool> bufferNeeded(buffers.size(), false);
+  std::vector<bool> live(passes.size(), false);
+  for (int sweep = 0; sweep < 2; sweep++) {
+    for (size_t i = passes.size(); i-- > 0;) {
+      const Pass& pass = *passes[i];
+      bool isLive = pass.hasSideEffect;
+      for (const Pass::Access& access : pass.accesses) {
+        const bool needed = access.texture ? textureNeeded[access.resource] : bufferNeeded[access.resource];
+        isLive = isLive || (access.writes && needed);
+      }
+      if (!isLive) {
+        continue;
+      }
+      live[i] = true;
+      for (const Pass::Access& access : pass.accesses) {
+        std::vector<bool>& needed = access.texture ? textureNeeded : bufferNeeded;
+        if (access.reads) {
+          needed[access.resource] = true;
+        } else if (access.writes) {
+          needed[access.resource] = false;  // earlier contents are overwritten
+        }
+      }
+    }
+  }
+
+  livePasses.clear();
+  for (size_t i = 0; i < passes.size(); i++) {
+    if (live[i]) {
+      livePasses.push_back(passes[i].get());
+    } else {
+      spdlog::debug("Render graph: culled pass {}", passes[i]->name);
+    }
+  }
+  statistics.passes = static_cast<uint32_t>(livePasses.size());
+  statistics.culledPasses = static_cast<uint32_t>(passes.size() - livePasses.size());
+}
+
+void RenderGraph::allocateTransients() {
+  VkDevice device = context->device;
+  std::vector<uint32_t> transients;
+  VkMemoryRequirements heapRequirements{0, 1, ~0u};
+  for (uint32_t i = 0; i < textures.size(); i++) {
+    TextureResource& resource = textures[i];
+    if (resource.imported || resource.firstPass == UINT32_MAX) {
+      continue;
+    }
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+    imageInfo.mipLevels = resource.desc.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = resource.desc.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = resource.usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    TextureManager::Texture& texture = resource.transient;
+    texture.device = device;
+    texture.extent = imageInfo.extent;
+    texture.format = imageInfo.format;
+    texture.mipLevels = imageInfo.mipLevels;
+    texture.usage = imageInfo.usage;
+    VK_CHECK_RESULT(vkCreateImage(device, &imageInfo, nullptr, &texture.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, texture.image, &requirements);
+    resource.size = requirements.size;
+    heapRequirements.alignment = std::max(heapRequirements.alignment, requirements.alignment);
+    heapRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+    statistics.transientBytes += requirements.size;
+    transients.push_back(i);
+  }
+  if (transients.empty()) {
+    return;
+  }
+  if (heapRequirements.memoryTypeBits == 0) {
+    throw std::runtime_error("Render graph transients have no common memory type");
+  }
+
+  // Largest first, each at the lowest offset that overlaps no placed texture whose lifetime overlaps its own
+  // Textures that keep contents across frames never share memory
+  std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) { return textures[a].size > textures[b].size; });
+  std::vector<uint32_t> placed;
+  for (uint32_t index : transients) {
+    TextureResource& resource = textures[index];
+    std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+    for (uint32_t other : placed) {
+      const TextureResource& o = textures[other];
+      const bool lifetimesOverlap = !resource.aliasable || !o.aliasable || (resource.firstPass <= o.lastPass && o.firstPass <= resource.lastPass);
+      if (lifetimesOverlap) {
+        occupied.emplace_back(o.offset, o.offset + o.size);
+      }
+    }
+    std::sort(occupied.begin(), occupied.end());
+    VkDeviceSize offset = 0;
+    for (const auto& range : occupied) {
+      if (offset + resource.size <= range.first) {
+        break;
+      }
+      offset = std::max(offset, (range.second + heapRequirements.alignment - 1) / heapRequirements.alignment * heapRequirements.alignment);
+    }
+    resource.offset = offset;
+    heapRequirements.size = std::max(heapRequirements.size, offset + resource.size);
+    placed.push_back(index);
+  }
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = heapRequirements.size;
+  allocInfo.memoryTypeIndex = bufferManager->findMemoryType(heapRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &transientMemory));
+  statistics.heapBytes = heapRequirements.size;
+
+  for (uint32_t index : transients) {
+    TextureResource& resource = textures[index];
+    TextureManager::Texture& texture = resource.transient;
+    VK_CHECK_RESULT(vkBindImageMemory(device, texture.image, transientMemory, resource.offset));
+    const VkImageAspectFlags aspect = aspectOf(texture.format);
+    texture.imageView = textureManager->createImageView(texture.image, texture.format, aspect, texture.mipLevels);
+    if (resource.desc.levelViews) {
+      for (uint32_t level = 0; level < texture.mipLevels; level++) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = texture.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = texture.format;
+        viewInfo.subresourceRange = {aspect, level, 1, 0, 1};
+        VkImageView view;
+        VK_CHECK_RESULT(vkCreateImageView(device, &viewInfo, nullptr, &view));
+        resource.levelViews.push_back(view);
+      }
+    }
+    if (texture.usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+      texture.sampler = texture.mipLevels == 1
+                            ? textureManager->createGBufferSampler()
+                            : textureManager->createTextureSampler({VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE},
+                                                                   static_cast<float>(texture.mipLevels), 1.0f);
+    }
+    spdlog::debug("Render graph: {} at {} KB, {} KB, passes {}-{}", resource.name, resource.offset >> 10, resource.size >> 10, resource.firstPass,
+                  resource.lastPass);
+  }
+}
+
+void RenderGraph::simulate(std::vector<ResourceState>& textureStates, std::vector<ResourceState>& bufferStates, std::vector<Barrier>* barriers) {
+  for (uint32_t passIndex = 0; passIndex < livePasses.size(); passIndex++) {
+    const Pass& pass = *livePasses[passIndex];
+    Barrier barrier;
+    for (const Pass::Access& access : pass.accesses) {
+      const UsageInfo info = usageInfo(access.usage);
+      const VkAccessFlags accessMask = access.writes ? info.access : info.access & ~WRITE_ACCESS;
+      ResourceState& state = access.texture ? textureStates[access.resource] : bufferStates[access.resource];
+      const VkImageLayout previousLayout = state.layout;
+      const bool layoutChange = access.texture && previousLayout != info.layout;
+
+      VkPipelineStageFlags srcStages = 0;
+      VkAccessFlags srcAccess = 0;
+      if (layoutChange || access.writes) {
+        // Write after read or write, or a layout transition: wait for every access since the last write
+        srcStages = state.writeStages | state.readStages;
+        srcAccess = state.writeAccess;
+        if (access.texture && textures[access.resource].aliasable && textures[access.resource].firstPass == passIndex) {
+          // Memory shared with other textures: wait for their accesses too, earlier this frame or late in the previous one
+          const TextureResource& resource = textures[access.resource];
+          for (uint32_t other = 0; other < textures.size(); other++) {
+            const TextureResource& o = textures[other];
+            if (other != access.resource && !o.imported && o.firstPass != UINT32_MAX && o.offset < resource.offset + resource.size &&
+                resource.offset < o.offset + o.size) {
+              srcStages |= textureStates[other].writeStages | textureStates[other].readStages;
+              srcAccess |= textureStates[other].writeAccess;
+            }
+          }
+        }
+        if (srcStages == 0 && layoutChange) {
+          srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+        state.layout = access.texture ? info.layout : state.layout;
+        state.writeStages = info.stages;
+        state.writeAccess = accessMask & WRITE_ACCESS;
+        state.readStages = access.writes ? 0 : info.stages;
+        state.visibleStages = access.writes ? 0 : info.stages;
+        state.visibleAccess = access.writes ? 0 : accessMask;
+      } else {
+        // Read after write: only when the write is not yet visible to this stage and access
+        if (state.writeStages != 0 && ((info.stages & ~state.visibleStages) != 0 || (accessMask & ~state.visibleAccess) != 0)) {
+          srcStages = state.writeStages;
+          srcAccess = state.writeAccess;
+          state.visibleStages |= info.stages;
+          state.visibleAccess |= accessMask;
+        }
+        state.readStages |= info.stages;
+      }
+      if (srcStages == 0 || barriers == nullptr) {
+        continue;
+      }
+
+      barrier.srcStages |= srcStages;
+      barrier.dstStages |= info.stages;
+      if (access.texture) {
+        TextureManager::Texture& texture = textureOf(access.resource);
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = srcAccess;
+        imageBarrier.dstAccessMask = accessMask;
+        // Contents the pass overwrites are discarded, which also covers memory another texture wrote
+        imageBarrier.oldLayout = (access.writes && !access.reads) ? VK_IMAGE_LAYOUT_UNDEFINED : previousLayout;
+        imageBarrier.newLayout = info.layout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = texture.image;
+        imageBarrier.subresourceRange = {aspectOf(texture.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+        barrier.images.push_back(imageBarrier);
+      } else {
+        barrier.memory.srcAccessMask |= srcAccess;
+        barrier.memory.dstAccessMask |= accessMask;
+      }
+    }
+    if (barriers != nullptr) {
+      barriers->push_back(std::move(barrier));
+    }
+  }
+}
+
+void RenderGraph::compile() {
+  statistics = {};
+  cull();
+
+  // Lifetimes and image usage from the live passes
+  for (uint32_t passIndex = 0; passIndex < livePasses.size(); passIndex++) {
+    for (const Pass::Access& access : livePasses[passIndex]->accesses) {
+      if (!access.texture) {
+        continue;
+      }
+      TextureResource& resource = textures[access.resource];
+      if (resource.firstPass == UINT32_MAX) {
+        resource.firstPass = passIndex;
+        resource.aliasable = !resource.imported && access.writes && !access.reads;
+      }
+      resource.lastPass = passIndex;
+      resource.usage |= usageInfo(access.usage).imageUsage;
+    }
+  }
+  allocateTransients();
+
+  // A frame starts where the previous one ended: one pass over the frame gives those states, the barriers come from a
+  // second pass that starts from them
+  std::vector<ResourceState> textureStates(textures.size());
+  std::vector<ResourceState> bufferStates(buffers.size());
+  simulate(textureStates, bufferStates, nullptr);
+  frameEndStates = textureStates;
+  passBarriers.clear();
+  simulate(textureStates, bufferStates, &passBarriers);
+  for (const Barrier& barrier : passBarriers) {
+    statistics.barriers += static_cast<uint32_t>(barrier.images.size());
+    statistics.barriers += (barrier.memory.srcAccessMask | barrier.memory.dstAccessMask) != 0 ? 1 : 0;
+  }
+
+  // Move every image into that layout once, the contents are undefined until the first frame writes them
+  std::vector<VkImageMemoryBarrier> initial;
+  for (uint32_t i = 0; i < textures.size(); i++) {
+    if (textures[i].firstPass == UINT32_MAX || frameEndStates[i].layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+      continue;
+    }
+    TextureManager::Texture& texture = textureOf(i);
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = frameEndStates[i].layout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = texture.image;
+    imageBarrier.subresourceRange = {aspectOf(texture.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    initial.push_back(imageBarrier);
+  }
+  if (!initial.empty()) {
+    cmdUtils->executeCommands([&](VkCommandBuffer cmd) {
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                           static_cast<uint32_t>(initial.size()), initial.data());
+    });
+  }
+  spdlog::info("Render graph: {} passes ({} culled), {} barriers per frame, transient memory {} KB ({} KB without aliasing)", statistics.passes,
+               statistics.culledPasses, statistics.barriers, statistics.heapBytes >> 10, statistics.transientBytes >> 10);
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+  for (size_t i = 0; i < livePasses.size(); i++) {
+    const Barrier& barrier = passBarriers[i];
+    if (barrier.srcStages != 0) {
+      const bool memory = (barrier.memory.srcAccessMask | barrier.memory.dstAccessMask) != 0;
+      vkCmdPipelineBarrier(commandBuffer, barrier.srcStages, barrier.dstStages, 0, memory ? 1 : 0, &barrier.memory, 0, nullptr,
+                           static_cast<uint32_t>(barrier.images.size()), barrier.images.data());
+    }
+    if (livePasses[i]->callback) {
+      livePasses[i]->callback(commandBuffer);
+    }
+  }
+}
+
+void RenderGraph::reset() {
+  for (TextureResource& resource : textures) {
+    for (VkImageView view : resource.levelViews) {
+      vkDestroyImageView(context->device, view, nullptr);
+    }
+  }
+  // Images before the memory they are bound to
+  textures.clear();
+  if (transientMemory != VK_NULL_HANDLE) {
+    vkFreeMemory(context->device, transientMemory, nullptr);
+    transientMemory = VK_NULL_HANDLE;
+  }
+  buffers.clear();
+  passes.clear();
+  livePasses.clear();
+  passBarriers.clear();
+  frameEndStates.clear();
+  statistics = {};
+}
+
+TextureManager::Texture& RenderGraph::texture(TextureHandle handle) { return textureOf(handle.index); }
+
+VkImageView RenderGraph::levelView(TextureHandle handle, uint32_t level) const { return textures[handle.index].levelViews[level]; }
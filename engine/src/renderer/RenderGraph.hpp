@@ -0,0 +1,180 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "renderer/BufferManager.hpp"
+#include "renderer/TextureManager.hpp"
+
+// Frame graph for the deferred renderer
+// Passes are declared in execution order together with the textures and buffers they read and write. compile() drops the
+// passes nothing visible depends on, creates the transient textures in one memory heap (textures whose lifetimes do not
+// overlap share memory) and derives every layout transition and pipeline barrier, execute() records them in front of the
+// pass callbacks. The graph is rebuilt when the swapchain changes size, not every frame.
+// - Imported textures keep their owner, transient textures belong to the graph and are shared by the frames in flight:
+//   the barriers of a frame's first access wait for the previous frame's last access.
+// - Layout transitions always come from the graph. Render passes of graph passes keep their attachments in the layout of
+//   the declared usage (initialLayout == finalLayout == subpass layout), only attachments private to the render pass
+//   (transient G-Buffer targets, the swapchain image) are handled by the render pass itself.
+// - Buffers are synchronized with global memory barriers, hazards between dispatches inside a pass are up to the pass.
+class RenderGraph {
+ public:
+  struct TextureHandle {
+    uint32_t index = UINT32_MAX;
+    bool valid() const { return index != UINT32_MAX; }
+  };
+  struct BufferHandle {
+    uint32_t index = UINT32_MAX;
+    bool valid() const { return index != UINT32_MAX; }
+  };
+
+  // How a pass touches a resource, each usage implies pipeline stages, access flags and (for textures) the image layout
+  enum class Usage {
+    ComputeSampled,       // combined image sampler in a compute shader
+    ComputeSampledDepth,  // depth sampled in a compute shader, depth stencil read-only layout
+    ComputeStorage,       // storage image in a compute shader, read and write
+    FragmentSampled,      // combined image sampler in a fragment shader
+    ColorAttachment,
+    DepthAttachment,  // depth test and write
+    DepthReadOnly,    // depth test without writes and input attachment reads
+    ComputeBufferRead,
+    ComputeBufferWrite,
+    FragmentBufferRead,
+  };
+
+  // Transient texture, the usage flags follow from the declared accesses
+  struct TextureDesc {
+    VkExtent2D extent;
+    VkFormat format;
+    uint32_t mipLevels = 1;
+    bool levelViews = false;  // one view per level in addition to the full view, for storage writes level by level
+  };
+
+  struct Stats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barriers = 0;             // image and memory barriers recorded per frame
+    VkDeviceSize transientBytes = 0;   // sum of the transient texture allocations
+    VkDeviceSize heapBytes = 0;        // memory actually allocated for them
+  };
+
+  class Pass {
+   public:
+    // Contents of the resource are read
+    Pass& read(TextureHandle texture, Usage usage);
+    Pass& read(BufferHandle buffer, Usage usage);
+    // The pass overwrites the resource completely, previous contents are discarded
+    Pass& write(TextureHandle texture, Usage usage);
+    Pass& write(BufferHandle buffer, Usage usage);
+    // Read-modify-write, previous contents are kept
+    Pass& modify(TextureHandle texture, Usage usage);
+    // Never culled (presents, writes results read by the host)
+    Pass& sideEffect();
+    Pass& execute(std::function<void(VkCommandBuffer)> callback);
+
+   private:
+    friend class RenderGraph;
+    struct Access {
+      uint32_t resource;
+      bool texture;
+      Usage usage;
+      bool reads;
+      bool writes;
+    };
+    Pass& add(uint32_t resource, bool texture, Usage usage, bool reads, bool writes);
+
+    std::string name;
+    std::vector<Access> accesses;
+    std::function<void(VkCommandBuffer)> callback;
+    bool hasSideEffect = false;
+  };
+
+  RenderGraph(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<CommandBufferUtils> cmdUtils, std::shared_ptr<BufferManager> bufferMgr,
+              std::shared_ptr<TextureManager> textureMgr)
+      : context(ctx), cmdUtils(cmdUtils), bufferManager(bufferMgr), textureManager(textureMgr) {}
+  ~RenderGraph() { reset(); }
+
+  // Declaration, valid until reset
+  TextureHandle importTexture(const std::string& name, TextureManager::Texture& texture);
+  TextureHandle createTexture(const std::string& name, const TextureDesc& desc);
+  BufferHandle importBuffer(const std::string& name);
+  Pass& addPass(const std::string& name);
+
+  // Culls, allocates the transient textures and computes the barriers
+  // Submits once to move every texture into the layout a frame leaves it in, expects an idle device
+  void compile();
+  // Barriers and pass callbacks of the live passes
+  void execute(VkCommandBuffer commandBuffer);
+  // Destroys the transient textures and forgets every declaration, expects an idle device
+  void reset();
+
+  // Transient textures exist after compile, unless no live pass uses them
+  TextureManager::Texture& texture(TextureHandle handle);
+  VkImageView levelView(TextureHandle handle, uint32_t level) const;
+  const Stats& stats() const { return statistics; }
+
+ private:
+  struct TextureResource {
+    std::string name;
+    TextureManager::Texture* imported = nullptr;
+    TextureManager::Texture transient;
+    TextureDesc desc{};
+    std::vector<VkImageView> levelViews;
+    VkImageUsageFlags usage = 0;
+    uint32_t firstPass = UINT32_MAX;  // lifetime in live pass order
+    uint32_t lastPass = 0;
+    bool aliasable = false;  // first access discards the contents
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+  };
+  struct BufferResource {
+    std::string name;
+  };
+  // Synchronization state of one resource between accesses
+  struct ResourceState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags writeStages = 0;  // last write (or layout transition)
+    VkAccessFlags writeAccess = 0;
+    VkPipelineStageFlags readStages = 0;    // reads since the last write
+    VkPipelineStageFlags visibleStages = 0;  // stages the last write was made visible to
+    VkAccessFlags visibleAccess = 0;
+  };
+  struct UsageInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+  };
+  // Barriers recorded in front of a live pass
+  struct Barrier {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkMemoryBarrier memory{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    std::vector<VkImageMemoryBarrier> images;
+  };
+
+  static UsageInfo usageInfo(Usage usage);
+  static VkImageAspectFlags aspectOf(VkFormat format);
+  TextureManager::Texture& textureOf(uint32_t index);
+  void cull();
+  void allocateTransients();
+  // One pass over the live passes starting from the given states, fills the barriers when requested
+  void simulate(std::vector<ResourceState>& textureStates, std::vector<ResourceState>& bufferStates, std::vector<Barrier>* barriers);
+
+  std::shared_ptr<VulkanContext> context;
+  std::shared_ptr<CommandBufferUtils> cmdUtils;
+  std::shared_ptr<BufferManager> bufferManager;
+  std::shared_ptr<TextureManager> textureManager;
+
+  std::vector<TextureResource> textures;
+  std::vector<BufferResource> buffers;
+  std::vector<std::unique_ptr<Pass>> passes;  // declaration order, stable addresses for the builders
+  std::vector<Pass*> livePasses;
+  std::vector<Barrier> passBarriers;           // one per live pass
+  std::vector<ResourceState> frameEndStates;   // textures, as the previous frame left them
+  VkDeviceMemory transientMemory = VK_NULL_HANDLE;
+  Stats statistics;
+};
@@ -0,0 +1,436 @@
+#include "renderer/ShadowCascades.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stdexcept>
+
+ShadowCascades::ShadowCascades(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<CommandBufferUtils> cmdUtils, std::shared_ptr<TextureManager> textureMgr,
+                               uint32_t framesInFlight, const Settings& initialSettings)
+    : settings(initialSettings), context(ctx), cmdUtils(cmdUtils), textureManager(textureMgr), resolution(initialSettings.resolution) {
+  VkDevice device = context->device;
+  const uint32_t atlasSize = resolution * 2;
+
+  textureManager->InitTexture(atlas, atlasSize, atlasSize, FORMAT, VK_IMAGE_TILING_OPTIMAL,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  atlas.imageView = textureManager->createImageView(atlas.image, FORMAT, VK_IMAGE_ASPECT_DEPTH_BIT);
+  textureManager->InitTexture(cache, atlasSize, atlasSize, FORMAT, VK_IMAGE_TILING_OPTIMAL,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  cache.imageView = textureManager->createImageView(cache.image, FORMAT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+  // Outside the atlas everything is lit: white border, the comparison passes
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  samplerInfo.compareEnable = VK_TRUE;
+  samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  samplerInfo.maxLod = 0.0f;
+  VK_CHECK_RESULT(vkCreateSampler(device, &samplerInfo, nullptr, &atlas.sampler));
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.compareEnable = VK_FALSE;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  VK_CHECK_RESULT(vkCreateSampler(device, &samplerInfo, nullptr, &depthSampler));
+
+  // Tiles are cleared and drawn one by one, the attachment keeps the other tiles
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = FORMAT;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depthRef{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.pDepthStencilAttachment = &depthRef;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &depthAttachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &casterRenderPass));
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = casterRenderPass;
+  framebufferInfo.attachmentCount = 1;
+  framebufferInfo.width = atlasSize;
+  framebufferInfo.height = atlasSize;
+  framebufferInfo.layers = 1;
+  framebufferInfo.pAttachments = &atlas.imageView;
+  VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &atlasFramebuffer));
+  framebufferInfo.pAttachments = &cache.imageView;
+  VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &cacheFramebuffer));
+
+  // The cache rests in transfer source layout between updates
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) {
+    imageBarrier(cmd, cache.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+                 VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+  });
+  cache.currentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  if (context->properties.limits.timestampComputeAndGraphics) {
+    VkQueryPoolCreateInfo queryPoolCI{};
+    queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount = framesInFlight * QUERIES_PER_FRAME;
+    VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &queryPool));
+    cmdUtils->executeCommands([&](VkCommandBuffer cmd) { vkCmdResetQueryPool(cmd, queryPool, 0, queryPoolCI.queryCount); });
+  }
+}
+
+ShadowCascades::~ShadowCascades() {
+  VkDevice device = context->device;
+  if (queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, queryPool, nullptr);
+  }
+  vkDestroyFramebuffer(device, atlasFramebuffer, nullptr);
+  vkDestroyFramebuffer(device, cacheFramebuffer, nullptr);
+  vkDestroyRenderPass(device, casterRenderPass, nullptr);
+  vkDestroySampler(device, depthSampler, nullptr);
+  textureManager->destroyTexture(atlas);
+  textureManager->destroyTexture(cache);
+}
+
+void ShadowCascades::setCasterBounds(const glm::vec3& min, const glm::vec3& max) {
+  boundsMin = min;
+  boundsMax = max;
+}
+
+void ShadowCascades::update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection) {
+  const glm::vec3 lightDir = glm::normalize(lightDirection);
+  const glm::vec3 up = std::abs(lightDir.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+  lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+  const glm::mat4 invView = glm::inverse(view);
+
+  // Light space depth range of the casters, shared by every cascade so moving the camera leaves it alone
+  float minZ = FLT_MAX;
+  float maxZ = -FLT_MAX;
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    glm::vec3 p((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y, (corner & 4) ? boundsMax.z : boundsMin.z);
+    float z = (lightView * glm::vec4(p, 1.0f)).z;
+    minZ = std::min(minZ, z);
+    maxZ = std::max(maxZ, z);
+  }
+  // A little slack so casters touching the box are not clipped
+  minZ -= 0.5f;
+  maxZ += 0.5f;
+
+  const float farPlane = std::max(settings.maxDistance, nearPlane * 2.0f);
+  const float tanHalfFov = std::tan(fovY * 0.5f);
+  const float diagonal2 = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);  // squared corner offset per unit of view depth
+  float splitNear = nearPlane;
+  for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+    Cascade& cascade = cascades[i];
+    const float p = static_cast<float>(i + 1) / CASCADE_COUNT;
+    const float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+    const float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+    const float splitFar = settings.splitLambda * (logSplit - uniformSplit) + uniformSplit;
+
+    // Smallest sphere around the slice: its center lies on the view axis, equally far from the near and far corners
+    float center = std::min((splitNear + splitFar) * (1.0f + diagonal2) * 0.5f, splitFar);
+    float radius = std::sqrt((splitFar - center) * (splitFar - center) + splitFar * splitFar * diagonal2);
+    radius = std::ceil(radius * 16.0f) / 16.0f;  // keeps the texel size constant against rounding
+
+    const float texelSize = 2.0f * radius / static_cast<float>(resolution);
+    glm::vec3 lightCenter = glm::vec3(lightView * invView * glm::vec4(0.0f, 0.0f, -center, 1.0f));
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+    cascade.splitNear = splitNear;
+    cascade.splitFar = splitFar;
+    cascade.lightMin = glm::vec3(lightCenter.x - radius, lightCenter.y - radius, minZ);
+    cascade.lightMax = glm::vec3(lightCenter.x + radius, lightCenter.y + radius, maxZ);
+    // Light looks down -z, the nearest caster has the largest z and gets depth 0. Zero to one depth regardless of the
+    // GLM_FORCE_DEPTH_ZERO_TO_ONE state of this translation unit, shadow_cascades.glsl compares against [0, 1]
+    const glm::mat4 proj = glm::orthoRH_ZO(cascade.lightMin.x, cascade.lightMax.x, cascade.lightMin.y, cascade.lightMax.y, -maxZ, -minZ);
+    const glm::mat4 viewProj = proj * lightView;
+    if (viewProj != cascade.viewProj) {
+      cascade.viewProj = viewProj;
+      cascade.cacheDirty = true;
+    }
+
+    // Clip xy to the uv range of the cascade's tile
+    glm::mat4 tile(1.0f);
+    tile[0][0] = 0.25f;
+    tile[1][1] = 0.25f;
+    tile[3][0] = 0.25f + 0.5f * static_cast<float>(i % 2);
+    tile[3][1] = 0.25f + 0.5f * static_cast<float>(i / 2);
+    uniforms.atlasFromWorld[i] = tile * viewProj;
+    uniforms.casterViewProj[i] = viewProj;
+    uniforms.splitDepth[i] = splitFar;
+    uniforms.texelSize[i] = texelSize;
+    uniforms.depthRange[i] = maxZ - minZ;
+    splitNear = splitFar;
+  }
+  uniforms.filterMode = static_cast<int>(settings.filter);
+  uniforms.tanLightAngle = std::tan(glm::radians(settings.lightAngle) * 0.5f);
+  uniforms.normalOffset = settings.normalOffset;
+  uniforms.showCascades = settings.showCascades ? 1 : 0;
+}
+
+void ShadowCascades::invalidateCache() {
+  for (Cascade& cascade : cascades) {
+    cascade.cacheDirty = true;
+  }
+}
+
+bool ShadowCascades::casterVisible(uint32_t cascadeIndex, const glm::vec3& worldMin, const glm::vec3& worldMax) {
+  const bool visible = boundsVisible(cascadeIndex, worldMin, worldMax);
+  if (visible) {
+    cascades[cascadeIndex].casters++;
+  } else {
+    cascades[cascadeIndex].culled++;
+  }
+  return visible;
+}
+
+bool ShadowCascades::boundsVisible(uint32_t cascadeIndex, const glm::vec3& worldMin, const glm::vec3& worldMax) const {
+  const Cascade& cascade = cascades[cascadeIndex];
+  glm::vec2 lightMin(FLT_MAX);
+  glm::vec2 lightMax(-FLT_MAX);
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    glm::vec3 p((corner & 1) ? worldMax.x : worldMin.x, (corner & 2) ? worldMax.y : worldMin.y, (corner & 4) ? worldMax.z : worldMin.z);
+    glm::vec2 l = glm::vec2(lightView * glm::vec4(p, 1.0f));
+    lightMin = glm::min(lightMin, l);
+    lightMax = glm::max(lightMax, l);
+  }
+  // Depth is not tested: every caster lies inside the caster bounds the depth range was fit to
+  return lightMax.x >= cascade.lightMin.x && lightMin.x <= cascade.lightMax.x && lightMax.y >= cascade.lightMin.y &&
+         lightMin.y <= cascade.lightMax.y;
+}
+
+VkViewport ShadowCascades::tileViewport(uint32_t cascadeIndex) const {
+  VkViewport viewport{};
+  viewport.x = static_cast<float>((cascadeIndex % 2) * resolution);
+  viewport.y = static_cast<float>((cascadeIndex / 2) * resolution);
+  viewport.width = static_cast<float>(resolution);
+  viewport.height = static_cast<float>(resolution);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  return viewport;
+}
+
+VkRect2D ShadowCascades::tileRect(uint32_t cascadeIndex) const {
+  VkRect2D rect{};
+  rect.offset = {static_cast<int32_t>((cascadeIndex % 2) * resolution), static_cast<int32_t>((cascadeIndex / 2) * resolution)};
+  rect.extent = {resolution, resolution};
+  return rect;
+}
+
+VkDescriptorImageInfo ShadowCascades::compareDescriptor() const {
+  return {atlas.sampler, atlas.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+}
+
+VkDescriptorImageInfo ShadowCascades::depthDescriptor() const {
+  return {depthSampler, atlas.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+}
+
+void ShadowCascades::imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                  VkPipelineStageFlags srcStages, VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void ShadowCascades::readTimings(uint32_t frame) {
+  if (queryPool == VK_NULL_HANDLE) {
+    return;
+  }
+  uint64_t timestamps[QUERIES_PER_FRAME];
+  if (vkGetQueryPoolResults(context->device, queryPool, frame * QUERIES_PER_FRAME, QUERIES_PER_FRAME, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+    return;
+  }
+  const float period = context->properties.limits.timestampPeriod / 1000000.0f;
+  auto smooth = [](float& avg, float ms) { avg = avg == 0.0f ? ms : avg * 0.95f + ms * 0.05f; };
+  for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+    // Cache updates are rare, the last one is shown as is
+    cascades[i].staticMs = static_cast<float>(timestamps[i * 4 + 1] - timestamps[i * 4]) * period;
+    smooth(cascades[i].dynamicMs, static_cast<float>(timestamps[i * 4 + 3] - timestamps[i * 4 + 2]) * period);
+  }
+  smooth(cacheCopyMs, static_cast<float>(timestamps[CASCADE_COUNT * 4 + 1] - timestamps[CASCADE_COUNT * 4]) * period);
+}
+
+void ShadowCascades::record(VkCommandBuffer commandBuffer, uint32_t frame, VkImageLayout finalLayout, const DrawCasters& drawCasters) {
+  readTimings(frame);
+  const uint32_t queryBase = frame * QUERIES_PER_FRAME;
+  auto timestamp = [&](VkPipelineStageFlagBits stage, uint32_t query) {
+    if (queryPool != VK_NULL_HANDLE) {
+      vkCmdWriteTimestamp(commandBuffer, stage, queryPool, queryBase + query);
+    }
+  };
+  if (queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, queryPool, queryBase, QUERIES_PER_FRAME);
+  }
+
+  const bool useCache = settings.cacheStatic;
+  if (useCache && (!wasCached || cachedBiasConstant != settings.depthBiasConstant || cachedBiasSlope != settings.depthBiasSlope)) {
+    invalidateCache();
+  }
+  wasCached = useCache;
+  cachedBiasConstant = settings.depthBiasConstant;
+  cachedBiasSlope = settings.depthBiasSlope;
+  for (Cascade& cascade : cascades) {
+    cascade.casters = 0;
+    cascade.culled = 0;
+  }
+
+  auto setTile = [&](uint32_t cascadeIndex) {
+    VkViewport viewport = tileViewport(cascadeIndex);
+    VkRect2D scissor = tileRect(cascadeIndex);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    vkCmdSetDepthBias(commandBuffer, settings.depthBiasConstant, 0.0f, settings.depthBiasSlope);
+  };
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = casterRenderPass;
+  renderPassInfo.renderArea.extent = {resolution * 2, resolution * 2};
+
+  // ==== STATIC CASTERS (cache, only the cascades whose projection changed) ====
+  bool anyDirty = false;
+  for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+    if (!useCache || !cascades[i].cacheDirty) {
+      // Empty interval, every query of the frame is written
+      if (useCache) {
+        timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, i * 4);
+        timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, i * 4 + 1);
+      }
+      continue;
+    }
+    anyDirty = true;
+  }
+  if (anyDirty) {
+    imageBarrier(commandBuffer, cache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                 0, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    renderPassInfo.framebuffer = cacheFramebuffer;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+      if (!cascades[i].cacheDirty) {
+        continue;
+      }
+      timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, i * 4);
+      VkClearAttachment clear{VK_IMAGE_ASPECT_DEPTH_BIT, 0, {}};
+      clear.clearValue.depthStencil = {1.0f, 0};
+      VkClearRect clearRect{tileRect(i), 0, 1};
+      vkCmdClearAttachments(commandBuffer, 1, &clear, 1, &clearRect);
+      setTile(i);
+      drawCasters(commandBuffer, i, true);
+      timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, i * 4 + 1);
+      cascades[i].cacheDirty = false;
+      cascades[i].cacheUpdates++;
+      atlasTileCached[i] = false;
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    imageBarrier(commandBuffer, cache.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                 VK_ACCESS_TRANSFER_READ_BIT);
+  }
+
+  // ==== CACHE COPY (or clear without the cache) ====
+  // Only the tiles that no longer hold the cache, the others keep last frame's contents
+  const VkPipelineStageFlags atlasStages =
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  const bool atlasValid = atlas.currentLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+  std::array<VkImageCopy, CASCADE_COUNT> regions{};
+  uint32_t regionCount = 0;
+  for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+    if (useCache && (!atlasValid || !atlasTileCached[i])) {
+      const VkRect2D rect = tileRect(i);
+      VkImageCopy& region = regions[regionCount++];
+      region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+      region.dstSubresource = region.srcSubresource;
+      region.srcOffset = {rect.offset.x, rect.offset.y, 0};
+      region.dstOffset = region.srcOffset;
+      region.extent = {resolution, resolution, 1};
+    }
+    atlasTileCached[i] = useCache && !(dynamicCascades & (1u << i));
+  }
+  lastCopiedTiles = regionCount;
+
+  VkImageLayout layout = atlasValid ? atlas.currentLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+  timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, CASCADE_COUNT * 4);
+  if (regionCount > 0 || !useCache) {
+    const bool discard = !useCache || regionCount == CASCADE_COUNT;
+    imageBarrier(commandBuffer, atlas.image, discard ? VK_IMAGE_LAYOUT_UNDEFINED : layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, atlasStages,
+                 discard ? 0 : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    if (useCache) {
+      vkCmdCopyImage(commandBuffer, cache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount,
+                     regions.data());
+    } else {
+      VkClearDepthStencilValue clearValue{1.0f, 0};
+      VkImageSubresourceRange range{VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+      vkCmdClearDepthStencilImage(commandBuffer, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
+    }
+    layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  }
+  timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, CASCADE_COUNT * 4 + 1);
+
+  // ==== DYNAMIC CASTERS (cascades they can reach, static ones too without the cache) ====
+  const bool drawAtlas = !useCache || dynamicCascades != 0;
+  if (drawAtlas) {
+    const bool copied = layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier(commandBuffer, atlas.image, layout, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, copied ? VK_PIPELINE_STAGE_TRANSFER_BIT : atlasStages,
+                 copied ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    renderPassInfo.framebuffer = atlasFramebuffer;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  }
+  for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+    const bool dynamic = (dynamicCascades & (1u << i)) != 0;
+    if (!useCache || dynamic) {
+      setTile(i);
+    }
+    if (!useCache) {
+      timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, i * 4);
+      drawCasters(commandBuffer, i, true);
+      timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, i * 4 + 1);
+    }
+    timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, i * 4 + 2);
+    if (dynamic) {
+      drawCasters(commandBuffer, i, false);
+    }
+    timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, i * 4 + 3);
+  }
+  if (drawAtlas) {
+    vkCmdEndRenderPass(commandBuffer);
+  }
+
+  if (layout != finalLayout) {
+    const bool copied = layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    const bool drawn = layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    const bool attachment = finalLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    imageBarrier(commandBuffer, atlas.image, layout, finalLayout,
+                 copied ? VK_PIPELINE_STAGE_TRANSFER_BIT : drawn ? VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : atlasStages,
+                 copied ? VK_ACCESS_TRANSFER_WRITE_BIT : drawn ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0,
+                 attachment ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                 attachment ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT);
+  }
+  atlas.currentLayout = finalLayout;
+}
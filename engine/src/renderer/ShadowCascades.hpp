@@ -0,0 +1,155 @@
+#pragma once
+// Sets the GLM_FORCE_* options, has to precede the first glm include
+#include "defines.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "renderer/CommandBufferUtils.hpp"
+#include "renderer/TextureManager.hpp"
+
+// Cascaded shadow map of one directional light, sampled by shaders/shadow_cascades.glsl
+// The camera frustum is split between its near plane and maxDistance (practical split scheme: a blend of uniform and
+// logarithmic splits), every cascade is an orthographic projection around the bounding sphere of its frustum slice and
+// owns one tile of a 2x2 depth atlas. The sphere keeps the size of a cascade constant while the camera turns and its
+// center is snapped to whole shadow map texels in light space, so shadow edges do not shimmer while the camera moves.
+// Static casters are drawn into a cache atlas only when the projection of their cascade changed (light direction,
+// camera moved by a texel or more). The sampled atlas keeps its tiles between frames, a tile is copied back from the
+// cache when the cache tile changed or dynamic casters were drawn over it, so cascades without dynamic casters cost
+// nothing while the cache is valid.
+class ShadowCascades {
+ public:
+  static constexpr uint32_t CASCADE_COUNT = 4;  // must match shadow_cascades.glsl
+  static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+
+  // Hard: one hardware 2x2 comparison, PCF: 16 rotated Poisson taps, PCSS: penumbra width from a blocker search
+  enum class Filter : int { Hard, PCF, PCSS };  // must match shadow_cascades.glsl
+
+  struct Settings {
+    uint32_t resolution = 2048;  // per cascade, read at construction
+    float maxDistance = 50.0f;   // view depth the last cascade ends at
+    float splitLambda = 0.75f;   // 0 uniform, 1 logarithmic splits
+    Filter filter = Filter::PCF;
+    float lightAngle = 0.5f;  // angular diameter of the light in degrees, PCSS penumbra size
+    // Slope scaled raster bias of the casters and receiver offset along the normal in texels
+    float depthBiasConstant = 1.25f;
+    float depthBiasSlope = 1.75f;
+    float normalOffset = 1.0f;
+    bool cacheStatic = true;  // off: static casters are drawn every frame
+    bool showCascades = false;
+  };
+
+  // std140, must match ShadowUBO in shadow_cascades.glsl
+  struct UniformData {
+    glm::mat4 atlasFromWorld[CASCADE_COUNT];  // xy = atlas uv inside the cascade's tile, z = depth
+    glm::mat4 casterViewProj[CASCADE_COUNT];  // Cascade::viewProj, for caster shaders that read the UBO
+    glm::vec4 splitDepth;                     // view depth each cascade ends at
+    glm::vec4 texelSize;                      // world units per texel of each cascade
+    glm::vec4 depthRange;                     // world units between the near and far plane of each cascade
+    int filterMode;
+    float tanLightAngle;
+    float normalOffset;
+    int showCascades;
+  };
+
+  struct Cascade {
+    glm::mat4 viewProj{1.0f};  // world to clip space, drawn into the cascade's tile through the viewport
+    float splitNear = 0.0f;    // view depth
+    float splitFar = 0.0f;
+    // Light space box, x and y snapped to texels
+    glm::vec3 lightMin{0.0f};
+    glm::vec3 lightMax{0.0f};
+    bool cacheDirty = true;
+    // Recorded frame
+    uint32_t casters = 0;  // casterVisible tests that passed
+    uint32_t culled = 0;
+    // Last completed frame
+    float staticMs = 0.0f;  // cache update, 0 while the cache is valid
+    float dynamicMs = 0.0f;
+    uint32_t cacheUpdates = 0;  // since creation
+  };
+
+  // Called with the cascade to draw and whether the static or the dynamic casters are wanted. Viewport, scissor and depth
+  // bias are set, the caster pipelines are created for renderPass() with those as dynamic state and depth bias enabled
+  using DrawCasters = std::function<void(VkCommandBuffer, uint32_t cascade, bool staticCasters)>;
+
+  ShadowCascades(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<CommandBufferUtils> cmdUtils, std::shared_ptr<TextureManager> textureMgr,
+                 uint32_t framesInFlight, const Settings& initialSettings = Settings());
+  ~ShadowCascades();
+  ShadowCascades(const ShadowCascades&) = delete;
+  ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+  // World space box the casters lie in, light space near and far planes enclose it
+  void setCasterBounds(const glm::vec3& min, const glm::vec3& max);
+  // Refits the cascades, call once per frame before record. lightDirection is the direction the light travels
+  void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection);
+  // Static casters moved or changed
+  void invalidateCache();
+  // Per cascade caster culling against the light space box of the cascade, counted in the cascade stats
+  bool casterVisible(uint32_t cascade, const glm::vec3& worldMin, const glm::vec3& worldMax);
+  // The same test without the stats
+  bool boundsVisible(uint32_t cascade, const glm::vec3& worldMin, const glm::vec3& worldMax) const;
+  // Bit per cascade the dynamic casters can reach, call after update. Cascades without the bit get no dynamic draw
+  // callback and keep their cached tile in the atlas. All cascades by default
+  void setDynamicCascades(uint32_t cascadeMask) { dynamicCascades = cascadeMask; }
+  // The atlas contents were discarded outside record (render graph rebuild), every tile is restored from the cache
+  void discardAtlas() { atlas.currentLayout = VK_IMAGE_LAYOUT_UNDEFINED; }
+
+  // Reads the timings of the last use of the frame slot (its fence has to be waited on) and records the cache update,
+  // the tile copies and the dynamic casters. The shadow map has to be in the layout the previous record left it in (or be
+  // discarded with discardAtlas) and ends in finalLayout
+  void record(VkCommandBuffer commandBuffer, uint32_t frame, VkImageLayout finalLayout, const DrawCasters& drawCasters);
+
+  VkRenderPass renderPass() const { return casterRenderPass; }
+  TextureManager::Texture& shadowMap() { return atlas; }
+  // Comparison sampler (hardware 2x2 PCF) and a plain one for the PCSS blocker search, both in shader read layout
+  VkDescriptorImageInfo compareDescriptor() const;
+  VkDescriptorImageInfo depthDescriptor() const;
+  const UniformData& uniformData() const { return uniforms; }
+  const Cascade& cascade(uint32_t index) const { return cascades[index]; }
+  const glm::mat4& lightFromWorld() const { return lightView; }
+  float copyMs() const { return cacheCopyMs; }
+  uint32_t copiedTiles() const { return lastCopiedTiles; }  // recorded frame
+
+  Settings settings;
+
+ private:
+  // Per frame: static begin/end and dynamic begin/end of every cascade, then the copy begin/end
+  static constexpr uint32_t QUERIES_PER_FRAME = CASCADE_COUNT * 4 + 2;
+
+  VkViewport tileViewport(uint32_t cascade) const;
+  VkRect2D tileRect(uint32_t cascade) const;
+  void readTimings(uint32_t frame);
+  void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStages,
+                    VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+
+  std::shared_ptr<VulkanContext> context;
+  std::shared_ptr<CommandBufferUtils> cmdUtils;
+  std::shared_ptr<TextureManager> textureManager;
+
+  uint32_t resolution;
+  TextureManager::Texture atlas;  // sampled, CASCADE_COUNT tiles of resolution^2
+  TextureManager::Texture cache;  // static casters only
+  VkSampler depthSampler = VK_NULL_HANDLE;
+  VkRenderPass casterRenderPass = VK_NULL_HANDLE;  // loads and stores the depth attachment
+  VkFramebuffer atlasFramebuffer = VK_NULL_HANDLE;
+  VkFramebuffer cacheFramebuffer = VK_NULL_HANDLE;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+
+  std::array<Cascade, CASCADE_COUNT> cascades;
+  UniformData uniforms{};
+  glm::mat4 lightView{1.0f};  // rotation into light space, the light travels along -z
+  glm::vec3 boundsMin{-1.0f};
+  glm::vec3 boundsMax{1.0f};
+  bool wasCached = false;  // cache contents are stale after frames without it
+  uint32_t dynamicCascades = (1u << CASCADE_COUNT) - 1;
+  std::array<bool, CASCADE_COUNT> atlasTileCached{};  // atlas tile holds the cache tile, nothing drawn over it
+  uint32_t lastCopiedTiles = 0;
+  float cachedBiasConstant = 0.0f;  // the cache holds depths rendered with this bias
+  float cachedBiasSlope = 0.0f;
+  float cacheCopyMs = 0.0f;
+};
@@ -4,18 +4,25 @@
 #include <spdlog/spdlog.h>
 #include <stb_image.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <mutex>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <stdexcept>
 
 #include "TextureManager.hpp"
+#include "core/utils.hpp"
+#include "renderer/EquirectConverter.hpp"
 
 void TextureManager::InitTexture(Texture& texture, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
                                  VkImageUsageFlags usage, VkMemoryPropertyFlags properties, uint32_t mipLevels,
-                                 VkSampleCountFlagBits numSamples) {
+                                 VkSampleCountFlagBits numSamples, VkImageCreateFlags flags) {
   // Initialize texture properties
   texture.device = context->device;
   texture.extent = {width, height, 1};
@@ -39,6 +46,7 @@ void TextureManager::InitTexture(Texture& texture, uint32_t width, uint32_t heig
   imageInfo.usage = usage;
   imageInfo.samples = numSamples;
   imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = flags;
 
   if (vkCreateImage(context->device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
@@ -241,18 +249,121 @@ TextureManager::Texture TextureManager::createTextureFromFile(const std::string&
   return texture;
 }
 
+namespace {
+// Transcode target for basis compressed KTX2 files, BC7 or BC3 when the device samples them, RGBA8 otherwise
+ktx_transcode_fmt_e basisTranscodeTarget(const VulkanContext& context, VkFormat& format) {
+  auto formatSupported = [&](VkFormat candidate) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(context.physicalDevice, candidate, &formatProperties);
+    return ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_TRANSFER_DST_BIT) &&
+            (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT));
+  };
+  format = VK_FORMAT_R8G8B8A8_UNORM;
+  if (context.enabledFeatures.textureCompressionBC) {
+    if (formatSupported(VK_FORMAT_BC7_UNORM_BLOCK)) {
+      format = VK_FORMAT_BC7_UNORM_BLOCK;
+      return KTX_TTF_BC7_RGBA;
+    }
+    if (formatSupported(VK_FORMAT_BC3_UNORM_BLOCK)) {
+      format = VK_FORMAT_BC3_UNORM_BLOCK;
+      return KTX_TTF_BC3_RGBA;
+    }
+  }
+  return KTX_TTF_RGBA32;
+}
+
+// The basis transcoder initializes its global tables lazily on the first transcode without locking, the first call runs alone
+ktx_error_code_e transcodeBasis(ktxTexture2* ktxTex, ktx_transcode_fmt_e targetFormat) {
+  static std::once_flag firstTranscode;
+  bool transcoded = false;
+  ktx_error_code_e result = KTX_SUCCESS;
+  std::call_once(firstTranscode, [&]() {
+    result = ktxTexture2_TranscodeBasis(ktxTex, targetFormat, 0);
+    transcoded = true;
+  });
+  return transcoded ? result : ktxTexture2_TranscodeBasis(ktxTex, targetFormat, 0);
+}
+
+// png/jpg pixels as RGBA with the component size of the image, opaque alpha and white for missing channels
+std::vector<uint8_t> expandToRGBA(const tinygltf::Image& gltfImage) {
+  if (gltfImage.component == 4) {
+    return gltfImage.image;
+  }
+  const size_t componentSize = gltfImage.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ? 2 : 1;
+  const size_t texelCount = static_cast<size_t>(gltfImage.width) * gltfImage.height;
+  const size_t srcStride = gltfImage.component * componentSize;
+  std::vector<uint8_t> rgba(texelCount * 4 * componentSize, 0xff);
+  for (size_t i = 0; i < texelCount; i++) {
+    memcpy(rgba.data() + i * 4 * componentSize, gltfImage.image.data() + i * srcStride, srcStride);
+  }
+  return rgba;
+}
+
+bool supportsLinearBlit(VkPhysicalDevice physicalDevice, VkFormat format) {
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+  const VkFormatFeatureFlags required =
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (properties.optimalTilingFeatures & required) == required;
+}
+
+// 2x2 box filter of an RGBA image, odd edges clamp
+template <typename T>
+void downsampleRGBA(const T* src, uint32_t srcWidth, uint32_t srcHeight, T* dst, uint32_t dstWidth, uint32_t dstHeight) {
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+    const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+    for (uint32_t x = 0; x < dstWidth; x++) {
+      const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+      const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+      for (uint32_t c = 0; c < 4; c++) {
+        uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] + src[(y1 * srcWidth + x0) * 4 + c] +
+                       src[(y1 * srcWidth + x1) * 4 + c];
+        dst[(y * dstWidth + x) * 4 + c] = static_cast<T>((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+// Box filter of sRGB encoded color, averaged in linear space, alpha stays linear
+void downsampleRGBA8Srgb(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight) {
+  static const std::array<float, 256> toLinear = []() {
+    std::array<float, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+      const float c = i / 255.0f;
+      table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }();
+  auto toSrgb = [](float linear) {
+    const float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+  };
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+    const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+    for (uint32_t x = 0; x < dstWidth; x++) {
+      const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+      const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+      const uint8_t* taps[4] = {src + (y0 * srcWidth + x0) * 4, src + (y0 * srcWidth + x1) * 4, src + (y1 * srcWidth + x0) * 4,
+                                src + (y1 * srcWidth + x1) * 4};
+      uint8_t* out = dst + (y * dstWidth + x) * 4;
+      for (uint32_t c = 0; c < 3; c++) {
+        out[c] = toSrgb((toLinear[taps[0][c]] + toLinear[taps[1][c]] + toLinear[taps[2][c]] + toLinear[taps[3][c]]) * 0.25f);
+      }
+      out[3] = static_cast<uint8_t>((taps[0][3] + taps[1][3] + taps[2][3] + taps[3][3] + 2) / 4);
+    }
+  }
+}
+}  // namespace
+
 TextureManager::Texture TextureManager::createTextureFromGLTFImage(const tinygltf::Image& gltfImage, std::string path,
                                                                    TextureSampler textureSampler, VkQueue copyQueue) {
   Texture texture;
   spdlog::info("Creating texture from glTF image: {}", gltfImage.name);
 
   // KTX2 files need to be handled explicitly
-  bool isKtx2 = false;
-  if (gltfImage.uri.find_last_of(".") != std::string::npos) {
-    if (gltfImage.uri.substr(gltfImage.uri.find_last_of(".") + 1) == "ktx2") {
-      isKtx2 = true;
-    }
-  }
+  const bool isKtx2 = isKtx2Image(gltfImage);
 
   VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
 
@@ -269,28 +380,11 @@ TextureManager::Texture TextureManager::createTextureFromGLTFImage(const tinyglt
     }
 
     // Select target format based on device features
-    ktx_transcode_fmt_e targetFormat = KTX_TTF_RGBA32;  // Default uncompressed
-
-    auto formatSupported = [&](VkFormat format) {
-      VkFormatProperties formatProperties;
-      vkGetPhysicalDeviceFormatProperties(context->physicalDevice, format, &formatProperties);
-      return ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_TRANSFER_DST_BIT) &&
-              (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT));
-    };
-
-    if (context->features.textureCompressionBC) {
-      if (formatSupported(VK_FORMAT_BC7_UNORM_BLOCK)) {
-        targetFormat = KTX_TTF_BC7_RGBA;
-        format = VK_FORMAT_BC7_UNORM_BLOCK;
-      } else if (formatSupported(VK_FORMAT_BC3_UNORM_BLOCK)) {
-        targetFormat = KTX_TTF_BC3_RGBA;
-        format = VK_FORMAT_BC3_UNORM_BLOCK;
-      }
-    }
+    ktx_transcode_fmt_e targetFormat = basisTranscodeTarget(*context, format);
 
     // Transcode if needed (basis compressed)
     if (ktxTexture2_NeedsTranscoding(ktxTex)) {
-      ktx_error_code_e transcode_result = ktxTexture2_TranscodeBasis(ktxTex, targetFormat, 0);
+      ktx_error_code_e transcode_result = transcodeBasis(ktxTex, targetFormat);
       if (transcode_result != KTX_SUCCESS) {
         ktxTexture_Destroy(ktxTexture(ktxTex));
         throw std::runtime_error("Failed to transcode KTX2 texture: " + filename);
@@ -361,134 +455,315 @@ TextureManager::Texture TextureManager::createTextureFromGLTFImage(const tinyglt
 
   } else {  // Image is a basic glTF format like png or jpg and can be
             // loaded directly via tinyglTF
-    std::vector<unsigned char> buffer;
-    VkDeviceSize bufferSize = 0;
-    if (gltfImage.component == 3) {
-      // convert to rgba
-      u32 resolution = gltfImage.width * gltfImage.height;
-      bufferSize = resolution * 4;
-      buffer.resize(bufferSize);
-      unsigned char* rgba = buffer.data();
-      const unsigned char* rgb = gltfImage.image.data();
-      for (uint32_t i = 0; i < resolution; ++i) {
-        rgba[0] = rgb[0];
-        rgba[1] = rgb[1];
-        rgba[2] = rgb[2];
-        rgba[3] = 255;  // opaque
-
-        rgba += 4;
-        rgb += 3;
-      }
-    } else {
-      buffer = gltfImage.image;
-      bufferSize = gltfImage.image.size();
+    UploadBatch batch = beginUploadBatch();
+    try {
+      uploadGLTFImage(texture, gltfImage, textureSampler, false, batch);
+    } catch (...) {
+      abandonUploadBatch(batch);
+      throw;
     }
-    // PNG supports up to 64 bits
-    if (gltfImage.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-      format = VK_FORMAT_R16G16B16A16_UNORM;
-    }
-    texture.mipLevels = static_cast<uint32_t>(floor(log2(std::max(gltfImage.width, gltfImage.height))) + 1.0);
-    // texture.mipLevels =
-    // static_cast<uint32_t>(floor(log2(std::max(texture.extent.width,
-    // texture.extent.height))) + 1.0);
+    endUploadBatch(batch);
+    return texture;
+  }
 
-    // upload image data to staging buffer
-    BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(bufferSize);
-    void* data;
-    vkMapMemory(context->device, stagingBuffer.memory, 0, bufferSize, 0, &data);
-    memcpy(data, buffer.data(), bufferSize);
-    vkUnmapMemory(context->device, stagingBuffer.memory);
-    // Create the texture image
-    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    InitTexture(texture, static_cast<uint32_t>(gltfImage.width), static_cast<uint32_t>(gltfImage.height), format,
-                VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.mipLevels);
+  // Create image view
+  texture.imageView = createImageView(texture.image, format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
 
-    VkCommandBuffer copyCmd = cmdUtils->beginSingleTimeCommands();
-    // undefined --> ready to recieve data
-    transitionImageLayout(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyCmd,
-                          texture.mipLevels);
-    // Copy buffer to mip level = 0
-    copyBufferToImage(texture, stagingBuffer.buffer, copyCmd, 0, 0, texture.extent);
-
-    // Transition first mip level to transfer source for mipmap
-    // generation
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.image = texture.image;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
+  // Create sampler based on textureSampler parameter
+  texture.sampler = createTextureSampler(textureSampler, static_cast<float>(texture.mipLevels));
+  // descriptor
+  texture.descriptor.imageLayout = texture.currentLayout;
+  texture.descriptor.imageView = texture.imageView;
+  texture.descriptor.sampler = texture.sampler;
 
-    int32_t mipWidth = texture.extent.width;
-    int32_t mipHeight = texture.extent.height;
+  return texture;
+}
 
-    for (uint32_t i = 1; i < texture.mipLevels; i++) {
-      barrier.subresourceRange.baseMipLevel = i - 1;
-      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+TextureManager::UploadBatch TextureManager::beginUploadBatch() {
+  UploadBatch batch;
+  batch.commandBuffer = cmdUtils->beginSingleTimeCommands();
+  return batch;
+}
 
-      vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
-                           nullptr, 1, &barrier);
+void TextureManager::uploadGLTFImage(Texture& texture, const tinygltf::Image& gltfImage, TextureSampler textureSampler, bool srgb,
+                                     UploadBatch& batch) {
+  // PNG supports up to 64 bits
+  const bool is16Bit = gltfImage.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+  const VkFormat viewFormat = is16Bit ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+  // Blits decode and re-encode sRGB images, so the chain averages linear values. Shaders decode sRGB themselves, they sample
+  // through a UNORM view of the same image
+  VkFormat imageFormat = viewFormat;
+  if (srgb && !is16Bit && supportsLinearBlit(context->physicalDevice, VK_FORMAT_R8G8B8A8_SRGB)) {
+    imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+  }
+  const uint32_t mipLevels = static_cast<uint32_t>(floor(log2(std::max(gltfImage.width, gltfImage.height)))) + 1;
 
-      VkImageBlit blit{};
-      blit.srcOffsets[0] = {0, 0, 0};
-      blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      blit.srcSubresource.mipLevel = i - 1;
-      blit.srcSubresource.baseArrayLayer = 0;
-      blit.srcSubresource.layerCount = 1;
-      blit.dstOffsets[0] = {0, 0, 0};
-      blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      blit.dstSubresource.mipLevel = i;
-      blit.dstSubresource.baseArrayLayer = 0;
-      blit.dstSubresource.layerCount = 1;
+  std::vector<uint8_t> rgba = expandToRGBA(gltfImage);
+  BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(rgba.size());
+  bufferManager->updateBuffer(stagingBuffer, rgba.data(), rgba.size(), 0);
 
-      vkCmdBlitImage(copyCmd, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image,
-                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  InitTexture(texture, static_cast<uint32_t>(gltfImage.width), static_cast<uint32_t>(gltfImage.height), imageFormat, VK_IMAGE_TILING_OPTIMAL, usage,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels, VK_SAMPLE_COUNT_1_BIT,
+              imageFormat != viewFormat ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT : 0);
+  texture.format = viewFormat;  // what shaders see
+
+  // undefined --> ready to recieve data, the mips are written by endUploadBatch
+  transitionImageLayout(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, batch.commandBuffer, mipLevels);
+  copyBufferToImage(texture, stagingBuffer.buffer, batch.commandBuffer, 0, 0, texture.extent);
+
+  texture.imageView = createImageView(texture.image, viewFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+  texture.sampler = createTextureSampler(textureSampler, static_cast<float>(mipLevels));
+  batch.stagingBuffers.push_back(std::move(stagingBuffer));
+  batch.textures.push_back(&texture);
+}
 
-      // Transition previous mip level to shader read
+void TextureManager::endUploadBatch(UploadBatch& batch) {
+  VkCommandBuffer cmd = batch.commandBuffer;
+  uint32_t maxLevels = 1;
+  for (Texture* texture : batch.textures) {
+    maxLevels = std::max(maxLevels, texture->mipLevels);
+  }
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  std::vector<VkImageMemoryBarrier> barriers;
+  // One barrier and one round of blits per level across all textures, each level is read once the previous round wrote it
+  for (uint32_t level = 1; level < maxLevels; level++) {
+    barriers.clear();
+    for (Texture* texture : batch.textures) {
+      if (texture->mipLevels > level) {
+        barrier.image = texture->image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1};
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers.push_back(barrier);
+      }
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data());
+    for (Texture* texture : batch.textures) {
+      if (texture->mipLevels > level) {
+        VkImageBlit blit{};
+        blit.srcOffsets[1] = {std::max(1, static_cast<int32_t>(texture->extent.width >> (level - 1))),
+                              std::max(1, static_cast<int32_t>(texture->extent.height >> (level - 1))), 1};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.dstOffsets[1] = {std::max(1, static_cast<int32_t>(texture->extent.width >> level)),
+                              std::max(1, static_cast<int32_t>(texture->extent.height >> level)), 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        vkCmdBlitImage(cmd, texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                       VK_FILTER_LINEAR);
+      }
+    }
+  }
+
+  // Every level but the last was a blit source, the last one is still a transfer destination
+  barriers.clear();
+  for (Texture* texture : batch.textures) {
+    barrier.image = texture->image;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    if (texture->mipLevels > 1) {
+      barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture->mipLevels - 1, 0, 1};
       barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
       barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      barriers.push_back(barrier);
+    }
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, texture->mipLevels - 1, 1, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers.push_back(barrier);
+  }
+  if (!barriers.empty()) {
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data());
+  }
+  try {
+    cmdUtils->endSingleTimeCommands(cmd);
+  } catch (...) {
+    abandonUploadBatch(batch);
+    throw;
+  }
 
-      vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
-                           nullptr, 1, &barrier);
+  for (BufferManager::Buffer& stagingBuffer : batch.stagingBuffers) {
+    bufferManager->destroyBuffer(stagingBuffer);
+  }
+  for (Texture* texture : batch.textures) {
+    texture->currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    texture->descriptor.imageLayout = texture->currentLayout;
+    texture->descriptor.imageView = texture->imageView;
+    texture->descriptor.sampler = texture->sampler;
+  }
+  batch = UploadBatch{};
+}
+
+void TextureManager::abandonUploadBatch(UploadBatch& batch) {
+  // The submit may have gone through before the failure, the command buffer and staging buffers must be idle before release
+  vkQueueWaitIdle(context->graphicsQueue);
+  if (batch.commandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(context->device, context->transientCommandPool, 1, &batch.commandBuffer);
+  }
+  for (BufferManager::Buffer& stagingBuffer : batch.stagingBuffers) {
+    bufferManager->destroyBuffer(stagingBuffer);
+  }
+  batch = UploadBatch{};
+}
 
-      if (mipWidth > 1) mipWidth /= 2;
-      if (mipHeight > 1) mipHeight /= 2;
+bool TextureManager::isKtx2Image(const tinygltf::Image& gltfImage) {
+  const size_t extpos = gltfImage.uri.find_last_of(".");
+  return extpos != std::string::npos && gltfImage.uri.substr(extpos + 1) == "ktx2";
+}
+
+uint32_t TextureManager::MipChain::firstLevelOfSize(uint32_t maxSize) const {
+  uint32_t level = 0;
+  while (level + 1 < levels.size() && std::max(width >> level, height >> level) > maxSize) {
+    level++;
+  }
+  return level;
+}
+
+TextureManager::MipChain TextureManager::loadMipChain(const tinygltf::Image& gltfImage, const std::string& path, bool srgb) {
+  MipChain chain;
+  if (isKtx2Image(gltfImage)) {
+    // Levels are stored one after the other, transcoded the same way as createTextureFromGLTFImage
+    const std::string filename = path + "/" + gltfImage.uri;
+    ktxTexture2* ktxTex;
+    if (ktxTexture2_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex) != KTX_SUCCESS) {
+      throw std::runtime_error("Could not load KTX2 file: " + filename);
     }
+    chain.format = static_cast<VkFormat>(ktxTex->vkFormat);
+    if (ktxTexture2_NeedsTranscoding(ktxTex)) {
+      ktx_transcode_fmt_e targetFormat = basisTranscodeTarget(*context, chain.format);
+      if (transcodeBasis(ktxTex, targetFormat) != KTX_SUCCESS) {
+        ktxTexture_Destroy(ktxTexture(ktxTex));
+        throw std::runtime_error("Failed to transcode KTX2 texture: " + filename);
+      }
+    }
+    ktxTexture* baseTex = ktxTexture(ktxTex);
+    chain.width = baseTex->baseWidth;
+    chain.height = baseTex->baseHeight;
+    chain.levels.resize(baseTex->numLevels);
+    for (uint32_t level = 0; level < baseTex->numLevels; level++) {
+      ktx_size_t offset;
+      ktxTexture_GetImageOffset(baseTex, level, 0, 0, &offset);
+      const ktx_uint8_t* levelData = ktxTexture_GetData(baseTex) + offset;
+      chain.levels[level].assign(levelData, levelData + ktxTexture_GetImageSize(baseTex, level));
+    }
+    ktxTexture_Destroy(baseTex);
+    return chain;
+  }
 
-    // Transition last mip level to shader read
-    barrier.subresourceRange.baseMipLevel = texture.mipLevels - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  // Decoded png/jpg: expand to RGBA and box filter the chain on the CPU
+  const bool is16Bit = gltfImage.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+  const size_t componentSize = is16Bit ? 2 : 1;
+  chain.format = is16Bit ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+  chain.width = static_cast<uint32_t>(gltfImage.width);
+  chain.height = static_cast<uint32_t>(gltfImage.height);
+  const uint32_t levelCount = static_cast<uint32_t>(floor(log2(std::max(chain.width, chain.height)))) + 1;
+  chain.levels.resize(levelCount);
+
+  chain.levels[0] = expandToRGBA(gltfImage);
+  for (uint32_t level = 1; level < levelCount; level++) {
+    const uint32_t srcWidth = std::max(1u, chain.width >> (level - 1));
+    const uint32_t srcHeight = std::max(1u, chain.height >> (level - 1));
+    const uint32_t dstWidth = std::max(1u, chain.width >> level);
+    const uint32_t dstHeight = std::max(1u, chain.height >> level);
+    chain.levels[level].resize(static_cast<size_t>(dstWidth) * dstHeight * 4 * componentSize);
+    if (is16Bit) {
+      downsampleRGBA(reinterpret_cast<const uint16_t*>(chain.levels[level - 1].data()), srcWidth, srcHeight,
+                     reinterpret_cast<uint16_t*>(chain.levels[level].data()), dstWidth, dstHeight);
+    } else if (srgb) {
+      downsampleRGBA8Srgb(chain.levels[level - 1].data(), srcWidth, srcHeight, chain.levels[level].data(), dstWidth, dstHeight);
+    } else {
+      downsampleRGBA(chain.levels[level - 1].data(), srcWidth, srcHeight, chain.levels[level].data(), dstWidth, dstHeight);
+    }
+  }
+  return chain;
+}
 
-    vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
-                         nullptr, 1, &barrier);
+TextureManager::MipChain TextureManager::compressMipChain(const MipChain& chain, BlockCompressor::Format format, uint32_t threadCount) {
+  MipChain compressed;
+  compressed.format = format == BlockCompressor::Format::BC4   ? VK_FORMAT_BC4_UNORM_BLOCK
+                      : format == BlockCompressor::Format::BC5 ? VK_FORMAT_BC5_UNORM_BLOCK
+                                                               : VK_FORMAT_BC7_UNORM_BLOCK;
+  compressed.width = chain.width;
+  compressed.height = chain.height;
+  compressed.levels.resize(chain.levels.size());
+  const bool is16Bit = chain.format == VK_FORMAT_R16G16B16A16_UNORM;
+  std::vector<uint8_t> rgba8;
+  for (uint32_t level = 0; level < chain.levels.size(); level++) {
+    const uint8_t* rgba = chain.levels[level].data();
+    if (is16Bit) {
+      // The encoders take 8 bit input, keep the high byte
+      rgba8.resize(chain.levels[level].size() / 2);
+      const uint16_t* src = reinterpret_cast<const uint16_t*>(chain.levels[level].data());
+      for (size_t i = 0; i < rgba8.size(); i++) {
+        rgba8[i] = static_cast<uint8_t>(src[i] >> 8);
+      }
+      rgba = rgba8.data();
+    }
+    compressed.levels[level] = BlockCompressor::compressImage(rgba, std::max(1u, chain.width >> level), std::max(1u, chain.height >> level), format,
+                                                              threadCount);
+  }
+  return compressed;
+}
 
-    texture.currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    cmdUtils->endSingleTimeCommands(copyCmd);
+VkFormat TextureManager::blockCompressedFormat(BlockCompressor::Format format) const {
+  const VkFormat vkFormat = format == BlockCompressor::Format::BC4   ? VK_FORMAT_BC4_UNORM_BLOCK
+                            : format == BlockCompressor::Format::BC5 ? VK_FORMAT_BC5_UNORM_BLOCK
+                                                                     : VK_FORMAT_BC7_UNORM_BLOCK;
+  if (!context->enabledFeatures.textureCompressionBC) {
+    return VK_FORMAT_UNDEFINED;
   }
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(context->physicalDevice, vkFormat, &properties);
+  const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_TRANSFER_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  return (properties.optimalTilingFeatures & required) == required ? vkFormat : VK_FORMAT_UNDEFINED;
+}
 
-  // Create image view
-  texture.imageView = createImageView(texture.image, format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+TextureManager::Texture TextureManager::createTextureFromMipChain(const MipChain& chain, uint32_t firstLevel, TextureSampler textureSampler) {
+  Texture texture;
+  const uint32_t levelCount = static_cast<uint32_t>(chain.levels.size()) - firstLevel;
+  InitTexture(texture, std::max(1u, chain.width >> firstLevel), std::max(1u, chain.height >> firstLevel), chain.format, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+              levelCount);
+
+  VkDeviceSize totalSize = 0;
+  for (uint32_t level = firstLevel; level < chain.levels.size(); level++) {
+    totalSize += chain.levels[level].size();
+  }
+  BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(totalSize);
+  std::vector<VkBufferImageCopy> copyRegions;
+  VkDeviceSize offset = 0;
+  for (uint32_t level = firstLevel; level < chain.levels.size(); level++) {
+    bufferManager->updateBuffer(stagingBuffer, chain.levels[level].data(), chain.levels[level].size(), offset);
+    VkBufferImageCopy copyRegion{};
+    copyRegion.bufferOffset = offset;
+    copyRegion.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - firstLevel, 0, 1};
+    copyRegion.imageExtent = {std::max(1u, chain.width >> level), std::max(1u, chain.height >> level), 1};
+    copyRegions.push_back(copyRegion);
+    offset += chain.levels[level].size();
+  }
 
-  // Create sampler based on textureSampler parameter
-  texture.sampler = createTextureSampler(textureSampler, static_cast<float>(texture.mipLevels));
-  // descriptor
+  VkCommandBuffer copyCmd = cmdUtils->beginSingleTimeCommands();
+  transitionImageLayout(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyCmd, levelCount);
+  vkCmdCopyBufferToImage(copyCmd, stagingBuffer.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copyRegions.size()),
+                         copyRegions.data());
+  transitionImageLayout(texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, copyCmd, levelCount);
+  cmdUtils->endSingleTimeCommands(copyCmd);
+  bufferManager->destroyBuffer(stagingBuffer);
+  texture.currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  texture.imageView = createImageView(texture.image, chain.format, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+  // Clamped by the view, the sampler can stay with the texture while its resident levels change
+  texture.sampler = createTextureSampler(textureSampler, static_cast<float>(chain.levels.size()));
   texture.descriptor.imageLayout = texture.currentLayout;
   texture.descriptor.imageView = texture.imageView;
   texture.descriptor.sampler = texture.sampler;
-
   return texture;
 }
 
@@ -1070,6 +1345,201 @@ TextureManager::Texture TextureManager::loadHDRCubemapTexture(std::string& filen
   bufferManager->destroyBuffer(stagingBuffer);
   return texture;
 }
+// ============= KTX2 texture cache =============
+namespace {
+const char* kCacheKeyName = "TakEngine.cacheKey";
+
+// Uncompressed formats the generated textures use, 0 for anything the cache does not handle
+uint32_t texelSize(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+      return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+      return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      return 16;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+bool TextureManager::writeTextureToKTX2(const Texture& texture, const std::string& filename, const std::string& cacheKey) {
+  const uint32_t pixelSize = texelSize(texture.format);
+  if (pixelSize == 0 || texture.image == VK_NULL_HANDLE || !(texture.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+    spdlog::warn("Texture cannot be written to {}: unsupported format or missing transfer src usage", filename);
+    return false;
+  }
+
+  // Tightly packed, level by level and face by face, the same order the KTX2 images are set in below
+  std::vector<VkBufferImageCopy> regions;
+  std::vector<VkDeviceSize> imageSizes;
+  VkDeviceSize totalSize = 0;
+  for (uint32_t level = 0; level < texture.mipLevels; level++) {
+    const uint32_t width = std::max(1u, texture.extent.width >> level);
+    const uint32_t height = std::max(1u, texture.extent.height >> level);
+    for (uint32_t layer = 0; layer < texture.layerCount; layer++) {
+      VkBufferImageCopy region{};
+      region.bufferOffset = totalSize;
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1};
+      region.imageExtent = {width, height, 1};
+      regions.push_back(region);
+      imageSizes.push_back(static_cast<VkDeviceSize>(width) * height * pixelSize);
+      totalSize += imageSizes.back();
+    }
+  }
+
+  BufferManager::Buffer readback =
+      bufferManager->createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = texture.image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, texture.layerCount};
+  barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  VkBufferMemoryBarrier hostBarrier{};
+  hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.buffer = readback.buffer;
+  hostBarrier.size = VK_WHOLE_SIZE;
+
+  VkCommandBuffer cmd = cmdUtils->beginSingleTimeCommands();
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  vkCmdCopyImageToBuffer(cmd, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, static_cast<uint32_t>(regions.size()), regions.data());
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+  cmdUtils->endSingleTimeCommands(cmd);
+
+  ktxTextureCreateInfo createInfo{};
+  createInfo.vkFormat = texture.format;
+  createInfo.baseWidth = texture.extent.width;
+  createInfo.baseHeight = texture.extent.height;
+  createInfo.baseDepth = 1;
+  createInfo.numDimensions = 2;
+  createInfo.numLevels = texture.mipLevels;
+  createInfo.numLayers = 1;
+  createInfo.numFaces = texture.isCubemap() ? 6 : 1;
+  createInfo.isArray = KTX_FALSE;
+  createInfo.generateMipmaps = KTX_FALSE;
+
+  ktxTexture2* ktxTex = nullptr;
+  if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &ktxTex) != KTX_SUCCESS) {
+    spdlog::warn("Failed to create KTX2 texture for {}", filename);
+    bufferManager->destroyBuffer(readback);
+    return false;
+  }
+  ktxTexture* baseTex = ktxTexture(ktxTex);
+
+  const ktx_uint8_t* pixels = static_cast<const ktx_uint8_t*>(readback.mapped);
+  for (size_t i = 0; i < regions.size(); i++) {
+    ktxTexture_SetImageFromMemory(baseTex, regions[i].imageSubresource.mipLevel, 0, regions[i].imageSubresource.baseArrayLayer, pixels + regions[i].bufferOffset,
+                                  imageSizes[i]);
+  }
+  ktxHashList_AddKVPair(&baseTex->kvDataHead, kCacheKeyName, static_cast<unsigned int>(cacheKey.size() + 1), cacheKey.c_str());
+
+  KTX_error_code result = ktxTexture_WriteToNamedFile(baseTex, filename.c_str());
+  ktxTexture_Destroy(baseTex);
+  bufferManager->destroyBuffer(readback);
+
+  if (result != KTX_SUCCESS) {
+    spdlog::warn("Failed to write {}: {}", filename, ktxErrorString(result));
+    return false;
+  }
+  return true;
+}
+
+bool TextureManager::loadTextureFromKTX2(Texture& texture, const std::string& filename, VkFormat format, const std::string& cacheKey,
+                                         TextureSampler samplerSetting) {
+  ktxTexture2* ktxTex = nullptr;
+  if (ktxTexture2_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex) != KTX_SUCCESS) {
+    return false;
+  }
+  ktxTexture* baseTex = ktxTexture(ktxTex);
+
+  // A stale file (other source, filter settings or format) is simply regenerated and overwritten
+  char* storedKey = nullptr;
+  unsigned int storedKeyLength = 0;
+  ktxHashList_FindValue(&baseTex->kvDataHead, kCacheKeyName, &storedKeyLength, reinterpret_cast<void**>(&storedKey));
+  const bool keyMatches = storedKey != nullptr && storedKeyLength == cacheKey.size() + 1 && cacheKey.compare(0, cacheKey.size(), storedKey, cacheKey.size()) == 0;
+  if (!keyMatches || ktxTex->vkFormat != static_cast<ktx_uint32_t>(format) || ktxTex->numLayers != 1 || (ktxTex->numFaces != 1 && ktxTex->numFaces != 6) ||
+      ktxTexture2_NeedsTranscoding(ktxTex)) {
+    spdlog::info("Cached texture {} is out of date", filename);
+    ktxTexture_Destroy(baseTex);
+    return false;
+  }
+
+  const uint32_t width = baseTex->baseWidth;
+  const uint32_t height = baseTex->baseHeight;
+  const uint32_t mipLevels = baseTex->numLevels;
+  const uint32_t numFaces = baseTex->numFaces;
+
+  BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(ktxTexture_GetDataSize(baseTex));
+  bufferManager->updateBuffer(stagingBuffer, ktxTexture_GetData(baseTex), ktxTexture_GetDataSize(baseTex));
+
+  std::vector<VkBufferImageCopy> bufferCopyRegions;
+  for (uint32_t level = 0; level < mipLevels; level++) {
+    for (uint32_t face = 0; face < numFaces; face++) {
+      ktx_size_t offset;
+      ktxTexture_GetImageOffset(baseTex, level, 0, face, &offset);
+
+      VkBufferImageCopy region{};
+      region.bufferOffset = offset;
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, face, 1};
+      region.imageExtent = {std::max(1u, width >> level), std::max(1u, height >> level), 1};
+      bufferCopyRegions.push_back(region);
+    }
+  }
+
+  // Transfer src so a loaded texture can be written back out like a generated one
+  const VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  Texture loaded;
+  auto cmdBuffer = cmdUtils->beginSingleTimeCommands();
+  if (numFaces == 6) {
+    InitCubemapTexture(loaded, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
+    transitionCubemapLayout(loaded, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmdBuffer);
+  } else {
+    InitTexture(loaded, width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
+    transitionImageLayout(loaded, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, cmdBuffer, mipLevels);
+  }
+  vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer.buffer, loaded.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()),
+                         bufferCopyRegions.data());
+  if (numFaces == 6) {
+    transitionCubemapLayout(loaded, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmdBuffer);
+  } else {
+    transitionImageLayout(loaded, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, cmdBuffer, mipLevels);
+  }
+  cmdUtils->endSingleTimeCommands(cmdBuffer);
+
+  loaded.currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  loaded.imageView = numFaces == 6 ? createCubemapImageView(loaded.image, format, mipLevels) : createImageView(loaded.image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+  loaded.sampler = createTextureSampler(samplerSetting, static_cast<float>(mipLevels), 1.0f);
+  loaded.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  loaded.descriptor.imageView = loaded.imageView;
+  loaded.descriptor.sampler = loaded.sampler;
+
+  ktxTexture_Destroy(baseTex);
+  bufferManager->destroyBuffer(stagingBuffer);
+  texture = std::move(loaded);
+  return true;
+}
+
 TextureManager::Texture TextureManager::createCubemapFromEquirectangular(const std::string& filepath) {
   spdlog::info("Converting equirectangular HDR to cubemap: {}", filepath);
 
@@ -1097,7 +1567,7 @@ TextureManager::Texture TextureManager::createCubemapFromEquirectangular(const s
     throw std::runtime_error("Failed to load equirectangular image: " + filepath);
   }
 
-  const uint32_t faceSize = 2048;  // hard coded for now
+  const uint32_t faceSize = equirectFaceSize;
   const uint32_t mipLevels = static_cast<uint32_t>(floor(log2(faceSize)) + 1.0);
 
   spdlog::info("Creating cubemap: face size={}, mip levels={}", faceSize, mipLevels);
@@ -1106,46 +1576,62 @@ TextureManager::Texture TextureManager::createCubemapFromEquirectangular(const s
   VkDeviceSize faceDataSize = faceSize * faceSize * pixelSize;
   VkDeviceSize totalSize = faceDataSize * 6;
 
-  // Convert equirectangular to cubemap faces on CPU
-  std::vector<uint8_t> cubemapData(totalSize);
-
-  // Face order: +X, -X, +Y, -Y, +Z, -Z
-  for (int face = 0; face < 6; ++face) {
-    convertEquirectFaceCPU(srcPixels, srcWidth, srcHeight, cubemapData.data() + face * faceDataSize, face, faceSize, isHDR);
-  }
-
-  // Free source image
-  if (isHDR) {
-    stbi_image_free(static_cast<float*>(srcPixels));
-  } else {
-    stbi_image_free(static_cast<uint8_t*>(srcPixels));
+  EquirectConversion conversion = equirectConversion;
+  if (conversion == EquirectConversion::Gpu) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(context->physicalDevice, format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+      spdlog::warn("Cubemap format does not support storage images, converting on the CPU");
+      conversion = EquirectConversion::CpuParallel;
+    }
   }
 
-  // Create staging buffer
-  BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(totalSize);
-  bufferManager->updateBuffer(stagingBuffer, cubemapData.data(), totalSize, 0);
-
   // Create cubemap texture
   Texture texture;
   VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
+  if (conversion == EquirectConversion::Gpu) {
+    usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+  }
   InitCubemapTexture(texture, faceSize, faceSize, format, VK_IMAGE_TILING_OPTIMAL, usage,
                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
 
-  // Transfer data to GPU and generate mipmaps
-  VkCommandBuffer commandBuffer = cmdUtils->beginSingleTimeCommands();
-
-  transitionCubemapLayout(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandBuffer);
+  auto conversionStart = std::chrono::high_resolution_clock::now();
+  if (conversion == EquirectConversion::Gpu) {
+    Texture equirect = createTextureFromBuffer(srcPixels, static_cast<uint32_t>(srcWidth * srcHeight * pixelSize), format, srcWidth, srcHeight);
+    convertEquirectOnGPU(equirect, texture, isHDR);
+    destroyTexture(equirect);
+  } else {
+    // Convert equirectangular to cubemap faces on CPU
+    std::vector<uint8_t> cubemapData(totalSize);
+    if (conversion == EquirectConversion::CpuScalar) {
+      // Face order: +X, -X, +Y, -Y, +Z, -Z
+      for (int face = 0; face < 6; ++face) {
+        EquirectConverter::convertFaceScalar(srcPixels, srcWidth, srcHeight, cubemapData.data() + face * faceDataSize, face, faceSize, isHDR);
+      }
+    } else {
+      EquirectConverter::convertCubemap(srcPixels, srcWidth, srcHeight, cubemapData.data(), faceSize, isHDR);
+    }
 
-  // Copy base mip level for all faces
-  for (uint32_t face = 0; face < 6; ++face) {
-    copyBufferToCubemapFace(texture, stagingBuffer.buffer, commandBuffer, face, face * faceDataSize, 0);
+    // Create staging buffer
+    BufferManager::Buffer stagingBuffer = bufferManager->createStagingBuffer(totalSize);
+    bufferManager->updateBuffer(stagingBuffer, cubemapData.data(), totalSize, 0);
+
+    // Transfer data to GPU and generate mipmaps
+    VkCommandBuffer commandBuffer = cmdUtils->beginSingleTimeCommands();
+    recordCubemapUpload(texture, stagingBuffer.buffer, commandBuffer);
+    cmdUtils->endSingleTimeCommands(commandBuffer);
+    bufferManager->destroyBuffer(stagingBuffer);
   }
+  const char* conversionNames[] = {"CPU scalar", "CPU SIMD + threads", "GPU compute"};
+  spdlog::info("Equirect to cubemap ({}): {:.1f} ms", conversionNames[static_cast<int>(conversion)],
+               std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - conversionStart).count());
 
-  // Generate mipmaps
-  generateCubemapMipmaps(texture, commandBuffer);
-
-  cmdUtils->endSingleTimeCommands(commandBuffer);
+  // Free source image
+  if (isHDR) {
+    stbi_image_free(static_cast<float*>(srcPixels));
+  } else {
+    stbi_image_free(static_cast<uint8_t*>(srcPixels));
+  }
 
   // Create image view and sampler
   texture.imageView = createCubemapImageView(texture.image, format, mipLevels);
@@ -1158,79 +1644,209 @@ TextureManager::Texture TextureManager::createCubemapFromEquirectangular(const s
   texture.descriptor.imageView = texture.imageView;
   texture.descriptor.sampler = texture.sampler;
 
-  bufferManager->destroyBuffer(stagingBuffer);
-
   return texture;
 }
 
-void TextureManager::convertEquirectFaceCPU(void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex,
-                                            int faceSize, bool isHDR) {
-  // Face orientations for cubemap
-  struct FaceOrientation {
-    glm::vec3 forward;
-    glm::vec3 up;
-    glm::vec3 right;
-  };
-
-  // Define orientation for each face (+X, -X, +Y, -Y, +Z, -Z)
-  static const FaceOrientation faceOrientations[6] = {
-      {{1, 0, 0}, {0, 1, 0}, {0, 0, -1}},  // +X
-      {{-1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  // -X
-      {{0, 1, 0}, {0, 0, -1}, {1, 0, 0}},  // +Y
-      {{0, -1, 0}, {0, 0, 1}, {1, 0, 0}},  // -Y
-      {{0, 0, 1}, {0, 1, 0}, {1, 0, 0}},   // +Z
-      {{0, 0, -1}, {0, 1, 0}, {-1, 0, 0}}  // -Z
-  };
-
-  const FaceOrientation& orient = faceOrientations[faceIndex];
-
-  float* srcHDR = static_cast<float*>(srcPixels);
-  float* dstHDR = static_cast<float*>(dstFaceData);
-
-  for (int y = 0; y < faceSize; ++y) {
-    for (int x = 0; x < faceSize; ++x) {
-      // Calculate normalized coordinates [-1, 1]
-      float u = (2.0f * x / (faceSize - 1)) - 1.0f;
-      float v = (2.0f * y / (faceSize - 1)) - 1.0f;
-
-      // Calculate direction vector for this pixel
-      glm::vec3 dir = glm::normalize(orient.forward + orient.right * u + orient.up * -v  // Flip Y
-      );
+bool TextureManager::convertEquirectToFaces(const std::string& filepath, uint32_t faceSize, void* dstFaces) {
+  bool isHDR = filepath.find(".hdr") != std::string::npos || filepath.find(".HDR") != std::string::npos;
+  int srcWidth, srcHeight, srcChannels;
+  void* srcPixels = isHDR ? static_cast<void*>(stbi_loadf(filepath.c_str(), &srcWidth, &srcHeight, &srcChannels, 4))
+                          : static_cast<void*>(stbi_load(filepath.c_str(), &srcWidth, &srcHeight, &srcChannels, STBI_rgb_alpha));
+  if (!srcPixels) {
+    spdlog::error("Failed to load equirectangular image: {}", filepath);
+    return false;
+  }
+  EquirectConverter::convertCubemap(srcPixels, srcWidth, srcHeight, dstFaces, faceSize, isHDR);
+  stbi_image_free(srcPixels);
+  return true;
+}
 
-      // Convert direction to spherical coordinates
-      float theta = atan2(dir.z, dir.x);  // Horizontal angle
-      float phi = asin(dir.y);            // Vertical angle
+bool TextureManager::convertEquirectToFacesOnGPU(const void* srcPixels, int srcWidth, int srcHeight, uint32_t faceSize, bool isHDR,
+                                                 void* dstFaces) {
+  const VkFormat format = isHDR ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+  const VkDeviceSize pixelSize = isHDR ? sizeof(float) * 4 : 4;
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(context->physicalDevice, format, &formatProperties);
+  if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+    return false;
+  }
 
-      // Convert to equirectangular UV coordinates
-      float equirectU = (theta + M_PI) / (2.0f * M_PI);
-      float equirectV = (phi + M_PI * 0.5f) / M_PI;
+  // Mip 0 only, convertEquirectOnGPU leaves it in shader read layout
+  Texture cubemap;
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+  InitCubemapTexture(cubemap, faceSize, faceSize, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1);
+  Texture equirect = createTextureFromBuffer(const_cast<void*>(srcPixels), static_cast<uint32_t>(srcWidth * srcHeight * pixelSize), format, srcWidth,
+                                             srcHeight);
+  convertEquirectOnGPU(equirect, cubemap, isHDR);
+  destroyTexture(equirect);
+
+  const VkDeviceSize faceDataSize = static_cast<VkDeviceSize>(faceSize) * faceSize * pixelSize;
+  BufferManager::Buffer readback = bufferManager->createBuffer(faceDataSize * 6, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  // Faces are array layers 0-5, tightly packed in the same order as the CPU conversion
+  VkBufferImageCopy region{};
+  region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 6};
+  region.imageExtent = {faceSize, faceSize, 1};
 
-      // Sample equirectangular image (bilinear interpolation)
-      float srcX = equirectU * (srcWidth - 1);
-      float srcY = equirectV * (srcHeight - 1);
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = cubemap.image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+  barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  VkBufferMemoryBarrier hostBarrier{};
+  hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  hostBarrier.buffer = readback.buffer;
+  hostBarrier.size = VK_WHOLE_SIZE;
+
+  VkCommandBuffer cmd = cmdUtils->beginSingleTimeCommands();
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+  vkCmdCopyImageToBuffer(cmd, cubemap.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+  cmdUtils->endSingleTimeCommands(cmd);
+
+  memcpy(dstFaces, readback.mapped, faceDataSize * 6);
+  bufferManager->destroyBuffer(readback);
+  destroyTexture(cubemap);
+  return true;
+}
 
-      int x0 = static_cast<int>(srcX);
-      int y0 = static_cast<int>(srcY);
-      int x1 = std::min(x0 + 1, srcWidth - 1);
-      int y1 = std::min(y0 + 1, srcHeight - 1);
+void TextureManager::recordCubemapUpload(Texture& texture, VkBuffer buffer, VkCommandBuffer commandBuffer) {
+  const VkDeviceSize faceDataSize = static_cast<VkDeviceSize>(texture.extent.width) * texture.extent.height * (texture.format == VK_FORMAT_R32G32B32A32_SFLOAT ? 16 : 4);
+  transitionCubemapLayout(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandBuffer);
+  // Copy base mip level for all faces
+  for (uint32_t face = 0; face < 6; ++face) {
+    copyBufferToCubemapFace(texture, buffer, commandBuffer, face, face * faceDataSize, 0);
+  }
+  // Generate mipmaps
+  generateCubemapMipmaps(texture, commandBuffer);
+}
 
-      float fx = srcX - x0;
-      float fy = srcY - y0;
+void TextureManager::convertEquirectOnGPU(const Texture& equirect, Texture& cubemap, bool isHDR) {
+  VkDevice device = context->device;
 
-      // Bilinear interpolation for each channel
-      int dstIdx = (y * faceSize + x) * 4;
-      for (int c = 0; c < 4; ++c) {
-        float p00 = srcHDR[(y0 * srcWidth + x0) * 4 + c];
-        float p10 = srcHDR[(y0 * srcWidth + x1) * 4 + c];
-        float p01 = srcHDR[(y1 * srcWidth + x0) * 4 + c];
-        float p11 = srcHDR[(y1 * srcWidth + x1) * 4 + c];
+  // Mip 0 of every face as one array view for imageStore
+  VkImageView faceArrayView;
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = cubemap.image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+  viewInfo.format = cubemap.format;
+  viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+  VK_CHECK_RESULT(vkCreateImageView(device, &viewInfo, nullptr, &faceArrayView));
+
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {{
+      {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+  }};
+  VkDescriptorSetLayoutCreateInfo setLayoutCI{};
+  setLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCI.bindingCount = static_cast<uint32_t>(bindings.size());
+  setLayoutCI.pBindings = bindings.data();
+  VkDescriptorSetLayout setLayout;
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCI, nullptr, &setLayout));
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes = {{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1}}};
+  VkDescriptorPoolCreateInfo poolCI{};
+  poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolCI.maxSets = 1;
+  poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolCI.pPoolSizes = poolSizes.data();
+  VkDescriptorPool descriptorPool;
+  VK_CHECK_RESULT(vkCreateDescriptorPool(device, &poolCI, nullptr, &descriptorPool));
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &setLayout;
+  VkDescriptorSet descriptorSet;
+  VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+
+  VkDescriptorImageInfo faceInfo{VK_NULL_HANDLE, faceArrayView, VK_IMAGE_LAYOUT_GENERAL};
+  std::array<VkWriteDescriptorSet, 2> writes{};
+  writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  writes[0].dstSet = descriptorSet;
+  writes[0].dstBinding = 0;
+  writes[0].descriptorCount = 1;
+  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  writes[0].pImageInfo = &equirect.descriptor;
+  writes[1] = writes[0];
+  writes[1].dstBinding = 1;
+  writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  writes[1].pImageInfo = &faceInfo;
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = 1;
+  pipelineLayoutCI.pSetLayouts = &setLayout;
+  VkPipelineLayout pipelineLayout;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayout));
+
+  std::vector<char> shaderCode =
+      readFile(std::string(SHADER_DIR) + (isHDR ? "/equirect2cube.comp.spv" : "/equirect2cube_ldr.comp.spv"));
+  VkShaderModuleCreateInfo moduleCI{};
+  moduleCI.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleCI.codeSize = shaderCode.size();
+  moduleCI.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+  VkShaderModule shaderModule;
+  VK_CHECK_RESULT(vkCreateShaderModule(device, &moduleCI, nullptr, &shaderModule));
+
+  VkComputePipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCI.layout = pipelineLayout;
+  pipelineCI.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineCI.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineCI.stage.module = shaderModule;
+  pipelineCI.stage.pName = "main";
+  VkPipeline pipeline;
+  VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &pipeline));
 
-        float value = p00 * (1 - fx) * (1 - fy) + p10 * fx * (1 - fy) + p01 * (1 - fx) * fy + p11 * fx * fy;
+  VkCommandBuffer commandBuffer = cmdUtils->beginSingleTimeCommands();
+  // Every mip to transfer dst as generateCubemapMipmaps expects, then mip 0 to general for the shader writes
+  transitionCubemapLayout(cubemap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, commandBuffer);
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = cubemap.image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                       &barrier);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+  vkCmdDispatch(commandBuffer, (cubemap.extent.width + 15) / 16, (cubemap.extent.height + 15) / 16, 6);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                       &barrier);
+  generateCubemapMipmaps(cubemap, commandBuffer);
+  cmdUtils->endSingleTimeCommands(commandBuffer);
 
-        dstHDR[dstIdx + c] = value;
-      }
-    }
-  }
+  vkDestroyPipeline(device, pipeline, nullptr);
+  vkDestroyShaderModule(device, shaderModule, nullptr);
+  vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+  vkDestroyImageView(device, faceArrayView, nullptr);
 }
 
 void TextureManager::generateCubemapMipmaps(Texture& cubemap, VkCommandBuffer cmd) {
@@ -6,8 +6,10 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "defines.hpp"
+#include "renderer/BlockCompressor.hpp"
 #include "renderer/BufferManager.hpp"
 #include "renderer/CommandBufferUtils.hpp"
 #include "renderer/VulkanContext.hpp"
@@ -162,14 +164,29 @@ class TextureManager {
     VkSamplerAddressMode addressModeV;
     VkSamplerAddressMode addressModeW;
   };
+  // CPU copy of every level of an image, kept for texture streaming (see TextureStreamer)
+  struct MipChain {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;  // tightly packed, level 0 first
+    // First level whose larger side is at most maxSize, the last level if none is that small
+    uint32_t firstLevelOfSize(uint32_t maxSize) const;
+  };
+  // How createCubemapFromEquirectangular builds the faces, all three produce the same image within
+  // EquirectConverter::maxRelativeError tolerance of the scalar reference
+  enum class EquirectConversion { CpuScalar, CpuParallel, Gpu };
+  EquirectConversion equirectConversion = EquirectConversion::CpuParallel;
+  static constexpr uint32_t equirectFaceSize = 2048;
+
   Texture createDefault();
   std::shared_ptr<VulkanContext> context;
   std::shared_ptr<CommandBufferUtils> cmdUtils;
   std::shared_ptr<BufferManager> bufferManager;
 
  private:
-  void TextureManager::convertEquirectFaceCPU(void* srcPixels, int srcWidth, int srcHeight, void* dstFaceData, int faceIndex,
-                                              int faceSize, bool isHDR);
+  // Writes mip 0 of all faces with equirect2cube.comp and builds the mip chain, cubemap needs storage usage
+  void convertEquirectOnGPU(const Texture& equirect, Texture& cubemap, bool isHDR);
   void generateCubemapMipmaps(Texture& cubemap, VkCommandBuffer cmd);
 
  public:
@@ -190,7 +207,7 @@ class TextureManager {
   VkSampler createGBufferSampler();
   void InitTexture(Texture& texture, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
                    VkImageUsageFlags usage, VkMemoryPropertyFlags properties, uint32_t mipLevels = 1,
-                   VkSampleCountFlagBits numSamples = VK_SAMPLE_COUNT_1_BIT);
+                   VkSampleCountFlagBits numSamples = VK_SAMPLE_COUNT_1_BIT, VkImageCreateFlags flags = 0);
   void transitionImageLayout(Texture& texture, VkImageLayout oldLayout, VkImageLayout newLayout,
                              VkCommandBuffer commandBuffer, uint32_t mipLevels = 1);
   void copyBufferToImage(Texture& texture, VkBuffer buffer, VkCommandBuffer commandBuffer, VkDeviceSize bufferOffset = 0,
@@ -199,6 +216,30 @@ class TextureManager {
   Texture createTextureFromGLTFImage(const tinygltf::Image& gltfImage, std::string path, TextureSampler textureSampler,
                                      VkQueue copyQueue);
   std::vector<TextureSampler> loadTextureSamplers(tinygltf::Model& gltfModel);
+  // Uploads of many textures in one command buffer: uploadGLTFImage records the copy of level 0, endUploadBatch blits the mip
+  // chains of all textures level by level, transitions them for sampling and submits once
+  struct UploadBatch {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    std::vector<BufferManager::Buffer> stagingBuffers;
+    std::vector<Texture*> textures;  // have to stay in place until endUploadBatch
+  };
+  UploadBatch beginUploadBatch();
+  // png/jpg image with a full mip chain, srgb color data is filtered in linear space (the view still returns the stored values)
+  void uploadGLTFImage(Texture& texture, const tinygltf::Image& gltfImage, TextureSampler textureSampler, bool srgb, UploadBatch& batch);
+  void endUploadBatch(UploadBatch& batch);
+  // Frees the command buffer and staging buffers of a batch whose recording or submission threw
+  void abandonUploadBatch(UploadBatch& batch);
+  static bool isKtx2Image(const tinygltf::Image& gltfImage);
+  // Same sources and formats as createTextureFromGLTFImage, mips of png/jpg images are box filtered on the CPU (in linear space
+  // for 8 bit srgb color). Touches no Vulkan objects, safe to call from several threads
+  MipChain loadMipChain(const tinygltf::Image& gltfImage, const std::string& path, bool srgb = false);
+  // Every level of an RGBA8/RGBA16 chain block compressed, 16 bit input is truncated to 8 bit
+  static MipChain compressMipChain(const MipChain& chain, BlockCompressor::Format format, uint32_t threadCount = 0);
+  // Vulkan format of the BlockCompressor output, VK_FORMAT_UNDEFINED unless textureCompressionBC is enabled and the format
+  // can be sampled
+  VkFormat blockCompressedFormat(BlockCompressor::Format format) const;
+  // Texture holding chain levels firstLevel and below, the sampler allows the full chain
+  Texture createTextureFromMipChain(const MipChain& chain, uint32_t firstLevel, TextureSampler textureSampler);
   // std::vector<Texture> loadTextures(tinygltf::Model& gltfModel, std::vector<TextureSampler>& samplers);
   Texture createTextureFromBuffer(void* data, uint32_t size, VkFormat format, uint32_t width, uint32_t height,
                                   bool isNoise = false);
@@ -213,5 +254,20 @@ class TextureManager {
   void InitCubemapTexture(Texture& texture, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
                           VkImageUsageFlags usage, VkMemoryPropertyFlags properties, uint32_t mipLevels = 1);
   Texture loadHDRCubemapTexture(std::string& filename, VkFormat format, VkImageUsageFlags usage);
+
+  // Uncompressed KTX2 round trip of every mip and face, used to cache generated textures between launches
+  // The texture has to be in shader read layout with transfer src usage, cacheKey is stored as metadata
+  bool writeTextureToKTX2(const Texture& texture, const std::string& filename, const std::string& cacheKey);
+  // Returns false (texture untouched) if the file is missing or its format, face count or cacheKey differ
+  bool loadTextureFromKTX2(Texture& texture, const std::string& filename, VkFormat format, const std::string& cacheKey,
+                           TextureSampler samplerSetting);
   TextureManager::Texture TextureManager::createCubemapFromEquirectangular(const std::string& filepath);
+  // The two halves of the CPU conversion for callers that must not block: decoding and conversion touch no Vulkan state
+  // and can run on a worker thread, dstFaces receives six faceSize^2 RGBA faces (float for .hdr files, 8 bit otherwise)
+  static bool convertEquirectToFaces(const std::string& filepath, uint32_t faceSize, void* dstFaces);
+  // The same faces from decoded pixels with equirect2cube.comp, read back into dstFaces (blocks until the GPU is done)
+  // Returns false if the face format does not support storage images
+  bool convertEquirectToFacesOnGPU(const void* srcPixels, int srcWidth, int srcHeight, uint32_t faceSize, bool isHDR, void* dstFaces);
+  // Records the copy of six packed faces from buffer into mip 0 and the mip chain blits, texture ends in shader read layout
+  void recordCubemapUpload(Texture& texture, VkBuffer buffer, VkCommandBuffer commandBuffer);
 };
@@ -0,0 +1,342 @@
+#include "renderer/TextureStreamer.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+namespace {
+// Larger side of the mesh bounds on screen in pixels, 0 outside the frustum, FLT_MAX when the camera is at the mesh
+float projectedPixels(const tak::BoundingBox& aabb, const glm::mat4& clipFromModel, const glm::vec2& viewport) {
+  uint32_t outsideAll = 0x3f;
+  glm::vec2 ndcMin(FLT_MAX);
+  glm::vec2 ndcMax(-FLT_MAX);
+  bool crossesNearPlane = false;
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    glm::vec3 p((corner & 1) ? aabb.max.x : aabb.min.x, (corner & 2) ? aabb.max.y : aabb.min.y, (corner & 4) ? aabb.max.z : aabb.min.z);
+    glm::vec4 clip = clipFromModel * glm::vec4(p, 1.0f);
+    uint32_t outside = 0;
+    outside |= (clip.x < -clip.w) ? 0x01 : 0;
+    outside |= (clip.x > clip.w) ? 0x02 : 0;
+    outside |= (clip.y < -clip.w) ? 0x04 : 0;
+    outside |= (clip.y > clip.w) ? 0x08 : 0;
+    outside |= (clip.z < 0.0f) ? 0x10 : 0;
+    outside |= (clip.z > clip.w) ? 0x20 : 0;
+    outsideAll &= outside;
+    if (clip.w <= 1e-4f) {
+      crossesNearPlane = true;
+      continue;
+    }
+    glm::vec2 ndc = glm::vec2(clip) / clip.w;
+    ndcMin = glm::min(ndcMin, ndc);
+    ndcMax = glm::max(ndcMax, ndc);
+  }
+  if (outsideAll != 0) {
+    return 0.0f;
+  }
+  if (crossesNearPlane) {
+    return FLT_MAX;
+  }
+  // Unclamped, a mesh larger than the screen still needs the texel density of its full extent
+  glm::vec2 pixels = (ndcMax - ndcMin) * 0.5f * viewport;
+  return std::max(pixels.x, pixels.y);
+}
+
+void forEachMaterialTexture(const tak::Material& material, const std::function<void(uint32_t)>& visit) {
+  for (uint32_t index : {material.baseColorTextureIndex, material.metallicRoughnessTextureIndex, material.normalTextureIndex,
+                         material.occlusionTextureIndex, material.emissiveTextureIndex, material.extension.diffuseTextureIndex,
+                         material.extension.specularGlossinessTextureIndex}) {
+    if (index != UINT32_MAX) {
+      visit(index);
+    }
+  }
+}
+}  // namespace
+
+void TextureStreamer::addModel(ModelManager::Model& model) {
+  if (model.textureMipChains.size() != model.textures.size()) {
+    spdlog::warn("Model {} was not loaded with streamTextures, its textures stay fully resident", model.filePath);
+    return;
+  }
+  for (uint32_t i = 0; i < model.textures.size(); i++) {
+    const TextureManager::MipChain& chain = model.textureMipChains[i];
+    Entry entry{};
+    entry.model = &model;
+    entry.textureIndex = i;
+    entry.tailFirst = static_cast<uint32_t>(chain.levels.size()) - model.textures[i].mipLevels;
+    entry.residentFirst = entry.tailFirst;
+    entry.targetFirst = entry.tailFirst;
+    entry.requestedFirst = entry.tailFirst;
+    entry.residentBytes = allocationSize(model.textures[i]);
+    entries.push_back(entry);
+    statistics.residentBytes += entry.residentBytes;
+    statistics.fullBytes += levelBytes(entry, 0);
+  }
+  statistics.textures = static_cast<uint32_t>(entries.size());
+}
+
+VkDeviceSize TextureStreamer::levelBytes(const Entry& entry, uint32_t firstLevel) const {
+  const std::vector<std::vector<uint8_t>>& levels = entry.model->textureMipChains[entry.textureIndex].levels;
+  VkDeviceSize bytes = 0;
+  for (uint32_t level = firstLevel; level < levels.size(); level++) {
+    bytes += levels[level].size();
+  }
+  return bytes;
+}
+
+VkDeviceSize TextureStreamer::allocationSize(const TextureManager::Texture& texture) const {
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(context->device, texture.image, &memRequirements);
+  return memRequirements.size;
+}
+
+void TextureStreamer::update(const glm::mat4& clipFromModel, const glm::vec2& viewport) {
+  frame++;
+  for (Entry& entry : entries) {
+    entry.screenPixels = 0.0f;
+  }
+
+  // Feedback: largest screen extent of any mesh drawing with the texture, assuming its uv range spans the mesh once
+  size_t modelBase = 0;
+  while (modelBase < entries.size()) {
+    ModelManager::Model& model = *entries[modelBase].model;
+    for (tak::Node* node : model.linearNodes) {
+      if (!node->mesh || !node->mesh->aabb.valid) {
+        continue;
+      }
+      const float pixels = projectedPixels(node->mesh->aabb, clipFromModel, viewport);
+      if (pixels <= 0.0f) {
+        continue;
+      }
+      for (tak::Primitive* primitive : node->mesh->primitives) {
+        if (primitive->materialIndex >= model.materials.size()) {
+          continue;
+        }
+        forEachMaterialTexture(model.materials[primitive->materialIndex], [&](uint32_t textureIndex) {
+          Entry& entry = entries[modelBase + textureIndex];
+          entry.screenPixels = std::max(entry.screenPixels, pixels);
+          entry.lastUsed = frame;
+        });
+      }
+    }
+    modelBase += model.textures.size();
+  }
+
+  // Request: the level whose size matches the screen extent, unseen textures keep what they have until the budget needs it
+  VkDeviceSize targetBytes = 0;
+  statistics.requestedBytes = 0;
+  for (Entry& entry : entries) {
+    if (entry.lastUsed == frame) {
+      const TextureManager::MipChain& chain = entry.model->textureMipChains[entry.textureIndex];
+      const float texels = static_cast<float>(std::max(chain.width, chain.height));
+      const float level = std::floor(std::log2(texels / std::max(entry.screenPixels, 1.0f)) + settings.lodBias);
+      entry.requestedFirst = static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(entry.tailFirst)));
+      entry.targetFirst = entry.requestedFirst;
+    } else {
+      entry.requestedFirst = entry.tailFirst;
+      entry.targetFirst = entry.residentFirst;
+    }
+    statistics.requestedBytes += levelBytes(entry, entry.requestedFirst);
+    targetBytes += levelBytes(entry, entry.targetFirst);
+  }
+
+  // Budget: least recently used first, then the smallest on screen, each drops to its tail before the next one is touched
+  if (targetBytes > settings.budget) {
+    std::vector<uint32_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      if (entries[a].lastUsed != entries[b].lastUsed) {
+        return entries[a].lastUsed < entries[b].lastUsed;
+      }
+      return entries[a].screenPixels < entries[b].screenPixels;
+    });
+    for (uint32_t index : order) {
+      Entry& entry = entries[index];
+      while (targetBytes > settings.budget && entry.targetFirst < entry.tailFirst) {
+        targetBytes -= entry.model->textureMipChains[entry.textureIndex].levels[entry.targetFirst].size();
+        entry.targetFirst++;
+      }
+      if (targetBytes <= settings.budget) {
+        break;
+      }
+    }
+  }
+
+  statistics.pendingTextures = 0;
+  for (const Entry& entry : entries) {
+    statistics.pendingTextures += entry.targetFirst != entry.residentFirst ? 1 : 0;
+  }
+}
+
+bool TextureStreamer::recordUpdates(VkCommandBuffer commandBuffer) {
+  // Images replaced at least framesInFlight frames ago are no longer referenced by any submitted frame
+  for (Retired& texture : retired) {
+    texture.countdown--;
+  }
+  retired.erase(std::remove_if(retired.begin(), retired.end(), [](const Retired& texture) { return texture.countdown == 0; }), retired.end());
+  stagingBuffers.resize(framesInFlight);
+  const uint32_t slot = frameSlot;
+  frameSlot = (frameSlot + 1) % framesInFlight;
+
+  // Evictions first, they free memory, then the cheapest loads, bounded by the bytes moved this frame
+  std::vector<uint32_t> changes;
+  for (uint32_t i = 0; i < entries.size(); i++) {
+    if (entries[i].targetFirst != entries[i].residentFirst) {
+      changes.push_back(i);
+    }
+  }
+  if (changes.empty()) {
+    return false;
+  }
+  auto moveBytes = [&](const Entry& entry) { return levelBytes(entry, entry.targetFirst); };
+  std::sort(changes.begin(), changes.end(), [&](uint32_t a, uint32_t b) {
+    const bool evictA = entries[a].targetFirst > entries[a].residentFirst;
+    const bool evictB = entries[b].targetFirst > entries[b].residentFirst;
+    if (evictA != evictB) {
+      return evictA;
+    }
+    return moveBytes(entries[a]) < moveBytes(entries[b]);
+  });
+  VkDeviceSize frameBytes = 0;
+  VkDeviceSize stagingSize = 0;
+  size_t changeCount = 0;
+  for (; changeCount < changes.size(); changeCount++) {
+    const Entry& entry = entries[changes[changeCount]];
+    if (changeCount > 0 && frameBytes + moveBytes(entry) > settings.maxBytesPerFrame) {
+      break;
+    }
+    frameBytes += moveBytes(entry);
+    if (entry.targetFirst < entry.residentFirst) {
+      stagingSize += levelBytes(entry, entry.targetFirst) - levelBytes(entry, entry.residentFirst);
+    }
+  }
+  changes.resize(changeCount);
+
+  BufferManager::Buffer& staging = stagingBuffers[slot];
+  if (stagingSize > 0 && staging.size < stagingSize) {
+    bufferManager->destroyBuffer(staging);
+    staging = bufferManager->createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  }
+
+  // New images with the target level range, old ones become copy sources once the previous frames stopped sampling them
+  std::vector<TextureManager::Texture> newTextures(changes.size());
+  std::vector<VkImageMemoryBarrier> barriers;
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  for (size_t c = 0; c < changes.size(); c++) {
+    const Entry& entry = entries[changes[c]];
+    const TextureManager::MipChain& chain = entry.model->textureMipChains[entry.textureIndex];
+    TextureManager::Texture& oldTexture = entry.model->textures[entry.textureIndex];
+    TextureManager::Texture& newTexture = newTextures[c];
+    textureManager->InitTexture(newTexture, std::max(1u, chain.width >> entry.targetFirst), std::max(1u, chain.height >> entry.targetFirst), chain.format,
+                                VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, static_cast<uint32_t>(chain.levels.size()) - entry.targetFirst);
+
+    barrier.image = newTexture.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, newTexture.mipLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers.push_back(barrier);
+    barrier.image = oldTexture.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, oldTexture.mipLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers.push_back(barrier);
+  }
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  VkDeviceSize stagingOffset = 0;
+  for (size_t c = 0; c < changes.size(); c++) {
+    Entry& entry = entries[changes[c]];
+    const TextureManager::MipChain& chain = entry.model->textureMipChains[entry.textureIndex];
+    TextureManager::Texture& oldTexture = entry.model->textures[entry.textureIndex];
+    TextureManager::Texture& newTexture = newTextures[c];
+    std::vector<VkBufferImageCopy> uploads;
+    std::vector<VkImageCopy> copies;
+    for (uint32_t level = entry.targetFirst; level < chain.levels.size(); level++) {
+      const VkExtent3D extent = {std::max(1u, chain.width >> level), std::max(1u, chain.height >> level), 1};
+      if (level < entry.residentFirst) {
+        memcpy(static_cast<uint8_t*>(staging.mapped) + stagingOffset, chain.levels[level].data(), chain.levels[level].size());
+        VkBufferImageCopy upload{};
+        upload.bufferOffset = stagingOffset;
+        upload.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - entry.targetFirst, 0, 1};
+        upload.imageExtent = extent;
+        uploads.push_back(upload);
+        stagingOffset += chain.levels[level].size();
+        statistics.levelsStreamedIn++;
+      } else {
+        VkImageCopy copy{};
+        copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - entry.residentFirst, 0, 1};
+        copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - entry.targetFirst, 0, 1};
+        copy.extent = extent;
+        copies.push_back(copy);
+      }
+    }
+    if (!uploads.empty()) {
+      vkCmdCopyBufferToImage(commandBuffer, staging.buffer, newTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(uploads.size()),
+                             uploads.data());
+    }
+    vkCmdCopyImage(commandBuffer, oldTexture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<uint32_t>(copies.size()), copies.data());
+    statistics.levelsEvicted += entry.targetFirst > entry.residentFirst ? entry.targetFirst - entry.residentFirst : 0;
+  }
+
+  barriers.clear();
+  for (TextureManager::Texture& newTexture : newTextures) {
+    barrier.image = newTexture.image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, newTexture.mipLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers.push_back(barrier);
+  }
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  // Swap: the sampler moves to the new image, the old image waits in retired
+  for (size_t c = 0; c < changes.size(); c++) {
+    Entry& entry = entries[changes[c]];
+    TextureManager::Texture& texture = entry.model->textures[entry.textureIndex];
+    TextureManager::Texture& newTexture = newTextures[c];
+    newTexture.currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    newTexture.imageView = textureManager->createImageView(newTexture.image, newTexture.format, VK_IMAGE_ASPECT_COLOR_BIT, newTexture.mipLevels);
+    newTexture.sampler = texture.sampler;
+    texture.sampler = VK_NULL_HANDLE;
+    newTexture.descriptor.imageLayout = newTexture.currentLayout;
+    newTexture.descriptor.imageView = newTexture.imageView;
+    newTexture.descriptor.sampler = newTexture.sampler;
+
+    statistics.residentBytes -= entry.residentBytes;
+    entry.residentBytes = allocationSize(newTexture);
+    statistics.residentBytes += entry.residentBytes;
+    entry.residentFirst = entry.targetFirst;
+    retired.push_back({std::move(texture), framesInFlight});
+    texture = std::move(newTexture);
+  }
+  statistics.pendingTextures -= static_cast<uint32_t>(changes.size());
+  textureVersion++;
+  return true;
+}
+
+void TextureStreamer::releaseAll() {
+  retired.clear();
+  for (BufferManager::Buffer& staging : stagingBuffers) {
+    bufferManager->destroyBuffer(staging);
+  }
+  stagingBuffers.clear();
+  entries.clear();
+  statistics = Stats{};
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "renderer/ModelManager.hpp"
+
+// Mip residency for the textures of models loaded with ModelManager::streamTextures
+// Every texture keeps the levels up to ModelManager::streamTailSize resident, larger levels follow a request derived from the
+// screen size of the primitives using the texture. When the requests exceed the budget, the least recently used textures give
+// up their top levels first. A residency change recreates the image with the new level range: levels it keeps are copied on
+// the GPU, new ones come from the CPU mip chain, everything is recorded into the frame's command buffer (no queue waits) and
+// the old image is released once no frame in flight can reference it.
+class TextureStreamer {
+ public:
+  struct Settings {
+    VkDeviceSize budget = 256ull << 20;            // device memory for all streamed textures
+    float lodBias = 0.0f;                          // added to the requested level, positive streams less
+    VkDeviceSize maxBytesPerFrame = 32ull << 20;   // uploaded plus copied per frame, at least one texture always changes
+  };
+  struct Stats {
+    VkDeviceSize residentBytes = 0;   // allocation size of the current images
+    VkDeviceSize requestedBytes = 0;  // level data the screen-size feedback asks for, tail levels of unseen textures
+    VkDeviceSize fullBytes = 0;       // level data of every level of every texture
+    uint32_t textures = 0;
+    uint32_t pendingTextures = 0;  // resident levels differ from the target
+    uint32_t levelsStreamedIn = 0;
+    uint32_t levelsEvicted = 0;
+  };
+
+  TextureStreamer(std::shared_ptr<VulkanContext> ctx, std::shared_ptr<BufferManager> bufferMgr, std::shared_ptr<TextureManager> textureMgr,
+                  uint32_t framesInFlight)
+      : context(ctx), bufferManager(bufferMgr), textureManager(textureMgr), framesInFlight(framesInFlight) {}
+  ~TextureStreamer() { releaseAll(); }
+
+  // The model must stay alive and keep its textures until releaseAll
+  void addModel(ModelManager::Model& model);
+  // Screen-size feedback and the budget decide the first resident level of every texture
+  // clipFromModel as in ModelManager::projectedScreenSize, viewport in pixels
+  void update(const glm::mat4& clipFromModel, const glm::vec2& viewport);
+  // Records this frame's residency changes, call before the render pass once the frame's fence was waited on
+  // Returns true if a texture was replaced, every descriptor referencing model textures has to be rewritten then
+  bool recordUpdates(VkCommandBuffer commandBuffer);
+  // Expects an idle device, models keep their current textures
+  void releaseAll();
+
+  const Stats& stats() const { return statistics; }
+  uint32_t version() const { return textureVersion; }  // incremented with every frame that replaced textures
+  Settings settings;
+
+ private:
+  struct Entry {
+    ModelManager::Model* model;
+    uint32_t textureIndex;
+    uint32_t tailFirst;       // first level that is always resident
+    uint32_t residentFirst;   // first chain level in the current image
+    uint32_t targetFirst;     // after budget
+    uint32_t requestedFirst;  // from the screen size
+    uint64_t lastUsed = 0;    // frame the texture was last on screen
+    float screenPixels = 0.0f;
+    VkDeviceSize residentBytes = 0;
+  };
+  struct Retired {
+    TextureManager::Texture texture;
+    uint32_t countdown;
+  };
+
+  VkDeviceSize levelBytes(const Entry& entry, uint32_t firstLevel) const;
+  VkDeviceSize allocationSize(const TextureManager::Texture& texture) const;
+
+  std::shared_ptr<VulkanContext> context;
+  std::shared_ptr<BufferManager> bufferManager;
+  std::shared_ptr<TextureManager> textureManager;
+  uint32_t framesInFlight;
+
+  std::vector<Entry> entries;
+  std::vector<Retired> retired;
+  std::vector<BufferManager::Buffer> stagingBuffers;  // one per frame slot, rewritten when the slot records again
+  uint32_t frameSlot = 0;
+  uint64_t frame = 0;
+  uint32_t textureVersion = 0;
+  Stats statistics;
+};
@@ -5,7 +5,10 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <future>
 #include <set>
 #include <stdexcept>
 
@@ -120,16 +123,21 @@ void VulkanBase::recordCommandBuffer(VkCommandBuffer commandBuffer, u32 imageInd
     throw std::runtime_error("failed to begin recording command buffer!");
   }
 
+  recordPreRenderPassCommands(commandBuffer, imageIndex);
+
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass;
   renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = swapChainExtent;
-  std::array<VkClearValue, 2> clearValues{};  // should be identical to order of attachments in renderpass
+  std::array<VkClearValue, 5> clearValues{};  // should be identical to order of attachments in renderpass
   clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-  clearValues[1].depthStencil = {1.0f, 0};
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+  clearValues[1].depthStencil = {0.0f, 0};  // reverse-Z: 0 is infinitely far
+  // Nothing accumulated yet, everything revealed
+  clearValues[3].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+  clearValues[4].color = {{1.0f, 0.0f, 0.0f, 0.0f}};
+  renderPassInfo.clearValueCount = transparencySubpasses ? 5 : 2;
   renderPassInfo.pClearValues = clearValues.data();
 
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
@@ -243,6 +251,7 @@ void VulkanBase::initVulkan() {
   createImageViews();
   createColorResources();
   createDepthResources();
+  createTransparencyResources();
   createRenderPass();
 
   // 6. load resources
@@ -341,6 +350,12 @@ void VulkanBase::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // Block compressed textures: KTX2 transcode targets and the BC import of png/jpg model textures
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  // Fragment shader invocation counts of the PBR scene's depth pre-pass comparison
+  deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -487,18 +502,21 @@ void VulkanBase::recreateSwapChain() {
 
   vkDeviceWaitIdle(device);
 
-  // Notify derived class about resize
-  onResize(width, height);
-
   cleanupSwapChain();
   depthBuffer = TextureManager::Texture();
   msaaColor = TextureManager::Texture();
+  textureManager->destroyTexture(oitAccum);
+  textureManager->destroyTexture(oitRevealage);
 
   createSwapChain();
   createImageViews();
   createColorResources();
   createDepthResources();
+  createTransparencyResources();
   createFramebuffers();
+
+  // Notify derived class about resize, once the swapchain sized resources exist again
+  onResize(width, height);
 }
 
 void VulkanBase::cleanupSwapChain() {
@@ -646,6 +664,107 @@ void VulkanBase::createRenderPass() {
   renderPassInfo.dependencyCount = 1;
   renderPassInfo.pDependencies = &dependency;
 
+  if (transparencySubpasses) {
+    createTransparencyRenderPass(attachments, dependency);
+    return;
+  }
+  if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render pass!");
+  }
+}
+
+void VulkanBase::createTransparencyRenderPass(const std::array<VkAttachmentDescription, 3>& sceneAttachments,
+                                              const VkSubpassDependency& sceneDependency) {
+  // Accumulation targets are cleared by the render pass and never leave it
+  VkAttachmentDescription oitAttachment{};
+  oitAttachment.samples = msaaSamples;
+  oitAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  oitAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  oitAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  oitAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  oitAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  oitAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  std::array<VkAttachmentDescription, 5> attachments = {sceneAttachments[0], sceneAttachments[1], sceneAttachments[2], oitAttachment,
+                                                        oitAttachment};
+  attachments[3].format = oitAccum.format;
+  attachments[4].format = oitRevealage.format;
+
+  // Subpass 0: scene
+  VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  // Subpass 1: accumulation, depth tested against the scene but not written
+  std::array<VkAttachmentReference, 2> oitAttachmentRefs = {VkAttachmentReference{3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+                                                            VkAttachmentReference{4, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}};
+  VkAttachmentReference depthReadOnlyRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+  uint32_t preservedColor = 0;
+  // Subpass 2: composite over the scene color, resolved to the swapchain image
+  std::array<VkAttachmentReference, 2> oitInputRefs = {VkAttachmentReference{3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+                                                       VkAttachmentReference{4, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}};
+  VkAttachmentReference colorAttachmentResolveRef{2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+  std::array<VkSubpassDescription, 3> subpasses{};
+  subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[0].colorAttachmentCount = 1;
+  subpasses[0].pColorAttachments = &colorAttachmentRef;
+  subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
+
+  subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[1].colorAttachmentCount = static_cast<uint32_t>(oitAttachmentRefs.size());
+  subpasses[1].pColorAttachments = oitAttachmentRefs.data();
+  subpasses[1].pDepthStencilAttachment = &depthReadOnlyRef;
+  subpasses[1].preserveAttachmentCount = 1;
+  subpasses[1].pPreserveAttachments = &preservedColor;
+
+  subpasses[2].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[2].inputAttachmentCount = static_cast<uint32_t>(oitInputRefs.size());
+  subpasses[2].pInputAttachments = oitInputRefs.data();
+  subpasses[2].colorAttachmentCount = 1;
+  subpasses[2].pColorAttachments = &colorAttachmentRef;
+  subpasses[2].pResolveAttachments = &colorAttachmentResolveRef;
+
+  std::array<VkSubpassDependency, 5> dependencies{};
+  dependencies[0] = sceneDependency;
+  // Swapchain image acquire -> its layout transition in front of the resolve
+  dependencies[4] = sceneDependency;
+  dependencies[4].dstSubpass = 2;
+  dependencies[4].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[4].srcAccessMask = 0;
+  dependencies[4].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[4].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  // Scene depth -> accumulation depth test
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = 1;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+  // Accumulation -> composite input attachment reads
+  dependencies[2].srcSubpass = 1;
+  dependencies[2].dstSubpass = 2;
+  dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+  dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+  // Scene color -> composite blending
+  dependencies[3].srcSubpass = 0;
+  dependencies[3].dstSubpass = 2;
+  dependencies[3].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[3].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[3].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[3].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[3].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses = subpasses.data();
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
   if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
@@ -659,12 +778,13 @@ void VulkanBase::createFramebuffers() {
 
   for (size_t i = 0; i < swapChainImageViews.size(); i++) {
     // TODO: create depthbuffer for each swapchain images(colors)
-    std::array<VkImageView, 3> attachments = {msaaColor.imageView, depthBuffer.imageView, swapChainImageViews[i]};
+    std::array<VkImageView, 5> attachments = {msaaColor.imageView, depthBuffer.imageView, swapChainImageViews[i], oitAccum.imageView,
+                                              oitRevealage.imageView};
 
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
     framebufferInfo.renderPass = renderPass;
-    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.attachmentCount = transparencySubpasses ? 5 : 3;
     framebufferInfo.pAttachments = attachments.data();
     framebufferInfo.width = swapChainExtent.width;
     framebufferInfo.height = swapChainExtent.height;
@@ -772,6 +892,8 @@ void VulkanBase::cleanup() {
   cleanupResources();
   textureManager->destroyTexture(depthBuffer);
   textureManager->destroyTexture(msaaColor);
+  textureManager->destroyTexture(oitAccum);
+  textureManager->destroyTexture(oitRevealage);
   cleanupSwapChain();
   // clean up core
   vkDestroyRenderPass(device, renderPass, nullptr);
@@ -945,6 +1067,22 @@ void VulkanBase::createColorResources() {
                               VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, msaaSamples);
   msaaColor.imageView = textureManager->createImageView(msaaColor.image, msaaColor.format, VK_IMAGE_ASPECT_COLOR_BIT);
 }
+
+void VulkanBase::createTransparencyResources() {
+  if (!transparencySubpasses) {
+    return;
+  }
+  // Only live inside the render pass, same sample count as the scene so the accumulation can depth test against it
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+  oitAccum.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+  textureManager->InitTexture(oitAccum, swapChainExtent.width, swapChainExtent.height, oitAccum.format, VK_IMAGE_TILING_OPTIMAL, usage,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, msaaSamples);
+  oitAccum.imageView = textureManager->createImageView(oitAccum.image, oitAccum.format, VK_IMAGE_ASPECT_COLOR_BIT);
+  oitRevealage.format = VK_FORMAT_R16_SFLOAT;
+  textureManager->InitTexture(oitRevealage, swapChainExtent.width, swapChainExtent.height, oitRevealage.format, VK_IMAGE_TILING_OPTIMAL,
+                              usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, msaaSamples);
+  oitRevealage.imageView = textureManager->createImageView(oitRevealage.image, oitRevealage.format, VK_IMAGE_ASPECT_COLOR_BIT);
+}
 // Static callback implementations
 void VulkanBase::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
   auto app = reinterpret_cast<VulkanBase*>(glfwGetWindowUserPointer(window));
@@ -1027,13 +1165,72 @@ void VulkanBase::mouseButtonCallback(GLFWwindow* window, int button, int action,
   app->onMouseButton(button, action, mods);
 }
 
+// ============= IBL cache =============
+namespace {
+// Filter settings of the generated IBL textures, all of them are part of the cache key
+constexpr uint32_t kIblCacheVersion = 1;
+constexpr VkFormat kBrdfLutFormat = VK_FORMAT_R16G16_SFLOAT;
+constexpr int32_t kBrdfLutSize = 512;
+constexpr VkFormat kIrradianceFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+constexpr int32_t kIrradianceSize = 64;
+constexpr VkFormat kPrefilteredFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+constexpr int32_t kPrefilteredSize = 512;
+constexpr uint32_t kPrefilterSamples = 32;
+// Cosine-weighted samples of the compute irradiance filter, the graphics path sweeps a fixed 180 x 64 grid
+constexpr uint32_t kIrradianceSamples = 128;
+
+const TextureManager::TextureSampler kIblSampler{VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                 VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE};
+
+// FNV-1a over the contents of the files (source image, filter shaders) and the filter parameters, as hex
+std::string iblCacheKey(const std::vector<std::string>& files, const std::vector<uint64_t>& parameters) {
+  uint64_t hash = 14695981039346656037ull;
+  auto hashBytes = [&hash](const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  std::vector<char> chunk(1 << 20);
+  for (const std::string& file : files) {
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+      hashBytes(file.data(), file.size());
+      continue;
+    }
+    while (stream.read(chunk.data(), chunk.size()) || stream.gcount() > 0) {
+      hashBytes(chunk.data(), static_cast<size_t>(stream.gcount()));
+    }
+  }
+  hashBytes(parameters.data(), parameters.size() * sizeof(uint64_t));
+
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+  return hex;
+}
+}  // namespace
+
 void VulkanBase::initializePBREnvironment() {
   if (pbrEnvironment.isInitialized) {
     return;
   }
 
   // Generate BRDF LUT first (doesn't depend on environment)
-  generateBRDFLUT();
+  auto tStart = std::chrono::high_resolution_clock::now();
+  const std::string lutPath = std::string(TEXTURE_DIR) + "/brdf_lut.ktx2";
+  const std::string lutKey = iblCacheKey({std::string(SHADER_DIR) + "/genbrdflut.vert.spv", std::string(SHADER_DIR) + "/genbrdflut.frag.spv"},
+                                         {kIblCacheVersion, kBrdfLutFormat, kBrdfLutSize});
+  if (iblCache && textureManager->loadTextureFromKTX2(pbrEnvironment.lutBrdf, lutPath, kBrdfLutFormat, lutKey, kIblSampler)) {
+    auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    spdlog::info("Loaded BRDF LUT from {} in {} ms", lutPath, tDiff);
+  } else {
+    generateBRDFLUT();
+    if (iblCache) {
+      textureManager->writeTextureToKTX2(pbrEnvironment.lutBrdf, lutPath, lutKey);
+    }
+    auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    spdlog::info("Generated BRDF LUT in {} ms", tDiff);
+  }
   // Load a default environment if needed
   // This can be overridden by derived classes
   pbrEnvironment.isInitialized = true;
@@ -1048,24 +1245,67 @@ void VulkanBase::loadEnvironment(std::string& filename) {
   spdlog::info("Environment loaded: {}", pbrEnvironment.environmentCube.image != VK_NULL_HANDLE);
   spdlog::info("Environment is cubemap: {}", pbrEnvironment.environmentCube.isCubemap());
 
+  // The compute path writes both cube formats as storage images, without that support it falls back to render passes
+  bool useCompute = iblFilterPath == IBLFilterPath::Compute;
+  for (VkFormat format : {kIrradianceFormat, kPrefilteredFormat}) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    useCompute = useCompute && (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+  }
+  if (iblFilterPath == IBLFilterPath::Compute && !useCompute) {
+    spdlog::warn("IBL cube formats lack storage image support, filtering with render passes");
+  }
+
+  // Filtered cubes from the cache if the environment and the filter settings are unchanged, otherwise generate and store them
+  auto tStart = std::chrono::high_resolution_clock::now();
+  const std::string irradiancePath = filename + ".irradiance.ktx2";
+  const std::string prefilteredPath = filename + ".prefiltered.ktx2";
+  std::vector<std::string> keyFiles = {filename};
+  if (useCompute) {
+    keyFiles.push_back(std::string(SHADER_DIR) + "/irradiancecube.comp.spv");
+    keyFiles.push_back(std::string(SHADER_DIR) + "/prefiltercube.comp.spv");
+  } else {
+    keyFiles.push_back(std::string(SHADER_DIR) + "/filtercube.vert.spv");
+    keyFiles.push_back(std::string(SHADER_DIR) + "/irradiancecube.frag.spv");
+    keyFiles.push_back(std::string(SHADER_DIR) + "/prefilterenvmap.frag.spv");
+  }
+  const std::string cubeKey = iblCacheKey(keyFiles, {kIblCacheVersion, useCompute, pbrEnvironment.environmentCube.extent.width, pbrEnvironment.environmentCube.mipLevels,
+                                                     kIrradianceFormat, kIrradianceSize, kIrradianceSamples, kPrefilteredFormat, kPrefilteredSize, kPrefilterSamples});
+  if (iblCache && textureManager->loadTextureFromKTX2(pbrEnvironment.irradianceCube, irradiancePath, kIrradianceFormat, cubeKey, kIblSampler) &&
+      textureManager->loadTextureFromKTX2(pbrEnvironment.prefilteredCube, prefilteredPath, kPrefilteredFormat, cubeKey, kIblSampler)) {
+    pbrEnvironment.prefilteredCubeMipLevels = static_cast<float>(pbrEnvironment.prefilteredCube.mipLevels);
+    auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+    spdlog::info("Loaded irradiance and prefiltered cubemaps from cache in {} ms", tDiff);
+    return;
+  }
+
   // Generate IBL maps from the environment
-  generateCubemaps();
+  if (useCompute) {
+    generateCubemapsCompute();
+  } else {
+    generateCubemaps();
+  }
+  auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+  spdlog::info("Generated IBL cubemaps with the {} path in {} ms", useCompute ? "compute" : "graphics", tDiff);
+  if (iblCache) {
+    textureManager->writeTextureToKTX2(pbrEnvironment.irradianceCube, irradiancePath, cubeKey);
+    textureManager->writeTextureToKTX2(pbrEnvironment.prefilteredCube, prefilteredPath, cubeKey);
+  }
 }
 
 void VulkanBase::generateBRDFLUT() {
   // BRDF LUT generation for PBR
-  const VkFormat format = VK_FORMAT_R16G16_SFLOAT;
-  const int32_t dim = 512;
+  const VkFormat format = kBrdfLutFormat;
+  const int32_t dim = kBrdfLutSize;
 
-  // Initialize texture
-  textureManager->InitTexture(pbrEnvironment.lutBrdf, dim, dim, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SAMPLE_COUNT_1_BIT);
+  // Initialize texture, transfer src for the KTX2 cache read back
+  textureManager->InitTexture(pbrEnvironment.lutBrdf, dim, dim, format, VK_IMAGE_TILING_OPTIMAL,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1,
+                              VK_SAMPLE_COUNT_1_BIT);
 
   pbrEnvironment.lutBrdf.imageView = textureManager->createImageView(pbrEnvironment.lutBrdf.image, format, VK_IMAGE_ASPECT_COLOR_BIT);
 
-  TextureManager::TextureSampler sampler{VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                                         VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE};
-  pbrEnvironment.lutBrdf.sampler = textureManager->createTextureSampler(sampler, 1.0f, 1.0f);
+  pbrEnvironment.lutBrdf.sampler = textureManager->createTextureSampler(kIblSampler, 1.0f, 1.0f);
 
   // Create render pass for BRDF LUT generation
   VkAttachmentDescription attDesc{};
@@ -1265,6 +1505,7 @@ void VulkanBase::generateBRDFLUT() {
 
 // This method should be called after generateCubemaps to cleanup temp resources
 void VulkanBase::cleanupPBREnvironment() {
+  cleanupEnvironmentUpdate();
   if (pbrEnvironment.environmentCube.image) {
     textureManager->destroyTexture(pbrEnvironment.environmentCube);
   }
@@ -1300,24 +1541,23 @@ void VulkanBase::generateCubemaps() {
 
     switch (target) {
       case IRRADIANCE:
-        format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        dim = 64;
+        format = kIrradianceFormat;
+        dim = kIrradianceSize;
         break;
       case PREFILTEREDENV:
-        format = VK_FORMAT_R16G16B16A16_SFLOAT;
-        dim = 512;
+        format = kPrefilteredFormat;
+        dim = kPrefilteredSize;
         break;
     }
 
     // Create target cubemap
     const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
-    textureManager->InitCubemapTexture(cubemap, dim, dim, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+    textureManager->InitCubemapTexture(cubemap, dim, dim, format, VK_IMAGE_TILING_OPTIMAL,
+                                       VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, numMips);
 
     cubemap.imageView = textureManager->createCubemapImageView(cubemap.image, format, numMips);
-    TextureManager::TextureSampler samplerSetting{VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                                                  VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE};
-    cubemap.sampler = textureManager->createTextureSampler(samplerSetting, numMips, 1.0f);
+    cubemap.sampler = textureManager->createTextureSampler(kIblSampler, numMips, 1.0f);
 
     // Create render pass
     VkAttachmentDescription attDesc{};
@@ -1442,7 +1682,7 @@ void VulkanBase::generateCubemaps() {
     struct PushBlockPrefilterEnv {
       glm::mat4 mvp;
       float roughness;
-      uint32_t numSamples = 32u;
+      uint32_t numSamples = kPrefilterSamples;
     } pushBlockPrefilterEnv;
 
     // Pipeline layout
@@ -1713,4 +1953,400 @@ void VulkanBase::generateCubemaps() {
     auto tDiff = std::chrono::duration<double, std::milli>(tEnd - tStart).count();
     spdlog::info("Generated {} cubemap with {} mip levels in {} ms", target == IRRADIANCE ? "irradiance" : "prefiltered environment", numMips, tDiff);
   }
-}
\ No newline at end of file
+}
+
+// ============= Compute IBL filter =============
+namespace {
+struct IBLFilterTarget {
+  VkFormat format;
+  int32_t dim;
+  uint32_t numSamples;
+  const char* shader;
+};
+// Irradiance (0) and prefiltered (1) cube of IBLFilter
+const std::array<IBLFilterTarget, 2> kIblFilterTargets = {{
+    {kIrradianceFormat, kIrradianceSize, kIrradianceSamples, "/irradiancecube.comp.spv"},
+    {kPrefilteredFormat, kPrefilteredSize, kPrefilterSamples, "/prefiltercube.comp.spv"},
+}};
+
+struct IBLFilterPushBlock {
+  float roughness;
+  uint32_t numSamples;
+  uint32_t firstFace;
+};
+}  // namespace
+
+void VulkanBase::createIBLFilter(IBLFilter& filter, const TextureManager::Texture& environment) {
+  uint32_t totalMips = 0;
+  for (size_t t = 0; t < kIblFilterTargets.size(); t++) {
+    const IBLFilterTarget& target = kIblFilterTargets[t];
+    TextureManager::Texture& cubemap = filter.cubemaps[t];
+    filter.numMips[t] = static_cast<uint32_t>(floor(log2(target.dim))) + 1;
+    totalMips += filter.numMips[t];
+    textureManager->InitCubemapTexture(cubemap, target.dim, target.dim, target.format, VK_IMAGE_TILING_OPTIMAL,
+                                       VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, filter.numMips[t]);
+    cubemap.imageView = textureManager->createCubemapImageView(cubemap.image, target.format, filter.numMips[t]);
+    cubemap.sampler = textureManager->createTextureSampler(kIblSampler, static_cast<float>(filter.numMips[t]), 1.0f);
+    cubemap.descriptor.imageView = cubemap.imageView;
+    cubemap.descriptor.sampler = cubemap.sampler;
+    cubemap.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    for (uint32_t m = 0; m < filter.numMips[t]; m++) {
+      VkImageViewCreateInfo viewInfo{};
+      viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+      viewInfo.image = cubemap.image;
+      viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+      viewInfo.format = target.format;
+      viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, m, 1, 0, 6};
+      VkImageView view;
+      VK_CHECK_RESULT(vkCreateImageView(device, &viewInfo, nullptr, &view));
+      filter.mipViews[t].push_back(view);
+    }
+  }
+
+  // Descriptors: the environment and one storage mip per set
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings = {{
+      {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+  }};
+  VkDescriptorSetLayoutCreateInfo setLayoutCI{};
+  setLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutCI.bindingCount = static_cast<uint32_t>(bindings.size());
+  setLayoutCI.pBindings = bindings.data();
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCI, nullptr, &filter.setLayout));
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes = {{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, totalMips}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, totalMips}}};
+  VkDescriptorPoolCreateInfo poolCI{};
+  poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolCI.maxSets = totalMips;
+  poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolCI.pPoolSizes = poolSizes.data();
+  VK_CHECK_RESULT(vkCreateDescriptorPool(device, &poolCI, nullptr, &filter.descriptorPool));
+
+  for (size_t t = 0; t < kIblFilterTargets.size(); t++) {
+    std::vector<VkDescriptorSetLayout> setLayouts(filter.numMips[t], filter.setLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = filter.descriptorPool;
+    allocInfo.descriptorSetCount = filter.numMips[t];
+    allocInfo.pSetLayouts = setLayouts.data();
+    filter.descriptorSets[t].resize(filter.numMips[t]);
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, filter.descriptorSets[t].data()));
+
+    for (uint32_t m = 0; m < filter.numMips[t]; m++) {
+      VkDescriptorImageInfo mipInfo{VK_NULL_HANDLE, filter.mipViews[t][m], VK_IMAGE_LAYOUT_GENERAL};
+      std::array<VkWriteDescriptorSet, 2> writes{};
+      writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[0].dstSet = filter.descriptorSets[t][m];
+      writes[0].dstBinding = 0;
+      writes[0].descriptorCount = 1;
+      writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      writes[0].pImageInfo = &environment.descriptor;
+      writes[1] = writes[0];
+      writes[1].dstBinding = 1;
+      writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+      writes[1].pImageInfo = &mipInfo;
+      vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+  }
+
+  VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IBLFilterPushBlock)};
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = 1;
+  pipelineLayoutCI.pSetLayouts = &filter.setLayout;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &filter.pipelineLayout));
+
+  for (size_t t = 0; t < kIblFilterTargets.size(); t++) {
+    VkComputePipelineCreateInfo pipelineCI{};
+    pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCI.layout = filter.pipelineLayout;
+    pipelineCI.stage = loadShader(std::string(SHADER_DIR) + kIblFilterTargets[t].shader, VK_SHADER_STAGE_COMPUTE_BIT);
+    VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &filter.pipelines[t]));
+    vkDestroyShaderModule(device, pipelineCI.stage.module, nullptr);
+  }
+}
+
+void VulkanBase::recordIBLFilterBarrier(VkCommandBuffer commandBuffer, IBLFilter& filter, bool toGeneral) {
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  for (size_t t = 0; t < barriers.size(); t++) {
+    barriers[t].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[t].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[t].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[t].image = filter.cubemaps[t].image;
+    barriers[t].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, filter.numMips[t], 0, 6};
+    barriers[t].oldLayout = toGeneral ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_GENERAL;
+    barriers[t].newLayout = toGeneral ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[t].srcAccessMask = toGeneral ? 0 : VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[t].dstAccessMask = toGeneral ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+    filter.cubemaps[t].currentLayout = barriers[t].newLayout;
+  }
+  vkCmdPipelineBarrier(commandBuffer, toGeneral ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       toGeneral ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+// Every mip only reads the environment, so dispatches of one filter need no barriers between them
+void VulkanBase::recordIBLFilter(VkCommandBuffer commandBuffer, const IBLFilter& filter, uint32_t target, uint32_t mip, uint32_t firstFace,
+                                 uint32_t faceCount) {
+  const uint32_t mipSize = std::max(1u, static_cast<uint32_t>(kIblFilterTargets[target].dim) >> mip);
+  IBLFilterPushBlock pushBlock{};
+  pushBlock.roughness = filter.numMips[target] > 1 ? static_cast<float>(mip) / static_cast<float>(filter.numMips[target] - 1) : 0.0f;
+  pushBlock.numSamples = kIblFilterTargets[target].numSamples;
+  pushBlock.firstFace = firstFace;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, filter.pipelines[target]);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, filter.pipelineLayout, 0, 1, &filter.descriptorSets[target][mip], 0, nullptr);
+  vkCmdPushConstants(commandBuffer, filter.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IBLFilterPushBlock), &pushBlock);
+  vkCmdDispatch(commandBuffer, (mipSize + 7) / 8, (mipSize + 7) / 8, faceCount);
+}
+
+// Destroys everything but the cubes, those are moved out by the caller
+void VulkanBase::destroyIBLFilter(IBLFilter& filter) {
+  for (size_t t = 0; t < kIblFilterTargets.size(); t++) {
+    vkDestroyPipeline(device, filter.pipelines[t], nullptr);
+    filter.pipelines[t] = VK_NULL_HANDLE;
+    for (VkImageView view : filter.mipViews[t]) {
+      vkDestroyImageView(device, view, nullptr);
+    }
+    filter.mipViews[t].clear();
+    filter.descriptorSets[t].clear();
+  }
+  vkDestroyPipelineLayout(device, filter.pipelineLayout, nullptr);
+  vkDestroyDescriptorPool(device, filter.descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device, filter.setLayout, nullptr);
+  filter.pipelineLayout = VK_NULL_HANDLE;
+  filter.descriptorPool = VK_NULL_HANDLE;
+  filter.setLayout = VK_NULL_HANDLE;
+}
+
+// Same targets as generateCubemaps, but filtercube.comp writes every mip of both cubes through per-mip storage views,
+// all dispatches are recorded into one command buffer with a single submission and wait
+void VulkanBase::generateCubemapsCompute() {
+  auto tStart = std::chrono::high_resolution_clock::now();
+  IBLFilter filter;
+  createIBLFilter(filter, pbrEnvironment.environmentCube);
+  auto tRecord = std::chrono::high_resolution_clock::now();
+
+  VkCommandBuffer cmdBuf = cmdUtils->beginSingleTimeCommands();
+  recordIBLFilterBarrier(cmdBuf, filter, true);
+  for (uint32_t t = 0; t < kIblFilterTargets.size(); t++) {
+    for (uint32_t m = 0; m < filter.numMips[t]; m++) {
+      recordIBLFilter(cmdBuf, filter, t, m, 0, 6);
+    }
+  }
+  recordIBLFilterBarrier(cmdBuf, filter, false);
+  cmdUtils->endSingleTimeCommands(cmdBuf);
+  auto tEnd = std::chrono::high_resolution_clock::now();
+
+  destroyIBLFilter(filter);
+  pbrEnvironment.prefilteredCubeMipLevels = static_cast<float>(filter.numMips[1]);
+  pbrEnvironment.irradianceCube = std::move(filter.cubemaps[0]);
+  pbrEnvironment.prefilteredCube = std::move(filter.cubemaps[1]);
+
+  auto setupMs = std::chrono::duration<double, std::milli>(tRecord - tStart).count();
+  auto filterMs = std::chrono::duration<double, std::milli>(tEnd - tRecord).count();
+  spdlog::info("Filtered irradiance and prefiltered environment cubemaps in one submission: {} ms setup, {} ms record and execute", setupMs, filterMs);
+}
+
+// ============= Incremental environment update =============
+bool VulkanBase::beginEnvironmentUpdate(const std::string& filename) {
+  EnvironmentUpdate& update = environmentUpdate;
+  if (update.active || update.retireCountdown > 0) {
+    spdlog::warn("Environment update still in progress, ignoring {}", filename);
+    return false;
+  }
+  for (VkFormat format : {kIrradianceFormat, kPrefilteredFormat}) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+      spdlog::warn("IBL cube formats lack storage image support, incremental environment updates are unavailable");
+      return false;
+    }
+  }
+  spdlog::info("Updating environment to {}", filename);
+
+  // Same cube as createCubemapFromEquirectangular, filled once the worker thread has converted the source
+  const bool isHDR = filename.find(".hdr") != std::string::npos || filename.find(".HDR") != std::string::npos;
+  const VkFormat format = isHDR ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+  const uint32_t faceSize = TextureManager::equirectFaceSize;
+  const uint32_t mipLevels = static_cast<uint32_t>(floor(log2(faceSize))) + 1;
+  const VkDeviceSize totalSize = static_cast<VkDeviceSize>(faceSize) * faceSize * (isHDR ? 16 : 4) * 6;
+  update.staging = bufferManager->createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  textureManager->InitCubemapTexture(update.environmentCube, faceSize, faceSize, format, VK_IMAGE_TILING_OPTIMAL,
+                                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipLevels);
+  update.environmentCube.imageView = textureManager->createCubemapImageView(update.environmentCube.image, format, mipLevels);
+  update.environmentCube.sampler = textureManager->createTextureSampler(kIblSampler, static_cast<float>(mipLevels));
+  update.environmentCube.descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  update.environmentCube.descriptor.imageView = update.environmentCube.imageView;
+  update.environmentCube.descriptor.sampler = update.environmentCube.sampler;
+  // Pipelines and descriptors up front, so the frames that filter only record dispatches
+  createIBLFilter(update.filter, update.environmentCube);
+
+  // One job per face and mip, a mirror mip is a single tap per texel
+  update.jobs.clear();
+  for (uint32_t t = 0; t < 2; t++) {
+    const uint32_t dim = update.filter.cubemaps[t].extent.width;
+    const uint32_t numSamples = t == 0 ? kIrradianceSamples : kPrefilterSamples;
+    for (uint32_t m = 0; m < update.filter.numMips[t]; m++) {
+      const double texels = static_cast<double>(std::max(1u, dim >> m)) * std::max(1u, dim >> m);
+      const double samples = (t == 1 && m == 0) ? 1.0 : static_cast<double>(numSamples);
+      for (uint32_t face = 0; face < 6; face++) {
+        update.jobs.push_back({t, m, face, texels * samples});
+      }
+    }
+  }
+  // Every job only reads the source environment, so they can run in any order. Cheap ones first pack the frame budget tightly
+  std::stable_sort(update.jobs.begin(), update.jobs.end(),
+                   [](const EnvironmentUpdate::Job& a, const EnvironmentUpdate::Job& b) { return a.cost < b.cost; });
+  update.nextJob = 0;
+  update.uploaded = false;
+  update.frames = 0;
+  update.filename = filename;
+
+  if (update.queryPool == VK_NULL_HANDLE && context->properties.limits.timestampComputeAndGraphics) {
+    VkQueryPoolCreateInfo queryPoolCI{};
+    queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+    VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &update.queryPool));
+    update.recordedCost.assign(MAX_FRAMES_IN_FLIGHT, 0.0);
+  }
+
+  update.startTime = std::chrono::high_resolution_clock::now();
+  update.conversion = std::async(std::launch::async, TextureManager::convertEquirectToFaces, filename, faceSize, update.staging.mapped);
+  update.active = true;
+  return true;
+}
+
+bool VulkanBase::recordEnvironmentUpdate(VkCommandBuffer commandBuffer) {
+  EnvironmentUpdate& update = environmentUpdate;
+  // The frame that swapped the cubes and every older one have completed once each slot was waited on again
+  if (update.retireCountdown > 0 && --update.retireCountdown == 0) {
+    for (TextureManager::Texture& texture : update.retired) {
+      if (texture.image != VK_NULL_HANDLE) {
+        textureManager->destroyTexture(texture);
+      }
+    }
+    destroyIBLFilter(update.filter);
+    bufferManager->destroyBuffer(update.staging);
+  }
+  if (!update.active) {
+    return false;
+  }
+  update.frames++;
+
+  // Filter throughput of the last submission from this slot, its fence has been waited on
+  if (update.queryPool != VK_NULL_HANDLE && update.recordedCost[currentFrame] > 0.0) {
+    uint64_t timestamps[2] = {};
+    VkResult result = vkGetQueryPoolResults(device, update.queryPool, currentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS && timestamps[1] > timestamps[0]) {
+      double ms = static_cast<double>(timestamps[1] - timestamps[0]) * context->properties.limits.timestampPeriod / 1000000.0;
+      update.samplesPerMs = update.samplesPerMs * 0.75 + (update.recordedCost[currentFrame] / ms) * 0.25;
+    }
+    update.recordedCost[currentFrame] = 0.0;
+  }
+
+  // Upload as soon as the worker thread is done, the filter starts on the next frame
+  if (!update.uploaded) {
+    if (update.conversion.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+    if (!update.conversion.get()) {
+      // Nothing was recorded with the new resources yet
+      spdlog::error("Environment update to {} failed", update.filename);
+      textureManager->destroyTexture(update.environmentCube);
+      textureManager->destroyTexture(update.filter.cubemaps[0]);
+      textureManager->destroyTexture(update.filter.cubemaps[1]);
+      destroyIBLFilter(update.filter);
+      bufferManager->destroyBuffer(update.staging);
+      update.active = false;
+      return false;
+    }
+    textureManager->recordCubemapUpload(update.environmentCube, update.staging.buffer, commandBuffer);
+    // The upload leaves the environment readable by fragment shaders, the filter samples it in compute
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    recordIBLFilterBarrier(commandBuffer, update.filter, true);
+    update.uploaded = true;
+    return false;
+  }
+
+  // As many jobs as fit the budget at the measured throughput, at least one so the update always progresses
+  const double budget = update.budgetMs * update.samplesPerMs;
+  double cost = 0.0;
+  if (update.queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, update.queryPool, currentFrame * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, update.queryPool, currentFrame * 2);
+  }
+  while (update.nextJob < update.jobs.size()) {
+    const EnvironmentUpdate::Job& job = update.jobs[update.nextJob];
+    if (cost > 0.0 && cost + job.cost > budget) {
+      break;
+    }
+    recordIBLFilter(commandBuffer, update.filter, job.target, job.mip, job.face, 1);
+    cost += job.cost;
+    update.nextJob++;
+  }
+  if (update.queryPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, update.queryPool, currentFrame * 2 + 1);
+    update.recordedCost[currentFrame] = cost;
+  }
+  if (update.nextJob < update.jobs.size()) {
+    return false;
+  }
+
+  // Complete: swap the new cubes in, the old ones stay alive until the frames still using them are done
+  recordIBLFilterBarrier(commandBuffer, update.filter, false);
+  update.retired[0] = std::move(pbrEnvironment.environmentCube);
+  update.retired[1] = std::move(pbrEnvironment.irradianceCube);
+  update.retired[2] = std::move(pbrEnvironment.prefilteredCube);
+  pbrEnvironment.environmentCube = std::move(update.environmentCube);
+  pbrEnvironment.irradianceCube = std::move(update.filter.cubemaps[0]);
+  pbrEnvironment.prefilteredCube = std::move(update.filter.cubemaps[1]);
+  pbrEnvironment.prefilteredCubeMipLevels = static_cast<float>(update.filter.numMips[1]);
+  pbrEnvironment.version++;
+  update.retireCountdown = MAX_FRAMES_IN_FLIGHT;
+  update.active = false;
+
+  update.lastSwitchMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - update.startTime).count();
+  update.lastSwitchFrames = update.frames;
+  spdlog::info("Environment switched to {} after {} frames, {} ms ({:.0f} filter samples/ms)", update.filename, update.frames, update.lastSwitchMs,
+               update.samplesPerMs);
+  return true;
+}
+
+// Expects an idle device
+void VulkanBase::cleanupEnvironmentUpdate() {
+  EnvironmentUpdate& update = environmentUpdate;
+  if (update.conversion.valid()) {
+    update.conversion.wait();
+  }
+  for (TextureManager::Texture* texture : {&update.environmentCube, &update.filter.cubemaps[0], &update.filter.cubemaps[1], &update.retired[0],
+                                           &update.retired[1], &update.retired[2]}) {
+    if (texture->image != VK_NULL_HANDLE) {
+      textureManager->destroyTexture(*texture);
+    }
+  }
+  if (update.filter.pipelineLayout != VK_NULL_HANDLE) {
+    destroyIBLFilter(update.filter);
+  }
+  if (update.staging.buffer != VK_NULL_HANDLE) {
+    bufferManager->destroyBuffer(update.staging);
+  }
+  if (update.queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, update.queryPool, nullptr);
+    update.queryPool = VK_NULL_HANDLE;
+  }
+  update.active = false;
+  update.retireCountdown = 0;
+}
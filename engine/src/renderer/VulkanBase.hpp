@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include <array>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
@@ -46,6 +47,8 @@ class TAK_API VulkanBase {
   virtual void onKeyEvent(int key, int scancode, int action, int mods) {}  // Optional key handling
   virtual void onMouseMove(double xpos, double ypos) {}                    // Optional mouse handling
   virtual void onMouseButton(int button, int action, int mods) {};
+  // Work that has to be recorded outside the render pass (compute pre-passes, query resets)
+  virtual void recordPreRenderPassCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {}
 
   virtual void initWindow();
   virtual void initVulkan();
@@ -63,6 +66,7 @@ class TAK_API VulkanBase {
   void createSwapChain();
   void createImageViews();
   void createRenderPass();
+  void createTransparencyRenderPass(const std::array<VkAttachmentDescription, 3>& sceneAttachments, const VkSubpassDependency& sceneDependency);
   void createFramebuffers();
   void createCommandPool();
   void createCommandBuffers();
@@ -96,8 +100,34 @@ class TAK_API VulkanBase {
   void initializePBREnvironment();
   void generateBRDFLUT();
   void generateCubemaps();
+  void generateCubemapsCompute();
   void loadEnvironment(std::string& filename);
   void cleanupPBREnvironment();
+  // Switches to another environment without stalling: the source is decoded and converted on a worker thread, uploaded
+  // in one frame and filtered a few faces per frame into a second set of cubes, the bound IBL stays in use until the
+  // new one is complete. Returns false if an update is still running or the compute filter is unavailable
+  bool beginEnvironmentUpdate(const std::string& filename);
+  // Records this frame's share of a pending update, call before the render pass once the frame's fence was waited.
+  // Returns true on the frame the new cubes replace the ones in pbrEnvironment, descriptors have to be rewritten then
+  bool recordEnvironmentUpdate(VkCommandBuffer commandBuffer);
+  void cleanupEnvironmentUpdate();
+
+  // filtercube.comp state for the irradiance (0) and prefiltered (1) cubes of one environment
+  struct IBLFilter {
+    std::array<TextureManager::Texture, 2> cubemaps;
+    std::array<uint32_t, 2> numMips{};
+    std::array<VkPipeline, 2> pipelines{};
+    std::array<std::vector<VkImageView>, 2> mipViews;  // 2D array view of one mip, all six faces
+    std::array<std::vector<VkDescriptorSet>, 2> descriptorSets;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  };
+  void createIBLFilter(IBLFilter& filter, const TextureManager::Texture& environment);
+  // UNDEFINED -> GENERAL before the first dispatch, GENERAL -> SHADER_READ_ONLY after the last one
+  void recordIBLFilterBarrier(VkCommandBuffer commandBuffer, IBLFilter& filter, bool toGeneral);
+  void recordIBLFilter(VkCommandBuffer commandBuffer, const IBLFilter& filter, uint32_t target, uint32_t mip, uint32_t firstFace, uint32_t faceCount);
+  void destroyIBLFilter(IBLFilter& filter);
 
   // Protected members accessible to derived classes
   GLFWwindow* window = nullptr;
@@ -136,6 +166,15 @@ class TAK_API VulkanBase {
   VkSampleCountFlagBits msaaSamples;
   TextureManager::Texture msaaColor;
 
+  // Weighted blended order-independent transparency, set by the derived class before initVulkan
+  // The render pass then has three subpasses: 0 the scene, 1 transparency accumulation into oitAccum/oitRevealage (depth
+  // read-only), 2 the composite over the scene color reading both as input attachments (resolve and overlay happen here).
+  // recordRenderCommands starts in subpass 0 and has to advance to subpass 2 itself
+  bool transparencySubpasses = false;
+  TextureManager::Texture oitAccum;      // RGBA16F, sum of weighted premultiplied color and weighted alpha
+  TextureManager::Texture oitRevealage;  // R16F, product of (1 - alpha)
+  void createTransparencyResources();
+
   VkCommandPool commandPool;
   VkCommandPool transientCommandPool;
   std::vector<VkCommandBuffer> commandBuffers;
@@ -167,8 +206,45 @@ class TAK_API VulkanBase {
     TextureManager::Texture prefilteredCube;  // Pre-filtered environment for specular IBL
     TextureManager::Texture lutBrdf;          // BRDF lookup table
     float prefilteredCubeMipLevels = 0.0f;    // Number of mip levels in prefiltered cube
+    uint32_t version = 0;                     // Incremented whenever the cubes are replaced at runtime
     bool isInitialized = false;
   } pbrEnvironment;
+  // Incremental environment switch, see beginEnvironmentUpdate
+  struct EnvironmentUpdate {
+    struct Job {
+      uint32_t target;  // IBLFilter cube
+      uint32_t mip;
+      uint32_t face;
+      double cost;  // texels times samples
+    };
+    bool active = false;
+    std::string filename;
+    std::future<bool> conversion;   // fills staging.mapped with the six faces
+    BufferManager::Buffer staging;  // host visible, kept mapped
+    TextureManager::Texture environmentCube;
+    IBLFilter filter;
+    bool uploaded = false;
+    std::vector<Job> jobs;  // cheapest first
+    size_t nextJob = 0;
+    uint32_t frames = 0;
+    std::chrono::high_resolution_clock::time_point startTime;
+    // GPU time of the filter dispatches per frame slot, refines samplesPerMs
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    std::vector<double> recordedCost;
+    double samplesPerMs = 1.0e6;
+    float budgetMs = 1.0f;
+    // Old cubes and the filter objects, destroyed once no frame in flight can reference them
+    std::array<TextureManager::Texture, 3> retired;
+    uint32_t retireCountdown = 0;
+    float lastSwitchMs = 0.0f;
+    uint32_t lastSwitchFrames = 0;
+  } environmentUpdate;
+  // How loadEnvironment filters the irradiance and prefiltered cubes: a render pass and copy per face and mip, or
+  // filtercube.comp writing every face and mip of both cubes in a single submission
+  enum class IBLFilterPath { Graphics, Compute };
+  IBLFilterPath iblFilterPath = IBLFilterPath::Compute;
+  // Reuse the BRDF LUT and the filtered cubes from KTX2 files next to their source while the source and filter settings match
+  bool iblCache = true;
 
   // For skybox generation in generateCubemaps
   ModelManager::Model tempSkyboxModel;
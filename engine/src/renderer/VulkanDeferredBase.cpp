@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <random>
 #include <set>
@@ -117,79 +118,10 @@ void VulkanDeferredBase::recordCommandBuffer(VkCommandBuffer commandBuffer, u32
     throw std::runtime_error("failed to begin recording command buffer!");
   }
 
-  // ==== GEOMETRY PASS ====
-  VkRenderPassBeginInfo geometryPassInfo{};
-  geometryPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  geometryPassInfo.renderPass = gBuffer.renderPass;
-  geometryPassInfo.framebuffer = gBuffer.framebuffers[currentFrame];
-  geometryPassInfo.renderArea.offset = {0, 0};
-  geometryPassInfo.renderArea.extent = swapChainExtent;
-
-  std::array<VkClearValue, 4> geometryClearValues{};
-  geometryClearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Normal
-  geometryClearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Albedo
-  geometryClearValues[2].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Material
-  geometryClearValues[3].depthStencil = {1.0f, 0};            // Depth
-
-  geometryPassInfo.clearValueCount = static_cast<uint32_t>(geometryClearValues.size());
-  geometryPassInfo.pClearValues = geometryClearValues.data();
-
-  vkCmdBeginRenderPass(commandBuffer, &geometryPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  // Record geometry pass commands from derived class
-  recordGeometryCommands(commandBuffer);
-  vkCmdEndRenderPass(commandBuffer);
-  // ==== SSAO PASS ====
-  VkRenderPassBeginInfo ssaoPassInfo{};
-  ssaoPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  ssaoPassInfo.renderPass = ssaoElements.ssaoRenderPass;
-  ssaoPassInfo.framebuffer = ssaoElements.ssaoFramebuffers[currentFrame];
-  ssaoPassInfo.renderArea.offset = {0, 0};
-  ssaoPassInfo.renderArea.extent = swapChainExtent;
-
-  VkClearValue ssaoClearValue{};
-  ssaoClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};  // Clear to 0 occlusion
-
-  ssaoPassInfo.clearValueCount = 1;
-  ssaoPassInfo.pClearValues = &ssaoClearValue;
-
-  vkCmdBeginRenderPass(commandBuffer, &ssaoPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  recordSSAOCommands(commandBuffer, imageIndex);
-  vkCmdEndRenderPass(commandBuffer);
-
-  // ==== SSAO BLUR PASS ====
-  VkRenderPassBeginInfo ssaoBlurPassInfo{};
-  ssaoBlurPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  ssaoBlurPassInfo.renderPass = ssaoElements.ssaoBlurRenderPass;
-  ssaoBlurPassInfo.framebuffer = ssaoElements.ssaoBlurFramebuffers[currentFrame];
-  ssaoBlurPassInfo.renderArea.offset = {0, 0};
-  ssaoBlurPassInfo.renderArea.extent = swapChainExtent;
-
-  VkClearValue ssaoBlurClearValue{};
-  ssaoBlurClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};  // Clear to 0 occlusion
-
-  ssaoBlurPassInfo.clearValueCount = 1;
-  ssaoBlurPassInfo.pClearValues = &ssaoBlurClearValue;
-
-  vkCmdBeginRenderPass(commandBuffer, &ssaoBlurPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  recordSSAOBlurCommands(commandBuffer, imageIndex);
-  vkCmdEndRenderPass(commandBuffer);
-
-  // ==== LIGHTING PASS ====
-  VkRenderPassBeginInfo lightingPassInfo{};
-  lightingPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  lightingPassInfo.renderPass = lightingPass.renderPass;
-  lightingPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-  lightingPassInfo.renderArea.offset = {0, 0};
-  lightingPassInfo.renderArea.extent = swapChainExtent;
-
-  VkClearValue lightingClearValue{};
-  lightingClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-  lightingPassInfo.clearValueCount = 1;
-  lightingPassInfo.pClearValues = &lightingClearValue;
-
-  vkCmdBeginRenderPass(commandBuffer, &lightingPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  recordLightingCommands(commandBuffer);
-  vkCmdEndRenderPass(commandBuffer);
+  // Passes, barriers and layout transitions come from the render graph (buildRenderGraph)
+  updateLightingUBO();
+  currentImageIndex = imageIndex;
+  renderGraph->execute(commandBuffer);
 
   // FIX: Removed duplicate vkEndCommandBuffer call.
   // The original had two consecutive vkEndCommandBuffer calls — the second
@@ -197,20 +129,168 @@ void VulkanDeferredBase::recordCommandBuffer(VkCommandBuffer commandBuffer, u32
   VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
 }
 
+void VulkanDeferredBase::buildRenderGraph() {
+  if (!renderGraph) {
+    renderGraph = std::make_unique<RenderGraph>(context, cmdUtils, bufferManager, textureManager);
+  }
+  RenderGraph& graph = *renderGraph;
+  graph.reset();
+  using Usage = RenderGraph::Usage;
+
+  const VkExtent2D halfExtent = {std::max(1u, (swapChainExtent.width + 1) / 2), std::max(1u, (swapChainExtent.height + 1) / 2)};
+  RenderGraph::TextureHandle normal = graph.importTexture("G-Buffer normal", gBuffer.normal);
+  RenderGraph::TextureHandle depth = graph.importTexture("G-Buffer depth", gBuffer.depthBuffer);
+  RenderGraph::BufferHandle clusters = graph.importBuffer("cluster light lists");
+  RenderGraph::TextureHandle shadowMap = graph.importTexture("shadow cascades", shadowCascades->shadowMap());
+  ssaoElements.depthPyramid = graph.createTexture("SSAO depth pyramid", {halfExtent, VK_FORMAT_R32_SFLOAT, SsaoElements::DEPTH_MIPS, true});
+  ssaoElements.halfNormal = graph.createTexture("SSAO half normal", {halfExtent, VK_FORMAT_R8G8B8A8_SNORM});
+  ssaoElements.ssaoOutput = graph.createTexture("SSAO raw", {halfExtent, ssaoElements.aoFormat});
+  ssaoElements.ssaoBlurTemp = graph.createTexture("SSAO blur temp", {halfExtent, ssaoElements.aoFormat});
+  ssaoElements.ssaoBlurred = graph.createTexture("SSAO blurred", {halfExtent, ssaoElements.aoFormat});
+  ssaoElements.ssaoFull = graph.createTexture("SSAO full", {swapChainExtent, ssaoElements.aoFormat});
+
+  // ==== LIGHT CULLING ====
+  graph.addPass("light culling").write(clusters, Usage::ComputeBufferWrite).execute([this](VkCommandBuffer cmd) { recordLightCulling(cmd); });
+
+  // ==== SHADOW CASCADES (cached static casters + dynamic casters) ====
+  // Read-modify-write: tiles without dynamic casters keep the cache copy of earlier frames
+  graph.addPass("shadow cascades").modify(shadowMap, Usage::DepthAttachment).execute([this](VkCommandBuffer cmd) {
+    shadowCascades->record(cmd, currentFrame, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                           [this](VkCommandBuffer commandBuffer, u32 cascade, bool staticCasters) { recordShadowCasters(commandBuffer, cascade, staticCasters); });
+  });
+
+  // ==== DEPTH/NORMAL PREPASS ====
+  graph.addPass("depth/normal prepass")
+      .write(normal, Usage::ColorAttachment)
+      .write(depth, Usage::DepthAttachment)
+      .execute([this](VkCommandBuffer cmd) {
+        VkRenderPassBeginInfo prepassInfo{};
+        prepassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        prepassInfo.renderPass = gBuffer.prepassRenderPass;
+        prepassInfo.framebuffer = gBuffer.prepassFramebuffer;
+        prepassInfo.renderArea.offset = {0, 0};
+        prepassInfo.renderArea.extent = swapChainExtent;
+
+        std::array<VkClearValue, 2> prepassClearValues{};
+        prepassClearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Normal
+        prepassClearValues[1].depthStencil = {0.0f, 0};            // Depth, reverse-Z
+
+        prepassInfo.clearValueCount = static_cast<uint32_t>(prepassClearValues.size());
+        prepassInfo.pClearValues = prepassClearValues.data();
+
+        vkCmdBeginRenderPass(cmd, &prepassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordGeometryCommands(cmd, gBuffer.prepassPipeline);
+        vkCmdEndRenderPass(cmd);
+      });
+
+  // ==== SSAO (compute, half resolution) ====
+  graph.addPass("SSAO downsample")
+      .read(depth, Usage::ComputeSampledDepth)
+      .read(normal, Usage::ComputeSampled)
+      .write(ssaoElements.depthPyramid, Usage::ComputeStorage)
+      .write(ssaoElements.halfNormal, Usage::ComputeStorage)
+      .execute([this](VkCommandBuffer cmd) { recordSSAODownsample(cmd); });
+  graph.addPass("SSAO")
+      .read(ssaoElements.depthPyramid, Usage::ComputeSampled)
+      .read(ssaoElements.halfNormal, Usage::ComputeSampled)
+      .write(ssaoElements.ssaoOutput, Usage::ComputeStorage)
+      .execute([this](VkCommandBuffer cmd) { recordSSAO(cmd); });
+
+  // ==== SSAO BLUR (compute, half resolution) ====
+  graph.addPass("SSAO blur horizontal")
+      .read(ssaoElements.ssaoOutput, Usage::ComputeSampled)
+      .read(ssaoElements.depthPyramid, Usage::ComputeSampled)
+      .read(ssaoElements.halfNormal, Usage::ComputeSampled)
+      .write(ssaoElements.ssaoBlurTemp, Usage::ComputeStorage)
+      .execute([this](VkCommandBuffer cmd) { recordSSAOBlur(cmd, 0); });
+  graph.addPass("SSAO blur vertical")
+      .read(ssaoElements.ssaoBlurTemp, Usage::ComputeSampled)
+      .read(ssaoElements.depthPyramid, Usage::ComputeSampled)
+      .read(ssaoElements.halfNormal, Usage::ComputeSampled)
+      .write(ssaoElements.ssaoBlurred, Usage::ComputeStorage)
+      .execute([this](VkCommandBuffer cmd) { recordSSAOBlur(cmd, 1); });
+
+  // ==== SSAO UPSAMPLE ====
+  graph.addPass("SSAO upsample")
+      .read(depth, Usage::ComputeSampledDepth)
+      .read(ssaoElements.depthPyramid, Usage::ComputeSampled)
+      .read(ssaoElements.ssaoBlurred, Usage::ComputeSampled)
+      .write(ssaoElements.ssaoFull, Usage::ComputeStorage)
+      .execute([this](VkCommandBuffer cmd) { recordSSAOUpsample(cmd); });
+
+  // ==== GEOMETRY + LIGHTING (one render pass, two subpasses) ====
+  RenderGraph::Pass& lighting = graph.addPass("geometry + lighting");
+  lighting.read(depth, Usage::DepthReadOnly)
+      .read(normal, Usage::FragmentSampled)
+      .read(ssaoElements.ssaoFull, Usage::FragmentSampled)
+      .read(shadowMap, Usage::FragmentSampled)
+      .read(clusters, Usage::FragmentBufferRead)
+      .sideEffect()
+      .execute([this](VkCommandBuffer cmd) {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = gBuffer.renderPass;
+        renderPassInfo.framebuffer = swapChainFramebuffers[currentImageIndex];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = swapChainExtent;
+
+        std::array<VkClearValue, 4> clearValues{};
+        clearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Albedo
+        clearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}};  // Material
+        clearValues[2].depthStencil = {0.0f, 0};            // Depth (loaded, unused)
+        clearValues[3].color = {{0.0f, 0.0f, 0.0f, 1.0f}};  // Swapchain
+
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        // Record geometry subpass commands from derived class
+        recordGeometryCommands(cmd, gBuffer.pipeline);
+        if (lightingPass.queryPool != VK_NULL_HANDLE) {
+          vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, lightingPass.queryPool, currentFrame * 4 + 2);
+        }
+        vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+        recordLightingCommands(cmd);
+        vkCmdEndRenderPass(cmd);
+        if (lightingPass.queryPool != VK_NULL_HANDLE) {
+          vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, lightingPass.queryPool, currentFrame * 4 + 3);
+        }
+      });
+  declareLightingInputs(lighting);
+
+  graph.compile();
+  shadowCascades->discardAtlas();  // compile transitions the imported textures from UNDEFINED
+  for (u32 i = 0; i < static_cast<u32>(MAX_FRAMES_IN_FLIGHT); i++) {
+    writeSsaoDescriptors(i);
+  }
+}
+
 void VulkanDeferredBase::createDescriptorPool() {
   //  Create descriptor pool
   // FIX: Use MAX_FRAMES_IN_FLIGHT consistently (was mixing with swapChainImages.size())
   const u32 frameCount = static_cast<u32>(MAX_FRAMES_IN_FLIGHT);
   std::vector<VkDescriptorPoolSize> poolSizes = {
-      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 4},  // Gbuffer
-      // SSAO pass: depth + normal + noise + 2 UBOs per frame
-      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 3},  // ssao depth, normal, noise
+      // SSAO: pyramid + normal + noise, kernel + params UBOs, raw output per frame
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 3},  // ssao pyramid, normal, noise
       VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * 2},          // ssao kernel, params
-      // SSAO Blur pass: 1 sampler per frame
-      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 1},  // ssao blur
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount * 1},           // ssao output
+      // SSAO depth pyramid: G-Buffer depth + normal, source + destination level + half normals, params per level
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * SsaoElements::DEPTH_MIPS * 2},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount * SsaoElements::DEPTH_MIPS * 3},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * SsaoElements::DEPTH_MIPS},
+      // SSAO upsample: depth + pyramid + blurred, full output, params
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 3},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount * 1},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * 1},
+      // SSAO blur: input + pyramid + normal, output per direction
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 2 * 3},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount * 2},
+      // Light culling: light UBO + point lights, clusters, stats
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount},
+      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 3},
   };
   // retrive sizes from derived class
-  uint32_t maxSets = frameCount * 4;
+  uint32_t maxSets = frameCount * (5 + SsaoElements::DEPTH_MIPS);
   getDescriptorPoolSizes(poolSizes, maxSets);
 
   VkDescriptorPoolCreateInfo poolInfo{};
@@ -223,155 +303,45 @@ void VulkanDeferredBase::createDescriptorPool() {
 }
 // G-Buffer Creation
 void VulkanDeferredBase::createGBuffer() {
-  // Formats for G-Buffer
-  // normal: RGB=normal, A=metallic
-  // albedo: RGB=albedo, A=AO
-  // material: R=roughness, GBA=emissive (LDR emissive)
-  gBuffer.normal.resize(MAX_FRAMES_IN_FLIGHT);
-  gBuffer.albedo.resize(MAX_FRAMES_IN_FLIGHT);
-  gBuffer.material.resize(MAX_FRAMES_IN_FLIGHT);
-  VkFormat GBUFFER_NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
-  VkFormat GBUFFER_ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
-  VkFormat GBUFFER_MATERIAL_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
-  VkFormat DEPTH_FORMAT = gBuffer.depthBuffer[0].format;
-
-  // Create G-Buffer textures
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->InitTexture(gBuffer.normal[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_NORMAL_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.normal[i].imageView = textureManager->createImageView(gBuffer.normal[i].image, GBUFFER_NORMAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.normal[i].sampler = textureManager->createGBufferSampler();
-
-    textureManager->InitTexture(gBuffer.albedo[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.albedo[i].imageView = textureManager->createImageView(gBuffer.albedo[i].image, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.albedo[i].sampler = textureManager->createGBufferSampler();
-
-    textureManager->InitTexture(gBuffer.material[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.material[i].imageView = textureManager->createImageView(gBuffer.material[i].image, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.material[i].sampler = textureManager->createGBufferSampler();
-  }
-
-  // NOTE: No manual layout transitions needed here
-  // The render pass will handle transitions
-  // Create descriptor set layout for G-Buffer "(used in lighting pass)"
-  // Bindings: normal, albedo, material, depth
-  std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
-
-  for (uint32_t i = 0; i < 4; i++) {
-    bindings[i].binding = i;
-    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[i].descriptorCount = 1;
-    bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[i].pImmutableSamplers = nullptr;
-  }
-
-  VkDescriptorSetLayoutCreateInfo layoutInfo{};
-  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-  layoutInfo.pBindings = bindings.data();
-
-  if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &gBuffer.descriptorSetLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create G-Buffer descriptor set layout!");
-  }
-
-  // Allocate descriptor sets
-  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, gBuffer.descriptorSetLayout);
-  VkDescriptorSetAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-  allocInfo.pSetLayouts = layouts.data();
-
-  gBuffer.descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-  if (vkAllocateDescriptorSets(device, &allocInfo, gBuffer.descriptorSets.data()) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate G-Buffer descriptor sets!");
-  }
-
-  // Update descriptor sets
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    std::array<VkDescriptorImageInfo, 4> imageInfos{};
-
-    // Binding 0: Normal + Metallic
-    imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[0].imageView = gBuffer.normal[i].imageView;
-    imageInfos[0].sampler = gBuffer.normal[i].sampler;
-
-    // Binding 1: Albedo + AO
-    imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[1].imageView = gBuffer.albedo[i].imageView;
-    imageInfos[1].sampler = gBuffer.albedo[i].sampler;
-
-    // Binding 2: Material (Roughness + Emissive)
-    imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[2].imageView = gBuffer.material[i].imageView;
-    imageInfos[2].sampler = gBuffer.material[i].sampler;
-
-    // Binding 3: Depth (for position reconstruction)
-    imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-    imageInfos[3].imageView = gBuffer.depthBuffer[i].imageView;
-    imageInfos[3].sampler = gBuffer.depthBuffer[i].sampler;
-
-    std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
-    for (uint32_t j = 0; j < 4; j++) {
-      descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      descriptorWrites[j].dstSet = gBuffer.descriptorSets[i];
-      descriptorWrites[j].dstBinding = j;
-      descriptorWrites[j].dstArrayElement = 0;
-      descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      descriptorWrites[j].descriptorCount = 1;
-      descriptorWrites[j].pImageInfo = &imageInfos[j];
+  // Formats for G-Buffer (12 bytes of color per pixel, was 16)
+  // normal: RG=octahedral view-space normal
+  // albedo: RGB=albedo (sRGB), A=AO
+  // material: R=metallic, G=roughness, B=emissive strength (emissive = albedo * strength)
+  VkFormat GBUFFER_NORMAL_FORMAT = gBuffer.normalFormat;
+  VkFormat GBUFFER_ALBEDO_FORMAT = GBuffer::ALBEDO_FORMAT;
+  VkFormat GBUFFER_MATERIAL_FORMAT = GBuffer::MATERIAL_FORMAT;
+
+  // Albedo and material only live inside the render pass: tilers back them with lazily allocated memory that is never
+  // committed, desktop GPUs have no such memory type and get a regular device local image
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  VkMemoryPropertyFlags transientMemory = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+    if (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+      transientMemory |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+      break;
     }
-
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
   }
-}
-
-void VulkanDeferredBase::recreateGbuffer() {
-  static constexpr VkFormat GBUFFER_NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
-  static constexpr VkFormat GBUFFER_ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
-  static constexpr VkFormat GBUFFER_MATERIAL_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
-  VkFormat DEPTH_FORMAT = gBuffer.depthBuffer[0].format;
+  const VkImageUsageFlags transientUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
 
   // Create G-Buffer textures
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->InitTexture(gBuffer.normal[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_NORMAL_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.normal[i].imageView = textureManager->createImageView(gBuffer.normal[i].image, GBUFFER_NORMAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.normal[i].sampler = textureManager->createGBufferSampler();
+  textureManager->InitTexture(gBuffer.normal, swapChainExtent.width, swapChainExtent.height, GBUFFER_NORMAL_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+                              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  gBuffer.normal.imageView = textureManager->createImageView(gBuffer.normal.image, GBUFFER_NORMAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
+  gBuffer.normal.sampler = textureManager->createGBufferSampler();
 
-    textureManager->InitTexture(gBuffer.albedo[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.albedo[i].imageView = textureManager->createImageView(gBuffer.albedo[i].image, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.albedo[i].sampler = textureManager->createGBufferSampler();
+  textureManager->InitTexture(gBuffer.albedo, swapChainExtent.width, swapChainExtent.height, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_TILING_OPTIMAL, transientUsage,
+                              transientMemory);
+  gBuffer.albedo.imageView = textureManager->createImageView(gBuffer.albedo.image, GBUFFER_ALBEDO_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
 
-    textureManager->InitTexture(gBuffer.material[i], swapChainExtent.width, swapChainExtent.height, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    gBuffer.material[i].imageView = textureManager->createImageView(gBuffer.material[i].image, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    gBuffer.material[i].sampler = textureManager->createGBufferSampler();
-  }
+  textureManager->InitTexture(gBuffer.material, swapChainExtent.width, swapChainExtent.height, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_TILING_OPTIMAL, transientUsage,
+                              transientMemory);
+  gBuffer.material.imageView = textureManager->createImageView(gBuffer.material.image, GBUFFER_MATERIAL_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT);
 
-  // Update descriptor sets to point to new views
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    std::array<VkDescriptorImageInfo, 4> imageInfos{};
-    imageInfos[0] = {gBuffer.normal[i].sampler, gBuffer.normal[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[1] = {gBuffer.albedo[i].sampler, gBuffer.albedo[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[2] = {gBuffer.material[i].sampler, gBuffer.material[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[3] = {gBuffer.depthBuffer[i].sampler, gBuffer.depthBuffer[i].imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
-
-    std::array<VkWriteDescriptorSet, 4> writes{};
-    for (uint32_t j = 0; j < 4; j++) {
-      writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      writes[j].dstSet = gBuffer.descriptorSets[i];  // which descriptor set to update
-      writes[j].dstBinding = j;                      // Which binding slot (0-3)
-      writes[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      writes[j].descriptorCount = 1;
-      writes[j].pImageInfo = &imageInfos[j];
-    }
-    vkUpdateDescriptorSets(device, 4, writes.data(), 0, nullptr);
-  }
+  // NOTE: No manual layout transitions needed here
+  // The render passes will handle transitions, the derived class reads the attachments through its lighting set
 }
+
 void VulkanDeferredBase::createSsaoElements() {
   generateSSAOKernel();
   createSSAONoiseTexture();
@@ -383,342 +353,242 @@ void VulkanDeferredBase::createSsaoElements() {
                                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
   }
 
-  // createSSAOTextures:
-  ssaoElements.ssaoOutput.resize(frameCount);
-  ssaoElements.ssaoBlurred.resize(frameCount);
-  for (size_t i = 0; i < frameCount; i++) {
-    // Raw SSAO output
-    textureManager->InitTexture(ssaoElements.ssaoOutput[i], swapChainExtent.width, swapChainExtent.height, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    ssaoElements.ssaoOutput[i].imageView = textureManager->createImageView(ssaoElements.ssaoOutput[i].image, VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    ssaoElements.ssaoOutput[i].sampler = textureManager->createGBufferSampler();
-
-    // Blurred SSAO output
-    textureManager->InitTexture(ssaoElements.ssaoBlurred[i], swapChainExtent.width, swapChainExtent.height, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    ssaoElements.ssaoBlurred[i].imageView = textureManager->createImageView(ssaoElements.ssaoBlurred[i].image, VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    ssaoElements.ssaoBlurred[i].sampler = textureManager->createGBufferSampler();
-  }
-  // ssao layout
-  {
-    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
-    // Binding 0: G-Buffer depth (for position reconstruction)
-    bindings[0].binding = 0;
-    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[0].descriptorCount = 1;
-    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    // Binding 1: G-Buffer normals
-    bindings[1].binding = 1;
-    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[1].descriptorCount = 1;
-    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    // Binding 2: Noise texture
-    bindings[2].binding = 2;
-    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[2].descriptorCount = 1;
-    bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    // Binding 3: SSAO kernel UBO
-    bindings[3].binding = 3;
-    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    bindings[3].descriptorCount = 1;
-    bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    // Binding 4: SSAO params UBO (projection matrix, etc.)
-    bindings[4].binding = 4;
-    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    bindings[4].descriptorCount = 1;
-    bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &ssaoElements.ssaoDescriptorSetLayout));
-  }
-  // blur layout
-  {  // SSAO Blur only needs the raw SSAO output to blur it
-    std::array<VkDescriptorSetLayoutBinding, 1> bindings{};
-
-    // Binding 0: Raw SSAO texture (from SSAO pass)
-    bindings[0].binding = 0;
-    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[0].descriptorCount = 1;
-    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[0].pImmutableSamplers = nullptr;
-
+  auto createComputeLayout = [&](std::initializer_list<VkDescriptorType> types, VkDescriptorSetLayout& layout) {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (VkDescriptorType type : types) {
+      VkDescriptorSetLayoutBinding binding{};
+      binding.binding = static_cast<uint32_t>(bindings.size());
+      binding.descriptorType = type;
+      binding.descriptorCount = 1;
+      binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+      bindings.push_back(binding);
+    }
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
     layoutInfo.pBindings = bindings.data();
-
-    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &ssaoElements.ssaoBlurDescriptorSetLayout));
-  }
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout));
+  };
+  // ssao layout: depth pyramid, half resolution normals, noise, kernel UBO, params UBO, raw SSAO output
+  createComputeLayout({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE},
+                      ssaoElements.ssaoDescriptorSetLayout);
+  // downsample layout: G-Buffer depth, G-Buffer normals, source level, destination level, half resolution normals, params UBO
+  createComputeLayout({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER},
+                      ssaoElements.downsampleDescriptorSetLayout);
+  // upsample layout: G-Buffer depth, depth pyramid, blurred SSAO, full resolution output, params UBO
+  createComputeLayout({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER},
+                      ssaoElements.upsampleDescriptorSetLayout);
+  // blur layout: SSAO input, depth pyramid, half resolution normals, blurred output
+  createComputeLayout({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE},
+                      ssaoElements.ssaoBlurDescriptorSetLayout);
   // allocate descriptor sets
-  {
-    std::vector<VkDescriptorSetLayout> layouts(frameCount, ssaoElements.ssaoDescriptorSetLayout);
+  auto allocateSets = [&](VkDescriptorSetLayout layout, uint32_t count, std::vector<VkDescriptorSet>& sets) {
+    std::vector<VkDescriptorSetLayout> layouts(count, layout);
 
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.descriptorSetCount = count;
     allocInfo.pSetLayouts = layouts.data();
 
-    ssaoElements.ssaoDescriptorSets.resize(frameCount);
-    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, ssaoElements.ssaoDescriptorSets.data()));
-  }
-  {
-    std::vector<VkDescriptorSetLayout> layouts(frameCount, ssaoElements.ssaoBlurDescriptorSetLayout);
+    sets.resize(count);
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, sets.data()));
+  };
+  allocateSets(ssaoElements.ssaoDescriptorSetLayout, frameCount, ssaoElements.ssaoDescriptorSets);
+  allocateSets(ssaoElements.downsampleDescriptorSetLayout, frameCount * SsaoElements::DEPTH_MIPS, ssaoElements.downsampleDescriptorSets);
+  allocateSets(ssaoElements.upsampleDescriptorSetLayout, frameCount, ssaoElements.upsampleDescriptorSets);
+  allocateSets(ssaoElements.ssaoBlurDescriptorSetLayout, frameCount * 2, ssaoElements.ssaoBlurDescriptorSets);
+  // Written by buildRenderGraph once the textures exist
 
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = frameCount;
-    allocInfo.pSetLayouts = layouts.data();
+  createSsaoPipelines();
 
-    ssaoElements.ssaoBlurDescriptorSets.resize(frameCount);
-    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, ssaoElements.ssaoBlurDescriptorSets.data()));
+  // Two timestamps per frame in flight around the whole SSAO chain
+  if (!context->properties.limits.timestampComputeAndGraphics) {
+    spdlog::warn("Timestamp queries not supported, SSAO timings disabled");
+    return;
   }
-  for (size_t i = 0; i < frameCount; i++) {
-    {
-      std::array<VkDescriptorImageInfo, 3> imageInfos{};
-
-      // Binding 0: Depth buffer (for position reconstruction)
-      imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-      imageInfos[0].imageView = gBuffer.depthBuffer[i].imageView;
-      imageInfos[0].sampler = gBuffer.depthBuffer[i].sampler;
-
-      // Binding 1: Normal buffer
-      imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[1].imageView = gBuffer.normal[i].imageView;
-      imageInfos[1].sampler = gBuffer.normal[i].sampler;
-
-      // Binding 2: Noise texture (same for all frames)
-      imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[2].imageView = ssaoElements.noiseTexture.imageView;
-      imageInfos[2].sampler = ssaoElements.noiseTexture.sampler;
-
-      std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
-
-      // Binding 3: SSAO Kernel UBO
-      bufferInfos[0].buffer = ssaoElements.ssaoKernelUBO[i].buffer;
-      bufferInfos[0].offset = 0;
-      bufferInfos[0].range = VK_WHOLE_SIZE;
-
-      // Binding 4: SSAO Params UBO
-      bufferInfos[1].buffer = ssaoElements.ssaoParamsUBO[i].buffer;
-      bufferInfos[1].offset = 0;
-      bufferInfos[1].range = VK_WHOLE_SIZE;
-
-      std::array<VkWriteDescriptorSet, 5> writes{};
-
-      // Image descriptors
-      for (uint32_t j = 0; j < 3; j++) {
-        writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[j].dstSet = ssaoElements.ssaoDescriptorSets[i];
-        writes[j].dstBinding = j;
-        writes[j].dstArrayElement = 0;
-        writes[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writes[j].descriptorCount = 1;
-        writes[j].pImageInfo = &imageInfos[j];
-      }
+  VkQueryPoolCreateInfo queryPoolCI{};
+  queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCI.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+  VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &ssaoElements.queryPool));
+  // Queries have to be reset once before the first read, otherwise results are undefined
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) { vkCmdResetQueryPool(cmd, ssaoElements.queryPool, 0, queryPoolCI.queryCount); });
+}
 
-      // Buffer descriptors
-      for (uint32_t j = 0; j < 2; j++) {
-        writes[3 + j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[3 + j].dstSet = ssaoElements.ssaoDescriptorSets[i];
-        writes[3 + j].dstBinding = 3 + j;
-        writes[3 + j].dstArrayElement = 0;
-        writes[3 + j].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writes[3 + j].descriptorCount = 1;
-        writes[3 + j].pBufferInfo = &bufferInfos[j];
-      }
+void VulkanDeferredBase::writeSsaoDescriptors(u32 frame) {
+  // Layouts follow the usages declared in buildRenderGraph: storage images in general layout, sampled ones read-only
+  RenderGraph& graph = *renderGraph;
+  auto sampled = [&](RenderGraph::TextureHandle handle) {
+    TextureManager::Texture& texture = graph.texture(handle);
+    return VkDescriptorImageInfo{texture.sampler, texture.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  };
+  auto storage = [&](RenderGraph::TextureHandle handle) {
+    return VkDescriptorImageInfo{VK_NULL_HANDLE, graph.texture(handle).imageView, VK_IMAGE_LAYOUT_GENERAL};
+  };
+  const VkDescriptorImageInfo gDepth = {gBuffer.depthBuffer.sampler, gBuffer.depthBuffer.imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+  const VkDescriptorImageInfo gNormal = {gBuffer.normal.sampler, gBuffer.normal.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  const VkDescriptorImageInfo pyramid = sampled(ssaoElements.depthPyramid);
+  const VkDescriptorImageInfo halfNormal = sampled(ssaoElements.halfNormal);
+  const VkDescriptorImageInfo halfNormalOut = storage(ssaoElements.halfNormal);
+  const VkDescriptorImageInfo noise = {ssaoElements.noiseTexture.sampler, ssaoElements.noiseTexture.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  const VkDescriptorImageInfo rawOut = storage(ssaoElements.ssaoOutput);
+  const VkDescriptorImageInfo raw = sampled(ssaoElements.ssaoOutput);
+  const VkDescriptorImageInfo blurTempOut = storage(ssaoElements.ssaoBlurTemp);
+  const VkDescriptorImageInfo blurTemp = sampled(ssaoElements.ssaoBlurTemp);
+  const VkDescriptorImageInfo blurredOut = storage(ssaoElements.ssaoBlurred);
+  const VkDescriptorImageInfo blurred = sampled(ssaoElements.ssaoBlurred);
+  const VkDescriptorImageInfo fullOut = storage(ssaoElements.ssaoFull);
+  std::array<VkDescriptorImageInfo, SsaoElements::DEPTH_MIPS> levels{};
+  for (uint32_t level = 0; level < SsaoElements::DEPTH_MIPS; level++) {
+    levels[level] = {VK_NULL_HANDLE, graph.levelView(ssaoElements.depthPyramid, level), VK_IMAGE_LAYOUT_GENERAL};
+  }
+  const VkDescriptorBufferInfo kernel = {ssaoElements.ssaoKernelUBO[frame].buffer, 0, VK_WHOLE_SIZE};
+  const VkDescriptorBufferInfo params = {ssaoElements.ssaoParamsUBO[frame].buffer, 0, VK_WHOLE_SIZE};
+
+  std::vector<VkWriteDescriptorSet> writes;
+  auto writeImage = [&](VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo* info) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorType = type;
+    write.descriptorCount = 1;
+    write.pImageInfo = info;
+    writes.push_back(write);
+  };
+  auto writeBuffer = [&](VkDescriptorSet set, uint32_t binding, const VkDescriptorBufferInfo* info) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = info;
+    writes.push_back(write);
+  };
 
-      vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
-    }
+  // Downsample, one set per pyramid level (level 0 reads the G-Buffer, its source binding is unused)
+  for (uint32_t level = 0; level < SsaoElements::DEPTH_MIPS; level++) {
+    VkDescriptorSet set = ssaoElements.downsampleDescriptorSets[frame * SsaoElements::DEPTH_MIPS + level];
+    writeImage(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &gDepth);
+    writeImage(set, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &gNormal);
+    writeImage(set, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &levels[level > 0 ? level - 1 : 0]);
+    writeImage(set, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &levels[level]);
+    writeImage(set, 4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &halfNormalOut);
+    writeBuffer(set, 5, &params);
+  }
+
+  VkDescriptorSet ssaoSet = ssaoElements.ssaoDescriptorSets[frame];
+  writeImage(ssaoSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramid);
+  writeImage(ssaoSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &halfNormal);
+  writeImage(ssaoSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &noise);
+  writeBuffer(ssaoSet, 3, &kernel);
+  writeBuffer(ssaoSet, 4, &params);
+  writeImage(ssaoSet, 5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &rawOut);
+
+  // Blur, horizontal reads the raw AO, vertical the horizontal result
+  const VkDescriptorImageInfo* blurInputs[2] = {&raw, &blurTemp};
+  const VkDescriptorImageInfo* blurOutputs[2] = {&blurTempOut, &blurredOut};
+  for (uint32_t pass = 0; pass < 2; pass++) {
+    VkDescriptorSet set = ssaoElements.ssaoBlurDescriptorSets[frame * 2 + pass];
+    writeImage(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, blurInputs[pass]);
+    writeImage(set, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramid);
+    writeImage(set, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &halfNormal);
+    writeImage(set, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, blurOutputs[pass]);
+  }
+
+  VkDescriptorSet upsampleSet = ssaoElements.upsampleDescriptorSets[frame];
+  writeImage(upsampleSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &gDepth);
+  writeImage(upsampleSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &pyramid);
+  writeImage(upsampleSet, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &blurred);
+  writeImage(upsampleSet, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &fullOut);
+  writeBuffer(upsampleSet, 4, &params);
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
 
-    {
-      VkDescriptorImageInfo imageInfo{};
-      imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfo.imageView = ssaoElements.ssaoOutput[i].imageView;
-      imageInfo.sampler = ssaoElements.ssaoOutput[i].sampler;
-
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = ssaoElements.ssaoBlurDescriptorSets[i];
-      write.dstBinding = 0;
-      write.dstArrayElement = 0;
-      write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      write.descriptorCount = 1;
-      write.pImageInfo = &imageInfo;
-
-      vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
-    }
-  }
+void VulkanDeferredBase::createSsaoPipelines() {
+  auto createPipeline = [&](VkDescriptorSetLayout setLayout, uint32_t pushConstantSize, const std::string& shader, VkPipelineLayout& layout,
+                            VkPipeline& pipeline) {
+    VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = layout;
+    pipelineInfo.stage = loadShader(std::string(SHADER_DIR) + "/deferredShaders/" + shader, VK_SHADER_STAGE_COMPUTE_BIT);
+    VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    vkDestroyShaderModule(device, pipelineInfo.stage.module, nullptr);
+  };
+  createPipeline(ssaoElements.downsampleDescriptorSetLayout, sizeof(int32_t), "ssao_downsample.comp.spv", ssaoElements.downsamplePipelineLayout,
+                 ssaoElements.downsamplePipeline);
+  // Occlusion writers are compiled per storage format (SSAO_RGBA8 variants)
+  const std::string aoSuffix = ssaoElements.aoFormat == VK_FORMAT_R8_UNORM ? ".comp.spv" : "_rgba8.comp.spv";
+  createPipeline(ssaoElements.ssaoDescriptorSetLayout, 0, "ssao" + aoSuffix, ssaoElements.ssaoPipelineLayout, ssaoElements.ssaoPipeline);
+  createPipeline(ssaoElements.ssaoBlurDescriptorSetLayout, sizeof(glm::ivec2), "ssao_blur" + aoSuffix, ssaoElements.ssaoBlurPipelineLayout,
+                 ssaoElements.ssaoBlurPipeline);
+  createPipeline(ssaoElements.upsampleDescriptorSetLayout, 0, "ssao_upsample" + aoSuffix, ssaoElements.upsamplePipelineLayout,
+                 ssaoElements.upsamplePipeline);
 }
 
-void VulkanDeferredBase::recreateSSaoElements() {
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    // Raw SSAO output
-    textureManager->InitTexture(ssaoElements.ssaoOutput[i], swapChainExtent.width, swapChainExtent.height, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    ssaoElements.ssaoOutput[i].imageView = textureManager->createImageView(ssaoElements.ssaoOutput[i].image, VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    ssaoElements.ssaoOutput[i].sampler = textureManager->createGBufferSampler();
-
-    // Blurred SSAO output
-    textureManager->InitTexture(ssaoElements.ssaoBlurred[i], swapChainExtent.width, swapChainExtent.height, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    ssaoElements.ssaoBlurred[i].imageView = textureManager->createImageView(ssaoElements.ssaoBlurred[i].image, VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    ssaoElements.ssaoBlurred[i].sampler = textureManager->createGBufferSampler();
-  }
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    {
-      std::array<VkDescriptorImageInfo, 3> imageInfos{};
-
-      // Binding 0: Depth buffer (for position reconstruction)
-      imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-      imageInfos[0].imageView = gBuffer.depthBuffer[i].imageView;
-      imageInfos[0].sampler = gBuffer.depthBuffer[i].sampler;
-
-      // Binding 1: Normal buffer
-      imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[1].imageView = gBuffer.normal[i].imageView;
-      imageInfos[1].sampler = gBuffer.normal[i].sampler;
-
-      // Binding 2: Noise texture (same for all frames)
-      imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfos[2].imageView = ssaoElements.noiseTexture.imageView;
-      imageInfos[2].sampler = ssaoElements.noiseTexture.sampler;
-
-      std::array<VkWriteDescriptorSet, 3> writes{};
-
-      // Image descriptors
-      for (uint32_t j = 0; j < 3; j++) {
-        writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writes[j].dstSet = ssaoElements.ssaoDescriptorSets[i];
-        writes[j].dstBinding = j;
-        writes[j].dstArrayElement = 0;
-        writes[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writes[j].descriptorCount = 1;
-        writes[j].pImageInfo = &imageInfos[j];
-      }
-      vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
-    }
-    {
-      VkDescriptorImageInfo imageInfo{};
-      imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-      imageInfo.imageView = ssaoElements.ssaoOutput[i].imageView;  // New view!
-      imageInfo.sampler = ssaoElements.ssaoOutput[i].sampler;
-
-      VkWriteDescriptorSet write{};
-      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = ssaoElements.ssaoBlurDescriptorSets[i];
-      write.dstBinding = 0;
-      write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      write.descriptorCount = 1;
-      write.pImageInfo = &imageInfo;
-
-      vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
-    }
-  }
+void VulkanDeferredBase::destroySsaoPipelines() {
+  vkDestroyPipeline(device, ssaoElements.downsamplePipeline, nullptr);
+  vkDestroyPipeline(device, ssaoElements.ssaoPipeline, nullptr);
+  vkDestroyPipeline(device, ssaoElements.ssaoBlurPipeline, nullptr);
+  vkDestroyPipeline(device, ssaoElements.upsamplePipeline, nullptr);
+  vkDestroyPipelineLayout(device, ssaoElements.downsamplePipelineLayout, nullptr);
+  vkDestroyPipelineLayout(device, ssaoElements.ssaoPipelineLayout, nullptr);
+  vkDestroyPipelineLayout(device, ssaoElements.ssaoBlurPipelineLayout, nullptr);
+  vkDestroyPipelineLayout(device, ssaoElements.upsamplePipelineLayout, nullptr);
 }
 // Render Passes: how attachments are used: just description
 void VulkanDeferredBase::createRenderPasses() {
-  // ==== GEOMETRY RENDER PASS ====
+  // Graph resources stay in the layout of their declared usage, the render graph transitions them and orders the passes
+  // ==== DEPTH/NORMAL PREPASS ====
   {
-    // Attachment 0: Normal (world-space normals)
+    // Attachment 0: Normal (octahedral view-space normals)
     VkAttachmentDescription normalAttachment{};
-    normalAttachment.format = gBuffer.normal[0].format;  // GBUFFER_NORMAL_FORMAT
+    normalAttachment.format = gBuffer.normal.format;  // GBUFFER_NORMAL_FORMAT
     normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     normalAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // Need to read in lighting pass
+    normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // Need to read in SSAO and lighting
     normalAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     normalAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    normalAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    normalAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Attachment 1: Albedo (base color)
-    VkAttachmentDescription albedoAttachment{};
-    albedoAttachment.format = gBuffer.albedo[0].format;
-    albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    albedoAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    albedoAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    normalAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    normalAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-    // Attachment 2: Material (roughness, metallic, ao, etc.)
-    VkAttachmentDescription materialAttachment{};
-    materialAttachment.format = gBuffer.material[0].format;
-    materialAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    materialAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    materialAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    materialAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    materialAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    materialAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    materialAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    // Attachment 3: Depth
+    // Attachment 1: Depth
     VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = gBuffer.depthBuffer[0].format;
+    depthAttachment.format = gBuffer.depthBuffer.format;
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // May need depth in lighting pass
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;  // SSAO and the EQUAL test of the geometry subpass
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-
-    std::array<VkAttachmentDescription, 4> attachments = {normalAttachment, albedoAttachment, materialAttachment, depthAttachment};
-
-    // ==== ATTACHMENT REFERENCES ====
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-    std::array<VkAttachmentReference, 3> colorAttachmentRefs{};
-    colorAttachmentRefs[0] = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};  // Normal
-    colorAttachmentRefs[1] = {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};  // Albedo
-    colorAttachmentRefs[2] = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};  // Material
+    std::array<VkAttachmentDescription, 2> attachments = {normalAttachment, depthAttachment};
 
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 3;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    // ==== SUBPASS ====
+    VkAttachmentReference normalRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depthRef = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
 
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
-    subpass.pColorAttachments = colorAttachmentRefs.data();
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    // ==== SUBPASS DEPENDENCIES ====
-
-    std::array<VkSubpassDependency, 2> dependencies{};
-
-    // Dependency 0: Before geometry pass
-    // Wait for any previous reads (from lighting pass) to finish
-    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[0].dstSubpass = 0;
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    // Dependency 1: After geometry pass
-    // Transition attachments for shader reads in lighting pass
-    dependencies[1].srcSubpass = 0;
-    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    // ==== CREATE RENDER PASS ====
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &normalRef;
+    subpass.pDepthStencilAttachment = &depthRef;
 
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -726,66 +596,38 @@ void VulkanDeferredBase::createRenderPasses() {
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-    renderPassInfo.pDependencies = dependencies.data();
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &gBuffer.renderPass) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create geometry render pass!");
-    }
+    VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &gBuffer.prepassRenderPass));
   }
-  // ==== SSAO RENDER PASS ====
+  // ==== GEOMETRY + LIGHTING RENDER PASS ====
   {
-    // Single color attachment
-    VkAttachmentDescription attachment{};  // enough for occlusion
-    attachment.format = VK_FORMAT_R8_UNORM;
-    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    VkAttachmentReference colorRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorRef;
-
-    // Dependencies to ensure G-Buffer is ready
-    std::array<VkSubpassDependency, 2> dependencies{};
+    // Attachment 0: Albedo (base color), cleared on chip and never written back
+    VkAttachmentDescription albedoAttachment{};
+    albedoAttachment.format = gBuffer.albedo.format;
+    albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    albedoAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    albedoAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[0].dstSubpass = 0;
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    dependencies[1].srcSubpass = 0;
-    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    // Attachment 1: Material (metallic, roughness, emissive strength)
+    VkAttachmentDescription materialAttachment = albedoAttachment;
+    materialAttachment.format = gBuffer.material.format;
 
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &attachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-    renderPassInfo.pDependencies = dependencies.data();
+    // Attachment 2: Depth from the prepass, read-only
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = gBuffer.depthBuffer.format;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;  // cleared again by the next prepass
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
-    VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &ssaoElements.ssaoRenderPass));
-    // blur renderpass
-    VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &ssaoElements.ssaoBlurRenderPass));
-  }
-  // ==== LIGHTING RENDER PASS ====
-  {
+    // Attachment 3: Swapchain image
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = swapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -796,108 +638,121 @@ void VulkanDeferredBase::createRenderPasses() {
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-    VkAttachmentReference colorRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorRef;
-
-    std::array<VkSubpassDependency, 2> dependencies{};
-    // Wait for SSAO blur to complete
-    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;  // prev renderpass
-    dependencies[0].dstSubpass = 0;                    // this subpass
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    // For presentation
-    dependencies[1].srcSubpass = 0;
-    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    std::array<VkAttachmentDescription, 4> attachments = {albedoAttachment, materialAttachment, depthAttachment, colorAttachment};
+
+    // ==== ATTACHMENT REFERENCES ====
+
+    std::array<VkAttachmentReference, 2> gBufferWriteRefs{};
+    gBufferWriteRefs[0] = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};  // Albedo
+    gBufferWriteRefs[1] = {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};  // Material
+    VkAttachmentReference depthTestRef = {2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+    // Order must match input_attachment_index in deferred_lighting.frag
+    std::array<VkAttachmentReference, 3> gBufferReadRefs{};
+    gBufferReadRefs[0] = {0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};          // Albedo
+    gBufferReadRefs[1] = {1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};          // Material
+    gBufferReadRefs[2] = {2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};  // Depth
+    VkAttachmentReference colorRef = {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    // ==== SUBPASSES ====
+
+    std::array<VkSubpassDescription, 2> subpasses{};
+    // Geometry: albedo + material where the prepass depth matches
+    subpasses[GBuffer::GEOMETRY_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[GBuffer::GEOMETRY_SUBPASS].colorAttachmentCount = static_cast<uint32_t>(gBufferWriteRefs.size());
+    subpasses[GBuffer::GEOMETRY_SUBPASS].pColorAttachments = gBufferWriteRefs.data();
+    subpasses[GBuffer::GEOMETRY_SUBPASS].pDepthStencilAttachment = &depthTestRef;
+    // Lighting: fullscreen, reads the G-Buffer at its own pixel
+    subpasses[GBuffer::LIGHTING_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[GBuffer::LIGHTING_SUBPASS].inputAttachmentCount = static_cast<uint32_t>(gBufferReadRefs.size());
+    subpasses[GBuffer::LIGHTING_SUBPASS].pInputAttachments = gBufferReadRefs.data();
+    subpasses[GBuffer::LIGHTING_SUBPASS].colorAttachmentCount = 1;
+    subpasses[GBuffer::LIGHTING_SUBPASS].pColorAttachments = &colorRef;
+
+    // ==== SUBPASS DEPENDENCIES ====
+
+    std::array<VkSubpassDependency, 4> dependencies{};
+
+    // Dependency 0: Before the geometry subpass
+    // The previous frame's lighting subpass must be done reading albedo and material (not render graph resources)
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = GBuffer::GEOMETRY_SUBPASS;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // Dependency 1: Before the lighting subpass
+    // Wait for the swapchain image, the SSAO and the light lists are ordered by the render graph
+    dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstSubpass = GBuffer::LIGHTING_SUBPASS;
     dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[1].dstAccessMask = 0;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = 0;
+    dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // Dependency 2: Geometry -> lighting, per pixel so tilers keep the G-Buffer on chip
+    dependencies[2].srcSubpass = GBuffer::GEOMETRY_SUBPASS;
+    dependencies[2].dstSubpass = GBuffer::LIGHTING_SUBPASS;
+    dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // Dependency 3: For presentation
+    dependencies[3].srcSubpass = GBuffer::LIGHTING_SUBPASS;
+    dependencies[3].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[3].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[3].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    dependencies[3].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[3].dstAccessMask = 0;
+
+    // ==== CREATE RENDER PASS ====
 
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
     renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
     renderPassInfo.pDependencies = dependencies.data();
 
-    VK_CHECK_RESULT(vkCreateRenderPass(device, &renderPassInfo, nullptr, &lightingPass.renderPass));
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &gBuffer.renderPass) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create geometry/lighting render pass!");
+    }
   }
 }
 
 // Framebuffers: which actual images the render pass will write to.
 void VulkanDeferredBase::createFramebuffers() {
-  const uint32_t frameCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-  gBuffer.framebuffers.resize(frameCount);
-  ssaoElements.ssaoFramebuffers.resize(frameCount);
-  ssaoElements.ssaoBlurFramebuffers.resize(frameCount);
   swapChainFramebuffers.resize(swapChainImages.size());
 
-  // ==== GEOMETRY FRAMEBUFFERS ====
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    // Order must match attachment order in geometry render pass
-    std::array<VkImageView, 4> attachments = {gBuffer.normal[i].imageView, gBuffer.albedo[i].imageView, gBuffer.material[i].imageView, gBuffer.depthBuffer[i].imageView};
+  // ==== PREPASS FRAMEBUFFER ====
+  {
+    // Order must match attachment order in the prepass
+    std::array<VkImageView, 2> attachments = {gBuffer.normal.imageView, gBuffer.depthBuffer.imageView};
 
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = gBuffer.renderPass;
+    framebufferInfo.renderPass = gBuffer.prepassRenderPass;
     framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     framebufferInfo.pAttachments = attachments.data();
     framebufferInfo.width = swapChainExtent.width;
     framebufferInfo.height = swapChainExtent.height;
     framebufferInfo.layers = 1;
 
-    VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &gBuffer.framebuffers[i]));
-  }
-  // ==== SSAO FRAMEBUFFERS ====
-
-  for (size_t i = 0; i < frameCount; i++) {
-    // SSAO framebuffer
-    {
-      VkImageView attachment = ssaoElements.ssaoOutput[i].imageView;
-
-      VkFramebufferCreateInfo fbInfo{};
-      fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-      fbInfo.renderPass = ssaoElements.ssaoRenderPass;
-      fbInfo.attachmentCount = 1;
-      fbInfo.pAttachments = &attachment;
-      fbInfo.width = swapChainExtent.width;
-      fbInfo.height = swapChainExtent.height;
-      fbInfo.layers = 1;
-
-      VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbInfo, nullptr, &ssaoElements.ssaoFramebuffers[i]));
-    }
-
-    // SSAO Blur framebuffer
-    {
-      VkImageView attachment = ssaoElements.ssaoBlurred[i].imageView;
-
-      VkFramebufferCreateInfo fbInfo{};
-      fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-      fbInfo.renderPass = ssaoElements.ssaoBlurRenderPass;
-      fbInfo.attachmentCount = 1;
-      fbInfo.pAttachments = &attachment;
-      fbInfo.width = swapChainExtent.width;
-      fbInfo.height = swapChainExtent.height;
-      fbInfo.layers = 1;
-
-      VK_CHECK_RESULT(vkCreateFramebuffer(device, &fbInfo, nullptr, &ssaoElements.ssaoBlurFramebuffers[i]));
-    }
+    VK_CHECK_RESULT(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &gBuffer.prepassFramebuffer));
   }
-
-  // ==== SWAPCHAIN FRAMEBUFFERS (for lighting pass) ====
+  // ==== SWAPCHAIN FRAMEBUFFERS (geometry + lighting) ====
   for (size_t i = 0; i < swapChainImages.size(); i++) {
-    std::array<VkImageView, 1> attachments = {swapChainImageViews[i]};
+    // Order must match attachment order in the geometry/lighting render pass
+    std::array<VkImageView, 4> attachments = {gBuffer.albedo.imageView, gBuffer.material.imageView, gBuffer.depthBuffer.imageView, swapChainImageViews[i]};
 
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = lightingPass.renderPass;
+    framebufferInfo.renderPass = gBuffer.renderPass;
     framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     framebufferInfo.pAttachments = attachments.data();
     framebufferInfo.width = swapChainExtent.width;
@@ -984,6 +839,9 @@ void VulkanDeferredBase::initVulkan() {
   createSsaoElements();
   createRenderPasses();
   createFullscreenQuad();
+  createShadowCascades();
+  createLightCulling();
+  buildRenderGraph();
 
   // 6. Load resources
   spdlog::info("Loading resources...");
@@ -992,7 +850,6 @@ void VulkanDeferredBase::initVulkan() {
   // 7. Create pipelines
   spdlog::info("Creating pipelines...");
   createGeometryPipeline();
-  createssaoPipeline();
   createLightingPipeline();
 
   // 8. Final setup
@@ -1017,25 +874,18 @@ void VulkanDeferredBase::recreateSwapChain() {
   onResize(width, height);
   // destroy framebuffers and swapchain image&view
   cleanupSwapChain();
-  // destroy textures
-  // ssao
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->destroyTexture(ssaoElements.ssaoOutput[i]);
-    textureManager->destroyTexture(ssaoElements.ssaoBlurred[i]);
-  }
+  // destroy textures, the render graph transients go with the rebuild
   // gbuffer
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->destroyTexture(gBuffer.normal[i]);
-    textureManager->destroyTexture(gBuffer.albedo[i]);
-    textureManager->destroyTexture(gBuffer.material[i]);
-    textureManager->destroyTexture(gBuffer.depthBuffer[i]);
-  }
+  textureManager->destroyTexture(gBuffer.normal);
+  textureManager->destroyTexture(gBuffer.albedo);
+  textureManager->destroyTexture(gBuffer.material);
+  textureManager->destroyTexture(gBuffer.depthBuffer);
 
   createSwapChain();
   createImageViews();  // for swapchain
   createDepthResources();
-  recreateGbuffer();  // recreates textures and updates descriptor sets
-  recreateSSaoElements();
+  createGBuffer();
+  buildRenderGraph();
   createFramebuffers();
 
   // FIX: Notify derived class to update lighting descriptors and ImGui texture handles.
@@ -1045,11 +895,7 @@ void VulkanDeferredBase::recreateSwapChain() {
 }
 
 void VulkanDeferredBase::cleanupSwapChain() {
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroyFramebuffer(device, ssaoElements.ssaoFramebuffers[i], nullptr);
-    vkDestroyFramebuffer(device, ssaoElements.ssaoBlurFramebuffers[i], nullptr);
-    vkDestroyFramebuffer(device, gBuffer.framebuffers[i], nullptr);
-  }
+  vkDestroyFramebuffer(device, gBuffer.prepassFramebuffer, nullptr);
 
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device, framebuffer, nullptr);
@@ -1070,11 +916,17 @@ void VulkanDeferredBase::cleanup() {
   // Clean up derived class resources FIRST
   cleanupResources();
 
+  destroyLightCulling();
+
   // Destroy SSAO resources
   textureManager->destroyTexture(ssaoElements.noiseTexture);
+  renderGraph.reset();
+  destroyShadowCascades();
+  destroySsaoPipelines();
+  if (ssaoElements.queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, ssaoElements.queryPool, nullptr);
+  }
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->destroyTexture(ssaoElements.ssaoOutput[i]);
-    textureManager->destroyTexture(ssaoElements.ssaoBlurred[i]);
     bufferManager->destroyBuffer(ssaoElements.ssaoKernelUBO[i]);
     bufferManager->destroyBuffer(ssaoElements.ssaoParamsUBO[i]);
   }
@@ -1082,7 +934,8 @@ void VulkanDeferredBase::cleanup() {
   // Destroy descriptor set layouts (descriptor sets freed with pool)
   vkDestroyDescriptorSetLayout(device, ssaoElements.ssaoDescriptorSetLayout, nullptr);
   vkDestroyDescriptorSetLayout(device, ssaoElements.ssaoBlurDescriptorSetLayout, nullptr);
-  vkDestroyDescriptorSetLayout(device, gBuffer.descriptorSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, ssaoElements.downsampleDescriptorSetLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, ssaoElements.upsampleDescriptorSetLayout, nullptr);
   vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
   // Clean up fullscreen quad
@@ -1090,19 +943,14 @@ void VulkanDeferredBase::cleanup() {
   bufferManager->destroyBuffer(fullscreenQuad.indexBuffer);
 
   // Clean up render passes
-  vkDestroyRenderPass(device, ssaoElements.ssaoRenderPass, nullptr);
-  vkDestroyRenderPass(device, ssaoElements.ssaoBlurRenderPass, nullptr);
+  vkDestroyRenderPass(device, gBuffer.prepassRenderPass, nullptr);
   vkDestroyRenderPass(device, gBuffer.renderPass, nullptr);
-  // FIX: Was commented out — lightingPass.renderPass was leaked
-  vkDestroyRenderPass(device, lightingPass.renderPass, nullptr);
 
   // Destroy G-buffer textures
-  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->destroyTexture(gBuffer.normal[i]);
-    textureManager->destroyTexture(gBuffer.albedo[i]);
-    textureManager->destroyTexture(gBuffer.material[i]);
-    textureManager->destroyTexture(gBuffer.depthBuffer[i]);
-  }
+  textureManager->destroyTexture(gBuffer.normal);
+  textureManager->destroyTexture(gBuffer.albedo);
+  textureManager->destroyTexture(gBuffer.material);
+  textureManager->destroyTexture(gBuffer.depthBuffer);
 
   // Clean up swap chain (framebuffers, image views, swapchain)
   cleanupSwapChain();
@@ -1215,6 +1063,26 @@ void VulkanDeferredBase::createLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures{};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // Block compressed textures: KTX2 transcode targets and the BC import of png/jpg model textures
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+  // r8 storage images of the compute SSAO (raw, blurred and upsampled occlusion), rgba8 without the feature
+  VkFormatProperties r8Properties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8_UNORM, &r8Properties);
+  deviceFeatures.shaderStorageImageExtendedFormats = supportedFeatures.shaderStorageImageExtendedFormats;
+  if (!supportedFeatures.shaderStorageImageExtendedFormats || !(r8Properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+    spdlog::info("R8 storage images not supported, SSAO falls back to RGBA8");
+    ssaoElements.aoFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  }
+  // Octahedral normals are rendered by the prepass and sampled by SSAO and the lighting pass
+  VkFormatProperties normalProperties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, gBuffer.normalFormat, &normalProperties);
+  const VkFormatFeatureFlags normalFeatures = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  if ((normalProperties.optimalTilingFeatures & normalFeatures) != normalFeatures) {
+    spdlog::info("R16G16_UNORM color attachments not supported, G-buffer normals fall back to R16G16_SFLOAT");
+    gBuffer.normalFormat = VK_FORMAT_R16G16_SFLOAT;
+  }
 
   VkDeviceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1368,13 +1236,12 @@ void VulkanDeferredBase::createDepthResources() {
   if (depthFormat == VK_FORMAT_UNDEFINED) {
     depthFormat = findDepthFormat();
   }
-  gBuffer.depthBuffer.resize(MAX_FRAMES_IN_FLIGHT);
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    textureManager->InitTexture(gBuffer.depthBuffer[i], swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL,
-                                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SAMPLE_COUNT_1_BIT);
-    gBuffer.depthBuffer[i].imageView = textureManager->createImageView(gBuffer.depthBuffer[i].image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-    gBuffer.depthBuffer[i].sampler = textureManager->createGBufferSampler();
-  }
+  // Sampled by the SSAO passes, read as an input attachment by the lighting subpass
+  textureManager->InitTexture(gBuffer.depthBuffer, swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL,
+                              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1, VK_SAMPLE_COUNT_1_BIT);
+  gBuffer.depthBuffer.imageView = textureManager->createImageView(gBuffer.depthBuffer.image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+  gBuffer.depthBuffer.sampler = textureManager->createGBufferSampler();
 }
 
 VulkanDeferredBase::SwapChainSupportDetails VulkanDeferredBase::querySwapChainSupport(VkPhysicalDevice device) {
@@ -1712,6 +1579,333 @@ void VulkanDeferredBase::mouseButtonCallback(GLFWwindow* window, int button, int
   app->onMouseButton(button, action, mods);
 }
 
+// Clustered Lights
+void VulkanDeferredBase::createLightCulling() {
+  lightingPass.uboBuffer.resize(MAX_FRAMES_IN_FLIGHT);
+  lightingPass.lightBuffer.resize(MAX_FRAMES_IN_FLIGHT);
+  lightingPass.clusterBuffer.resize(MAX_FRAMES_IN_FLIGHT);
+  lightingPass.statsBuffer.resize(MAX_FRAMES_IN_FLIGHT);
+  const VkDeviceSize clusterSize = sizeof(u32) * LightingPass::CLUSTER_COUNT * (LightingPass::MAX_LIGHTS_PER_CLUSTER + 1);
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    lightingPass.uboBuffer[i] = bufferManager->createBuffer(sizeof(LightingPass::LightUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    // Grows in recordLightCulling once the scene has more lights
+    lightingPass.lightBuffer[i] = bufferManager->createBuffer(sizeof(LightingPass::PointLight) * 256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    lightingPass.clusterBuffer[i] = bufferManager->createBuffer(clusterSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    lightingPass.statsBuffer[i] =
+        bufferManager->createBuffer(sizeof(LightingPass::ClusterStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    std::memset(lightingPass.statsBuffer[i].mapped, 0, sizeof(LightingPass::ClusterStats));
+  }
+
+  // 0: LightUBO, 1: point lights, 2: clusters, 3: stats
+  std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+  for (u32 i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<u32>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &lightingPass.cullDescriptorLayout));
+
+  std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, lightingPass.cullDescriptorLayout);
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = static_cast<u32>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.pSetLayouts = layouts.data();
+  lightingPass.cullDescriptorSet.resize(MAX_FRAMES_IN_FLIGHT);
+  VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, lightingPass.cullDescriptorSet.data()));
+  for (u32 i = 0; i < static_cast<u32>(MAX_FRAMES_IN_FLIGHT); i++) {
+    writeLightingBufferDescriptors(i);
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &lightingPass.cullDescriptorLayout;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &lightingPass.cullPipelineLayout));
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.layout = lightingPass.cullPipelineLayout;
+  pipelineInfo.stage = loadShader(std::string(SHADER_DIR) + "/deferredShaders/light_cull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+  VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &lightingPass.cullPipeline));
+  vkDestroyShaderModule(device, pipelineInfo.stage.module, nullptr);
+
+  // Four timestamps per frame in flight: around the culling dispatch and around the lighting pass
+  if (!context->properties.limits.timestampComputeAndGraphics) {
+    spdlog::warn("Timestamp queries not supported, light culling timings disabled");
+    return;
+  }
+  VkQueryPoolCreateInfo queryPoolCI{};
+  queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCI.queryCount = 4 * MAX_FRAMES_IN_FLIGHT;
+  VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &lightingPass.queryPool));
+  // Queries have to be reset once before the first read, otherwise results are undefined
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) { vkCmdResetQueryPool(cmd, lightingPass.queryPool, 0, queryPoolCI.queryCount); });
+}
+
+void VulkanDeferredBase::destroyLightCulling() {
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    bufferManager->destroyBuffer(lightingPass.uboBuffer[i]);
+    bufferManager->destroyBuffer(lightingPass.lightBuffer[i]);
+    bufferManager->destroyBuffer(lightingPass.clusterBuffer[i]);
+    bufferManager->destroyBuffer(lightingPass.statsBuffer[i]);
+  }
+  if (lightingPass.queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, lightingPass.queryPool, nullptr);
+  }
+  vkDestroyPipeline(device, lightingPass.cullPipeline, nullptr);
+  vkDestroyPipelineLayout(device, lightingPass.cullPipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, lightingPass.cullDescriptorLayout, nullptr);
+}
+
+void VulkanDeferredBase::writeLightingBufferDescriptors(u32 frame) {
+  std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+  bufferInfos[0] = {lightingPass.uboBuffer[frame].buffer, 0, sizeof(LightingPass::LightUBO)};
+  bufferInfos[1] = {lightingPass.lightBuffer[frame].buffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[2] = {lightingPass.clusterBuffer[frame].buffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[3] = {lightingPass.statsBuffer[frame].buffer, 0, VK_WHOLE_SIZE};
+
+  std::vector<VkWriteDescriptorSet> writes;
+  for (u32 i = 0; i < bufferInfos.size(); i++) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = lightingPass.cullDescriptorSet[frame];
+    write.dstBinding = i;
+    write.descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfos[i];
+    writes.push_back(write);
+    // Lighting set: 5 = LightUBO, 6 = point lights, 7 = clusters
+    if (i < 3 && frame < lightingPass.descriptorSet.size()) {
+      write.dstSet = lightingPass.descriptorSet[frame];
+      write.dstBinding = 5 + i;
+      writes.push_back(write);
+    }
+  }
+  // 8 = ShadowUBO, 9 = shadow map with comparison, 10 = shadow map depth
+  VkDescriptorBufferInfo shadowBufferInfo{shadowUBO[frame].buffer, 0, sizeof(ShadowCascades::UniformData)};
+  std::array<VkDescriptorImageInfo, 2> shadowImageInfos = {shadowCascades->compareDescriptor(), shadowCascades->depthDescriptor()};
+  if (frame < lightingPass.descriptorSet.size()) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = lightingPass.descriptorSet[frame];
+    write.dstBinding = 8;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &shadowBufferInfo;
+    writes.push_back(write);
+    write.pBufferInfo = nullptr;
+    write.dstBinding = 9;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = static_cast<u32>(shadowImageInfos.size());
+    write.pImageInfo = shadowImageInfos.data();
+    writes.push_back(write);
+  }
+  vkUpdateDescriptorSets(device, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void VulkanDeferredBase::updateLightingUBO() {
+  LightingPass::LightUBO ubo{};
+
+  glm::mat4 view = camera.getViewMatrix();
+  float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
+  glm::mat4 proj = camera.getProjectionMatrix(aspectRatio);
+
+  ubo.invView = glm::inverse(view);
+  ubo.invProj = glm::inverse(proj);
+  ubo.view = view;
+  ubo.cameraPos = glm::vec4(glm::vec3(ubo.invView[3]), 1.0f);
+
+  ubo.sunLight = lightingPass.sunLight;
+
+  // Exponential slices: slice i covers near * (far / near)^(i / CLUSTER_Z) to the next one
+  const float nearPlane = camera.getNearPlane();
+  const float farPlane = camera.getFarPlane();
+  const float sliceScale = LightingPass::CLUSTER_Z / std::log(farPlane / nearPlane);
+  ubo.clusterGrid = glm::uvec4(LightingPass::CLUSTER_X, LightingPass::CLUSTER_Y, LightingPass::CLUSTER_Z, 0);
+  ubo.clusterDepth = glm::vec4(nearPlane, farPlane, sliceScale, -std::log(nearPlane) * sliceScale);
+
+  ubo.numPointLights = static_cast<int>(lightingPass.pointLights.size());
+  ubo.ambientIntensity = lightingPass.ambientIntensity;
+  ubo.ssaoStrength = lightingPass.ssaoStrength;
+  ubo.clusterHeatmap = lightingPass.clusterHeatmap ? 1 : 0;
+
+  bufferManager->updateBuffer(lightingPass.uboBuffer[currentFrame], &ubo, sizeof(ubo), 0);
+
+  // Cascades follow the camera and the sun, dirty cascades redraw their static casters when the graph records them
+  shadowCascades->update(view, glm::radians(camera.getFov()), aspectRatio, nearPlane, glm::vec3(lightingPass.sunLight.direction));
+  bufferManager->updateBuffer(shadowUBO[currentFrame], &shadowCascades->uniformData(), sizeof(ShadowCascades::UniformData), 0);
+}
+
+void VulkanDeferredBase::recordLightCulling(VkCommandBuffer commandBuffer) {
+  // Results of the last submission that used this frame slot, its fence was just waited on
+  const auto* stats = static_cast<const LightingPass::ClusterStats*>(lightingPass.statsBuffer[currentFrame].mapped);
+  lightingPass.stats = *stats;
+  if (lightingPass.queryPool != VK_NULL_HANDLE) {
+    uint64_t timestamps[4] = {};
+    if (vkGetQueryPoolResults(device, lightingPass.queryPool, currentFrame * 4, 4, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      const float period = context->properties.limits.timestampPeriod / 1000000.0f;
+      auto smooth = [](float& average, float ms) { average = (average == 0.0f) ? ms : average * 0.95f + ms * 0.05f; };
+      smooth(lightingPass.cullMs, static_cast<float>(timestamps[1] - timestamps[0]) * period);
+      smooth(lightingPass.lightingMs, static_cast<float>(timestamps[3] - timestamps[2]) * period);
+    }
+    vkCmdResetQueryPool(commandBuffer, lightingPass.queryPool, currentFrame * 4, 4);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, lightingPass.queryPool, currentFrame * 4);
+  }
+
+  // Point lights, the buffer of this slot is no longer read by the GPU
+  const VkDeviceSize lightBytes = sizeof(LightingPass::PointLight) * lightingPass.pointLights.size();
+  if (lightBytes > lightingPass.lightBuffer[currentFrame].size) {
+    VkDeviceSize capacity = lightingPass.lightBuffer[currentFrame].size;
+    while (capacity < lightBytes) {
+      capacity *= 2;
+    }
+    bufferManager->destroyBuffer(lightingPass.lightBuffer[currentFrame]);
+    lightingPass.lightBuffer[currentFrame] = bufferManager->createBuffer(capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    writeLightingBufferDescriptors(currentFrame);
+  }
+  if (lightBytes > 0) {
+    bufferManager->updateBuffer(lightingPass.lightBuffer[currentFrame], lightingPass.pointLights.data(), lightBytes, 0);
+  }
+
+  vkCmdFillBuffer(commandBuffer, lightingPass.statsBuffer[currentFrame].buffer, 0, VK_WHOLE_SIZE, 0);
+  VkMemoryBarrier clearBarrier{};
+  clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+  // One invocation per cluster
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightingPass.cullPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, lightingPass.cullPipelineLayout, 0, 1, &lightingPass.cullDescriptorSet[currentFrame],
+                          0, nullptr);
+  vkCmdDispatch(commandBuffer, (LightingPass::CLUSTER_COUNT + 127) / 128, 1, 1);
+  if (lightingPass.queryPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, lightingPass.queryPool, currentFrame * 4 + 1);
+  }
+
+  // Stats to the host once the fence signals, the render graph hands the light lists to the lighting pass
+  VkMemoryBarrier statsBarrier{};
+  statsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &statsBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanDeferredBase::createShadowCascades() {
+  shadowCascades = std::make_unique<ShadowCascades>(context, cmdUtils, textureManager, static_cast<u32>(MAX_FRAMES_IN_FLIGHT));
+  shadowUBO.resize(MAX_FRAMES_IN_FLIGHT);
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    shadowUBO[i] = bufferManager->createBuffer(sizeof(ShadowCascades::UniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  }
+}
+
+void VulkanDeferredBase::destroyShadowCascades() {
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    bufferManager->destroyBuffer(shadowUBO[i]);
+  }
+  shadowCascades.reset();
+}
+
+void VulkanDeferredBase::updateSsaoParams() {
+  SsaoElements::SsaoParamsUBO params{};
+  float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
+  params.projection = camera.getProjectionMatrix(aspectRatio);
+  params.invProjection = glm::inverse(params.projection);
+  params.fullSize = glm::vec2(swapChainExtent.width, swapChainExtent.height);
+  const VkExtent3D halfExtent = renderGraph->texture(ssaoElements.ssaoOutput).extent;
+  params.halfSize = glm::vec2(halfExtent.width, halfExtent.height);
+  params.sampleCount = SsaoElements::PRESETS[static_cast<size_t>(ssaoElements.quality)].sampleCount;
+  params.radius = ssaoElements.radius;
+  params.bias = ssaoElements.bias;
+  params.intensity = ssaoElements.intensity;
+
+  bufferManager->updateBuffer(ssaoElements.ssaoParamsUBO[currentFrame], &params, sizeof(params), 0);
+}
+
+void VulkanDeferredBase::recordSSAODownsample(VkCommandBuffer commandBuffer) {
+  if (ssaoElements.queryPool != VK_NULL_HANDLE) {
+    uint64_t timestamps[2] = {};
+    if (vkGetQueryPoolResults(device, ssaoElements.queryPool, currentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      const float period = context->properties.limits.timestampPeriod / 1000000.0f;
+      const float ms = static_cast<float>(timestamps[1] - timestamps[0]) * period;
+      ssaoElements.gpuMs = (ssaoElements.gpuMs == 0.0f) ? ms : ssaoElements.gpuMs * 0.95f + ms * 0.05f;
+    }
+    vkCmdResetQueryPool(commandBuffer, ssaoElements.queryPool, currentFrame * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, ssaoElements.queryPool, currentFrame * 2);
+  }
+  updateSsaoParams();
+
+  // Each level reads the one written before it
+  VkMemoryBarrier computeBarrier{};
+  computeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  computeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  const VkExtent3D halfExtent = renderGraph->texture(ssaoElements.ssaoOutput).extent;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.downsamplePipeline);
+  for (uint32_t level = 0; level < SsaoElements::DEPTH_MIPS; level++) {
+    if (level > 0) {
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, nullptr, 0,
+                           nullptr);
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.downsamplePipelineLayout, 0, 1,
+                            &ssaoElements.downsampleDescriptorSets[currentFrame * SsaoElements::DEPTH_MIPS + level], 0, nullptr);
+    int32_t pushLevel = static_cast<int32_t>(level);
+    vkCmdPushConstants(commandBuffer, ssaoElements.downsamplePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushLevel), &pushLevel);
+    const uint32_t width = std::max(1u, halfExtent.width >> level);
+    const uint32_t height = std::max(1u, halfExtent.height >> level);
+    vkCmdDispatch(commandBuffer, (width + 7) / 8, (height + 7) / 8, 1);
+  }
+}
+
+void VulkanDeferredBase::recordSSAO(VkCommandBuffer commandBuffer) {
+  const VkExtent3D halfExtent = renderGraph->texture(ssaoElements.ssaoOutput).extent;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.ssaoPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.ssaoPipelineLayout, 0, 1, &ssaoElements.ssaoDescriptorSets[currentFrame],
+                          0, nullptr);
+  vkCmdDispatch(commandBuffer, (halfExtent.width + 7) / 8, (halfExtent.height + 7) / 8, 1);
+}
+
+void VulkanDeferredBase::recordSSAOBlur(VkCommandBuffer commandBuffer, u32 pass) {
+  // One workgroup per 64 texel segment of a row (horizontal) or a column (vertical), must match ssao_blur.comp
+  const VkExtent3D halfExtent = renderGraph->texture(ssaoElements.ssaoOutput).extent;
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.ssaoBlurPipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.ssaoBlurPipelineLayout, 0, 1,
+                          &ssaoElements.ssaoBlurDescriptorSets[currentFrame * 2 + pass], 0, nullptr);
+  const glm::ivec2 direction = pass == 0 ? glm::ivec2(1, 0) : glm::ivec2(0, 1);
+  vkCmdPushConstants(commandBuffer, ssaoElements.ssaoBlurPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(direction), &direction);
+  if (pass == 0) {
+    vkCmdDispatch(commandBuffer, (halfExtent.width + 63) / 64, halfExtent.height, 1);
+  } else {
+    vkCmdDispatch(commandBuffer, (halfExtent.height + 63) / 64, halfExtent.width, 1);
+  }
+}
+
+void VulkanDeferredBase::recordSSAOUpsample(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.upsamplePipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoElements.upsamplePipelineLayout, 0, 1,
+                          &ssaoElements.upsampleDescriptorSets[currentFrame], 0, nullptr);
+  vkCmdDispatch(commandBuffer, (swapChainExtent.width + 7) / 8, (swapChainExtent.height + 7) / 8, 1);
+
+  if (ssaoElements.queryPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, ssaoElements.queryPool, currentFrame * 2 + 1);
+  }
+}
+
 // calculations
 // Full-screen Quad Creation
 void VulkanDeferredBase::createFullscreenQuad() {
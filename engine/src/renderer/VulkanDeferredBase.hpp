@@ -14,6 +14,8 @@
 #include "BufferManager.hpp"
 #include "CommandBufferUtils.hpp"
 #include "ModelManager.hpp"
+#include "RenderGraph.hpp"
+#include "ShadowCascades.hpp"
 #include "TextureManager.hpp"
 #include "VulkanContext.hpp"
 #include "core/QuaternionCamera.hpp"
@@ -22,7 +24,8 @@
 
 class GLFWwindow;
 /*
-  PASS 1: G-BUFFER (Geometry Pass) -> PASS 2: SSAO -> PASS 3: LIGHTING -> PASS 4: SKYBOX ->PASS 5: TRANSPARENT
+  The frame is a RenderGraph built in buildRenderGraph(): LIGHT CULLING -> SHADOW CASCADES ->
+  PASS 1: DEPTH/NORMAL PREPASS -> PASS 2: SSAO -> PASS 3: G-BUFFER + LIGHTING (subpasses) -> PASS 4: SKYBOX ->PASS 5: TRANSPARENT
   -> PASS 6: POST-PROCESSING(bloom,toneMapping (HDR → LDR + gamma))
 */
 class TAK_API VulkanDeferredBase {
@@ -40,92 +43,155 @@ class TAK_API VulkanDeferredBase {
   // Pure virtual methods that derived classes must implement
   virtual void getDescriptorPoolSizes(std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t& maxSets) = 0;
   virtual void createGeometryPipeline() = 0;  // pass1
-  virtual void createssaoPipeline() = 0;      // 2
-  virtual void createLightingPipeline() = 0;  // 3
+  virtual void createLightingPipeline() = 0;  // 2, SSAO is compute and belongs to the base
   // virtual void createSkyboxPipeline() = 0;
   // virtual void createTransparentPipeline() = 0;
   // virtual void createPostProcessingPipelines() = 0;  // bloomPipeline, toneMappingPipeline,fxaaPipeline
 
   virtual void loadResources() = 0;
-  virtual void recordGeometryCommands(VkCommandBuffer commandBuffer) = 0;
-  virtual void recordSSAOCommands(VkCommandBuffer commandBuffer, u32 imageIndex) = 0;
-  virtual void recordSSAOBlurCommands(VkCommandBuffer commandBuffer, u32 imageIndex) = 0;
+  // Called twice per frame with the pipeline to bind: gBuffer.prepassPipeline (depth + normal) and gBuffer.pipeline
+  // (albedo + material at depth EQUAL), the draws must be identical
+  virtual void recordGeometryCommands(VkCommandBuffer commandBuffer, VkPipeline pipeline) = 0;
   virtual void recordLightingCommands(VkCommandBuffer commandBuffer) = 0;
   virtual void cleanupResources() = 0;
 
-  std::vector<VkFramebuffer> swapChainFramebuffers;
+  std::vector<VkFramebuffer> swapChainFramebuffers;  // gBuffer.renderPass: albedo, material, depth, swapchain image
   // G-Buffer components
-  // definition->depth resource create->Gbuffer Texture Create -> geometry render pass->framebuffer->geometrypipline create(derived)
-  // ->record geometry pass command->geometry commands from (derived) -> cleanup
+  // A depth/normal prepass feeds the SSAO compute passes, then one render pass runs the geometry subpass (albedo + material)
+  // and the lighting subpass, which reads them as input attachments. Albedo and material never leave tile memory on tilers:
+  // they are transient (lazily allocated where the device has such memory) and never stored.
+  // One set of images serves every frame in flight, the render graph orders a frame's writes after the previous frame's
+  // reads (albedo and material, which never leave the render pass, through its external dependency).
+  // 12 bytes of color per pixel against the 16 of the RGBA16F normal layout: a quarter less, the normal target is halved.
+  // Emissive has no color of its own, it is albedo scaled by material.b.
   struct GBuffer {
-    // swapChainImageViews.size
-    std::vector<TextureManager::Texture> normal;    // RGB=normal (encoded), A=metallic
-    std::vector<TextureManager::Texture> albedo;    // RGB=albedo, A=AO
-    std::vector<TextureManager::Texture> material;  // R=roughness, GBA=emissive
-    std::vector<TextureManager::Texture> depthBuffer;
-
-    VkDescriptorSetLayout descriptorSetLayout;
-    std::vector<VkDescriptorSet> descriptorSets;  // used for lighting pass not a descriptor for own
+    static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;    // 4 bytes, linear in the shaders
+    static constexpr VkFormat MATERIAL_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;  // 4 bytes
+    static constexpr u32 GEOMETRY_SUBPASS = 0;
+    static constexpr u32 LIGHTING_SUBPASS = 1;
+    // 4 bytes. R16G16_UNORM is not a required color attachment format, R16G16_SFLOAT (required) holds the same [0,1]
+    // encoding where it is missing
+    VkFormat normalFormat = VK_FORMAT_R16G16_UNORM;
+
+    TextureManager::Texture normal;       // RG=octahedral normal (view-space), written by the prepass
+    TextureManager::Texture albedo;       // RGB=albedo, A=AO (transient)
+    TextureManager::Texture material;     // R=metallic, G=roughness, B=emissive strength, A=unused (transient)
+    TextureManager::Texture depthBuffer;  // written by the prepass, read-only afterwards
     // derived class: gbufferubo, descriptorset, etc..
 
-    std::vector<VkFramebuffer> framebuffers;
-    VkPipeline pipeline;  // MRT output, depth write
+    VkRenderPass prepassRenderPass;
+    VkFramebuffer prepassFramebuffer;
+    VkPipeline prepassPipeline;  // normal output, depth write
 
-    VkRenderPass renderPass;
+    VkRenderPass renderPass;  // geometry + lighting subpasses
+    VkPipeline pipeline;      // MRT output, depth EQUAL without writes
   } gBuffer;
 
   void createGBuffer();
-  void recreateGbuffer();
-  // Definition ->  Kernel Generation-> Noise Texture Creation ->createSsaoElements()->Render Passes-> Framebuffers
-  //->Pipeline Creation (Derived Class)->Runtime Update->Command Buffer Recording->SSAO Draw Commands (Derived Class)->cleanup
+  // SSAO runs at half resolution in compute: ssao_downsample.comp builds a linear depth pyramid (DEPTH_MIPS levels, level 0 at
+  // half resolution) with matching normals, ssao.comp spreads the preset's kernel taps over 2x2 pixel quads (interleaved
+  // sampling), ssao_blur.comp blurs the result at half resolution in two separable bilateral passes and ssao_upsample.comp
+  // resolves it to full resolution weighted by depth. The lighting pass reads ssaoFull.
+  // The intermediate textures are render graph transients shared by the frames in flight, textures whose passes do not
+  // overlap share memory.
   struct SsaoElements {
     static constexpr int SSAO_KERNEL_SIZE = 64;
     static constexpr float SSAO_RADIUS = 0.3f;
     static constexpr int SSAO_NOISE_DIM = 8;
+    static constexpr u32 DEPTH_MIPS = 4;  // must match ssao.comp
 
-    // Textures
-    TextureManager::Texture noiseTexture;              // Random rotation vectors
-    std::vector<TextureManager::Texture> ssaoOutput;   // Raw SSAO result (per swapchain image)
-    std::vector<TextureManager::Texture> ssaoBlurred;  // Blurred result (per swapchain image)
+    // Quality/cost presets, taps per pixel out of the SSAO_KERNEL_SIZE kernel (a power of two up to SSAO_KERNEL_SIZE)
+    enum class Quality : int { Low, Medium, High, Ultra };
+    struct Preset {
+      const char* name;
+      int sampleCount;
+    };
+    static constexpr std::array<Preset, 4> PRESETS = {{{"Low", 8}, {"Medium", 16}, {"High", 32}, {"Ultra", 64}}};
 
-    // Framebuffers
-    std::vector<VkFramebuffer> ssaoFramebuffers;
-    std::vector<VkFramebuffer> ssaoBlurFramebuffers;
+    // Textures
+    TextureManager::Texture noiseTexture;  // Random rotation vectors
+    RenderGraph::TextureHandle depthPyramid;  // R32 linear view depth, DEPTH_MIPS levels with single level views for storage writes
+    RenderGraph::TextureHandle halfNormal;    // view-space normals of pyramid level 0
+    RenderGraph::TextureHandle ssaoOutput;    // Raw SSAO result, half resolution
+    RenderGraph::TextureHandle ssaoBlurTemp;  // Horizontal blur pass output, half resolution
+    RenderGraph::TextureHandle ssaoBlurred;   // Blurred result, half resolution
+    RenderGraph::TextureHandle ssaoFull;      // Upsampled result read by the lighting pass
+    // Occlusion storage format: R8 where storage writes to it are supported, else RGBA8 (always a storage format)
+    VkFormat aoFormat = VK_FORMAT_R8_UNORM;
 
     // Uniform buffers
     std::vector<BufferManager::Buffer> ssaoKernelUBO;  // Sample kernel
-    // FIX: Added invProjection — precomputed on CPU so the shader doesn't call
-    //      inverse(projection) 65 times per pixel (once per fragment + per kernel sample).
     struct SsaoParamsUBO {
       glm::mat4 projection;
       glm::mat4 invProjection;  // precomputed inverse projection
-      float nearPlane;
-      float farPlane;
-      glm::vec2 noiseScale;  // screenSize / noiseTextureSize
+      glm::vec2 fullSize;       // pixels
+      glm::vec2 halfSize;       // pixels of ssaoOutput and pyramid level 0
+      int sampleCount;
+      float radius;     // view-space
+      float bias;
+      float intensity;  // exponent applied to the result
     };
     std::vector<BufferManager::Buffer> ssaoParamsUBO;
 
     // Pipeline layouts
     VkPipelineLayout ssaoPipelineLayout;
     VkPipelineLayout ssaoBlurPipelineLayout;
+    VkPipelineLayout downsamplePipelineLayout;
+    VkPipelineLayout upsamplePipelineLayout;
+
+    // Compute pipelines
+    VkPipeline ssaoPipeline;
+    VkPipeline ssaoBlurPipeline;
+    VkPipeline downsamplePipeline;
+    VkPipeline upsamplePipeline;
 
     // Descriptor set layouts & sets
     VkDescriptorSetLayout ssaoDescriptorSetLayout;
     VkDescriptorSetLayout ssaoBlurDescriptorSetLayout;
+    VkDescriptorSetLayout downsampleDescriptorSetLayout;
+    VkDescriptorSetLayout upsampleDescriptorSetLayout;
     std::vector<VkDescriptorSet> ssaoDescriptorSets;
-    std::vector<VkDescriptorSet> ssaoBlurDescriptorSets;
-
-    // Render passes
-    VkRenderPass ssaoRenderPass;
-    VkRenderPass ssaoBlurRenderPass;
+    std::vector<VkDescriptorSet> ssaoBlurDescriptorSets;    // 2 per frame, horizontal then vertical
+    std::vector<VkDescriptorSet> downsampleDescriptorSets;  // DEPTH_MIPS per frame, one per pyramid level
+    std::vector<VkDescriptorSet> upsampleDescriptorSets;
+
+    // Settings, applied the next frame
+    Quality quality = Quality::Medium;
+    float radius = SSAO_RADIUS;
+    float bias = 0.025f;
+    float intensity = 1.0f;
+
+    // GPU time from the first downsample to the end of the upsample, blur included
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    float gpuMs = 0.0f;
   } ssaoElements;
   void generateSSAOKernel();
   void createSSAONoiseTexture();
   void createSsaoElements();
-  void recreateSSaoElements();
+  // Once the render graph is compiled
+  void writeSsaoDescriptors(u32 frame);
+  void createSsaoPipelines();
+  void destroySsaoPipelines();
+  void updateSsaoParams();
+  // Depth pyramid, one dispatch per level
+  void recordSSAODownsample(VkCommandBuffer commandBuffer);
+  // Half resolution AO
+  void recordSSAO(VkCommandBuffer commandBuffer);
+  // Horizontal (pass 0) or vertical (pass 1) bilateral blur, 2 * RADIUS + 1 taps per pass instead of a square kernel
+  void recordSSAOBlur(VkCommandBuffer commandBuffer, u32 pass);
+  // Full resolution resolve of the blurred AO
+  void recordSSAOUpsample(VkCommandBuffer commandBuffer);
   // light pass
+  // Point lights live in a storage buffer without a fixed cap. Every frame light_cull.comp bins them into a froxel grid
+  // (CLUSTER_X x CLUSTER_Y screen tiles, CLUSTER_Z exponential view depth slices between the camera planes) and
+  // deferred_lighting.frag only evaluates the lights of the pixel's cluster
   struct LightingPass {
-    static const int MAX_POINT_LIGHTS = 32;
+    static constexpr u32 CLUSTER_X = 16;
+    static constexpr u32 CLUSTER_Y = 9;
+    static constexpr u32 CLUSTER_Z = 24;
+    static constexpr u32 CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    // Light list slots per cluster, must match light_cull.comp and deferred_lighting.frag, further lights are dropped
+    static constexpr u32 MAX_LIGHTS_PER_CLUSTER = 256;
     VkDescriptorSetLayout descriptorLayout;
     std::vector<VkDescriptorSet> descriptorSet;
 
@@ -144,24 +210,72 @@ class TAK_API VulkanDeferredBase {
     struct LightUBO {
       glm::mat4 invView;    // Inverse view matrix (for world-space reconstruction)
       glm::mat4 invProj;    // Inverse projection matrix
+      glm::mat4 view;       // light culling works in view space
       glm::vec4 cameraPos;  // xyz = camera position, w = unused
       DirectionalLight sunLight;
-      PointLight pointLights[MAX_POINT_LIGHTS];
+      glm::uvec4 clusterGrid;  // xyz = CLUSTER_X/Y/Z, w = unused
+      glm::vec4 clusterDepth;  // near, far, slice = log(viewDepth) * z + w
       int numPointLights;
       float ambientIntensity;
       float ssaoStrength;
-      float padding;
+      int clusterHeatmap;  // shade the light count per cluster instead of the scene
+    };
+    // Written by light_cull.comp, read back once the frame's fence was waited on
+    struct ClusterStats {
+      u32 maxLights;         // most lights overlapping a single cluster, before the MAX_LIGHTS_PER_CLUSTER clamp
+      u32 overflowClusters;  // clusters that dropped lights
     };
     std::vector<BufferManager::Buffer> uboBuffer;
-    VkRenderPass renderPass;
+    std::vector<BufferManager::Buffer> lightBuffer;    // PointLight array per frame, host visible, grows with pointLights
+    std::vector<BufferManager::Buffer> clusterBuffer;  // per cluster: light count, then MAX_LIGHTS_PER_CLUSTER light indices
+    std::vector<BufferManager::Buffer> statsBuffer;    // ClusterStats per frame, host visible
+
+    // Light culling compute
+    VkDescriptorSetLayout cullDescriptorLayout;
+    std::vector<VkDescriptorSet> cullDescriptorSet;
+    VkPipelineLayout cullPipelineLayout;
+    VkPipeline cullPipeline;
+    VkQueryPool queryPool = VK_NULL_HANDLE;  // per frame: culling begin/end, lighting subpass begin/end
 
     // Scene lights
     DirectionalLight sunLight;
-    std::vector<PointLight> pointLights;
+    std::vector<PointLight> pointLights;  // any number, uploaded every frame
     float ambientIntensity = 0.03f;
     float ssaoStrength = 1.0f;
+    bool clusterHeatmap = false;
+
+    // Last completed frame
+    ClusterStats stats{};
+    float cullMs = 0.0f;
+    float lightingMs = 0.0f;
   } lightingPass;
-  // call updateSSAOParamsUBO() from derived::updatescene(deltaTime);
+  void createLightCulling();
+  void destroyLightCulling();
+  // Lighting set bindings 5-10 (LightUBO, point lights, cluster light lists, shadow UBO and samplers) and the culling set of a frame,
+  // the derived class writes lighting bindings 0-4 and calls this once its lighting sets are allocated
+  void writeLightingBufferDescriptors(u32 frame);
+  void updateLightingUBO();
+  // Uploads the point lights and bins them, before the geometry pass
+  void recordLightCulling(VkCommandBuffer commandBuffer);
+
+  // Cascaded shadow map of the sun, fit to the camera every frame and sampled by the lighting set: 8 = ShadowUBO,
+  // 9 = comparison sampler, 10 = plain depth sampler (PCSS blocker search). Not swapchain sized, created once
+  std::unique_ptr<ShadowCascades> shadowCascades;
+  std::vector<BufferManager::Buffer> shadowUBO;  // ShadowCascades::UniformData per frame
+  void createShadowCascades();
+  void destroyShadowCascades();
+  // Casters of one cascade, called by shadowCascades->record with viewport, scissor and depth bias set. Static casters are
+  // drawn into the cache only when the cascade moved, dynamic ones every frame. Cull with shadowCascades->casterVisible and
+  // bind pipelines created for shadowCascades->renderPass()
+  virtual void recordShadowCasters(VkCommandBuffer commandBuffer, u32 cascade, bool staticCasters) {}
+
+  // Frame render graph, every pass of recordCommandBuffer with the textures and buffers it reads and writes
+  // Rebuilt with the swapchain: the SSAO transients follow its size
+  std::unique_ptr<RenderGraph> renderGraph;
+  void buildRenderGraph();
+  // Further reads of the geometry + lighting pass (debug views drawn by the overlay), graph textures nothing reads are
+  // culled or share memory with later ones
+  virtual void declareLightingInputs(RenderGraph::Pass& pass) {}
 
   // Optional virtual methods
   virtual void updateScene(float deltaTime) {}
@@ -260,6 +374,7 @@ class TAK_API VulkanDeferredBase {
 
   const int MAX_FRAMES_IN_FLIGHT = 2;
   u32 currentFrame = 0;
+  u32 currentImageIndex = 0;  // swapchain image of the command buffer being recorded
   bool framebufferResized = false;
   // single descriptor pool
   VkDescriptorPool descriptorPool;
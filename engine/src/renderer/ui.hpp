@@ -42,7 +42,7 @@ struct UI {
   } pushConstBlock;
 
   UI(std::shared_ptr<TextureManager> textureManager, VkRenderPass renderPass, VkSampleCountFlagBits multiSampleCount,
-     const std::string& shaderDir, GLFWwindow* window)  // Added window parameter
+     const std::string& shaderDir, GLFWwindow* window, uint32_t subpass = 0)  // Added window parameter
       : textureManager(textureManager) {
     device = textureManager->context->device;
 
@@ -188,6 +188,7 @@ struct UI {
     pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineCI.layout = pipelineLayout;
     pipelineCI.renderPass = renderPass;
+    pipelineCI.subpass = subpass;  // the overlay is drawn in the last subpass of the render pass
     pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
     pipelineCI.pVertexInputState = &vertexInputStateCI;
     pipelineCI.pRasterizationState = &rasterizationStateCI;
@@ -261,6 +262,13 @@ struct UI {
       return (ImTextureID)it->second;
     }
 
+    ImTextureID texId = createTexture(sampler, imageView);
+    textureDescriptorSets[imageView] = (VkDescriptorSet)texId;
+    return texId;
+  }
+
+  // Uncached set for an image whose view gets replaced, rewrite it with updateTexture while no submitted frame uses it
+  ImTextureID createTexture(VkSampler sampler, VkImageView imageView) {
     VkDescriptorSet texDescSet;
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -268,7 +276,11 @@ struct UI {
     allocInfo.pSetLayouts = &descriptorSetLayout;
     allocInfo.descriptorSetCount = 1;
     vkAllocateDescriptorSets(device, &allocInfo, &texDescSet);
+    updateTexture((ImTextureID)texDescSet, sampler, imageView);
+    return (ImTextureID)texDescSet;
+  }
 
+  void updateTexture(ImTextureID texId, VkSampler sampler, VkImageView imageView) {
     VkDescriptorImageInfo imageInfo{};
     imageInfo.sampler = sampler;
     imageInfo.imageView = imageView;
@@ -276,15 +288,12 @@ struct UI {
 
     VkWriteDescriptorSet writeDesc{};
     writeDesc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDesc.dstSet = texDescSet;
+    writeDesc.dstSet = (VkDescriptorSet)texId;
     writeDesc.dstBinding = 0;
     writeDesc.descriptorCount = 1;
     writeDesc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     writeDesc.pImageInfo = &imageInfo;
     vkUpdateDescriptorSets(device, 1, &writeDesc, 0, nullptr);
-
-    textureDescriptorSets[imageView] = texDescSet;
-    return (ImTextureID)texDescSet;
   }
 
   void draw(VkCommandBuffer cmdBuffer) {
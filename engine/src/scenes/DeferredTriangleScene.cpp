@@ -3,6 +3,12 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <random>
+
 #include "core/utils.hpp"
 
 DeferredTriangleScene::DeferredTriangleScene() {
@@ -15,11 +21,26 @@ DeferredTriangleScene::DeferredTriangleScene() {
 void DeferredTriangleScene::loadResources() {
   spdlog::info("Loading deferred scene resources");
 
+  // Pillars for the shadow cascades: near the origin and out to the last cascade
+  for (int i = 0; i < 8; i++) {
+    const float angle = glm::two_pi<float>() * static_cast<float>(i) / 8.0f;
+    const float distance = 3.0f + 2.0f * static_cast<float>(i);
+    addBox(glm::vec3(distance * std::cos(angle), distance * std::sin(angle), 1.0f), glm::vec3(0.3f, 0.3f, 1.0f));
+  }
+  glm::vec3 boundsMin(FLT_MAX);
+  glm::vec3 boundsMax(-FLT_MAX);
+  for (const Vertex& vertex : vertices) {
+    boundsMin = glm::min(boundsMin, vertex.pos);
+    boundsMax = glm::max(boundsMax, vertex.pos);
+  }
+  shadowCascades->setCasterBounds(boundsMin, boundsMax);
+  shadowCascades->setDynamicCascades(0);  // static pillars only, the atlas tiles are copied from the cache when it changes
+
   // Create scene resources
   createVertexBuffer();
   createIndexBuffer();
   createUniformBuffers();
-  createLightingUBOs();
+  initLights();
 
   // Load textures BEFORE descriptor sets — descriptors reference albedoTexture.imageView
   albedoTexture = textureManager->createTextureFromFile(std::string(TEXTURE_DIR) + "/cuteCat.jpg");
@@ -27,18 +48,17 @@ void DeferredTriangleScene::loadResources() {
   createDescriptorSets();
 
   // Initialize UI
-  ui = new UI(textureManager, lightingPass.renderPass, VK_SAMPLE_COUNT_1_BIT, std::string(SHADER_DIR), window);
+  ui = new UI(textureManager, gBuffer.renderPass, VK_SAMPLE_COUNT_1_BIT, std::string(SHADER_DIR), window, GBuffer::LIGHTING_SUBPASS);
 
-  // Register G-Buffer textures with ImGui (using first frame's textures)
-  normalTexId = ui->addTexture(gBuffer.normal[0].sampler, gBuffer.normal[0].imageView);
-  albedoTexId = ui->addTexture(gBuffer.albedo[0].sampler, gBuffer.albedo[0].imageView);
-  materialTexId = ui->addTexture(gBuffer.material[0].sampler, gBuffer.material[0].imageView);
+  // Register G-Buffer textures with ImGui (albedo and material are transient and cannot be sampled)
+  normalTexId = ui->addTexture(gBuffer.normal.sampler, gBuffer.normal.imageView);
 
   // Caution!: Cannot register depth buffer with ImGui — ImGui_ImplVulkan_AddTexture hardcodes
   // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, but depth is in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
-  depthTexId = ui->addTexture(gBuffer.depthBuffer[0].sampler, gBuffer.depthBuffer[0].imageView);
-  ssaoTexId = ui->addTexture(ssaoElements.ssaoOutput[0].sampler, ssaoElements.ssaoOutput[0].imageView);
-  ssaoBlurredTexId = ui->addTexture(ssaoElements.ssaoBlurred[0].sampler, ssaoElements.ssaoBlurred[0].imageView);
+  depthTexId = ui->addTexture(gBuffer.depthBuffer.sampler, gBuffer.depthBuffer.imageView);
+  ssaoTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoOutput).sampler, renderGraph->texture(ssaoElements.ssaoOutput).imageView);
+  ssaoBlurredTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoBlurred).sampler, renderGraph->texture(ssaoElements.ssaoBlurred).imageView);
+  ssaoFullTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoFull).sampler, renderGraph->texture(ssaoElements.ssaoFull).imageView);
 }
 
 void DeferredTriangleScene::getDescriptorPoolSizes(std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t& maxSets) {
@@ -47,18 +67,23 @@ void DeferredTriangleScene::getDescriptorPoolSizes(std::vector<VkDescriptorPoolS
   // Geometry pass
   poolSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount});
   poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount});
-  // Lighting pass: G-Buffer (4 textures) + SSAO blurred (1 texture) + UBO (1)
-  poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 5});  // gbuffer + ssao
-  poolSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount});
+  // Lighting pass: normal + SSAO + shadow map twice (4 textures) + albedo, material, depth (3 input attachments) + light and
+  // shadow UBOs (2) + point lights and clusters (2)
+  poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * 4});  // normal + ssao + shadow compare + shadow depth
+  poolSizes.push_back({VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, frameCount * 3});
+  poolSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * 2});
+  poolSizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 2});
   maxSets += (frameCount * 2);
 }
 
 void DeferredTriangleScene::createGeometryPipeline() {
-  spdlog::info("Creating geometry pipeline");
+  spdlog::info("Creating geometry pipelines");
 
-  // Shader stages
-  VkPipelineShaderStageCreateInfo shaderStages[] = {loadShader(std::string(SHADER_DIR) + "/deferred_geometry.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
-                                                    loadShader(std::string(SHADER_DIR) + "/deferred_geometry.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)};
+  // Shader stages: the prepass and the geometry subpass share the vertex shader (invariant gl_Position)
+  VkPipelineShaderStageCreateInfo shaderStages[] = {
+      loadShader(std::string(SHADER_DIR) + "/deferredShaders/deferred_geometry.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+      loadShader(std::string(SHADER_DIR) + "/deferredShaders/deferred_prepass.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT),
+      loadShader(std::string(SHADER_DIR) + "/deferredShaders/deferred_geometry.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)};
 
   // Vertex input
   auto bindingDescription = Vertex::getBindingDescription();
@@ -100,17 +125,17 @@ void DeferredTriangleScene::createGeometryPipeline() {
   multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
   multisampling.sampleShadingEnable = VK_FALSE;
 
-  // Depth testing
+  // Depth testing: the prepass resolves visibility
   VkPipelineDepthStencilStateCreateInfo depthStencil{};
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
   depthStencil.depthWriteEnable = VK_TRUE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;  // reverse-Z
   depthStencil.depthBoundsTestEnable = VK_FALSE;
   depthStencil.stencilTestEnable = VK_FALSE;
 
-  // Color blending - MRT setup for G-Buffer
-  std::array<VkPipelineColorBlendAttachmentState, 3> colorBlendAttachments{};
+  // Color blending - MRT setup for G-Buffer (the prepass only uses the first attachment)
+  std::array<VkPipelineColorBlendAttachmentState, 2> colorBlendAttachments{};
   for (auto& attachment : colorBlendAttachments) {
     attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     attachment.blendEnable = VK_FALSE;
@@ -119,7 +144,7 @@ void DeferredTriangleScene::createGeometryPipeline() {
   VkPipelineColorBlendStateCreateInfo colorBlending{};
   colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
   colorBlending.logicOpEnable = VK_FALSE;
-  colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+  colorBlending.attachmentCount = 1;
   colorBlending.pAttachments = colorBlendAttachments.data();
 
   // Dynamic state
@@ -138,7 +163,7 @@ void DeferredTriangleScene::createGeometryPipeline() {
 
   VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &geometryPipelineLayout));
 
-  // Create pipeline
+  // Create prepass pipeline: depth + normal
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
   pipelineInfo.stageCount = 2;
@@ -152,152 +177,148 @@ void DeferredTriangleScene::createGeometryPipeline() {
   pipelineInfo.pColorBlendState = &colorBlending;
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = geometryPipelineLayout;
-  pipelineInfo.renderPass = gBuffer.renderPass;
+  pipelineInfo.renderPass = gBuffer.prepassRenderPass;
   pipelineInfo.subpass = 0;
 
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &gBuffer.prepassPipeline));
+
+  // Create G-Buffer pipeline: albedo + material, only the visible fragment passes EQUAL so each pixel is shaded once
+  std::array<VkPipelineShaderStageCreateInfo, 2> gBufferStages = {shaderStages[0], shaderStages[2]};
+  depthStencil.depthWriteEnable = VK_FALSE;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+  pipelineInfo.pStages = gBufferStages.data();
+  pipelineInfo.renderPass = gBuffer.renderPass;
+  pipelineInfo.subpass = GBuffer::GEOMETRY_SUBPASS;
+
   VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &gBuffer.pipeline));
 
   // Cleanup shader modules
-  vkDestroyShaderModule(device, shaderStages[0].module, nullptr);
-  vkDestroyShaderModule(device, shaderStages[1].module, nullptr);
+  for (auto& stage : shaderStages) {
+    vkDestroyShaderModule(device, stage.module, nullptr);
+  }
 
-  spdlog::info("Geometry pipeline created successfully");
+  createShadowCasterPipeline();
+  spdlog::info("Geometry pipelines created successfully");
 }
 
-void DeferredTriangleScene::createssaoPipeline() {
-  spdlog::info("Creating SSAO pipelines");
+void DeferredTriangleScene::createShadowCasterPipeline() {
+  // Positions only, same vertex buffer as the geometry passes
+  auto bindingDescription = Vertex::getBindingDescription();
+  auto attributeDescription = Vertex::getAttributeDescriptions()[0];
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount = 1;
+  vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
 
-  // Common pipeline state
   VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
   inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-  // Use fullscreen quad vertex input (from base class)
-  struct QuadVertex {
-    glm::vec2 pos;
-    glm::vec2 uv;
-  };
-
-  VkVertexInputBindingDescription bindingDesc{};
-  bindingDesc.binding = 0;
-  bindingDesc.stride = sizeof(QuadVertex);
-  bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-  std::array<VkVertexInputAttributeDescription, 2> attrDesc{};
-  attrDesc[0].binding = 0;
-  attrDesc[0].location = 0;
-  attrDesc[0].format = VK_FORMAT_R32G32_SFLOAT;
-  attrDesc[0].offset = offsetof(QuadVertex, pos);
-
-  attrDesc[1].binding = 0;
-  attrDesc[1].location = 1;
-  attrDesc[1].format = VK_FORMAT_R32G32_SFLOAT;
-  attrDesc[1].offset = offsetof(QuadVertex, uv);
-
-  VkPipelineVertexInputStateCreateInfo vertexInput{};
-  vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInput.vertexBindingDescriptionCount = 1;
-  vertexInput.pVertexBindingDescriptions = &bindingDesc;
-  vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attrDesc.size());
-  vertexInput.pVertexAttributeDescriptions = attrDesc.data();
-
-  // Viewport & scissor
   VkPipelineViewportStateCreateInfo viewportState{};
   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
   viewportState.viewportCount = 1;
   viewportState.scissorCount = 1;
 
-  // Rasterizer
+  // Two sided: the test quad has no back, slope scaled bias from ShadowCascades::settings
   VkPipelineRasterizationStateCreateInfo rasterizer{};
   rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
   rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
   rasterizer.cullMode = VK_CULL_MODE_NONE;
   rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
   rasterizer.lineWidth = 1.0f;
+  rasterizer.depthBiasEnable = VK_TRUE;
 
-  // No depth testing for SSAO
-  VkPipelineDepthStencilStateCreateInfo depthStencil{};
-  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depthStencil.depthTestEnable = VK_FALSE;
-  depthStencil.depthWriteEnable = VK_FALSE;
-
-  // Multisampling
   VkPipelineMultisampleStateCreateInfo multisampling{};
   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
   multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-  // Color blending
-  VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-  colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;  // Only R channel for SSAO
-  colorBlendAttachment.blendEnable = VK_FALSE;
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = VK_TRUE;
+  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
 
   VkPipelineColorBlendStateCreateInfo colorBlending{};
   colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &colorBlendAttachment;
-
-  // Dynamic state
-  std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
+  std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_DEPTH_BIAS};
   VkPipelineDynamicStateCreateInfo dynamicState{};
   dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
   dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
   dynamicState.pDynamicStates = dynamicStates.data();
 
-  // === SSAO Pipeline ===
-  VkPipelineLayoutCreateInfo ssaoLayoutInfo{};
-  ssaoLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  ssaoLayoutInfo.setLayoutCount = 1;
-  ssaoLayoutInfo.pSetLayouts = &ssaoElements.ssaoDescriptorSetLayout;
-
-  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &ssaoLayoutInfo, nullptr, &ssaoElements.ssaoPipelineLayout));
-
-  VkPipelineShaderStageCreateInfo ssaoShaders[] = {loadShader(std::string(SHADER_DIR) + "/deferredShaders/ssao.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
-                                                   loadShader(std::string(SHADER_DIR) + "/deferredShaders/ssao.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)};
-
-  VkGraphicsPipelineCreateInfo ssaoPipelineInfo{};
-  ssaoPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  ssaoPipelineInfo.stageCount = 2;
-  ssaoPipelineInfo.pStages = ssaoShaders;
-  ssaoPipelineInfo.pVertexInputState = &vertexInput;
-  ssaoPipelineInfo.pInputAssemblyState = &inputAssembly;
-  ssaoPipelineInfo.pViewportState = &viewportState;
-  ssaoPipelineInfo.pRasterizationState = &rasterizer;
-  ssaoPipelineInfo.pMultisampleState = &multisampling;
-  ssaoPipelineInfo.pDepthStencilState = &depthStencil;
-  ssaoPipelineInfo.pColorBlendState = &colorBlending;
-  ssaoPipelineInfo.pDynamicState = &dynamicState;
-  ssaoPipelineInfo.layout = ssaoElements.ssaoPipelineLayout;
-  ssaoPipelineInfo.renderPass = ssaoElements.ssaoRenderPass;
-
-  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &ssaoPipelineInfo, nullptr, &ssaoPipeline));
-
-  vkDestroyShaderModule(device, ssaoShaders[0].module, nullptr);
-  vkDestroyShaderModule(device, ssaoShaders[1].module, nullptr);
-
-  // === SSAO Blur Pipeline ===
-  VkPipelineLayoutCreateInfo blurLayoutInfo{};
-  blurLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  blurLayoutInfo.setLayoutCount = 1;
-  blurLayoutInfo.pSetLayouts = &ssaoElements.ssaoBlurDescriptorSetLayout;
-
-  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &blurLayoutInfo, nullptr, &ssaoElements.ssaoBlurPipelineLayout));
-
-  VkPipelineShaderStageCreateInfo blurShaders[] = {loadShader(std::string(SHADER_DIR) + "/deferredShaders/ssao_blur.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
-                                                   loadShader(std::string(SHADER_DIR) + "/deferredShaders/ssao_blur.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)};
-
-  VkGraphicsPipelineCreateInfo blurPipelineInfo = ssaoPipelineInfo;
-  blurPipelineInfo.pStages = blurShaders;
-  blurPipelineInfo.layout = ssaoElements.ssaoBlurPipelineLayout;
-  blurPipelineInfo.renderPass = ssaoElements.ssaoBlurRenderPass;
+  VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4)};
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &shadowPipelineLayout));
 
-  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &blurPipelineInfo, nullptr, &ssaoBlurPipeline));
+  VkPipelineShaderStageCreateInfo shaderStage = loadShader(std::string(SHADER_DIR) + "/deferredShaders/shadow_caster.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+  VkGraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount = 1;
+  pipelineInfo.pStages = &shaderStage;
+  pipelineInfo.pVertexInputState = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = shadowPipelineLayout;
+  pipelineInfo.renderPass = shadowCascades->renderPass();
+  pipelineInfo.subpass = 0;
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shadowPipeline));
+  vkDestroyShaderModule(device, shaderStage.module, nullptr);
+}
 
-  vkDestroyShaderModule(device, blurShaders[0].module, nullptr);
-  vkDestroyShaderModule(device, blurShaders[1].module, nullptr);
+void DeferredTriangleScene::recordShadowCasters(VkCommandBuffer commandBuffer, u32 cascade, bool staticCasters) {
+  if (!staticCasters) {
+    return;
+  }
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline);
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, &offset);
+  vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+  // Model matrix is the identity
+  const glm::mat4& clipFromModel = shadowCascades->cascade(cascade).viewProj;
+  vkCmdPushConstants(commandBuffer, shadowPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &clipFromModel);
+  for (const ShadowCaster& caster : shadowCasters) {
+    if (shadowCascades->casterVisible(cascade, caster.min, caster.max)) {
+      vkCmdDrawIndexed(commandBuffer, caster.indexCount, 1, caster.firstIndex, 0, 0);
+    }
+  }
+}
 
-  spdlog::info("SSAO pipelines created successfully");
+void DeferredTriangleScene::addBox(const glm::vec3& center, const glm::vec3& halfExtent) {
+  shadowCasters.push_back({static_cast<uint32_t>(indices.size()), 36, center - halfExtent, center + halfExtent});
+  const glm::vec3 axes[3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  const glm::vec2 corners[4] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+  for (int axis = 0; axis < 3; axis++) {
+    for (float sign : {1.0f, -1.0f}) {
+      // u x v = normal, so the faces wind like the test quad
+      const glm::vec3 normal = axes[axis] * sign;
+      glm::vec3 u = axes[(axis + 1) % 3];
+      glm::vec3 v = axes[(axis + 2) % 3];
+      if (sign < 0.0f) {
+        std::swap(u, v);
+      }
+      const uint16_t base = static_cast<uint16_t>(vertices.size());
+      for (const glm::vec2& corner : corners) {
+        vertices.push_back({center + halfExtent * (normal + corner.x * u + corner.y * v), normal, (corner + 1.0f) * 0.5f});
+      }
+      for (uint16_t index : {0, 1, 2, 2, 3, 0}) {
+        indices.push_back(static_cast<uint16_t>(base + index));
+      }
+    }
+  }
 }
+
 void DeferredTriangleScene::createLightingPipeline() {
   spdlog::info("Creating lighting pipeline");
 
@@ -387,8 +408,8 @@ void DeferredTriangleScene::createLightingPipeline() {
   pipelineInfo.pColorBlendState = &colorBlending;
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = lightingPass.pipelineLayout;
-  pipelineInfo.renderPass = lightingPass.renderPass;
-  pipelineInfo.subpass = 0;
+  pipelineInfo.renderPass = gBuffer.renderPass;
+  pipelineInfo.subpass = GBuffer::LIGHTING_SUBPASS;
 
   VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &lightingPass.pipeline));
 
@@ -398,7 +419,7 @@ void DeferredTriangleScene::createLightingPipeline() {
   spdlog::info("Lighting pipeline created successfully");
 }
 
-void DeferredTriangleScene::recordGeometryCommands(VkCommandBuffer commandBuffer) {
+void DeferredTriangleScene::recordGeometryCommands(VkCommandBuffer commandBuffer, VkPipeline pipeline) {
   // Set viewport and scissor
   VkViewport viewport{};
   viewport.x = 0.0f;
@@ -414,8 +435,8 @@ void DeferredTriangleScene::recordGeometryCommands(VkCommandBuffer commandBuffer
   scissor.extent = swapChainExtent;
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-  // Bind geometry pipeline
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gBuffer.pipeline);
+  // Bind prepass or G-Buffer pipeline, both use geometryPipelineLayout
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
   // Bind vertex and index buffers
   VkBuffer vertexBuffers[] = {vertexBuffer.buffer};
@@ -554,29 +575,21 @@ void DeferredTriangleScene::createDescriptorSets() {
     //=================Lighting=======
     {
       // layout
-      std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
-      // 0:normal+metalic from Gbuffer
+      std::array<VkDescriptorSetLayoutBinding, 11> bindings{};
+      // 0:octahedral normal from Gbuffer
       bindings[0].binding = 0;
       bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
       bindings[0].descriptorCount = 1;
       bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-      // 1:Albedo+AO
-      bindings[1].binding = 1;
-      bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      bindings[1].descriptorCount = 1;
-      bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-      // 2:Material
-      bindings[2].binding = 2;
-      bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      bindings[2].descriptorCount = 1;
-      bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-      // 3:depth
-      bindings[3].binding = 3;
-      bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      bindings[3].descriptorCount = 1;
-      bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-      // 4: SSAO Blurred
+      // 1:Albedo+AO, 2:Material, 3:depth as input attachments of the lighting subpass
+      for (uint32_t b = 1; b < 4; b++) {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+      }
+
+      // 4: SSAO (upsampled)
       bindings[4].binding = 4;
       bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
       bindings[4].descriptorCount = 1;
@@ -588,6 +601,22 @@ void DeferredTriangleScene::createDescriptorSets() {
       bindings[5].descriptorCount = 1;
       bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+      // 6: Point lights, 7: cluster light lists (light_cull.comp)
+      for (uint32_t b = 6; b < 8; b++) {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+      }
+
+      // 8: Shadow UBO, 9: shadow map with comparison, 10: shadow map depth (written by the base)
+      for (uint32_t b = 8; b < 11; b++) {
+        bindings[b].binding = b;
+        bindings[b].descriptorType = b == 8 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[b].descriptorCount = 1;
+        bindings[b].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+      }
+
       VkDescriptorSetLayoutCreateInfo layoutInfo{};
       layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
       layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -617,37 +646,28 @@ void DeferredTriangleScene::updateLightingDescriptorSets() {
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     std::array<VkDescriptorImageInfo, 5> imageInfos{};
 
-    // G-Buffer textures
-    imageInfos[0] = {gBuffer.normal[i].sampler, gBuffer.normal[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[1] = {gBuffer.albedo[i].sampler, gBuffer.albedo[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[2] = {gBuffer.material[i].sampler, gBuffer.material[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-    imageInfos[3] = {gBuffer.depthBuffer[i].sampler, gBuffer.depthBuffer[i].imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
-    imageInfos[4] = {ssaoElements.ssaoBlurred[i].sampler, ssaoElements.ssaoBlurred[i].imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = lightingPass.uboBuffer[i].buffer;
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(LightingPass::LightUBO);
+    // G-Buffer: normal is sampled, albedo, material and depth are input attachments (no sampler)
+    imageInfos[0] = {gBuffer.normal.sampler, gBuffer.normal.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[1] = {VK_NULL_HANDLE, gBuffer.albedo.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[2] = {VK_NULL_HANDLE, gBuffer.material.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[3] = {VK_NULL_HANDLE, gBuffer.depthBuffer.imageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    imageInfos[4] = {renderGraph->texture(ssaoElements.ssaoFull).sampler, renderGraph->texture(ssaoElements.ssaoFull).imageView,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
-    std::array<VkWriteDescriptorSet, 6> writes{};
+    std::array<VkWriteDescriptorSet, 5> writes{};
 
     for (uint32_t j = 0; j < 5; j++) {
       writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
       writes[j].dstSet = lightingPass.descriptorSet[i];
       writes[j].dstBinding = j;
-      writes[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      writes[j].descriptorType = (j >= 1 && j <= 3) ? VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
       writes[j].descriptorCount = 1;
       writes[j].pImageInfo = &imageInfos[j];
     }
 
-    writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[5].dstSet = lightingPass.descriptorSet[i];
-    writes[5].dstBinding = 5;
-    writes[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    writes[5].descriptorCount = 1;
-    writes[5].pBufferInfo = &bufferInfo;
-
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    // 5-10: light UBO, point lights, clusters, shadow UBO and maps
+    writeLightingBufferDescriptors(static_cast<uint32_t>(i));
   }
 }
 
@@ -662,60 +682,43 @@ void DeferredTriangleScene::updateUniformBuffer() {
   bufferManager->updateBuffer(uniformBuffers[currentFrame], &ubo, sizeof(ubo), 0);
 }
 
-void DeferredTriangleScene::updateSSAOParams() {
-  SsaoElements::SsaoParamsUBO params{};
-  float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
-  params.projection = camera.getProjectionMatrix(aspectRatio);
-  // FIX: Precompute inverse projection on CPU instead of per-fragment in shader.
-  // The SSAO shader was calling inverse(params.projection) 65 times per pixel
-  // (once per fragment + once per kernel sample in reconstructViewPos).
-  params.invProjection = glm::inverse(params.projection);
-  params.nearPlane = 0.1f;
-  params.farPlane = 100.0f;
-  params.noiseScale = glm::vec2(swapChainExtent.width / static_cast<float>(SsaoElements::SSAO_NOISE_DIM), swapChainExtent.height / static_cast<float>(SsaoElements::SSAO_NOISE_DIM));
-
-  bufferManager->updateBuffer(ssaoElements.ssaoParamsUBO[currentFrame], &params, sizeof(params), 0);
-}
-
 void DeferredTriangleScene::updateScene(float deltaTime) {
   updateOverlay(deltaTime);
   updateUniformBuffer();
-  updateSSAOParams();
-  updateLightingUBO();
+  updateBenchmarkLights(deltaTime);
 }
-void DeferredTriangleScene::createLightingUBOs() {
-  lightingPass.uboBuffer.resize(MAX_FRAMES_IN_FLIGHT);
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    lightingPass.uboBuffer[i] = bufferManager->createBuffer(sizeof(LightingPass::LightUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
-  }
+void DeferredTriangleScene::initLights() {
   // Set default sun light
   lightingPass.sunLight.direction = glm::vec4(glm::normalize(glm::vec3(-0.5f, -1.0f, -0.3f)), 0.0f);
   lightingPass.sunLight.color = glm::vec4(1.0f, 0.98f, 0.95f, 3.0f);
-}
-void DeferredTriangleScene::updateLightingUBO() {
-  LightingPass::LightUBO ubo{};
-
-  glm::mat4 view = camera.getViewMatrix();
-  float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
-  glm::mat4 proj = camera.getProjectionMatrix(aspectRatio);
-
-  ubo.invView = glm::inverse(view);
-  ubo.invProj = glm::inverse(proj);
-  ubo.cameraPos = glm::vec4(glm::vec3(glm::inverse(view)[3]), 1.0f);
-
-  ubo.sunLight = lightingPass.sunLight;
 
-  // Copy point lights
-  ubo.numPointLights = static_cast<int>(std::min(lightingPass.pointLights.size(), static_cast<size_t>(LightingPass::MAX_POINT_LIGHTS)));
-  for (int i = 0; i < ubo.numPointLights; i++) {
-    ubo.pointLights[i] = lightingPass.pointLights[i];
+  // Benchmark orbits, the same for every run
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  lightBenchmark.orbits.resize(LightBenchmark::MAX_LIGHTS);
+  for (LightBenchmark::Orbit& orbit : lightBenchmark.orbits) {
+    orbit.center = glm::vec2(unit(rng), unit(rng)) * 36.0f - 18.0f;
+    orbit.radius = 0.5f + unit(rng) * 2.0f;
+    orbit.phase = unit(rng) * glm::two_pi<float>();
+    orbit.speed = (unit(rng) < 0.5f ? -1.0f : 1.0f) * (0.3f + unit(rng));
+    orbit.height = 0.1f + unit(rng) * 0.8f;
+    orbit.color = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + 0.1f);
   }
+}
 
-  ubo.ambientIntensity = lightingPass.ambientIntensity;
-  ubo.ssaoStrength = lightingPass.ssaoStrength;
-
-  bufferManager->updateBuffer(lightingPass.uboBuffer[currentFrame], &ubo, sizeof(ubo), 0);
+void DeferredTriangleScene::updateBenchmarkLights(float deltaTime) {
+  if (lightBenchmark.animate) {
+    lightBenchmark.time += deltaTime;
+  }
+  const float t = lightBenchmark.time;
+  lightingPass.pointLights.resize(static_cast<size_t>(lightBenchmark.lightCount));
+  for (size_t i = 0; i < lightingPass.pointLights.size(); i++) {
+    const LightBenchmark::Orbit& orbit = lightBenchmark.orbits[i];
+    const float angle = orbit.phase + orbit.speed * t;
+    glm::vec3 position(orbit.center + orbit.radius * glm::vec2(std::cos(angle), std::sin(angle)), orbit.height + 0.1f * std::sin(2.0f * angle));
+    lightingPass.pointLights[i].position = glm::vec4(position, lightBenchmark.lightRadius);
+    lightingPass.pointLights[i].color = glm::vec4(orbit.color, lightBenchmark.intensity);
+  }
 }
 
 void DeferredTriangleScene::updateOverlay(float deltaTime) {
@@ -744,27 +747,91 @@ void DeferredTriangleScene::updateOverlay(float deltaTime) {
   if (ImGui::CollapsingHeader("G-Buffer", ImGuiTreeNodeFlags_DefaultOpen)) {
     const float imageSize = 150.0f;
 
-    ImGui::Text("Normal + Metallic:");
+    ImGui::Text("Normal (octahedral):");
     ImGui::Image(normalTexId, ImVec2(imageSize, imageSize));
 
-    ImGui::Text("Albedo + AO:");
-    ImGui::Image(albedoTexId, ImVec2(imageSize, imageSize));
-
-    ImGui::Text("Material (R/M/E):");
-    ImGui::Image(materialTexId, ImVec2(imageSize, imageSize));
-
+    // Albedo and material stay in tile memory and are never stored
     ImGui::Text("Depth:");
     ImGui::Image(depthTexId, ImVec2(imageSize, imageSize));
   }
 
+  if (ImGui::CollapsingHeader("Clustered Lights", ImGuiTreeNodeFlags_DefaultOpen)) {
+    ImGui::SliderInt("Point lights", &lightBenchmark.lightCount, 0, LightBenchmark::MAX_LIGHTS);
+    ImGui::SliderFloat("Light radius", &lightBenchmark.lightRadius, 0.25f, 5.0f);
+    ImGui::SliderFloat("Intensity", &lightBenchmark.intensity, 0.1f, 10.0f);
+    ImGui::Checkbox("Animate", &lightBenchmark.animate);
+    ImGui::Checkbox("Cluster heatmap", &lightingPass.clusterHeatmap);
+    ui->text("Grid: %u x %u x %u clusters", LightingPass::CLUSTER_X, LightingPass::CLUSTER_Y, LightingPass::CLUSTER_Z);
+    ui->text("Max lights per cluster: %u (limit %u)", lightingPass.stats.maxLights, LightingPass::MAX_LIGHTS_PER_CLUSTER);
+    if (lightingPass.stats.overflowClusters > 0) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.2f, 1.0f), "%u clusters dropped lights", lightingPass.stats.overflowClusters);
+    }
+    if (lightingPass.queryPool != VK_NULL_HANDLE) {
+      ui->text("GPU culling: %.3f ms", lightingPass.cullMs);
+      ui->text("GPU lighting + UI: %.3f ms", lightingPass.lightingMs);
+    }
+  }
+
   if (ImGui::CollapsingHeader("SSAO", ImGuiTreeNodeFlags_DefaultOpen)) {
     const float imageSize = 150.0f;
 
-    ImGui::Text("SSAO Raw:");
+    int quality = static_cast<int>(ssaoElements.quality);
+    const char* presetNames[SsaoElements::PRESETS.size()];
+    for (size_t i = 0; i < SsaoElements::PRESETS.size(); i++) {
+      presetNames[i] = SsaoElements::PRESETS[i].name;
+    }
+    if (ImGui::Combo("Quality", &quality, presetNames, static_cast<int>(SsaoElements::PRESETS.size()))) {
+      ssaoElements.quality = static_cast<SsaoElements::Quality>(quality);
+    }
+    const int taps = SsaoElements::PRESETS[quality].sampleCount;
+    ui->text("%d taps per pixel, %d kernel samples per 2x2 quad", taps, std::min(taps * 4, SsaoElements::SSAO_KERNEL_SIZE));
+    ImGui::SliderFloat("Radius", &ssaoElements.radius, 0.05f, 2.0f);
+    ImGui::SliderFloat("Intensity##ssao", &ssaoElements.intensity, 0.25f, 4.0f);
+    ImGui::SliderFloat("Strength", &lightingPass.ssaoStrength, 0.0f, 1.0f);
+    if (ssaoElements.queryPool != VK_NULL_HANDLE) {
+      ui->text("GPU SSAO: %.3f ms", ssaoElements.gpuMs);
+    }
+
+    ImGui::Text("SSAO Raw (half):");
     ImGui::Image(ssaoTexId, ImVec2(imageSize, imageSize));
 
-    ImGui::Text("SSAO Blurred:");
+    ImGui::Text("SSAO Blurred (half):");
     ImGui::Image(ssaoBlurredTexId, ImVec2(imageSize, imageSize));
+
+    ImGui::Text("SSAO Upsampled:");
+    ImGui::Image(ssaoFullTexId, ImVec2(imageSize, imageSize));
+  }
+
+  if (ImGui::CollapsingHeader("Shadows", ImGuiTreeNodeFlags_DefaultOpen)) {
+    ShadowCascades::Settings& shadowSettings = shadowCascades->settings;
+    const char* filterNames[] = {"Hard", "PCF", "PCSS"};
+    int filter = static_cast<int>(shadowSettings.filter);
+    if (ImGui::Combo("Filter", &filter, filterNames, 3)) {
+      shadowSettings.filter = static_cast<ShadowCascades::Filter>(filter);
+    }
+    ImGui::SliderFloat("Light angle", &shadowSettings.lightAngle, 0.1f, 5.0f, "%.2f deg");
+    ImGui::SliderFloat("Distance", &shadowSettings.maxDistance, 10.0f, 100.0f);
+    ImGui::SliderFloat("Split lambda", &shadowSettings.splitLambda, 0.0f, 1.0f);
+    ImGui::SliderFloat("Depth bias", &shadowSettings.depthBiasConstant, 0.0f, 8.0f);
+    ImGui::SliderFloat("Slope bias", &shadowSettings.depthBiasSlope, 0.0f, 8.0f);
+    ImGui::SliderFloat("Normal offset", &shadowSettings.normalOffset, 0.0f, 4.0f);
+    ImGui::Checkbox("Cache static casters", &shadowSettings.cacheStatic);
+    ImGui::Checkbox("Show cascades", &shadowSettings.showCascades);
+    for (u32 i = 0; i < ShadowCascades::CASCADE_COUNT; i++) {
+      const ShadowCascades::Cascade& cascade = shadowCascades->cascade(i);
+      ui->text("%u: %.1f-%.1f m, %u casters (%u culled), %u cache updates", i, cascade.splitNear, cascade.splitFar, cascade.casters, cascade.culled,
+               cascade.cacheUpdates);
+      ui->text("   GPU static %.3f ms, dynamic %.3f ms", cascade.staticMs, cascade.dynamicMs);
+    }
+    ui->text("GPU cache copy: %.3f ms (%u tiles)", shadowCascades->copyMs(), shadowCascades->copiedTiles());
+  }
+
+  if (ImGui::CollapsingHeader("Render Graph")) {
+    const RenderGraph::Stats& graphStats = renderGraph->stats();
+    ui->text("Passes: %u (%u culled)", graphStats.passes, graphStats.culledPasses);
+    ui->text("Barriers per frame: %u", graphStats.barriers);
+    ui->text("Transient memory: %.2f MB (%.2f MB without aliasing)", graphStats.heapBytes / (1024.0f * 1024.0f),
+             graphStats.transientBytes / (1024.0f * 1024.0f));
   }
 
   ImGui::End();
@@ -778,6 +845,10 @@ void DeferredTriangleScene::updateOverlay(float deltaTime) {
   ui->updateBuffers();
 }
 
+void DeferredTriangleScene::declareLightingInputs(RenderGraph::Pass& pass) {
+  pass.read(ssaoElements.ssaoOutput, RenderGraph::Usage::FragmentSampled).read(ssaoElements.ssaoBlurred, RenderGraph::Usage::FragmentSampled);
+}
+
 void DeferredTriangleScene::onResize(int width, int height) { spdlog::info("Deferred scene resized to {}x{}", width, height); }
 
 // FIX: Called by base class after swap chain recreation.
@@ -790,12 +861,11 @@ void DeferredTriangleScene::onSwapChainRecreated() {
   updateLightingDescriptorSets();
 
   // Re-register ImGui textures — old handles pointed to destroyed image views
-  normalTexId = ui->addTexture(gBuffer.normal[0].sampler, gBuffer.normal[0].imageView);
-  albedoTexId = ui->addTexture(gBuffer.albedo[0].sampler, gBuffer.albedo[0].imageView);
-  materialTexId = ui->addTexture(gBuffer.material[0].sampler, gBuffer.material[0].imageView);
-  depthTexId = ui->addTexture(gBuffer.depthBuffer[0].sampler, gBuffer.depthBuffer[0].imageView);
-  ssaoTexId = ui->addTexture(ssaoElements.ssaoOutput[0].sampler, ssaoElements.ssaoOutput[0].imageView);
-  ssaoBlurredTexId = ui->addTexture(ssaoElements.ssaoBlurred[0].sampler, ssaoElements.ssaoBlurred[0].imageView);
+  normalTexId = ui->addTexture(gBuffer.normal.sampler, gBuffer.normal.imageView);
+  depthTexId = ui->addTexture(gBuffer.depthBuffer.sampler, gBuffer.depthBuffer.imageView);
+  ssaoTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoOutput).sampler, renderGraph->texture(ssaoElements.ssaoOutput).imageView);
+  ssaoBlurredTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoBlurred).sampler, renderGraph->texture(ssaoElements.ssaoBlurred).imageView);
+  ssaoFullTexId = ui->addTexture(renderGraph->texture(ssaoElements.ssaoFull).sampler, renderGraph->texture(ssaoElements.ssaoFull).imageView);
 }
 
 void DeferredTriangleScene::cleanupResources() {
@@ -817,88 +887,19 @@ void DeferredTriangleScene::cleanupResources() {
   for (auto& buffer : uniformBuffers) {
     bufferManager->destroyBuffer(buffer);
   }
-  // Lighting cleanup
-  for (auto& buffer : lightingPass.uboBuffer) {
-    bufferManager->destroyBuffer(buffer);
-  }
+  // Lighting cleanup, the light buffers belong to the base class
   vkDestroyPipeline(device, lightingPass.pipeline, nullptr);
   vkDestroyPipelineLayout(device, lightingPass.pipelineLayout, nullptr);
   vkDestroyDescriptorSetLayout(device, lightingPass.descriptorLayout, nullptr);
-  // geometry pipeline
+  // geometry pipelines
+  vkDestroyPipeline(device, gBuffer.prepassPipeline, nullptr);
   vkDestroyPipeline(device, gBuffer.pipeline, nullptr);
   vkDestroyPipelineLayout(device, geometryPipelineLayout, nullptr);
-  // ssao
-  vkDestroyPipeline(device, ssaoPipeline, nullptr);
-  vkDestroyPipeline(device, ssaoBlurPipeline, nullptr);
-  vkDestroyPipelineLayout(device, ssaoElements.ssaoPipelineLayout, nullptr);
-  vkDestroyPipelineLayout(device, ssaoElements.ssaoBlurPipelineLayout, nullptr);
+  vkDestroyPipeline(device, shadowPipeline, nullptr);
+  vkDestroyPipelineLayout(device, shadowPipelineLayout, nullptr);
 
   // Clean up descriptor resources
   vkDestroyDescriptorSetLayout(device, geometryDescriptorSetLayout, nullptr);
 
   spdlog::info("Deferred scene resources cleaned up");
 }
-
-void DeferredTriangleScene::recordSSAOCommands(VkCommandBuffer commandBuffer, u32 imageIndex) {
-  // Set viewport and scissor for full-screen pass
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = static_cast<float>(swapChainExtent.width);
-  viewport.height = static_cast<float>(swapChainExtent.height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-  VkRect2D scissor{};
-  scissor.offset = {0, 0};
-  scissor.extent = swapChainExtent;
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-  // Bind SSAO pipeline
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
-
-  // Bind SSAO descriptor sets (depth, normal, noise, kernel, params)
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoElements.ssaoPipelineLayout, 0, 1, &ssaoElements.ssaoDescriptorSets[currentFrame], 0, nullptr);
-
-  // Bind full-screen quad vertex buffer
-  VkBuffer vertexBuffers[] = {fullscreenQuad.vertexBuffer.buffer};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-  vkCmdBindIndexBuffer(commandBuffer, fullscreenQuad.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
-
-  // Draw full-screen quad
-  vkCmdDrawIndexed(commandBuffer, fullscreenQuad.indexCount, 1, 0, 0, 0);
-}
-
-void DeferredTriangleScene::recordSSAOBlurCommands(VkCommandBuffer commandBuffer, u32 imageIndex) {
-  // Set viewport and scissor for full-screen pass
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = static_cast<float>(swapChainExtent.width);
-  viewport.height = static_cast<float>(swapChainExtent.height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-  VkRect2D scissor{};
-  scissor.offset = {0, 0};
-  scissor.extent = swapChainExtent;
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-  // Bind SSAO blur pipeline
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoBlurPipeline);
-
-  // Bind blur descriptor sets (raw SSAO texture)
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoElements.ssaoBlurPipelineLayout, 0, 1, &ssaoElements.ssaoBlurDescriptorSets[currentFrame], 0, nullptr);
-
-  // Bind full-screen quad vertex buffer
-  VkBuffer vertexBuffers[] = {fullscreenQuad.vertexBuffer.buffer};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-  vkCmdBindIndexBuffer(commandBuffer, fullscreenQuad.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
-
-  // Draw full-screen quad
-  vkCmdDrawIndexed(commandBuffer, fullscreenQuad.indexCount, 1, 0, 0, 0);
-}
\ No newline at end of file
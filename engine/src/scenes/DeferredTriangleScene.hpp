@@ -12,11 +12,8 @@ class TAK_API DeferredTriangleScene : public VulkanDeferredBase {
   // Required pure virtual implementations
   void getDescriptorPoolSizes(std::vector<VkDescriptorPoolSize>& poolSizes, uint32_t& maxSets);
   void createGeometryPipeline() override;
-  void createssaoPipeline() override;
   void loadResources() override;
-  void recordGeometryCommands(VkCommandBuffer commandBuffer) override;
-  void recordSSAOCommands(VkCommandBuffer commandBuffer, u32 imageIndex) override;
-  void recordSSAOBlurCommands(VkCommandBuffer commandBuffer, u32 imageIndex) override;
+  void recordGeometryCommands(VkCommandBuffer commandBuffer, VkPipeline pipeline) override;
   void cleanupResources() override;
 
   // Optional overrides
@@ -65,13 +62,28 @@ class TAK_API DeferredTriangleScene : public VulkanDeferredBase {
     }
   };
 
-  // Test triangle with normals, revise to draw two quads
-  const std::vector<Vertex> vertices = {{{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
-                                        {{0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
-                                        {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-                                        {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}}};
-
-  const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0};
+  // Test quad with normals above a floor plane for the light benchmark (z is up), addBox appends the shadow test pillars
+  std::vector<Vertex> vertices = {{{-0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+                                  {{0.5f, -0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
+                                  {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                                  {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+                                  {{-20.0f, -20.0f, -0.01f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+                                  {{20.0f, -20.0f, -0.01f}, {0.0f, 0.0f, 1.0f}, {20.0f, 0.0f}},
+                                  {{20.0f, 20.0f, -0.01f}, {0.0f, 0.0f, 1.0f}, {20.0f, 20.0f}},
+                                  {{-20.0f, 20.0f, -0.01f}, {0.0f, 0.0f, 1.0f}, {0.0f, 20.0f}}};
+
+  std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
+  // Index ranges drawn into the shadow cascades with their world bounds, the floor only receives
+  struct ShadowCaster {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 min;
+    glm::vec3 max;
+  };
+  std::vector<ShadowCaster> shadowCasters = {{0, 6, {-0.5f, -0.5f, 0.0f}, {0.5f, 0.5f, 0.0f}}};
+  void addBox(const glm::vec3& center, const glm::vec3& halfExtent);
+  VkPipelineLayout shadowPipelineLayout = VK_NULL_HANDLE;
+  VkPipeline shadowPipeline = VK_NULL_HANDLE;
 
   // Buffers
   BufferManager::Buffer vertexBuffer;
@@ -89,15 +101,35 @@ class TAK_API DeferredTriangleScene : public VulkanDeferredBase {
   VkDescriptorSetLayout geometryDescriptorSetLayout;
   std::vector<VkDescriptorSet> geometryDescriptorSets;
 
-  // SSAO pipeline resources
-  VkPipeline ssaoPipeline;
-  VkPipeline ssaoBlurPipeline;
-
   // Lighting pass
   void createLightingPipeline() override;
   void recordLightingCommands(VkCommandBuffer commandBuffer) override;
-  void createLightingUBOs();
-  void updateLightingUBO();
+  // The overlay samples the raw and blurred SSAO during the lighting subpass
+  void declareLightingInputs(RenderGraph::Pass& pass) override;
+  // Every caster is static, the scene never moves
+  void recordShadowCasters(VkCommandBuffer commandBuffer, u32 cascade, bool staticCasters) override;
+  void createShadowCasterPipeline();
+  void initLights();
+  void updateBenchmarkLights(float deltaTime);
+
+  // Clustered lighting benchmark: point lights orbiting above the floor
+  struct LightBenchmark {
+    static constexpr int MAX_LIGHTS = 10000;
+    struct Orbit {
+      glm::vec2 center;
+      float radius;
+      float phase;
+      float speed;   // radians per second, negative orbits clockwise
+      float height;
+      glm::vec3 color;
+    };
+    std::vector<Orbit> orbits;  // MAX_LIGHTS, fixed seed
+    int lightCount = 1024;
+    float lightRadius = 1.5f;
+    float intensity = 1.0f;
+    bool animate = true;
+    float time = 0.0f;
+  } lightBenchmark;
 
   // FIX: Extracted so it can be called both during initial setup and after
   //      swap chain recreation (when G-Buffer/SSAO textures are new).
@@ -111,11 +143,10 @@ class TAK_API DeferredTriangleScene : public VulkanDeferredBase {
 
   // ImGui texture IDs for G-Buffer visualization
   ImTextureID normalTexId;
-  ImTextureID albedoTexId;
-  ImTextureID materialTexId;
   ImTextureID depthTexId;
   ImTextureID ssaoTexId;
   ImTextureID ssaoBlurredTexId;
+  ImTextureID ssaoFullTexId;
 
   // Debug info
   float fps = 0.0f;
@@ -129,6 +160,5 @@ class TAK_API DeferredTriangleScene : public VulkanDeferredBase {
   void createUniformBuffers();
   void createDescriptorSets();
   void updateUniformBuffer();
-  void updateSSAOParams();
   void updateOverlay(float deltaTime);
 };
\ No newline at end of file
@@ -174,36 +174,57 @@ void ModelScene::createMaterialBuffer() {
   shaderMaterialBuffer.descriptor.range = bufferSize;
   shaderMaterialBuffer.device = device;
 }
-// We place all the shader data blocks for all meshes (node) into a single buffer
+// We place the transforms of all meshes (node) into a single buffer and their joint palettes into a second one
 // This allows us to use one singular allocation instead of having to do lots of small allocations per mesh
 // The vertex shader then get's the index into this buffer from a push constant set per mesh
+// Palettes are packed back to back and sized to the skin's actual joint count, not MAX_NUM_JOINTS
 void ModelScene::createMeshDataBuffer() {
   shaderMeshDataBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  std::vector<ShaderMeshData> shaderMeshData{};
+  jointPaletteBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  uploadedMeshVersions.resize(MAX_FRAMES_IN_FLIGHT);
+  meshes.clear();
   for (auto& node : scene.linearNodes) {
-    ShaderMeshData meshData{};
     if (node->mesh) {
-      memcpy(meshData.jointMatrix, node->mesh->jointMatrix.data(), sizeof(glm::mat4) * MAX_NUM_JOINTS);
-      meshData.jointCount = node->mesh->jointcount;
-      meshData.matrix = node->mesh->matrix;
-      shaderMeshData.push_back(meshData);
+      if (node->mesh->index >= meshes.size()) {
+        meshes.resize(node->mesh->index + 1, nullptr);
+      }
+      meshes[node->mesh->index] = node->mesh;
     }
   }
-  for (auto& shaderMeshDataBuffer : shaderMeshDataBuffers) {
-    if (shaderMeshDataBuffer.buffer != VK_NULL_HANDLE) {
-      bufferManager->destroyBuffer(shaderMeshDataBuffer);
+  std::vector<ShaderMeshData> shaderMeshData(meshes.size());
+  std::vector<glm::mat4> jointPalette;
+  jointPaletteOffsets.assign(meshes.size(), 0);
+  for (tak::Mesh* mesh : meshes) {
+    jointPaletteOffsets[mesh->index] = static_cast<uint32_t>(jointPalette.size());
+    jointPalette.insert(jointPalette.end(), mesh->jointMatrix.begin(), mesh->jointMatrix.begin() + mesh->jointcount);
+    shaderMeshData[mesh->index].matrix = mesh->matrix;
+    shaderMeshData[mesh->index].jointOffset = jointPaletteOffsets[mesh->index];
+    shaderMeshData[mesh->index].jointCount = mesh->jointcount;
+  }
+  if (jointPalette.empty()) {
+    jointPalette.push_back(glm::mat4(1.0f));  // zero sized buffers are not allowed
+  }
+  VkDeviceSize meshDataSize = shaderMeshData.size() * sizeof(ShaderMeshData);
+  VkDeviceSize jointPaletteSize = jointPalette.size() * sizeof(glm::mat4);
+  for (size_t i = 0; i < shaderMeshDataBuffers.size(); i++) {
+    if (shaderMeshDataBuffers[i].buffer != VK_NULL_HANDLE) {
+      bufferManager->destroyBuffer(shaderMeshDataBuffers[i]);
+      bufferManager->destroyBuffer(jointPaletteBuffers[i]);
     }
-    // create buffer
-    VkDeviceSize bufferSize = shaderMeshData.size() * sizeof(ShaderMeshData);
-    shaderMeshDataBuffer =
-        bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    // create buffers
+    shaderMeshDataBuffers[i] =
+        bufferManager->createBuffer(meshDataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    bufferManager->updateBuffer(shaderMeshDataBuffers[i], shaderMeshData.data(), meshDataSize, 0);
+    jointPaletteBuffers[i] =
+        bufferManager->createBuffer(jointPaletteSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
-    bufferManager->updateBuffer(shaderMeshDataBuffer, shaderMeshData.data(), bufferSize, 0);
-    // Update descriptor
-    shaderMeshDataBuffer.descriptor.buffer = shaderMeshDataBuffer.buffer;
-    shaderMeshDataBuffer.descriptor.offset = 0;
-    shaderMeshDataBuffer.descriptor.range = bufferSize;
-    shaderMeshDataBuffer.device = device;
+    bufferManager->updateBuffer(jointPaletteBuffers[i], jointPalette.data(), jointPaletteSize, 0);
+    // Both buffers now hold the current state of every mesh
+    uploadedMeshVersions[i].resize(meshes.size());
+    for (tak::Mesh* mesh : meshes) {
+      uploadedMeshVersions[i][mesh->index] = mesh->version;
+    }
   }
 }
 
@@ -229,8 +250,8 @@ void ModelScene::setupDescriptors() {
   uint32_t sceneUBOCount = 1 * MAX_FRAMES_IN_FLIGHT;
   // Material descriptors: 5 image samplers per material
   uint32_t materialImageSamplerCount = 5 * materialCount;
-  // Mesh data descriptors: 1 storage buffer per frame
-  uint32_t meshDataStorageBufferCount = 1 * MAX_FRAMES_IN_FLIGHT;
+  // Mesh data descriptors: transforms + joint palettes per frame
+  uint32_t meshDataStorageBufferCount = 2 * MAX_FRAMES_IN_FLIGHT;
   // Material buffer: 1 storage buffer (shared)
   uint32_t materialStorageBufferCount = 1;
 
@@ -398,8 +419,10 @@ void ModelScene::setupDescriptors() {
 
     // Mesh data buffer
     {
+      // binding 0: per-mesh transforms, 1: packed joint palettes
       std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
           {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+          {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
       };
       VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
       descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -415,14 +438,17 @@ void ModelScene::setupDescriptors() {
         descriptorSetAllocInfo.descriptorSetCount = 1;
         vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &descriptorSetsMeshData[i]);
 
-        VkWriteDescriptorSet writeDescriptorSet{};
-        writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writeDescriptorSet.descriptorCount = 1;
-        writeDescriptorSet.dstSet = descriptorSetsMeshData[i];
-        writeDescriptorSet.dstBinding = 0;
-        writeDescriptorSet.pBufferInfo = &shaderMeshDataBuffers[i].descriptor;
-        vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+        writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writeDescriptorSets[0].descriptorCount = 1;
+        writeDescriptorSets[0].dstSet = descriptorSetsMeshData[i];
+        writeDescriptorSets[0].dstBinding = 0;
+        writeDescriptorSets[0].pBufferInfo = &shaderMeshDataBuffers[i].descriptor;
+        writeDescriptorSets[1] = writeDescriptorSets[0];
+        writeDescriptorSets[1].dstBinding = 1;
+        writeDescriptorSets[1].pBufferInfo = &jointPaletteBuffers[i].descriptor;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
       }
     }
   }
@@ -491,9 +517,13 @@ void ModelScene::updateScene(float deltaTime) {
     if (animationTimer > scene.animations[animationIndex].end) {
       animationTimer -= scene.animations[animationIndex].end;
     }
-    modelManager->updateAnimation(scene, animationIndex, animationTimer);
-    updateMeshDataBuffer(currentFrame);
+    // Same transform chain as pbr.vert, the y flip comes after the model matrix
+    glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+    glm::mat4 clipFromModel = uboMatrices.projection * uboMatrices.view * flipY * uboMatrices.model;
+    modelManager->updateAnimationLod(scene, animationIndex, animationTimer, deltaTime, clipFromModel, animationLod);
   }
+  // Has to run every frame so each frame in flight catches up on earlier changes
+  updateMeshDataBuffer(currentFrame);
 }
 
 void ModelScene::createModelPipeline(const std::string& prefix) {
@@ -582,7 +612,7 @@ void ModelScene::createModelPipeline(const std::string& prefix) {
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
   depthStencil.depthWriteEnable = VK_TRUE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;  // reverse-Z
   depthStencil.depthBoundsTestEnable = VK_FALSE;
   depthStencil.stencilTestEnable = VK_FALSE;
 
@@ -663,24 +693,25 @@ void ModelScene::createModelPipeline(const std::string& prefix) {
   spdlog::info("Model pipeline created successfully");
 }
 
-void ModelScene::updateMeshDataBuffer(uint32_t index) {  // @todo: optimize (no push, use fixed size)
-  std::vector<ShaderMeshData> shaderMeshData;
-  std::map<uint32_t, ShaderMeshData> meshDataMap;
-  for (auto& node : scene.linearNodes) {
-    if (node->mesh) {
-      ShaderMeshData meshData{};
-      memcpy(meshData.jointMatrix, node->mesh->jointMatrix.data(), sizeof(glm::mat4) * MAX_NUM_JOINTS);
-      meshData.jointCount = node->mesh->jointcount;
-      meshData.matrix = node->mesh->matrix;
-      meshDataMap[node->mesh->index] = meshData;
+void ModelScene::updateMeshDataBuffer(uint32_t index) {
+  // Only write meshes whose transforms changed since this frame in flight last used its buffers
+  std::vector<uint32_t>& uploaded = uploadedMeshVersions[index];
+  for (tak::Mesh* mesh : meshes) {
+    if (uploaded[mesh->index] == mesh->version) {
+      continue;
     }
+    ShaderMeshData meshData{};
+    meshData.matrix = mesh->matrix;
+    meshData.jointOffset = jointPaletteOffsets[mesh->index];
+    meshData.jointCount = mesh->jointcount;
+    bufferManager->updateBuffer(shaderMeshDataBuffers[index], &meshData, sizeof(ShaderMeshData),
+                                mesh->index * sizeof(ShaderMeshData));
+    if (mesh->jointcount > 0) {
+      bufferManager->updateBuffer(jointPaletteBuffers[index], mesh->jointMatrix.data(), mesh->jointcount * sizeof(glm::mat4),
+                                  jointPaletteOffsets[mesh->index] * sizeof(glm::mat4));
+    }
+    uploaded[mesh->index] = mesh->version;
   }
-  // Convert map to vector in correct order
-  for (const auto& [idx, data] : meshDataMap) {
-    shaderMeshData.push_back(data);
-  }
-  VkDeviceSize bufferSize = shaderMeshData.size() * sizeof(ShaderMeshData);
-  bufferManager->updateBuffer(shaderMeshDataBuffers[index], shaderMeshData.data(), bufferSize, 0);
 }
 
 void ModelScene::cleanupResources() {
@@ -694,6 +725,7 @@ void ModelScene::cleanupResources() {
     bufferManager->destroyBuffer(ub.params);
   }
   for (auto& buf : shaderMeshDataBuffers) bufferManager->destroyBuffer(buf);
+  for (auto& buf : jointPaletteBuffers) bufferManager->destroyBuffer(buf);
   bufferManager->destroyBuffer(shaderMaterialBuffer);
 
   // Destroy descriptor layouts and pool
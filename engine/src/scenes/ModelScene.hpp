@@ -74,13 +74,17 @@ class TAK_API ModelScene : public VulkanBase {
     float emissiveStrength;
   };
   BufferManager::Buffer shaderMaterialBuffer;
-  // Mesh data SSBO (per-mesh transforms, skinning)
+  // Mesh data SSBO (per-mesh transforms), joint palettes live in a separate packed pool
   struct alignas(16) ShaderMeshData {
     glm::mat4 matrix;
-    glm::mat4 jointMatrix[MAX_NUM_JOINTS];
-    uint32_t jointCount;
+    uint32_t jointOffset{0};  // first mat4 of this mesh in the joint palette pool
+    uint32_t jointCount{0};
   };
   std::vector<BufferManager::Buffer> shaderMeshDataBuffers;  // One per frame
+  std::vector<BufferManager::Buffer> jointPaletteBuffers;    // One per frame, sized to the sum of actual joint counts
+  std::vector<tak::Mesh*> meshes;                            // By mesh index
+  std::vector<uint32_t> jointPaletteOffsets;                 // By mesh index
+  std::vector<std::vector<uint32_t>> uploadedMeshVersions;   // [frame][mesh index] = tak::Mesh::version last written
   // ============= Descriptors =============
   // Descriptor layouts
   struct DescriptorSetLayouts {
@@ -116,6 +120,7 @@ class TAK_API ModelScene : public VulkanBase {
   int32_t animationIndex = 0;
   float animationTimer = 0.0f;
   bool animate = true;
+  ModelManager::AnimationLodState animationLod;
 
   // ============= defines =============
   enum PBRWorkflows { PBR_WORKFLOW_METALLIC_ROUGHNESS = 0, PBR_WORKFLOW_SPECULAR_GLOSSINESS = 1 };
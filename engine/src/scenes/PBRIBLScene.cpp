@@ -2,203 +2,1343 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
 #include "core/utils.hpp"
 
 void PBRIBLScene::loadResources() {
   uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
   descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
   shaderMeshDataBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  jointPaletteBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  uploadedMeshVersions.resize(MAX_FRAMES_IN_FLIGHT);
   descriptorSetsMeshData.resize(MAX_FRAMES_IN_FLIGHT);
   // Initialize PBR environment resources in base class
   initializePBREnvironment();
   emptyTexture = textureManager->createDefault();
 
-  loadAssets();  // Scene and environment loading entry point
-  prepareUniformBuffers();
-  setupDescriptors();
+  loadAssets();  // Scene and environment loading entry point
+  prepareUniformBuffers();
+  createShadowCascades();
+  setupDescriptors();
+  createComputeSkinning();
+  createMeshletCulling();
+  createDepthPrepass();
+
+  ui = new UI(textureManager, renderPass, msaaSamples, std::string(SHADER_DIR), window, 2);
+  // Streamed textures replace their image views, every frame then owns its preview sets and rewrites them with its material sets
+  imguiTexIds.resize(MAX_FRAMES_IN_FLIGHT);
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    for (auto& tex : models.scene.textures) {
+      imguiTexIds[frame].push_back(textureStreamer ? ui->createTexture(tex.sampler, tex.imageView) : ui->addTexture(tex.sampler, tex.imageView));
+    }
+  }
+}
+
+void PBRIBLScene::createPipeline() {
+  // Create the pipeline layout ONCE here
+  spdlog::info("Creating pipelines - current count: {}", pipelines.size());
+  const std::vector<VkDescriptorSetLayout> setLayouts = {descriptorSetLayouts.scene, descriptorSetLayouts.material,
+                                                         descriptorSetLayouts.meshDataBuffer,
+                                                         descriptorSetLayouts.materialBuffer};
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutCI.pSetLayouts = setLayouts.data();
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.size = sizeof(MeshPushConstantBlock);
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayout));
+  createSkyboxPipeline();
+  // PBR pipelines
+  addPipelineSet("pbr", std::string(SHADER_DIR) + "/pbribl.vert.spv", std::string(SHADER_DIR) + "/material_pbr.frag.spv");
+  // KHR_materials_unlit
+  addPipelineSet("unlit", std::string(SHADER_DIR) + "/pbribl.vert.spv",
+                 std::string(SHADER_DIR) + "/material_unlit.frag.spv");
+  // Same sets for vertices already skinned by the compute pre-pass
+  addPipelineSet("pbr_preskinned", std::string(SHADER_DIR) + "/pbribl.vert.spv",
+                 std::string(SHADER_DIR) + "/material_pbr.frag.spv", true);
+  addPipelineSet("unlit_preskinned", std::string(SHADER_DIR) + "/pbribl.vert.spv",
+                 std::string(SHADER_DIR) + "/material_unlit.frag.spv", true);
+  // Compressed tak::PackedVertex streams
+  addPipelineSet("pbr_packed", std::string(SHADER_DIR) + "/pbrIbl_packed.vert.spv",
+                 std::string(SHADER_DIR) + "/material_pbr.frag.spv", false, true);
+  addPipelineSet("unlit_packed", std::string(SHADER_DIR) + "/pbrIbl_packed.vert.spv",
+                 std::string(SHADER_DIR) + "/material_unlit.frag.spv", false, true);
+  // Depth pre-pass, shared by lit and unlit materials
+  addDepthPrepassPipelines("depth");
+  addDepthPrepassPipelines("depth_preskinned", true);
+  addDepthPrepassPipelines("depth_packed", false, true);
+  // Shadow casters, same vertex inputs
+  addDepthPrepassPipelines("shadow", false, false, true);
+  addDepthPrepassPipelines("shadow_preskinned", true, false, true);
+  addDepthPrepassPipelines("shadow_packed", false, true, true);
+  createTransparencyComposite();
+  createComputeSkinningPipeline();
+  createMeshletCullingPipeline();
+}
+
+void PBRIBLScene::recordPreRenderPassCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+  recordEnvironmentUpdate(commandBuffer);
+  if (boundEnvironmentVersions[currentFrame] != pbrEnvironment.version) {
+    updateEnvironmentDescriptors(currentFrame);
+  }
+  if (textureStreamer) {
+    textureStreamer->recordUpdates(commandBuffer);
+    if (boundTextureVersions[currentFrame] != textureStreamer->version()) {
+      writeMaterialDescriptors(currentFrame);
+      for (size_t i = 0; i < imguiTexIds[currentFrame].size(); i++) {
+        ui->updateTexture(imguiTexIds[currentFrame][i], models.scene.textures[i].sampler, models.scene.textures[i].imageView);
+      }
+    }
+  }
+  computeSkinning.recordedWithCompute[currentFrame] = computeSkinning.enabled;
+  if (computeSkinning.queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, computeSkinning.queryPool, currentFrame * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, computeSkinning.queryPool, currentFrame * 2);
+  }
+  if (depthPrepass.queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, depthPrepass.queryPool, currentFrame, 1);
+  }
+  recordMeshletCulling(commandBuffer);
+  if (computeSkinning.enabled && !computeSkinning.primitives.empty()) {
+    recordComputeSkinning(commandBuffer);
+  }
+  // After skinning, the casters fetch the skinned vertices
+  recordShadowCascades(commandBuffer);
+}
+
+void PBRIBLScene::recordComputeSkinning(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeSkinning.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeSkinning.pipelineLayout, 0, 1,
+                          &computeSkinning.descriptorSets[currentFrame], 0, nullptr);
+
+  SkinningPushConstantBlock pushConstantBlock = skinningPushConstants();
+  pushConstantBlock.skinned = 1;
+  for (auto& [mesh, primitive] : computeSkinning.primitives) {
+    pushConstantBlock.meshIndex = mesh->index;
+    pushConstantBlock.firstVertex = primitive->firstVertex;
+    pushConstantBlock.vertexCount = primitive->vertexCount;
+    vkCmdPushConstants(commandBuffer, computeSkinning.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SkinningPushConstantBlock), &pushConstantBlock);
+    vkCmdDispatch(commandBuffer, (primitive->vertexCount + 63) / 64, 1, 1);
+  }
+
+  // Skinned vertices are fetched by every draw that follows
+  VkBufferMemoryBarrier bufferBarrier{};
+  bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = computeSkinning.vertexBuffers[currentFrame].buffer;
+  bufferBarrier.offset = 0;
+  bufferBarrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr,
+                       1, &bufferBarrier, 0, nullptr);
+}
+
+void PBRIBLScene::recordRenderCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+  boundPipeline = VK_NULL_HANDLE;
+  // Render pass is already begun in base class recordCommandBuffer()
+  // Just need to bind pipeline and draw
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(swapChainExtent.width);
+  viewport.height = static_cast<float>(swapChainExtent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  VkRect2D scissor{};
+  scissor.offset = {0, 0};
+  scissor.extent = swapChainExtent;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  boundPipeline = VK_NULL_HANDLE;
+  bindSceneBuffers(commandBuffer);
+
+  // Depth of the opaque and masked primitives, the shaded draws below only pass where they match it
+  depthPrepass.recordedWithPrepass[currentFrame] = depthPrepass.enabled;
+  if (depthPrepass.enabled) {
+    for (auto node : models.scene.nodes) {
+      renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_OPAQUE, true);
+    }
+    for (auto node : models.scene.nodes) {
+      renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_MASK, true);
+    }
+  }
+
+  renderedTriangles = 0;
+  fullTriangles = 0;
+  if (depthPrepass.queryPool != VK_NULL_HANDLE) {
+    vkCmdBeginQuery(commandBuffer, depthPrepass.queryPool, currentFrame, 0);
+  }
+  // Opaque primitives first
+  for (auto node : models.scene.nodes) {
+    renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_OPAQUE);
+  }
+  // Alpha masked primitives
+  for (auto node : models.scene.nodes) {
+    renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_MASK);
+  }
+  // Queries cannot span subpasses, the transparency stage may move to the accumulation subpass
+  if (depthPrepass.queryPool != VK_NULL_HANDLE) {
+    vkCmdEndQuery(commandBuffer, depthPrepass.queryPool, currentFrame);
+  }
+  // Skybox after the opaque geometry, it sits at depth 0 (reverse-Z) and only shades the pixels nothing covered
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipelineLayout, 0, 1,
+                          &skyboxDescriptorSets[currentFrame], 0, nullptr);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
+  const VkDeviceSize offsetSkybox[1] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models.skybox.vertices.buffer, offsetSkybox);
+  vkCmdBindIndexBuffer(commandBuffer, models.skybox.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+  for (tak::Node* node : models.skybox.nodes) {
+    modelManager->drawNode(node, commandBuffer);
+  }
+  boundPipeline = VK_NULL_HANDLE;
+  bindSceneBuffers(commandBuffer);
+  // Transparent primitives, ends in the composite subpass
+  recordTransparency(commandBuffer);
+  if (computeSkinning.queryPool != VK_NULL_HANDLE) {
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, computeSkinning.queryPool, currentFrame * 2 + 1);
+  }
+  ui->draw(commandBuffer);
+}
+
+void PBRIBLScene::bindSceneBuffers(VkCommandBuffer commandBuffer) {
+  if (packedVertices && !computeSkinning.enabled) {
+    modelManager->bindPackedVertexBuffers(models.scene, commandBuffer);
+  } else {
+    VkDeviceSize offsets_scene[] = {0};
+    VkBuffer sceneVertexBuffer =
+        computeSkinning.enabled ? computeSkinning.vertexBuffers[currentFrame].buffer : models.scene.vertices.buffer;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &sceneVertexBuffer, offsets_scene);
+  }
+  if (meshletCulling.enabled && models.scene.meshlets.drawCount > 0) {
+    vkCmdBindIndexBuffer(commandBuffer, meshletCulling.indexBuffers[currentFrame].buffer, 0, VK_INDEX_TYPE_UINT32);
+  } else if (models.scene.indices.buffer != VK_NULL_HANDLE) {
+    vkCmdBindIndexBuffer(commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+  }
+}
+
+void PBRIBLScene::renderNode(VkCommandBuffer cmdBuffer, tak::Node* node, uint32_t ImageIndex,
+                             tak::Material::AlphaMode alphaMode, bool depthOnly) {
+  if (node->mesh) {
+    // Render mesh primitives
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (models.scene.materials[primitive->materialIndex].alphaMode == alphaMode) {
+        drawPrimitive(cmdBuffer, node, primitive, alphaMode, depthOnly);
+      }
+    }
+  };
+  for (auto child : node->children) {
+    renderNode(cmdBuffer, child, ImageIndex, alphaMode, depthOnly);
+  }
+}
+
+void PBRIBLScene::drawPrimitive(VkCommandBuffer cmdBuffer, tak::Node* node, tak::Primitive* primitive, tak::Material::AlphaMode alphaMode,
+                                bool depthOnly) {
+  std::string pipelineName = "pbr";
+  std::string pipelineVariant = "";
+
+  if (depthOnly) {
+    pipelineName = "depth";
+  } else if (models.scene.materials[primitive->materialIndex].unlit) {
+    pipelineName = "unlit";
+  }
+  if (computeSkinning.enabled) {
+    pipelineName += "_preskinned";
+  } else if (packedVertices) {
+    pipelineName += "_packed";
+  }
+
+  // Material properties define if we e.g. need to bind a pipeline variant with culling disabled (double sided)
+  if (alphaMode == tak::Material::ALPHAMODE_BLEND) {
+    pipelineVariant = transparency.weightedOIT ? "_oit" : "_alpha_blending";
+  } else {
+    if (depthOnly && alphaMode == tak::Material::ALPHAMODE_MASK) {
+      pipelineVariant = "_mask";
+    }
+    if (models.scene.materials[primitive->materialIndex].doubleSided) {
+      pipelineVariant += "_double_sided";
+    }
+    if (!depthOnly && depthPrepass.enabled) {
+      pipelineVariant += "_depth_equal";
+    }
+  }
+  const VkPipeline pipeline = pipelines[pipelineName + pipelineVariant];
+
+  if (boundPipeline != pipeline) {
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    boundPipeline = pipeline;
+  }
+
+  const std::vector<VkDescriptorSet> descriptorsets = {
+      descriptorSets[currentFrame].scene,                              // set 0
+      materialDescriptorSets[currentFrame][primitive->materialIndex],  // set 1
+      descriptorSetsMeshData[currentFrame],                            // set 2
+      descriptorSetMaterials                                           // set 3
+  };
+  vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0,
+                          static_cast<uint32_t>(descriptorsets.size()), descriptorsets.data(), 0, NULL);
+
+  // Pass material index for this primitive using a push constant, the shader uses this to index into the material
+  // buffer
+  MeshPushConstantBlock pushConstantBlock{};
+  // @todo: index
+  pushConstantBlock.meshIndex = node->mesh->index;
+  pushConstantBlock.materialIndex = models.scene.materials[primitive->materialIndex].materialIndex;
+
+  vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(MeshPushConstantBlock), &pushConstantBlock);
+
+  if (primitive->hasIndices && meshletCulling.enabled && primitive->meshletCount > 0) {
+    // Culled and compacted by recordMeshletCulling, which also picked the LOD
+    vkCmdDrawIndexedIndirect(cmdBuffer, meshletCulling.drawBuffers[currentFrame].buffer,
+                             primitive->meshletDraw * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    uint32_t indexCount = primitive->lods.empty() ? primitive->indexCount : primitive->lods[primitive->currentLod].indexCount;
+    renderedTriangles += indexCount / 3;
+    fullTriangles += primitive->indexCount / 3;
+  } else if (primitive->hasIndices) {
+    uint32_t firstIndex = primitive->firstIndex;
+    uint32_t indexCount = primitive->indexCount;
+    if (!primitive->lods.empty()) {
+      const tak::Primitive::Lod& lod = primitive->lods[selectLod(node, primitive)];
+      firstIndex = lod.firstIndex;
+      indexCount = lod.indexCount;
+    }
+    vkCmdDrawIndexed(cmdBuffer, indexCount, 1, firstIndex, 0, 0);
+    renderedTriangles += indexCount / 3;
+    fullTriangles += primitive->indexCount / 3;
+  } else {
+    vkCmdDraw(cmdBuffer, primitive->vertexCount, 1, 0, 0);
+    renderedTriangles += primitive->vertexCount / 3;
+    fullTriangles += primitive->vertexCount / 3;
+  }
+}
+
+void PBRIBLScene::collectTransparentDraws(tak::Node* node, const glm::mat4& viewFromModel) {
+  if (node->mesh) {
+    glm::mat4 viewFromObject = viewFromModel * node->mesh->matrix;
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (models.scene.materials[primitive->materialIndex].alphaMode != tak::Material::ALPHAMODE_BLEND) {
+        continue;
+      }
+      // Bounding box center, the mesh origin for primitives without one
+      glm::vec3 center = primitive->bb.valid ? (primitive->bb.min + primitive->bb.max) * 0.5f : glm::vec3(0.0f);
+      float viewDepth = -(viewFromObject * glm::vec4(center, 1.0f)).z;
+      transparency.draws.push_back({viewDepth, node, primitive});
+    }
+  }
+  for (auto child : node->children) {
+    collectTransparentDraws(child, viewFromModel);
+  }
+}
+
+void PBRIBLScene::recordTransparency(VkCommandBuffer commandBuffer) {
+  // Same chain as pbrIbl.vert
+  glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+  glm::mat4 viewFromModel = sceneUboMatrices.view * flipY * sceneUboMatrices.model;
+  transparency.draws.clear();
+  for (auto node : models.scene.nodes) {
+    collectTransparentDraws(node, viewFromModel);
+  }
+
+  if (!transparency.weightedOIT) {
+    // Back to front in the scene subpass, primitives at the same depth keep their traversal order
+    std::stable_sort(transparency.draws.begin(), transparency.draws.end(),
+                     [](const TransparentDraw& a, const TransparentDraw& b) { return a.viewDepth > b.viewDepth; });
+    for (const TransparentDraw& draw : transparency.draws) {
+      drawPrimitive(commandBuffer, draw.node, draw.primitive, tak::Material::ALPHAMODE_BLEND);
+    }
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    return;
+  }
+
+  // Unsorted into the accumulation targets, then one fullscreen composite over the scene color
+  vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+  boundPipeline = VK_NULL_HANDLE;
+  for (const TransparentDraw& draw : transparency.draws) {
+    drawPrimitive(commandBuffer, draw.node, draw.primitive, tak::Material::ALPHAMODE_BLEND);
+  }
+  vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+  if (!transparency.draws.empty()) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, transparency.compositePipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, transparency.pipelineLayout, 0, 1, &transparency.descriptorSet,
+                            0, nullptr);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+  }
+}
+
+uint32_t PBRIBLScene::selectLod(const tak::Node* node, tak::Primitive* primitive) {
+  const uint32_t lodCount = static_cast<uint32_t>(primitive->lods.size());
+  if (!meshLodEnabled || lodCount < 2 || !primitive->bb.valid) {
+    primitive->currentLod = 0;
+    return 0;
+  }
+  // Same chain as pbrIbl.vert, the view matrix is rigid so distances in view space are world distances
+  glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+  glm::mat4 worldFromObject = flipY * sceneUboMatrices.model * node->mesh->matrix;
+  float scale = std::max(glm::length(glm::vec3(worldFromObject[0])),
+                         std::max(glm::length(glm::vec3(worldFromObject[1])), glm::length(glm::vec3(worldFromObject[2]))));
+  glm::vec3 center = (primitive->bb.min + primitive->bb.max) * 0.5f;
+  float radius = glm::length(primitive->bb.max - primitive->bb.min) * 0.5f * scale;
+  glm::vec3 viewCenter = glm::vec3(sceneUboMatrices.view * worldFromObject * glm::vec4(center, 1.0f));
+  // Closest point of the bounding sphere, a camera inside it always gets full detail
+  float distance = glm::length(viewCenter) - radius;
+  if (distance <= 0.0f) {
+    primitive->currentLod = 0;
+    return 0;
+  }
+  float pixelsPerUnit = swapChainExtent.height * 0.5f * std::abs(sceneUboMatrices.projection[1][1]) / distance;
+  auto projectedError = [&](uint32_t lod) { return primitive->lods[lod].error * scale * pixelsPerUnit; };
+
+  uint32_t lod = std::min(primitive->currentLod, lodCount - 1);
+  while (lod > 0 && projectedError(lod) > lodErrorThreshold) {
+    lod--;
+  }
+  while (lod + 1 < lodCount && projectedError(lod + 1) < lodErrorThreshold * (1.0f - lodHysteresis)) {
+    lod++;
+  }
+  primitive->currentLod = lod;
+  return lod;
+}
+
+void PBRIBLScene::updateScene(float deltaTime) {
+  readSkinningTimings();
+  readPrepassStatistics();
+  updateOverlay(deltaTime);
+  //  Update UBOs
+  updateUniformData();
+  updateParams();
+  updateShadowCascades();
+  //  update shader buffer
+  bufferManager->updateBuffer(uniformBuffers[currentFrame].scene, &sceneUboMatrices, sizeof(sceneUboMatrices), 0);
+  bufferManager->updateBuffer(uniformBuffers[currentFrame].params, &shaderValuesParams, sizeof(shaderValuesParams), 0);
+  bufferManager->updateBuffer(uniformBuffers[currentFrame].skybox, &uboSkybox, sizeof(uboSkybox), 0);
+
+  // update animation and params
+  if ((animate) && (models.scene.animations.size() > 0)) {
+    animationTimer += deltaTime;
+    if (animationTimer > models.scene.animations[animationIndex].end) {
+      animationTimer -= models.scene.animations[animationIndex].end;
+    }
+    if (animationLodEnabled) {
+      modelManager->updateAnimationLod(models.scene, animationIndex, animationTimer, deltaTime, sceneClipFromModel(), animationLod,
+                                       animationLodSettings);
+    } else {
+      modelManager->updateAnimation(models.scene, animationIndex, animationTimer);
+    }
+  }
+  // Cheap when nothing changed, but has to run every frame so each frame in flight catches up on earlier changes
+  updateMeshDataBuffer(currentFrame);
+  if (textureStreamer) {
+    textureStreamer->update(sceneClipFromModel(), glm::vec2(swapChainExtent.width, swapChainExtent.height));
+  }
+}
+
+glm::mat4 PBRIBLScene::sceneClipFromModel(const glm::mat4& instance) const {
+  // Matches pbrIbl.vert: the y flip is applied after the model matrix
+  glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+  return sceneUboMatrices.projection * sceneUboMatrices.view * flipY * instance * sceneUboMatrices.model;
+}
+
+void PBRIBLScene::runCrowdBenchmark() {
+  if (models.scene.animations.empty()) {
+    spdlog::warn("Crowd benchmark needs an animated scene model");
+    return;
+  }
+  // Instances on a square grid around the scene origin, updateUniformData normalizes the model to ~0.5 units
+  uint32_t instanceCount = static_cast<uint32_t>(crowdBenchmark.instanceCount);
+  uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+  const float spacing = 0.75f;
+  std::vector<glm::mat4> clipFromInstance(instanceCount);
+  for (uint32_t i = 0; i < instanceCount; i++) {
+    glm::vec3 offset((static_cast<float>(i % side) - side * 0.5f) * spacing, 0.0f, (static_cast<float>(i / side) - side * 0.5f) * spacing);
+    clipFromInstance[i] = sceneClipFromModel(glm::translate(glm::mat4(1.0f), offset));
+  }
+
+  const float frameTime = 1.0f / 60.0f;
+  const float animationLength = models.scene.animations[animationIndex].end;
+  auto runPass = [&](bool useLod) {
+    std::vector<ModelManager::AnimationLodState> states(instanceCount);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t frame = 0; frame < crowdBenchmark.frames; frame++) {
+      for (uint32_t i = 0; i < instanceCount; i++) {
+        float time = std::fmod(animationTimer + frame * frameTime + i * 0.37f, animationLength);
+        if (useLod) {
+          crowdBenchmark.evaluated +=
+              modelManager->updateAnimationLod(models.scene, animationIndex, time, frameTime, clipFromInstance[i], states[i], animationLodSettings);
+        } else {
+          modelManager->updateAnimation(models.scene, animationIndex, time);
+        }
+      }
+    }
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (useLod) {
+      crowdBenchmark.offScreen = 0;
+      crowdBenchmark.reducedJoints = 0;
+      for (const auto& state : states) {
+        crowdBenchmark.offScreen += state.visible ? 0 : 1;
+        crowdBenchmark.reducedJoints += (state.visible && state.reducedJoints) ? 1 : 0;
+      }
+    }
+    return elapsedMs / crowdBenchmark.frames;
+  };
+  crowdBenchmark.evaluated = 0;
+  crowdBenchmark.fullRateMs = runPass(false);
+  crowdBenchmark.lodMs = runPass(true);
+  // Instances share the scene's nodes, put the displayed pose back
+  modelManager->updateAnimation(models.scene, animationIndex, animationTimer);
+
+  spdlog::info("Crowd benchmark ({} instances, {} frames): full rate {:.3f} ms/frame, animation LOD {:.3f} ms/frame", instanceCount,
+               crowdBenchmark.frames, crowdBenchmark.fullRateMs, crowdBenchmark.lodMs);
+  spdlog::info("Animation LOD evaluated {} of {} instance updates, last frame: {} off-screen, {} on reduced joints", crowdBenchmark.evaluated,
+               instanceCount * crowdBenchmark.frames, crowdBenchmark.offScreen, crowdBenchmark.reducedJoints);
+}
+
+void PBRIBLScene::updateMeshDataBuffer(uint32_t index) {
+  // Only write meshes whose transforms changed since this frame in flight last used its buffers
+  std::vector<uint32_t>& uploaded = uploadedMeshVersions[index];
+  for (tak::Mesh* mesh : meshes) {
+    if (uploaded[mesh->index] == mesh->version) {
+      continue;
+    }
+    ShaderMeshData meshData{};
+    meshData.matrix = mesh->matrix;
+    meshData.jointOffset = jointPaletteOffsets[mesh->index];
+    meshData.jointcount = mesh->jointcount;
+    bufferManager->updateBuffer(shaderMeshDataBuffers[index], &meshData, sizeof(ShaderMeshData),
+                                mesh->index * sizeof(ShaderMeshData));
+    if (mesh->jointcount > 0) {
+      bufferManager->updateBuffer(jointPaletteBuffers[index], mesh->jointMatrix.data(), mesh->jointcount * sizeof(glm::mat4),
+                                  jointPaletteOffsets[mesh->index] * sizeof(glm::mat4));
+    }
+    uploaded[mesh->index] = mesh->version;
+  }
+}
+
+void PBRIBLScene::createMeshletCulling() {
+  const ModelManager::Model& model = models.scene;
+  if (model.meshlets.drawCount == 0) {
+    meshletCulling.enabled = false;
+    return;
+  }
+  meshletCulling.indexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  meshletCulling.drawBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  meshletCulling.controlBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  meshletCulling.recorded.resize(MAX_FRAMES_IN_FLIGHT, false);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // Ranges of primitives drawn directly (skinned, LOD ranges) keep the copied indices
+    meshletCulling.indexBuffers[i] = bufferManager->createBuffer(
+        model.indices.size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    bufferManager->copyBuffer(model.indices.buffer, meshletCulling.indexBuffers[i].buffer, model.indices.size);
+    meshletCulling.drawBuffers[i] = bufferManager->createBuffer(
+        model.meshlets.drawTemplate.size,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    meshletCulling.controlBuffers[i] =
+        bufferManager->createBuffer((1 + model.meshlets.drawCount) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  }
+
+  // binding 0: meshlets, 1: mesh data, 2: source indices, 3: culled indices, 4: indirect draws, 5: control block
+  std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+  for (uint32_t b = 0; b < 6; b++) {
+    setLayoutBindings.push_back({b, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr});
+  }
+  VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
+  descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
+  descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &meshletCulling.descriptorSetLayout));
+
+  meshletCulling.descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.pSetLayouts = &meshletCulling.descriptorSetLayout;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &meshletCulling.descriptorSets[i]));
+
+    std::array<VkDescriptorBufferInfo, 6> bufferInfos = {model.meshlets.buffer.descriptor,           shaderMeshDataBuffers[i].descriptor,
+                                                         model.indices.descriptor,                   meshletCulling.indexBuffers[i].descriptor,
+                                                         meshletCulling.drawBuffers[i].descriptor, meshletCulling.controlBuffers[i].descriptor};
+    std::array<VkWriteDescriptorSet, 6> writeDescriptorSets{};
+    for (size_t b = 0; b < bufferInfos.size(); b++) {
+      writeDescriptorSets[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writeDescriptorSets[b].descriptorCount = 1;
+      writeDescriptorSets[b].dstSet = meshletCulling.descriptorSets[i];
+      writeDescriptorSets[b].dstBinding = static_cast<uint32_t>(b);
+      writeDescriptorSets[b].pBufferInfo = &bufferInfos[b];
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+  }
+}
+
+void PBRIBLScene::createMeshletCullingPipeline() {
+  if (meshletCulling.descriptorSetLayout == VK_NULL_HANDLE) {
+    return;
+  }
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(MeshletCullPushConstantBlock);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = 1;
+  pipelineLayoutCI.pSetLayouts = &meshletCulling.descriptorSetLayout;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &meshletCulling.pipelineLayout));
+
+  VkComputePipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCI.layout = meshletCulling.pipelineLayout;
+  pipelineCI.stage = loadShader(std::string(SHADER_DIR) + "/meshletcull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+  VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &meshletCulling.pipeline));
+  vkDestroyShaderModule(device, pipelineCI.stage.module, nullptr);
+}
+
+void PBRIBLScene::recordMeshletCulling(VkCommandBuffer commandBuffer) {
+  const ModelManager::Model& model = models.scene;
+  if (meshletCulling.pipeline == VK_NULL_HANDLE) {
+    return;
+  }
+  // The fence of this frame slot has been waited on, its buffers hold the results of the previous submission
+  uint32_t* control = static_cast<uint32_t*>(meshletCulling.controlBuffers[currentFrame].mapped);
+  if (meshletCulling.recorded[currentFrame]) {
+    const auto* draws = static_cast<const VkDrawIndexedIndirectCommand*>(meshletCulling.drawBuffers[currentFrame].mapped);
+    meshletCulling.visibleMeshlets = control[0];
+    meshletCulling.culledTriangles = 0;
+    for (uint32_t i = 0; i < model.meshlets.drawCount; i++) {
+      meshletCulling.culledTriangles += draws[i].indexCount / 3;
+    }
+  }
+  meshletCulling.recorded[currentFrame] = meshletCulling.enabled;
+  if (!meshletCulling.enabled) {
+    return;
+  }
+
+  // LOD per draw with the same projected error metric as the direct draws, read by the shader at execution time
+  control[0] = 0;
+  for (auto node : model.linearNodes) {
+    if (!node->mesh) {
+      continue;
+    }
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (primitive->meshletCount > 0) {
+        control[1 + primitive->meshletDraw] = primitive->lods.empty() ? 0 : selectLod(node, primitive);
+      }
+    }
+  }
+
+  // Reset the indirect commands (indexCount 0), the shader counts the surviving indices into them
+  VkBufferCopy copyRegion{0, 0, model.meshlets.drawTemplate.size};
+  vkCmdCopyBuffer(commandBuffer, model.meshlets.drawTemplate.buffer, meshletCulling.drawBuffers[currentFrame].buffer, 1, &copyRegion);
+  VkMemoryBarrier memoryBarrier{};
+  memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr,
+                       0, nullptr);
+
+  // Mesh matrices map into the space after the scene model matrix and y flip, cull there
+  glm::mat4 clip = sceneClipFromModel();
+  MeshletCullPushConstantBlock pushConstantBlock{};
+  glm::vec4 rows[4];
+  for (int r = 0; r < 4; r++) {
+    rows[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+  }
+  // Left, right, bottom, top, near (reverse-Z: depth <= 1). The far plane is at infinity and never culls
+  const glm::vec4 planes[5] = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] - rows[2]};
+  for (int i = 0; i < 5; i++) {
+    pushConstantBlock.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+  }
+  pushConstantBlock.frustumPlanes[5] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+  pushConstantBlock.cameraPos = glm::inverse(sceneUboMatrices.view * flipY * sceneUboMatrices.model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  pushConstantBlock.meshletCount = static_cast<uint32_t>(model.meshlets.clusters.size());
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCulling.pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCulling.pipelineLayout, 0, 1,
+                          &meshletCulling.descriptorSets[currentFrame], 0, nullptr);
+  vkCmdPushConstants(commandBuffer, meshletCulling.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletCullPushConstantBlock),
+                     &pushConstantBlock);
+  // One workgroup per meshlet, spread over y once x hits the guaranteed group count limit
+  const uint32_t maxGroups = 65535;
+  uint32_t groupsX = std::min(pushConstantBlock.meshletCount, maxGroups);
+  uint32_t groupsY = (pushConstantBlock.meshletCount + maxGroups - 1) / maxGroups;
+  vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+
+  // Indirect commands and compacted indices are consumed by the scene draws, counters are read back on the host
+  memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier,
+                       0, nullptr, 0, nullptr);
+}
+
+void PBRIBLScene::createDepthPrepass() {
+  depthPrepass.recordedWithPrepass.resize(MAX_FRAMES_IN_FLIGHT, false);
+  // One query per frame in flight around the shaded scene draws
+  if (!context->enabledFeatures.pipelineStatisticsQuery) {
+    spdlog::warn("Pipeline statistics queries not supported, shaded fragment counts disabled");
+    return;
+  }
+  VkQueryPoolCreateInfo queryPoolCI{};
+  queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCI.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  queryPoolCI.queryCount = MAX_FRAMES_IN_FLIGHT;
+  queryPoolCI.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+  VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &depthPrepass.queryPool));
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) { vkCmdResetQueryPool(cmd, depthPrepass.queryPool, 0, queryPoolCI.queryCount); });
+}
+
+void PBRIBLScene::addDepthPrepassPipelines(const std::string prefix, bool preSkinned, bool packed, bool shadowCaster) {
+  VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI{};
+  inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssemblyStateCI.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  // Shadow casters draw both sides, the light often sees single sided geometry from behind
+  const VkCullModeFlags cullMode = shadowCaster ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+  VkPipelineRasterizationStateCreateInfo rasterizationStateCI{};
+  rasterizationStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizationStateCI.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizationStateCI.cullMode = cullMode;
+  rasterizationStateCI.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  rasterizationStateCI.lineWidth = 1.0f;
+  rasterizationStateCI.depthBiasEnable = shadowCaster ? VK_TRUE : VK_FALSE;
+
+  // Same subpass as the shaded draws, the color attachment is left alone
+  VkPipelineColorBlendAttachmentState blendAttachmentState{};
+  blendAttachmentState.colorWriteMask = 0;
+  blendAttachmentState.blendEnable = VK_FALSE;
+
+  VkPipelineColorBlendStateCreateInfo colorBlendStateCI{};
+  colorBlendStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlendStateCI.attachmentCount = shadowCaster ? 0 : 1;
+  colorBlendStateCI.pAttachments = &blendAttachmentState;
+
+  VkPipelineDepthStencilStateCreateInfo depthStencilStateCI{};
+  depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencilStateCI.depthTestEnable = VK_TRUE;
+  depthStencilStateCI.depthWriteEnable = VK_TRUE;
+  // Reverse-Z for the camera, the shadow map keeps standard depth
+  depthStencilStateCI.depthCompareOp = shadowCaster ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_GREATER_OR_EQUAL;
+  depthStencilStateCI.front = depthStencilStateCI.back;
+  depthStencilStateCI.back.compareOp = VK_COMPARE_OP_ALWAYS;
+
+  VkPipelineViewportStateCreateInfo viewportStateCI{};
+  viewportStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportStateCI.viewportCount = 1;
+  viewportStateCI.scissorCount = 1;
+
+  VkPipelineMultisampleStateCreateInfo multisampleStateCI{};
+  multisampleStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  if (shadowCaster) {
+    multisampleStateCI.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  } else if (multisampling) {
+    multisampleStateCI.rasterizationSamples = msaaSamples;
+  }
+
+  std::vector<VkDynamicState> dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  if (shadowCaster) {
+    dynamicStateEnables.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+  }
+  VkPipelineDynamicStateCreateInfo dynamicStateCI{};
+  dynamicStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicStateCI.pDynamicStates = dynamicStateEnables.data();
+  dynamicStateCI.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+
+  // Only the attributes depth_prepass.vert reads: position and skin (locations 0, 4, 5), plus the uvs (2, 3) for the
+  // alpha test. With packed vertices that leaves the 12 byte position stream and the 8 byte skin stream
+  VkVertexInputBindingDescription vertexInputBinding = tak::Vertex::getBindingDescription();
+  std::array<VkVertexInputAttributeDescription, 8> vertexInputAttributes = tak::Vertex::getAttributeDescriptions();
+  std::array<VkVertexInputBindingDescription, 4> packedInputBindings =
+      tak::PackedVertex::getBindingDescriptions(models.scene.packed.hasSkin, models.scene.packed.hasColor);
+  std::array<VkVertexInputAttributeDescription, 7> packedInputAttributes = tak::PackedVertex::getAttributeDescriptions();
+  auto selectInputs = [&](bool uvs, std::vector<VkVertexInputBindingDescription>& bindings,
+                          std::vector<VkVertexInputAttributeDescription>& attributes) {
+    auto used = [uvs](uint32_t location) { return location == 0 || location == 4 || location == 5 || (uvs && (location == 2 || location == 3)); };
+    if (packed) {
+      for (const VkVertexInputAttributeDescription& attribute : packedInputAttributes) {
+        if (used(attribute.location)) {
+          attributes.push_back(attribute);
+        }
+      }
+      for (const VkVertexInputBindingDescription& binding : packedInputBindings) {
+        if (binding.binding == 0 || binding.binding == 2 || (uvs && binding.binding == 1)) {
+          bindings.push_back(binding);
+        }
+      }
+    } else {
+      for (const VkVertexInputAttributeDescription& attribute : vertexInputAttributes) {
+        if (used(attribute.location)) {
+          attributes.push_back(attribute);
+        }
+      }
+      bindings.push_back(vertexInputBinding);
+    }
+  };
+  std::vector<VkVertexInputBindingDescription> opaqueBindings, maskBindings;
+  std::vector<VkVertexInputAttributeDescription> opaqueAttributes, maskAttributes;
+  selectInputs(false, opaqueBindings, opaqueAttributes);
+  selectInputs(true, maskBindings, maskAttributes);
+
+  VkPipelineVertexInputStateCreateInfo vertexInputStateCI{};
+  vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputStateCI.vertexBindingDescriptionCount = static_cast<uint32_t>(opaqueBindings.size());
+  vertexInputStateCI.pVertexBindingDescriptions = opaqueBindings.data();
+  vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(opaqueAttributes.size());
+  vertexInputStateCI.pVertexAttributeDescriptions = opaqueAttributes.data();
+
+  // Opaque geometry has no fragment shader at all, masked geometry runs the alpha test only
+  std::array<VkPipelineShaderStageCreateInfo, 3> shaderStages;
+  const std::string vertexShader = std::string(SHADER_DIR) + (shadowCaster ? "/shadow_caster" : "/depth_prepass");
+  shaderStages[0] = loadShader(vertexShader + ".vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+  shaderStages[1] = loadShader(vertexShader + "_mask.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+  shaderStages[2] = loadShader(std::string(SHADER_DIR) + "/depth_prepass_mask.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+  // PRE_SKINNED (constant_id = 0), same as pbrIbl.vert
+  VkBool32 preSkinnedConstant = preSkinned ? VK_TRUE : VK_FALSE;
+  VkSpecializationMapEntry specializationEntry{0, 0, sizeof(VkBool32)};
+  VkSpecializationInfo specializationInfo{1, &specializationEntry, sizeof(VkBool32), &preSkinnedConstant};
+  shaderStages[0].pSpecializationInfo = &specializationInfo;
+  shaderStages[1].pSpecializationInfo = &specializationInfo;
+
+  VkGraphicsPipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineCI.layout = pipelineLayout;
+  pipelineCI.renderPass = shadowCaster ? shadowCascades->renderPass() : renderPass;
+  pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
+  pipelineCI.pVertexInputState = &vertexInputStateCI;
+  pipelineCI.pRasterizationState = &rasterizationStateCI;
+  pipelineCI.pColorBlendState = &colorBlendStateCI;
+  pipelineCI.pMultisampleState = &multisampleStateCI;
+  pipelineCI.pViewportState = &viewportStateCI;
+  pipelineCI.pDepthStencilState = &depthStencilStateCI;
+  pipelineCI.pDynamicState = &dynamicStateCI;
+  pipelineCI.stageCount = 1;
+  pipelineCI.pStages = &shaderStages[0];
+
+  VkPipeline pipeline{};
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+  pipelines[prefix] = pipeline;
+  if (!shadowCaster) {
+    rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
+    VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+    pipelines[prefix + "_double_sided"] = pipeline;
+  }
+
+  // Alpha masked
+  vertexInputStateCI.vertexBindingDescriptionCount = static_cast<uint32_t>(maskBindings.size());
+  vertexInputStateCI.pVertexBindingDescriptions = maskBindings.data();
+  vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(maskAttributes.size());
+  vertexInputStateCI.pVertexAttributeDescriptions = maskAttributes.data();
+  pipelineCI.stageCount = 2;
+  pipelineCI.pStages = &shaderStages[1];
+  rasterizationStateCI.cullMode = cullMode;
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+  pipelines[prefix + "_mask"] = pipeline;
+  if (!shadowCaster) {
+    rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
+    VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+    pipelines[prefix + "_mask_double_sided"] = pipeline;
+  }
+
+  for (auto shaderStage : shaderStages) {
+    vkDestroyShaderModule(device, shaderStage.module, nullptr);
+  }
+}
+
+void PBRIBLScene::readPrepassStatistics() {
+  if (depthPrepass.queryPool == VK_NULL_HANDLE) {
+    return;
+  }
+  // Last submission that used this frame slot, skipped while it is still in flight
+  uint64_t fragmentInvocations = 0;
+  VkResult result = vkGetQueryPoolResults(device, depthPrepass.queryPool, currentFrame, 1, sizeof(fragmentInvocations),
+                                          &fragmentInvocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) {
+    return;
+  }
+  if (depthPrepass.recordedWithPrepass[currentFrame]) {
+    depthPrepass.shadedFragments = fragmentInvocations;
+  } else {
+    depthPrepass.shadedFragmentsWithout = fragmentInvocations;
+  }
+}
+
+void PBRIBLScene::createShadowCascades() {
+  // The scene model is scaled to half a unit (updateUniformData), a few units of shadow distance cover it
+  ShadowCascades::Settings shadowSettings;
+  shadowSettings.maxDistance = 4.0f;
+  shadowCascades = std::make_unique<ShadowCascades>(context, cmdUtils, textureManager, MAX_FRAMES_IN_FLIGHT, shadowSettings);
+  shadowUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  for (auto& uniformBuffer : shadowUniformBuffers) {
+    uniformBuffer = bufferManager->createBuffer(sizeof(ShadowCascades::UniformData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+  }
+  // Bind pose box in the y flipped world of pbrIbl.vert, doubled so animated nodes stay inside
+  glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+  glm::vec3 modelMin = glm::vec3(models.scene.aabb[3]);
+  glm::vec3 modelSize = glm::vec3(models.scene.aabb[0][0], models.scene.aabb[1][1], models.scene.aabb[2][2]);
+  tak::BoundingBox bounds =
+      tak::BoundingBox(modelMin - 0.5f * modelSize, modelMin + 1.5f * modelSize).getAABB(flipY * sceneUboMatrices.model);
+  shadowCascades->setCasterBounds(bounds.min, bounds.max);
+}
+
+void PBRIBLScene::updateShadowCascades() {
+  // Starting, stopping or switching the animation moves nodes between the static and the dynamic casters
+  int32_t runningAnimation = (animate && !models.scene.animations.empty()) ? animationIndex : -1;
+  if (runningAnimation != shadowAnimation) {
+    animatedNodes.clear();
+    if (runningAnimation >= 0) {
+      for (const tak::AnimationChannel& channel : models.scene.animations[runningAnimation].channels) {
+        animatedNodes.insert(channel.node);
+      }
+    }
+    shadowAnimation = runningAnimation;
+    shadowCascades->invalidateCache();
+  }
+  // lightDir points from the surface to the light (material_pbr.frag)
+  float aspectRatio = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
+  shadowCascades->update(sceneUboMatrices.view, glm::radians(camera.getFov()), aspectRatio, camera.getNearPlane(),
+                         -glm::vec3(shaderValuesParams.lightDir));
+  uint32_t dynamicCascades = 0;
+  for (auto node : models.scene.nodes) {
+    dynamicCascades |= dynamicShadowCascades(node, false);
+  }
+  shadowCascades->setDynamicCascades(dynamicCascades);
+  bufferManager->updateBuffer(shadowUniformBuffers[currentFrame], &shadowCascades->uniformData(), sizeof(ShadowCascades::UniformData), 0);
+}
+
+void PBRIBLScene::recordShadowCascades(VkCommandBuffer commandBuffer) {
+  // Same vertex streams as the scene draws, but the full index buffer: the meshlet culled one only holds what the camera sees
+  if (packedVertices && !computeSkinning.enabled) {
+    modelManager->bindPackedVertexBuffers(models.scene, commandBuffer);
+  } else {
+    VkDeviceSize offsets[] = {0};
+    VkBuffer sceneVertexBuffer =
+        computeSkinning.enabled ? computeSkinning.vertexBuffers[currentFrame].buffer : models.scene.vertices.buffer;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &sceneVertexBuffer, offsets);
+  }
+  if (models.scene.indices.buffer != VK_NULL_HANDLE) {
+    vkCmdBindIndexBuffer(commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+  }
+  shadowCascades->record(commandBuffer, currentFrame, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                         [this](VkCommandBuffer cmd, uint32_t cascade, bool staticCasters) { recordShadowCasters(cmd, cascade, staticCasters); });
+}
+
+void PBRIBLScene::recordShadowCasters(VkCommandBuffer commandBuffer, uint32_t cascade, bool staticCasters) {
+  boundPipeline = VK_NULL_HANDLE;
+  for (auto node : models.scene.nodes) {
+    renderShadowNode(commandBuffer, node, cascade, staticCasters, false);
+  }
+}
+
+// Cascades the dynamic casters below node reach, the same split and culling as renderShadowNode
+uint32_t PBRIBLScene::dynamicShadowCascades(tak::Node* node, bool animated) const {
+  animated = animated || animatedNodes.count(node) > 0;
+  uint32_t cascades = 0;
+  if (node->mesh && (animated || node->skin)) {
+    glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+    glm::mat4 worldFromObject = flipY * sceneUboMatrices.model * node->mesh->matrix;
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      if (models.scene.materials[primitive->materialIndex].alphaMode == tak::Material::ALPHAMODE_BLEND) {
+        continue;
+      }
+      if (node->skin || !primitive->bb.valid) {
+        return (1u << ShadowCascades::CASCADE_COUNT) - 1;
+      }
+      tak::BoundingBox bounds = primitive->bb.getAABB(worldFromObject);
+      for (uint32_t i = 0; i < ShadowCascades::CASCADE_COUNT; i++) {
+        if (shadowCascades->boundsVisible(i, bounds.min, bounds.max)) {
+          cascades |= 1u << i;
+        }
+      }
+    }
+  }
+  for (auto child : node->children) {
+    cascades |= dynamicShadowCascades(child, animated);
+  }
+  return cascades;
+}
+
+void PBRIBLScene::renderShadowNode(VkCommandBuffer commandBuffer, tak::Node* node, uint32_t cascade, bool staticCasters, bool animated) {
+  animated = animated || animatedNodes.count(node) > 0;
+  const bool dynamic = animated || node->skin != nullptr;
+  if (node->mesh && dynamic != staticCasters) {
+    glm::mat4 flipY = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f));
+    glm::mat4 worldFromObject = flipY * sceneUboMatrices.model * node->mesh->matrix;
+    for (tak::Primitive* primitive : node->mesh->primitives) {
+      const tak::Material& material = models.scene.materials[primitive->materialIndex];
+      if (material.alphaMode == tak::Material::ALPHAMODE_BLEND) {
+        continue;
+      }
+      // Skinned bounds do not follow the joints, those primitives are always drawn
+      if (!node->skin && primitive->bb.valid) {
+        tak::BoundingBox bounds = primitive->bb.getAABB(worldFromObject);
+        if (!shadowCascades->casterVisible(cascade, bounds.min, bounds.max)) {
+          continue;
+        }
+      }
+
+      std::string pipelineName = "shadow";
+      if (computeSkinning.enabled) {
+        pipelineName += "_preskinned";
+      } else if (packedVertices) {
+        pipelineName += "_packed";
+      }
+      if (material.alphaMode == tak::Material::ALPHAMODE_MASK) {
+        pipelineName += "_mask";
+      }
+      const VkPipeline pipeline = pipelines[pipelineName];
+      if (boundPipeline != pipeline) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        boundPipeline = pipeline;
+      }
+
+      const std::vector<VkDescriptorSet> descriptorsets = {descriptorSets[currentFrame].scene, materialDescriptorSets[currentFrame][primitive->materialIndex],
+                                                           descriptorSetsMeshData[currentFrame], descriptorSetMaterials};
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorsets.size()),
+                              descriptorsets.data(), 0, NULL);
+      MeshPushConstantBlock pushConstantBlock{};
+      pushConstantBlock.meshIndex = node->mesh->index;
+      pushConstantBlock.materialIndex = material.materialIndex;
+      pushConstantBlock.cascade = static_cast<int32_t>(cascade);
+      vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                         sizeof(MeshPushConstantBlock), &pushConstantBlock);
+
+      // The cached cascades stay at full detail, dynamic casters follow the level the camera picked
+      if (primitive->hasIndices) {
+        uint32_t firstIndex = primitive->firstIndex;
+        uint32_t indexCount = primitive->indexCount;
+        if (!staticCasters && !primitive->lods.empty()) {
+          firstIndex = primitive->lods[primitive->currentLod].firstIndex;
+          indexCount = primitive->lods[primitive->currentLod].indexCount;
+        }
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
+      } else {
+        vkCmdDraw(commandBuffer, primitive->vertexCount, 1, 0, 0);
+      }
+    }
+  }
+  for (auto child : node->children) {
+    renderShadowNode(commandBuffer, child, cascade, staticCasters, animated);
+  }
+}
+
+void PBRIBLScene::createTransparencyComposite() {
+  // Accumulation and revealage as input attachments of the composite subpass
+  std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+      {0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+  };
+  VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
+  descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
+  descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &transparency.descriptorSetLayout));
+
+  VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+  descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  descriptorSetAllocInfo.descriptorPool = descriptorPool;
+  descriptorSetAllocInfo.pSetLayouts = &transparency.descriptorSetLayout;
+  descriptorSetAllocInfo.descriptorSetCount = 1;
+  VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &transparency.descriptorSet));
+  writeTransparencyDescriptors();
+
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = 1;
+  pipelineLayoutCI.pSetLayouts = &transparency.descriptorSetLayout;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &transparency.pipelineLayout));
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI{};
+  inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssemblyStateCI.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkPipelineRasterizationStateCreateInfo rasterizationStateCI{};
+  rasterizationStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizationStateCI.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
+  rasterizationStateCI.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+  rasterizationStateCI.lineWidth = 1.0f;
+
+  // scene * revealage + average transparent color * (1 - revealage), the shader outputs revealage as alpha
+  VkPipelineColorBlendAttachmentState blendAttachmentState{};
+  blendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT;
+  blendAttachmentState.blendEnable = VK_TRUE;
+  blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+  blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+  blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+  blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+  VkPipelineColorBlendStateCreateInfo colorBlendStateCI{};
+  colorBlendStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlendStateCI.attachmentCount = 1;
+  colorBlendStateCI.pAttachments = &blendAttachmentState;
+
+  // The composite subpass has no depth attachment
+  VkPipelineDepthStencilStateCreateInfo depthStencilStateCI{};
+  depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+  VkPipelineViewportStateCreateInfo viewportStateCI{};
+  viewportStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportStateCI.viewportCount = 1;
+  viewportStateCI.scissorCount = 1;
+
+  VkPipelineMultisampleStateCreateInfo multisampleStateCI{};
+  multisampleStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  if (multisampling) {
+    multisampleStateCI.rasterizationSamples = msaaSamples;
+  }
+
+  std::vector<VkDynamicState> dynamicStateEnables = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicStateCI{};
+  dynamicStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicStateCI.pDynamicStates = dynamicStateEnables.data();
+  dynamicStateCI.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+
+  VkPipelineVertexInputStateCreateInfo vertexInputStateCI{};
+  vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-  ui = new UI(textureManager, renderPass, msaaSamples, std::string(SHADER_DIR), window);
-  for (auto& tex : models.scene.textures) {
-    imguiTexId.push_back(ui->addTexture(tex.sampler, tex.imageView));
+  // Fullscreen triangle from the vertex index
+  std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
+  shaderStages[0] = loadShader(std::string(SHADER_DIR) + "/genbrdflut.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+  // SAMPLE_COUNT (constant_id = 0) of the multisampled variant
+  int32_t sampleCount = static_cast<int32_t>(msaaSamples);
+  VkSpecializationMapEntry specializationEntry{0, 0, sizeof(int32_t)};
+  VkSpecializationInfo specializationInfo{1, &specializationEntry, sizeof(int32_t), &sampleCount};
+  if (msaaSamples != VK_SAMPLE_COUNT_1_BIT) {
+    shaderStages[1] = loadShader(std::string(SHADER_DIR) + "/oit_composite_ms.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    shaderStages[1].pSpecializationInfo = &specializationInfo;
+  } else {
+    shaderStages[1] = loadShader(std::string(SHADER_DIR) + "/oit_composite.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
   }
-}
 
-void PBRIBLScene::createPipeline() {
-  // Create the pipeline layout ONCE here
-  spdlog::info("Creating pipelines - current count: {}", pipelines.size());
-  const std::vector<VkDescriptorSetLayout> setLayouts = {descriptorSetLayouts.scene, descriptorSetLayouts.material,
-                                                         descriptorSetLayouts.meshDataBuffer,
-                                                         descriptorSetLayouts.materialBuffer};
-  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
-  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
-  pipelineLayoutCI.pSetLayouts = setLayouts.data();
+  VkGraphicsPipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineCI.layout = transparency.pipelineLayout;
+  pipelineCI.renderPass = renderPass;
+  pipelineCI.subpass = 2;
+  pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
+  pipelineCI.pVertexInputState = &vertexInputStateCI;
+  pipelineCI.pRasterizationState = &rasterizationStateCI;
+  pipelineCI.pColorBlendState = &colorBlendStateCI;
+  pipelineCI.pMultisampleState = &multisampleStateCI;
+  pipelineCI.pViewportState = &viewportStateCI;
+  pipelineCI.pDepthStencilState = &depthStencilStateCI;
+  pipelineCI.pDynamicState = &dynamicStateCI;
+  pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+  pipelineCI.pStages = shaderStages.data();
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &transparency.compositePipeline));
 
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.size = sizeof(MeshPushConstantBlock);
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pipelineLayoutCI.pushConstantRangeCount = 1;
-  pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+  for (auto shaderStage : shaderStages) {
+    vkDestroyShaderModule(device, shaderStage.module, nullptr);
+  }
+}
 
-  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayout));
-  createSkyboxPipeline();
-  // PBR pipelines
-  addPipelineSet("pbr", std::string(SHADER_DIR) + "/pbribl.vert.spv", std::string(SHADER_DIR) + "/material_pbr.frag.spv");
-  // KHR_materials_unlit
-  addPipelineSet("unlit", std::string(SHADER_DIR) + "/pbribl.vert.spv",
-                 std::string(SHADER_DIR) + "/material_unlit.frag.spv");
+void PBRIBLScene::writeTransparencyDescriptors() {
+  std::array<VkDescriptorImageInfo, 2> imageInfos = {
+      VkDescriptorImageInfo{VK_NULL_HANDLE, oitAccum.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      VkDescriptorImageInfo{VK_NULL_HANDLE, oitRevealage.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}};
+  std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+  for (size_t b = 0; b < imageInfos.size(); b++) {
+    writeDescriptorSets[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[b].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    writeDescriptorSets[b].descriptorCount = 1;
+    writeDescriptorSets[b].dstSet = transparency.descriptorSet;
+    writeDescriptorSets[b].dstBinding = static_cast<uint32_t>(b);
+    writeDescriptorSets[b].pImageInfo = &imageInfos[b];
+  }
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 }
 
-void PBRIBLScene::recordRenderCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
-  boundPipeline = VK_NULL_HANDLE;
-  // Render pass is already begun in base class recordCommandBuffer()
-  // Just need to bind pipeline and draw
-  VkViewport viewport{};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = static_cast<float>(swapChainExtent.width);
-  viewport.height = static_cast<float>(swapChainExtent.height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
+void PBRIBLScene::onResize(int width, int height) {
+  // Accumulation targets were recreated with the swapchain
+  writeTransparencyDescriptors();
+}
 
-  VkRect2D scissor{};
-  scissor.offset = {0, 0};
-  scissor.extent = swapChainExtent;
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-  // skybox render
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipelineLayout, 0, 1,
-                          &skyboxDescriptorSets[currentFrame], 0, nullptr);
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
-  const VkDeviceSize offsetSkybox[1] = {0};
-  for (tak::Node* node : models.skybox.nodes) {
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models.skybox.vertices.buffer, offsetSkybox);
-    vkCmdBindIndexBuffer(commandBuffer, models.skybox.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-    modelManager->drawNode(node, commandBuffer);
-  }
-  // scene render
-  boundPipeline = VK_NULL_HANDLE;
-  VkDeviceSize offsets_scene[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models.scene.vertices.buffer, offsets_scene);
-  if (models.scene.indices.buffer != VK_NULL_HANDLE) {
-    vkCmdBindIndexBuffer(commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+void PBRIBLScene::createComputeSkinning() {
+  // Skinned primitives, each one is a vertex range the compute pass rewrites every frame
+  for (auto& node : models.scene.linearNodes) {
+    if (node->mesh && node->skin) {
+      for (tak::Primitive* primitive : node->mesh->primitives) {
+        computeSkinning.primitives.push_back({node->mesh, primitive});
+      }
+    }
   }
-
-  // Opaque primitives first
-  for (auto node : models.scene.nodes) {
-    renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_OPAQUE);
+  spdlog::info("Compute skinning: {} skinned primitives", computeSkinning.primitives.size());
+  computeSkinning.recordedWithCompute.resize(MAX_FRAMES_IN_FLIGHT, false);
+
+  // binding 0: source vertices (packed positions), 1: skinned output, 2: mesh data, 3: joint palettes of the same frame,
+  // 4-6: packed surface, skin and color streams
+  std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+  for (uint32_t b = 0; b < (packedVertices ? 7u : 4u); b++) {
+    setLayoutBindings.push_back({b, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr});
   }
-  // Alpha masked primitives
-  for (auto node : models.scene.nodes) {
-    renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_MASK);
+  VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
+  descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
+  descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+  VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &computeSkinning.descriptorSetLayout));
+
+  computeSkinning.descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.pSetLayouts = &computeSkinning.descriptorSetLayout;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &computeSkinning.descriptorSets[i]));
   }
-  // Transparent primitives
-  // TODO: Correct depth sorting
-  for (auto node : models.scene.nodes) {
-    renderNode(commandBuffer, node, imageIndex, tak::Material::ALPHAMODE_BLEND);
+  // Written together with the output buffers, those only exist while compute skinning is enabled
+
+  // Two timestamps per frame in flight: before the skinning pre-pass and after the scene draws
+  if (!context->properties.limits.timestampComputeAndGraphics) {
+    spdlog::warn("Timestamp queries not supported, skinning timings disabled");
+    return;
   }
-  ui->draw(commandBuffer);
+  VkQueryPoolCreateInfo queryPoolCI{};
+  queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCI.queryCount = 2 * MAX_FRAMES_IN_FLIGHT;
+  VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCI, nullptr, &computeSkinning.queryPool));
+  // Queries have to be reset once before the first read, otherwise results are undefined
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) { vkCmdResetQueryPool(cmd, computeSkinning.queryPool, 0, queryPoolCI.queryCount); });
 }
 
-void PBRIBLScene::renderNode(VkCommandBuffer cmdBuffer, tak::Node* node, uint32_t ImageIndex,
-                             tak::Material::AlphaMode alphaMode) {
-  if (node->mesh) {
-    // Render mesh primitives
-    for (tak::Primitive* primitive : node->mesh->primitives) {
-      if (models.scene.materials[primitive->materialIndex].alphaMode == alphaMode) {
-        std::string pipelineName = "pbr";
-        std::string pipelineVariant = "";
-
-        if (models.scene.materials[primitive->materialIndex].unlit) {
-          pipelineName = "unlit";
-        }
+PBRIBLScene::SkinningPushConstantBlock PBRIBLScene::skinningPushConstants() const {
+  SkinningPushConstantBlock pushConstantBlock{};
+  pushConstantBlock.vertexStride = sizeof(tak::Vertex) / sizeof(float);
+  pushConstantBlock.posOffset = offsetof(tak::Vertex, pos) / sizeof(float);
+  pushConstantBlock.normalOffset = offsetof(tak::Vertex, normal) / sizeof(float);
+  pushConstantBlock.uv0Offset = offsetof(tak::Vertex, uv0) / sizeof(float);
+  pushConstantBlock.uv1Offset = offsetof(tak::Vertex, uv1) / sizeof(float);
+  pushConstantBlock.jointOffset = offsetof(tak::Vertex, joint0) / sizeof(float);
+  pushConstantBlock.weightOffset = offsetof(tak::Vertex, weight0) / sizeof(float);
+  pushConstantBlock.colorOffset = offsetof(tak::Vertex, color) / sizeof(float);
+  pushConstantBlock.tangentOffset = offsetof(tak::Vertex, tangent) / sizeof(float);
+  pushConstantBlock.skinStride = models.scene.packed.hasSkin ? 1 : 0;
+  pushConstantBlock.colorStride = models.scene.packed.hasColor ? 1 : 0;
+  return pushConstantBlock;
+}
 
-        // Material properties define if we e.g. need to bind a pipeline variant with culling disabled (double sided)
-        if (alphaMode == tak::Material::ALPHAMODE_BLEND) {
-          pipelineVariant = "_alpha_blending";
-        } else {
-          if (models.scene.materials[primitive->materialIndex].doubleSided) {
-            pipelineVariant = "_double_sided";
-          }
-        }
-        const VkPipeline pipeline = pipelines[pipelineName + pipelineVariant];
+void PBRIBLScene::createSkinnedVertexBuffers() {
+  // Full format output for the _preskinned pipelines, nothing may be in flight
+  const VkDeviceSize vertexCount =
+      packedVertices ? models.scene.packed.positions.size / sizeof(glm::vec3) : models.scene.vertices.size / sizeof(tak::Vertex);
+  const VkDeviceSize bufferSize = vertexCount * sizeof(tak::Vertex);
+  computeSkinning.vertexBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    computeSkinning.vertexBuffers[i] = bufferManager->createBuffer(
+        bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // Output starts as a copy of the full source so static geometry and the attributes the shader does not touch stay valid
+    if (!packedVertices) {
+      bufferManager->copyBuffer(models.scene.vertices.buffer, computeSkinning.vertexBuffers[i].buffer, bufferSize);
+    }
 
-        if (boundPipeline != pipeline) {
-          vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-          boundPipeline = pipeline;
-        }
+    std::vector<VkDescriptorBufferInfo> bufferInfos = {packedVertices ? models.scene.packed.positions.descriptor : models.scene.vertices.descriptor,
+                                                       computeSkinning.vertexBuffers[i].descriptor, shaderMeshDataBuffers[i].descriptor,
+                                                       jointPaletteBuffers[i].descriptor};
+    if (packedVertices) {
+      bufferInfos.push_back(models.scene.packed.surface.descriptor);
+      bufferInfos.push_back(models.scene.packed.skin.descriptor);
+      bufferInfos.push_back(models.scene.packed.color.descriptor);
+    }
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets(bufferInfos.size());
+    for (size_t b = 0; b < bufferInfos.size(); b++) {
+      writeDescriptorSets[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writeDescriptorSets[b].descriptorCount = 1;
+      writeDescriptorSets[b].dstSet = computeSkinning.descriptorSets[i];
+      writeDescriptorSets[b].dstBinding = static_cast<uint32_t>(b);
+      writeDescriptorSets[b].pBufferInfo = &bufferInfos[b];
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+  }
+  if (!packedVertices) {
+    return;
+  }
 
-        const std::vector<VkDescriptorSet> descriptorsets = {
-            descriptorSets[currentFrame].scene,                              // set 0
-            models.scene.materials[primitive->materialIndex].descriptorSet,  // set 1
-            descriptorSetsMeshData[currentFrame],                            // set 2
-            descriptorSetMaterials                                           // set 3
-        };
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0,
-                                static_cast<uint32_t>(descriptorsets.size()), descriptorsets.data(), 0, NULL);
-
-        // Pass material index for this primitive using a push constant, the shader uses this to index into the material
-        // buffer
-        MeshPushConstantBlock pushConstantBlock{};
-        // @todo: index
-        pushConstantBlock.meshIndex = node->mesh->index;
-        pushConstantBlock.materialIndex = models.scene.materials[primitive->materialIndex].materialIndex;
-
-        vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-                           sizeof(MeshPushConstantBlock), &pushConstantBlock);
-
-        if (primitive->hasIndices) {
-          vkCmdDrawIndexed(cmdBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
-        } else {
-          vkCmdDraw(cmdBuffer, primitive->vertexCount, 1, 0, 0);
-        }
-      }
+  // Packed source: decode every vertex once unskinned, the per-frame dispatches then only rewrite the skinned ranges
+  SkinningPushConstantBlock pushConstantBlock = skinningPushConstants();
+  pushConstantBlock.vertexCount = static_cast<uint32_t>(vertexCount);
+  cmdUtils->executeCommands([&](VkCommandBuffer cmd) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computeSkinning.pipeline);
+    vkCmdPushConstants(cmd, computeSkinning.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningPushConstantBlock),
+                       &pushConstantBlock);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+      vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computeSkinning.pipelineLayout, 0, 1, &computeSkinning.descriptorSets[i], 0,
+                              nullptr);
+      vkCmdDispatch(cmd, static_cast<uint32_t>((vertexCount + 63) / 64), 1, 1);
     }
-  };
-  for (auto child : node->children) {
-    renderNode(cmdBuffer, child, ImageIndex, alphaMode);
+  });
+}
+
+void PBRIBLScene::destroySkinnedVertexBuffers() {
+  for (auto& vertexBuffer : computeSkinning.vertexBuffers) {
+    bufferManager->destroyBuffer(vertexBuffer);
   }
+  computeSkinning.vertexBuffers.clear();
 }
 
-void PBRIBLScene::updateScene(float deltaTime) {
-  updateOverlay(deltaTime);
-  //  Update UBOs
-  updateUniformData();
-  updateParams();
-  //  update shader buffer
-  bufferManager->updateBuffer(uniformBuffers[currentFrame].scene, &sceneUboMatrices, sizeof(sceneUboMatrices), 0);
-  bufferManager->updateBuffer(uniformBuffers[currentFrame].params, &shaderValuesParams, sizeof(shaderValuesParams), 0);
-  bufferManager->updateBuffer(uniformBuffers[currentFrame].skybox, &uboSkybox, sizeof(uboSkybox), 0);
+void PBRIBLScene::createComputeSkinningPipeline() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(SkinningPushConstantBlock);
 
-  // update animation and params
-  if ((animate) && (models.scene.animations.size() > 0)) {
-    animationTimer += deltaTime;
-    if (animationTimer > models.scene.animations[animationIndex].end) {
-      animationTimer -= models.scene.animations[animationIndex].end;
-    }
-    modelManager->updateAnimation(models.scene, animationIndex, animationTimer);
-    updateMeshDataBuffer(currentFrame);
-  }
+  VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+  pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutCI.setLayoutCount = 1;
+  pipelineLayoutCI.pSetLayouts = &computeSkinning.descriptorSetLayout;
+  pipelineLayoutCI.pushConstantRangeCount = 1;
+  pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+  VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &computeSkinning.pipelineLayout));
+
+  VkComputePipelineCreateInfo pipelineCI{};
+  pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineCI.layout = computeSkinning.pipelineLayout;
+  const std::string shaderFile = packedVertices ? "/skinning_packed.comp.spv" : "/skinning.comp.spv";
+  pipelineCI.stage = loadShader(std::string(SHADER_DIR) + shaderFile, VK_SHADER_STAGE_COMPUTE_BIT);
+  VK_CHECK_RESULT(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &computeSkinning.pipeline));
+  vkDestroyShaderModule(device, pipelineCI.stage.module, nullptr);
 }
 
-void PBRIBLScene::updateMeshDataBuffer(uint32_t index) {  // @todo: optimize (no push, use fixed size)
-  std::vector<ShaderMeshData> shaderMeshData;
-  std::map<uint32_t, ShaderMeshData> meshDataMap;
-  for (auto& node : models.scene.linearNodes) {
-    if (node->mesh) {
-      ShaderMeshData meshData{};
-      memcpy(meshData.jointMatrix, node->mesh->jointMatrix.data(), sizeof(glm::mat4) * MAX_NUM_JOINTS);
-      meshData.jointcount = node->mesh->jointcount;
-      meshData.matrix = node->mesh->matrix;
-      meshDataMap[node->mesh->index] = meshData;
-    }
+void PBRIBLScene::readSkinningTimings() {
+  if (computeSkinning.queryPool == VK_NULL_HANDLE) {
+    return;
   }
-  // Convert map to vector in correct order
-  for (const auto& [idx, data] : meshDataMap) {
-    shaderMeshData.push_back(data);
+  // Results of the last submission that used this frame slot, skipped while it is still in flight
+  uint64_t timestamps[2] = {};
+  VkResult result = vkGetQueryPoolResults(device, computeSkinning.queryPool, currentFrame * 2, 2, sizeof(timestamps), timestamps,
+                                          sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) {
+    return;
   }
-  VkDeviceSize bufferSize = shaderMeshData.size() * sizeof(ShaderMeshData);
-  bufferManager->updateBuffer(shaderMeshDataBuffers[index], shaderMeshData.data(), bufferSize, 0);
+  float ms = static_cast<float>(timestamps[1] - timestamps[0]) * context->properties.limits.timestampPeriod / 1000000.0f;
+  float& average =
+      computeSkinning.recordedWithCompute[currentFrame] ? computeSkinning.computeSkinningMs : computeSkinning.vertexSkinningMs;
+  average = (average == 0.0f) ? ms : average * 0.95f + ms * 0.05f;
 }
 
 void PBRIBLScene::createSkyboxPipeline() {
@@ -226,9 +1366,9 @@ void PBRIBLScene::createSkyboxPipeline() {
 
   VkPipelineDepthStencilStateCreateInfo depthStencilStateCI{};
   depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depthStencilStateCI.depthTestEnable = VK_FALSE;
+  depthStencilStateCI.depthTestEnable = VK_TRUE;
   depthStencilStateCI.depthWriteEnable = VK_FALSE;
-  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;  // sky depth is 0, passes only where nothing was drawn
   depthStencilStateCI.depthBoundsTestEnable = VK_FALSE;
   depthStencilStateCI.stencilTestEnable = VK_FALSE;
 
@@ -305,7 +1445,15 @@ void PBRIBLScene::createSkyboxPipeline() {
 
 void PBRIBLScene::loadAssets() {
   // load scene
-  models.scene = modelManager->createModelFromFile(std::string(MODEL_DIR) + "/buster_drone/scene.gltf");
+  // One vertex format only, compute skinning reads whichever was created
+  modelManager->streamTextures = textureStreaming;
+  models.scene = modelManager->createModelFromFile(std::string(MODEL_DIR) + "/buster_drone/scene.gltf", 1.0f,
+                                                   packedVertices ? ModelManager::VERTEX_FORMAT_PACKED : ModelManager::VERTEX_FORMAT_FULL);
+  modelManager->streamTextures = false;
+  if (textureStreaming) {
+    textureStreamer = std::make_unique<TextureStreamer>(context, bufferManager, textureManager, MAX_FRAMES_IN_FLIGHT);
+    textureStreamer->addModel(models.scene);
+  }
   createMaterialBuffer();
   createMeshDataBuffer();
   // Check and list unsupported extensions
@@ -318,6 +1466,16 @@ void PBRIBLScene::loadAssets() {
 
   // Load environment using base class method
   loadSceneEnvironment(std::string(TEXTURE_DIR) + "/skybox/workshop.hdr");
+
+  for (const auto& entry : std::filesystem::directory_iterator(std::string(TEXTURE_DIR) + "/skybox")) {
+    const std::string extension = entry.path().extension().string();
+    if (extension == ".hdr" || extension == ".png" || extension == ".jpg") {
+      environmentFiles.push_back(entry.path().filename().string());
+      if (environmentFiles.back() == "workshop.hdr") {
+        selectedEnvironment = static_cast<int32_t>(environmentFiles.size()) - 1;
+      }
+    }
+  }
 }
 
 void PBRIBLScene::loadSceneEnvironment(std::string& filename) {
@@ -325,6 +1483,101 @@ void PBRIBLScene::loadSceneEnvironment(std::string& filename) {
   loadEnvironment(filename);
 }
 
+void PBRIBLScene::switchEnvironment(const std::string& filename) {
+  if (environmentUpdate.active) {
+    spdlog::warn("Environment update still in progress, ignoring {}", filename);
+    return;
+  }
+  if (incrementalIBL) {
+    beginEnvironmentUpdate(filename);
+    return;
+  }
+  // Blocking reference path: nothing may be in flight while the cubes are replaced in place
+  auto tStart = std::chrono::high_resolution_clock::now();
+  vkDeviceWaitIdle(device);
+  textureManager->destroyTexture(pbrEnvironment.environmentCube);
+  textureManager->destroyTexture(pbrEnvironment.irradianceCube);
+  textureManager->destroyTexture(pbrEnvironment.prefilteredCube);
+  std::string path = filename;
+  loadEnvironment(path);
+  pbrEnvironment.version++;
+  environmentUpdate.lastSwitchMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+  environmentUpdate.lastSwitchFrames = 1;
+}
+
+// Only called for a frame slot whose fence has been waited on, so its sets are not in use
+void PBRIBLScene::updateEnvironmentDescriptors(uint32_t frame) {
+  // Scene bindings 2-4 (irradiance, prefiltered, BRDF LUT) and skybox binding 2, as written by setupDescriptors
+  const std::array<const TextureManager::Texture*, 4> textures = {&pbrEnvironment.irradianceCube, &pbrEnvironment.prefilteredCube,
+                                                                  &pbrEnvironment.lutBrdf, &pbrEnvironment.environmentCube};
+  std::array<VkDescriptorImageInfo, 4> imageInfos{};
+  std::array<VkWriteDescriptorSet, 4> writeDescriptorSets{};
+  for (uint32_t i = 0; i < textures.size(); i++) {
+    imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfos[i].imageView = textures[i]->imageView;
+    imageInfos[i].sampler = textures[i]->sampler;
+    writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writeDescriptorSets[i].descriptorCount = 1;
+    writeDescriptorSets[i].dstSet = descriptorSets[frame].scene;
+    writeDescriptorSets[i].dstBinding = 2 + i;
+    writeDescriptorSets[i].pImageInfo = &imageInfos[i];
+  }
+  writeDescriptorSets[3].dstSet = skyboxDescriptorSets[frame];
+  writeDescriptorSets[3].dstBinding = 2;
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+  boundEnvironmentVersions[frame] = pbrEnvironment.version;
+}
+
+// Only called for a frame slot whose fence has been waited on, so its sets are not in use
+void PBRIBLScene::writeMaterialDescriptors(uint32_t frame) {
+  for (size_t m = 0; m < models.scene.materials.size(); m++) {
+    const tak::Material& material = models.scene.materials[m];
+    auto normalDescriptor = material.normalTextureIndex != UINT32_MAX
+                                ? models.scene.textures[material.normalTextureIndex].descriptor
+                                : emptyTexture.descriptor;
+    auto occlusionDescriptor = material.occlusionTextureIndex != UINT32_MAX
+                                   ? models.scene.textures[material.occlusionTextureIndex].descriptor
+                                   : emptyTexture.descriptor;
+    auto emissiveDescriptor = material.emissiveTextureIndex != UINT32_MAX
+                                  ? models.scene.textures[material.emissiveTextureIndex].descriptor
+                                  : emptyTexture.descriptor;
+    std::vector<VkDescriptorImageInfo> imageDescriptors = {emptyTexture.descriptor, emptyTexture.descriptor,
+                                                           normalDescriptor, occlusionDescriptor, emissiveDescriptor};
+
+    if (material.pbrWorkflows.metallicRoughness) {
+      if (material.baseColorTextureIndex != UINT32_MAX) {
+        imageDescriptors[0] = models.scene.textures[material.baseColorTextureIndex].descriptor;
+      }
+      if (material.metallicRoughnessTextureIndex != UINT32_MAX) {
+        imageDescriptors[1] = models.scene.textures[material.metallicRoughnessTextureIndex].descriptor;
+      }
+    } else {
+      if (material.pbrWorkflows.specularGlossiness) {
+        if (material.extension.diffuseTextureIndex != UINT32_MAX) {
+          imageDescriptors[0] = models.scene.textures[material.extension.diffuseTextureIndex].descriptor;
+        }
+        if (material.extension.specularGlossinessTextureIndex != UINT32_MAX) {
+          imageDescriptors[1] = models.scene.textures[material.extension.specularGlossinessTextureIndex].descriptor;
+        }
+      }
+    }
+
+    std::array<VkWriteDescriptorSet, 5> writeDescriptorSets{};
+    for (size_t i = 0; i < imageDescriptors.size(); i++) {
+      writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      writeDescriptorSets[i].descriptorCount = 1;
+      writeDescriptorSets[i].dstSet = materialDescriptorSets[frame][m];
+      writeDescriptorSets[i].dstBinding = static_cast<uint32_t>(i);
+      writeDescriptorSets[i].pImageInfo = &imageDescriptors[i];
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
+  }
+  boundTextureVersions[frame] = textureStreamer ? textureStreamer->version() : 0;
+}
+
 void PBRIBLScene::setupDescriptors() {
   /*
                         Descriptor Pool
@@ -333,8 +1586,8 @@ void PBRIBLScene::setupDescriptors() {
   uint32_t materialCount = 0;
   uint32_t meshCount = 0;
 
-  // Environment samplers (radiance, irradiance, brdf lut)
-  imageSamplerCount += 3;
+  // Environment samplers (radiance, irradiance, brdf lut), shadow map with and without comparison
+  imageSamplerCount += 5;
 
   std::vector<ModelManager::Model*> modellist = {&models.skybox, &models.scene};
   for (auto& model : modellist) {
@@ -348,17 +1601,24 @@ void PBRIBLScene::setupDescriptors() {
       }
     }
   }
-  u32 imageCnt = swapChainImages.size();
+  // Material sets exist once per frame in flight, the per-image scaling covers them as long as there are at least as many images
+  u32 imageCnt = std::max<u32>(static_cast<u32>(swapChainImages.size()), MAX_FRAMES_IN_FLIGHT);
   std::vector<VkDescriptorPoolSize> poolSizes = {
-      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (4 + meshCount) * imageCnt},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (5 + meshCount) * imageCnt},
       {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageSamplerCount * imageCnt},
-      // One SSBO for the shader material buffer and one SSBO for the mesh data buffer
-      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 + static_cast<uint32_t>(shaderMeshDataBuffers.size())}};
+      // One SSBO for the shader material buffer, mesh data and joint palette SSBOs per frame
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 + 2 * static_cast<uint32_t>(shaderMeshDataBuffers.size())},
+      // Compute skinning: source (four packed streams), output, mesh data and joint palettes per frame
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7 * static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)},
+      // Meshlet culling: meshlets, mesh data, source/culled indices, draws and control block per frame
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)},
+      // Weighted blended OIT composite: accumulation and revealage
+      {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 2}};
   VkDescriptorPoolCreateInfo descriptorPoolCI{};
   descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   descriptorPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   descriptorPoolCI.pPoolSizes = poolSizes.data();
-  descriptorPoolCI.maxSets = (2 + materialCount + meshCount) * imageCnt;
+  descriptorPoolCI.maxSets = (2 + materialCount + meshCount) * imageCnt + 2 * MAX_FRAMES_IN_FLIGHT + 1;
   vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &descriptorPool);
   // Scene (matrices and environment maps)
   {
@@ -368,6 +1628,10 @@ void PBRIBLScene::setupDescriptors() {
         {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
         {3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
         {4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        // Shadow cascades (shadow_cascades.glsl), the caster shaders read the matrices
+        {5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        {6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        {7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
     };
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
     descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -396,7 +1660,8 @@ void PBRIBLScene::setupDescriptors() {
       lutBrdfInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
       lutBrdfInfo.imageView = pbrEnvironment.lutBrdf.imageView;
       lutBrdfInfo.sampler = pbrEnvironment.lutBrdf.sampler;
-      std::array<VkWriteDescriptorSet, 5> writeDescriptorSets{};
+      VkDescriptorImageInfo shadowMapInfos[2] = {shadowCascades->compareDescriptor(), shadowCascades->depthDescriptor()};
+      std::array<VkWriteDescriptorSet, 8> writeDescriptorSets{};
 
       writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
       writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -433,6 +1698,22 @@ void PBRIBLScene::setupDescriptors() {
       writeDescriptorSets[4].dstBinding = 4;
       writeDescriptorSets[4].pImageInfo = &lutBrdfInfo;
 
+      writeDescriptorSets[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+      writeDescriptorSets[5].descriptorCount = 1;
+      writeDescriptorSets[5].dstSet = descriptorSets[i].scene;
+      writeDescriptorSets[5].dstBinding = 5;
+      writeDescriptorSets[5].pBufferInfo = &shadowUniformBuffers[i].descriptor;
+
+      for (uint32_t j = 0; j < 2; j++) {
+        writeDescriptorSets[6 + j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[6 + j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writeDescriptorSets[6 + j].descriptorCount = 1;
+        writeDescriptorSets[6 + j].dstSet = descriptorSets[i].scene;
+        writeDescriptorSets[6 + j].dstBinding = 6 + j;
+        writeDescriptorSets[6 + j].pImageInfo = &shadowMapInfos[j];
+      }
+
       vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
     }
   }
@@ -452,56 +1733,21 @@ void PBRIBLScene::setupDescriptors() {
     descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
     vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayouts.material);
 
-    // Per-Material descriptor sets
-    for (auto& material : models.scene.materials) {
-      VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-      descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-      descriptorSetAllocInfo.descriptorPool = descriptorPool;
-      descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayouts.material;
-      descriptorSetAllocInfo.descriptorSetCount = 1;
-      vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &material.descriptorSet);
-
-      auto normalDescriptor = material.normalTextureIndex != UINT32_MAX
-                                  ? models.scene.textures[material.normalTextureIndex].descriptor
-                                  : emptyTexture.descriptor;
-      auto occlusionDescriptor = material.occlusionTextureIndex != UINT32_MAX
-                                     ? models.scene.textures[material.occlusionTextureIndex].descriptor
-                                     : emptyTexture.descriptor;
-      auto emissiveDescriptor = material.emissiveTextureIndex != UINT32_MAX
-                                    ? models.scene.textures[material.emissiveTextureIndex].descriptor
-                                    : emptyTexture.descriptor;
-      std::vector<VkDescriptorImageInfo> imageDescriptors = {emptyTexture.descriptor, emptyTexture.descriptor,
-                                                             normalDescriptor, occlusionDescriptor, emissiveDescriptor};
-
-      if (material.pbrWorkflows.metallicRoughness) {
-        if (material.baseColorTextureIndex != UINT32_MAX) {
-          imageDescriptors[0] = models.scene.textures[material.baseColorTextureIndex].descriptor;
-        }
-        if (material.metallicRoughnessTextureIndex != UINT32_MAX) {
-          imageDescriptors[1] = models.scene.textures[material.metallicRoughnessTextureIndex].descriptor;
-        }
-      } else {
-        if (material.pbrWorkflows.specularGlossiness) {
-          if (material.extension.diffuseTextureIndex != UINT32_MAX) {
-            imageDescriptors[0] = models.scene.textures[material.extension.diffuseTextureIndex].descriptor;
-          }
-          if (material.extension.specularGlossinessTextureIndex != UINT32_MAX) {
-            imageDescriptors[1] = models.scene.textures[material.extension.specularGlossinessTextureIndex].descriptor;
-          }
-        }
-      }
-
-      std::array<VkWriteDescriptorSet, 5> writeDescriptorSets{};
-      for (size_t i = 0; i < imageDescriptors.size(); i++) {
-        writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSets[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writeDescriptorSets[i].descriptorCount = 1;
-        writeDescriptorSets[i].dstSet = material.descriptorSet;
-        writeDescriptorSets[i].dstBinding = static_cast<uint32_t>(i);
-        writeDescriptorSets[i].pImageInfo = &imageDescriptors[i];
+    // Per-Material descriptor sets, one per frame in flight so streamed textures can be rebound while an older frame still samples the previous ones
+    materialDescriptorSets.assign(MAX_FRAMES_IN_FLIGHT, std::vector<VkDescriptorSet>(models.scene.materials.size()));
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+      for (auto& descriptorSet : materialDescriptorSets[frame]) {
+        VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+        descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descriptorSetAllocInfo.descriptorPool = descriptorPool;
+        descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayouts.material;
+        descriptorSetAllocInfo.descriptorSetCount = 1;
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &descriptorSet));
       }
-
-      vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
+    }
+    boundTextureVersions.assign(MAX_FRAMES_IN_FLIGHT, 0);
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+      writeMaterialDescriptors(frame);
     }
 
     // Material buffer
@@ -534,8 +1780,10 @@ void PBRIBLScene::setupDescriptors() {
 
     // Mesh data buffer
     {
+      // binding 0: per-mesh transforms, 1: packed joint palettes
       std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
           {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+          {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
       };
       VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
       descriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -551,14 +1799,17 @@ void PBRIBLScene::setupDescriptors() {
         descriptorSetAllocInfo.descriptorSetCount = 1;
         vkAllocateDescriptorSets(device, &descriptorSetAllocInfo, &descriptorSetsMeshData[i]);
 
-        VkWriteDescriptorSet writeDescriptorSet{};
-        writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        writeDescriptorSet.descriptorCount = 1;
-        writeDescriptorSet.dstSet = descriptorSetsMeshData[i];
-        writeDescriptorSet.dstBinding = 0;
-        writeDescriptorSet.pBufferInfo = &shaderMeshDataBuffers[i].descriptor;
-        vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+        std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
+        writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writeDescriptorSets[0].descriptorCount = 1;
+        writeDescriptorSets[0].dstSet = descriptorSetsMeshData[i];
+        writeDescriptorSets[0].dstBinding = 0;
+        writeDescriptorSets[0].pBufferInfo = &shaderMeshDataBuffers[i].descriptor;
+        writeDescriptorSets[1] = writeDescriptorSets[0];
+        writeDescriptorSets[1].dstBinding = 1;
+        writeDescriptorSets[1].pBufferInfo = &jointPaletteBuffers[i].descriptor;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
       }
     }
   }
@@ -638,10 +1889,11 @@ void PBRIBLScene::setupDescriptors() {
       vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
   }
+  boundEnvironmentVersions.assign(MAX_FRAMES_IN_FLIGHT, pbrEnvironment.version);
 }
 
 void PBRIBLScene::addPipelineSet(const std::string prefix, const std::string vertexShader,
-                                 const std::string fragmentShader) {
+                                 const std::string fragmentShader, bool preSkinned, bool packed) {
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI{};
   inputAssemblyStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   inputAssemblyStateCI.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -667,7 +1919,7 @@ void PBRIBLScene::addPipelineSet(const std::string prefix, const std::string ver
   depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencilStateCI.depthTestEnable = VK_TRUE;
   depthStencilStateCI.depthWriteEnable = VK_TRUE;
-  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;  // reverse-Z
   depthStencilStateCI.front = depthStencilStateCI.back;
   depthStencilStateCI.back.compareOp = VK_COMPARE_OP_ALWAYS;
 
@@ -691,18 +1943,34 @@ void PBRIBLScene::addPipelineSet(const std::string prefix, const std::string ver
   // Vertex bindings and attributes
   VkVertexInputBindingDescription vertexInputBinding = tak::Vertex::getBindingDescription();
   std::array<VkVertexInputAttributeDescription, 8> vertexInputAttributes = tak::Vertex::getAttributeDescriptions();
+  // Packed streams depend on which optional streams the scene model stored
+  std::array<VkVertexInputBindingDescription, 4> packedInputBindings =
+      tak::PackedVertex::getBindingDescriptions(models.scene.packed.hasSkin, models.scene.packed.hasColor);
+  std::array<VkVertexInputAttributeDescription, 7> packedInputAttributes = tak::PackedVertex::getAttributeDescriptions();
 
   VkPipelineVertexInputStateCreateInfo vertexInputStateCI{};
   vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputStateCI.vertexBindingDescriptionCount = 1;
-  vertexInputStateCI.pVertexBindingDescriptions = &vertexInputBinding;
-  vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
-  vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttributes.data();
+  if (packed) {
+    vertexInputStateCI.vertexBindingDescriptionCount = static_cast<uint32_t>(packedInputBindings.size());
+    vertexInputStateCI.pVertexBindingDescriptions = packedInputBindings.data();
+    vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(packedInputAttributes.size());
+    vertexInputStateCI.pVertexAttributeDescriptions = packedInputAttributes.data();
+  } else {
+    vertexInputStateCI.vertexBindingDescriptionCount = 1;
+    vertexInputStateCI.pVertexBindingDescriptions = &vertexInputBinding;
+    vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
+    vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttributes.data();
+  }
 
   // Pipelines
   std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
   shaderStages[0] = loadShader(vertexShader, VK_SHADER_STAGE_VERTEX_BIT);
   shaderStages[1] = loadShader(fragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+  // PRE_SKINNED (constant_id = 0): vertices come from the compute skinning output
+  VkBool32 preSkinnedConstant = preSkinned ? VK_TRUE : VK_FALSE;
+  VkSpecializationMapEntry specializationEntry{0, 0, sizeof(VkBool32)};
+  VkSpecializationInfo specializationInfo{1, &specializationEntry, sizeof(VkBool32), &preSkinnedConstant};
+  shaderStages[0].pSpecializationInfo = &specializationInfo;
 
   VkGraphicsPipelineCreateInfo pipelineCI{};
   pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -727,7 +1995,17 @@ void PBRIBLScene::addPipelineSet(const std::string prefix, const std::string ver
   rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
   VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
   pipelines[prefix + "_double_sided"] = pipeline;
-  // Alpha blending
+  // Behind the depth pre-pass: only the fragment that wrote the depth passes, nothing left to write
+  depthStencilStateCI.depthWriteEnable = VK_FALSE;
+  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  rasterizationStateCI.cullMode = VK_CULL_MODE_BACK_BIT;
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+  pipelines[prefix + "_depth_equal"] = pipeline;
+  rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+  pipelines[prefix + "_double_sided_depth_equal"] = pipeline;
+  // Alpha blending, tested against the opaque depth but not written so sorted surfaces behind each other all show
+  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
   rasterizationStateCI.cullMode = VK_CULL_MODE_NONE;
   blendAttachmentState.blendEnable = VK_TRUE;
   blendAttachmentState.colorWriteMask =
@@ -740,6 +2018,32 @@ void PBRIBLScene::addPipelineSet(const std::string prefix, const std::string ver
   blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
   VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
   pipelines[prefix + "_alpha_blending"] = pipeline;
+  // Weighted blended OIT accumulation in subpass 1, fragment shader variant compiled with -DWEIGHTED_OIT
+  std::array<VkPipelineColorBlendAttachmentState, 2> oitBlendAttachmentStates{};
+  oitBlendAttachmentStates[0].blendEnable = VK_TRUE;
+  oitBlendAttachmentStates[0].colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  oitBlendAttachmentStates[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  oitBlendAttachmentStates[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  oitBlendAttachmentStates[0].colorBlendOp = VK_BLEND_OP_ADD;
+  oitBlendAttachmentStates[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  oitBlendAttachmentStates[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  oitBlendAttachmentStates[0].alphaBlendOp = VK_BLEND_OP_ADD;
+  oitBlendAttachmentStates[1].blendEnable = VK_TRUE;
+  oitBlendAttachmentStates[1].colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+  oitBlendAttachmentStates[1].srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+  oitBlendAttachmentStates[1].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+  oitBlendAttachmentStates[1].colorBlendOp = VK_BLEND_OP_ADD;
+  oitBlendAttachmentStates[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  oitBlendAttachmentStates[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  oitBlendAttachmentStates[1].alphaBlendOp = VK_BLEND_OP_ADD;
+  colorBlendStateCI.attachmentCount = static_cast<uint32_t>(oitBlendAttachmentStates.size());
+  colorBlendStateCI.pAttachments = oitBlendAttachmentStates.data();
+  vkDestroyShaderModule(device, shaderStages[1].module, nullptr);
+  shaderStages[1] = loadShader(fragmentShader.substr(0, fragmentShader.rfind(".frag.spv")) + "_oit.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+  pipelineCI.subpass = 1;
+  VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCI, nullptr, &pipeline));
+  pipelines[prefix + "_oit"] = pipeline;
 
   for (auto shaderStage : shaderStages) {
     vkDestroyShaderModule(device, shaderStage.module, nullptr);
@@ -813,33 +2117,43 @@ void PBRIBLScene::createMeshDataBuffer() {
   for (auto& node : models.scene.nodes) {
     assignMeshIndices(node);
   }
-  std::map<uint32_t, ShaderMeshData> meshDataMap;
+  meshes.assign(meshIndex, nullptr);
   for (auto& node : models.scene.linearNodes) {
-    ShaderMeshData meshData{};
     if (node->mesh) {
-      memcpy(meshData.jointMatrix, node->mesh->jointMatrix.data(), sizeof(glm::mat4) * MAX_NUM_JOINTS);
-      meshData.jointcount = node->mesh->jointcount;
-      meshData.matrix = node->mesh->matrix;
-      meshDataMap[node->mesh->index] = meshData;
+      meshes[node->mesh->index] = node->mesh;
     }
   }
-  // Convert map to vector in index order
-  std::vector<ShaderMeshData> shaderMeshData(meshDataMap.size());
-  for (const auto& [idx, data] : meshDataMap) {
-    shaderMeshData[idx] = data;
+  // Pack the joint palettes back to back, each mesh only reserves the joints its skin actually has
+  std::vector<ShaderMeshData> shaderMeshData(meshes.size());
+  std::vector<glm::mat4> jointPalette;
+  jointPaletteOffsets.assign(meshes.size(), 0);
+  for (tak::Mesh* mesh : meshes) {
+    jointPaletteOffsets[mesh->index] = static_cast<uint32_t>(jointPalette.size());
+    jointPalette.insert(jointPalette.end(), mesh->jointMatrix.begin(), mesh->jointMatrix.begin() + mesh->jointcount);
+    shaderMeshData[mesh->index].matrix = mesh->matrix;
+    shaderMeshData[mesh->index].jointOffset = jointPaletteOffsets[mesh->index];
+    shaderMeshData[mesh->index].jointcount = mesh->jointcount;
+  }
+  if (jointPalette.empty()) {
+    jointPalette.push_back(glm::mat4(1.0f));  // zero sized buffers are not allowed
   }
   // create buffers
-  for (auto& shaderMeshDataBuffer : shaderMeshDataBuffers) {
-    VkDeviceSize bufferSize = shaderMeshData.size() * sizeof(ShaderMeshData);
-    shaderMeshDataBuffer =
-        bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+  VkDeviceSize meshDataSize = shaderMeshData.size() * sizeof(ShaderMeshData);
+  VkDeviceSize jointPaletteSize = jointPalette.size() * sizeof(glm::mat4);
+  for (size_t i = 0; i < shaderMeshDataBuffers.size(); i++) {
+    shaderMeshDataBuffers[i] =
+        bufferManager->createBuffer(meshDataSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
-    bufferManager->updateBuffer(shaderMeshDataBuffer, shaderMeshData.data(), bufferSize, 0);
-    // Update descriptor
-    shaderMeshDataBuffer.descriptor.buffer = shaderMeshDataBuffer.buffer;
-    shaderMeshDataBuffer.descriptor.offset = 0;
-    shaderMeshDataBuffer.descriptor.range = bufferSize;
-    shaderMeshDataBuffer.device = device;
+    bufferManager->updateBuffer(shaderMeshDataBuffers[i], shaderMeshData.data(), meshDataSize, 0);
+    jointPaletteBuffers[i] =
+        bufferManager->createBuffer(jointPaletteSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+    bufferManager->updateBuffer(jointPaletteBuffers[i], jointPalette.data(), jointPaletteSize, 0);
+    // Both buffers now hold the current state of every mesh
+    uploadedMeshVersions[i].resize(meshes.size());
+    for (tak::Mesh* mesh : meshes) {
+      uploadedMeshVersions[i][mesh->index] = mesh->version;
+    }
   }
 }
 
@@ -884,6 +2198,41 @@ void PBRIBLScene::cleanupResources() {
   vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.meshDataBuffer, nullptr);
   descriptorSetLayouts.meshDataBuffer = VK_NULL_HANDLE;
 
+  // Compute skinning
+  vkDestroyPipeline(device, computeSkinning.pipeline, nullptr);
+  vkDestroyPipelineLayout(device, computeSkinning.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, computeSkinning.descriptorSetLayout, nullptr);
+  if (computeSkinning.queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, computeSkinning.queryPool, nullptr);
+  }
+  if (depthPrepass.queryPool != VK_NULL_HANDLE) {
+    vkDestroyQueryPool(device, depthPrepass.queryPool, nullptr);
+  }
+
+  // Shadow cascades, the caster pipelines are gone with the others
+  shadowCascades.reset();
+  for (auto& uniformBuffer : shadowUniformBuffers) {
+    bufferManager->destroyBuffer(uniformBuffer);
+  }
+
+  // Transparency composite
+  vkDestroyPipeline(device, transparency.compositePipeline, nullptr);
+  vkDestroyPipelineLayout(device, transparency.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, transparency.descriptorSetLayout, nullptr);
+  destroySkinnedVertexBuffers();
+
+  // Meshlet culling
+  vkDestroyPipeline(device, meshletCulling.pipeline, nullptr);
+  vkDestroyPipelineLayout(device, meshletCulling.pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, meshletCulling.descriptorSetLayout, nullptr);
+  for (size_t i = 0; i < meshletCulling.indexBuffers.size(); i++) {
+    bufferManager->destroyBuffer(meshletCulling.indexBuffers[i]);
+    bufferManager->destroyBuffer(meshletCulling.drawBuffers[i]);
+    bufferManager->destroyBuffer(meshletCulling.controlBuffers[i]);
+  }
+
+  // Streamed images go back to the model before it is destroyed
+  textureStreamer.reset();
   // Clean up models, buffers, textures...
   modelManager->destroyModel(models.scene);
   modelManager->destroyModel(models.skybox);
@@ -894,6 +2243,7 @@ void PBRIBLScene::cleanupResources() {
     bufferManager->destroyBuffer(uniformBuffers[i].skybox);
     bufferManager->destroyBuffer(uniformBuffers[i].scene);
     bufferManager->destroyBuffer(shaderMeshDataBuffers[i]);
+    bufferManager->destroyBuffer(jointPaletteBuffers[i]);
   }
 
   // Clean up skybox param buffer
@@ -963,6 +2313,7 @@ void PBRIBLScene::updateParams() {
       glm::vec4(sin(glm::radians(lightSource.rotation.x)) * cos(glm::radians(lightSource.rotation.y)),
                 sin(glm::radians(lightSource.rotation.y)),
                 cos(glm::radians(lightSource.rotation.x)) * cos(glm::radians(lightSource.rotation.y)), 0.0f);
+  shaderValuesParams.prefilteredCubeMipLevels = pbrEnvironment.prefilteredCubeMipLevels;
 }
 
 void PBRIBLScene::updateOverlay(float deltaTime) {
@@ -988,12 +2339,133 @@ void PBRIBLScene::updateOverlay(float deltaTime) {
 
   ImGui::Separator();
 
+  if (ui->checkbox("Compute skinning", &computeSkinning.enabled)) {
+    // Output buffers are only kept while they are used
+    vkDeviceWaitIdle(device);
+    if (computeSkinning.enabled) {
+      createSkinnedVertexBuffers();
+    } else {
+      destroySkinnedVertexBuffers();
+    }
+  }
+  ui->text("Skinned primitives: %d", static_cast<int>(computeSkinning.primitives.size()));
+  ui->text("Scene GPU, compute skinning: %.3f ms", computeSkinning.computeSkinningMs);
+  ui->text("Scene GPU, vertex skinning: %.3f ms", computeSkinning.vertexSkinningMs);
+
+  ImGui::Separator();
+
+  ui->checkbox("Depth pre-pass", &depthPrepass.enabled);
+  if (depthPrepass.queryPool != VK_NULL_HANDLE) {
+    ui->text("Shaded fragments, pre-pass: %llu", static_cast<unsigned long long>(depthPrepass.shadedFragments));
+    ui->text("Shaded fragments, no pre-pass: %llu", static_cast<unsigned long long>(depthPrepass.shadedFragmentsWithout));
+  }
+
+  ImGui::Separator();
+
+  ui->checkbox("Weighted blended OIT", &transparency.weightedOIT);
+  ui->text("Transparent primitives: %u", static_cast<uint32_t>(transparency.draws.size()));
+
+  ImGui::Separator();
+
+  ShadowCascades::Settings& shadowSettings = shadowCascades->settings;
+  int32_t shadowFilter = static_cast<int32_t>(shadowSettings.filter);
+  if (ui->combo("Shadow filter", &shadowFilter, {"Hard", "PCF", "PCSS"})) {
+    shadowSettings.filter = static_cast<ShadowCascades::Filter>(shadowFilter);
+  }
+  ui->slider("Light angle (deg)", &shadowSettings.lightAngle, 0.1f, 5.0f);
+  ui->slider("Shadow distance", &shadowSettings.maxDistance, 1.0f, 20.0f);
+  ui->slider("Split lambda", &shadowSettings.splitLambda, 0.0f, 1.0f);
+  ui->slider("Depth bias", &shadowSettings.depthBiasConstant, 0.0f, 8.0f);
+  ui->slider("Slope bias", &shadowSettings.depthBiasSlope, 0.0f, 8.0f);
+  ui->slider("Normal offset", &shadowSettings.normalOffset, 0.0f, 4.0f);
+  ui->checkbox("Cache static casters", &shadowSettings.cacheStatic);
+  ui->checkbox("Show cascades", &shadowSettings.showCascades);
+  for (uint32_t i = 0; i < ShadowCascades::CASCADE_COUNT; i++) {
+    const ShadowCascades::Cascade& cascade = shadowCascades->cascade(i);
+    ui->text("%u: %.2f-%.2f, %u casters (%u culled), %u cache updates", i, cascade.splitNear, cascade.splitFar, cascade.casters,
+             cascade.culled, cascade.cacheUpdates);
+    ui->text("   GPU static %.3f ms, dynamic %.3f ms", cascade.staticMs, cascade.dynamicMs);
+  }
+  ui->text("GPU cache copy: %.3f ms (%u tiles)", shadowCascades->copyMs(), shadowCascades->copiedTiles());
+
+  ImGui::Separator();
+
+  VkDeviceSize packedBytes = models.scene.packed.positions.size + models.scene.packed.surface.size + models.scene.packed.skin.size +
+                             models.scene.packed.color.size;
+  VkDeviceSize skinnedBytes = 0;
+  for (const auto& vertexBuffer : computeSkinning.vertexBuffers) {
+    skinnedBytes += vertexBuffer.size;
+  }
+  ui->text("Vertex format: %s (set at load)", packedVertices ? "packed" : "full");
+  ui->text("Vertex memory: %.1f KB full, %.1f KB packed, %.1f KB skinned output", models.scene.vertices.size / 1024.0f,
+           packedBytes / 1024.0f, skinnedBytes / 1024.0f);
+
+  ImGui::Separator();
+
+  if (models.scene.meshlets.drawCount > 0) {
+    ui->checkbox("Meshlet culling", &meshletCulling.enabled);
+    ui->text("Meshlets visible: %u / %u", meshletCulling.visibleMeshlets, static_cast<uint32_t>(models.scene.meshlets.clusters.size()));
+    ui->text("Triangles after culling: %u", meshletCulling.culledTriangles);
+  }
+  ui->checkbox("Mesh LOD", &meshLodEnabled);
+  ui->slider("LOD error (px)", &lodErrorThreshold, 0.25f, 8.0f);
+  ui->text("Triangles: %u / %u", renderedTriangles, fullTriangles);
+
+  ImGui::Separator();
+
+  ui->checkbox("Animation LOD", &animationLodEnabled);
+  ui->text("Screen size: %.3f (%s)", animationLod.screenSize,
+           !animationLod.visible ? "off-screen" : (animationLod.reducedJoints ? "reduced joints" : "all joints"));
+  ImGui::SliderInt("Crowd instances", &crowdBenchmark.instanceCount, 64, 1024);
+  if (ui->button("Run crowd benchmark")) {
+    runCrowdBenchmark();
+  }
+  if (crowdBenchmark.fullRateMs > 0.0f) {
+    ui->text("CPU full rate: %.3f ms/frame", crowdBenchmark.fullRateMs);
+    ui->text("CPU animation LOD: %.3f ms/frame", crowdBenchmark.lodMs);
+    ui->text("Off-screen: %u, reduced joints: %u", crowdBenchmark.offScreen, crowdBenchmark.reducedJoints);
+  }
+
+  ImGui::Separator();
+
+  if (!environmentFiles.empty()) {
+    ui->combo("Environment", &selectedEnvironment, environmentFiles);
+    ui->checkbox("Incremental IBL", &incrementalIBL);
+    if (ui->button("Switch environment")) {
+      switchEnvironment(std::string(TEXTURE_DIR) + "/skybox/" + environmentFiles[selectedEnvironment]);
+    }
+  }
+  if (environmentUpdate.active) {
+    ui->text("IBL update: %u / %u jobs", static_cast<uint32_t>(environmentUpdate.nextJob), static_cast<uint32_t>(environmentUpdate.jobs.size()));
+  }
+  ui->slider("IBL budget (ms)", &environmentUpdate.budgetMs, 0.25f, 8.0f);
+  if (environmentUpdate.lastSwitchFrames > 0) {
+    ui->text("Last switch: %.1f ms over %u frames", environmentUpdate.lastSwitchMs, environmentUpdate.lastSwitchFrames);
+  }
+
+  ImGui::Separator();
+
+  if (textureStreamer) {
+    const TextureStreamer::Stats& streamStats = textureStreamer->stats();
+    float budgetMB = static_cast<float>(textureStreamer->settings.budget) / (1024.0f * 1024.0f);
+    if (ui->slider("Texture budget (MB)", &budgetMB, 8.0f, 512.0f)) {
+      textureStreamer->settings.budget = static_cast<VkDeviceSize>(budgetMB * 1024.0f * 1024.0f);
+    }
+    ui->slider("Texture LOD bias", &textureStreamer->settings.lodBias, -1.0f, 4.0f);
+    ui->text("Textures resident: %.1f MB", streamStats.residentBytes / (1024.0f * 1024.0f));
+    ui->text("Requested %.1f MB, all levels %.1f MB", streamStats.requestedBytes / (1024.0f * 1024.0f),
+             streamStats.fullBytes / (1024.0f * 1024.0f));
+    ui->text("Pending: %u / %u textures", streamStats.pendingTextures, streamStats.textures);
+    ui->text("Levels streamed in: %u, evicted: %u", streamStats.levelsStreamedIn, streamStats.levelsEvicted);
+    ImGui::Separator();
+  }
+
   ui->checkbox("Show Texture", &showTexture);
 
   if (showTexture) {
-    for (int i = 0; i < imguiTexId.size(); i++) {
+    for (size_t i = 0; i < imguiTexIds[currentFrame].size(); i++) {
       ImGui::Separator();
-      ImGui::Image(imguiTexId[i], ImVec2(128, 128));
+      ImGui::Image(imguiTexIds[currentFrame][i], ImVec2(128, 128));
     }
   }
   ImGui::End();
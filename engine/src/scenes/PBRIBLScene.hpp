@@ -3,11 +3,13 @@
 #include <unordered_set>
 #include <vector>
 
+#include "renderer/ShadowCascades.hpp"
+#include "renderer/TextureStreamer.hpp"
 #include "renderer/VulkanBase.hpp"
 
 class TAK_API PBRIBLScene : public VulkanBase {
  public:
-  PBRIBLScene() {};
+  PBRIBLScene() { transparencySubpasses = true; };
   ~PBRIBLScene() = default;
 
  protected:
@@ -17,7 +19,8 @@ class TAK_API PBRIBLScene : public VulkanBase {
   void recordRenderCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
   void updateScene(float deltaTime) override;
   void cleanupResources() override;
-  void onResize(int width, int height) override {};
+  void onResize(int width, int height) override;
+  void recordPreRenderPassCommands(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
 
  private:
   // ============= Scene Data =============
@@ -90,13 +93,17 @@ class TAK_API PBRIBLScene : public VulkanBase {
   };
   BufferManager::Buffer shaderMaterialBuffer;
 
-  // Mesh data SSBO (per-mesh transforms, skinning)
+  // Mesh data SSBO (per-mesh transforms), joint palettes live in a separate packed pool
   struct alignas(16) ShaderMeshData {
     glm::mat4 matrix;
-    glm::mat4 jointMatrix[MAX_NUM_JOINTS];
+    uint32_t jointOffset{0};  // first mat4 of this mesh in the joint palette pool
     uint32_t jointcount{0};
   };
   std::vector<BufferManager::Buffer> shaderMeshDataBuffers;  // One per frame
+  std::vector<BufferManager::Buffer> jointPaletteBuffers;    // One per frame, sized to the sum of actual joint counts
+  std::vector<tak::Mesh*> meshes;                            // By mesh index
+  std::vector<uint32_t> jointPaletteOffsets;                 // By mesh index
+  std::vector<std::vector<uint32_t>> uploadedMeshVersions;   // [frame][mesh index] = tak::Mesh::version last written
 
   // ============= Descriptors =============
   // Descriptor layouts
@@ -114,6 +121,7 @@ class TAK_API PBRIBLScene : public VulkanBase {
   std::vector<DescriptorSets> descriptorSets;           // One per frame
   std::vector<VkDescriptorSet> descriptorSetsMeshData;  // One per frame
   VkDescriptorSet descriptorSetMaterials{VK_NULL_HANDLE};
+  std::vector<std::vector<VkDescriptorSet>> materialDescriptorSets;  // [frame][material] texture sets
 
   VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 
@@ -122,6 +130,7 @@ class TAK_API PBRIBLScene : public VulkanBase {
   struct MeshPushConstantBlock {
     int32_t meshIndex;
     int32_t materialIndex;
+    int32_t cascade;  // shadow caster pipelines only
   };
 
   // Pipeline
@@ -130,6 +139,7 @@ class TAK_API PBRIBLScene : public VulkanBase {
   VkPipeline boundPipeline{VK_NULL_HANDLE};  // Track current bound pipeline
   TextureManager::Texture emptyTexture;      // White texture
   bool displayBackground = true;
+  bool packedVertices = true;  // load time: only the tak::PackedVertex streams are created (compute skinning decodes them)
 
   // skybox pipeline
   VkPipeline skyboxPipeline = VK_NULL_HANDLE;
@@ -139,10 +149,173 @@ class TAK_API PBRIBLScene : public VulkanBase {
   BufferManager::Buffer skyBoxParamBuffer;
   void createSkyboxPipeline();
 
+  // Environment switching: each frame slot rebinds the IBL textures once pbrEnvironment.version moved past the one it holds
+  std::vector<uint32_t> boundEnvironmentVersions;  // One per frame
+  std::vector<std::string> environmentFiles;       // equirect images in TEXTURE_DIR/skybox
+  int32_t selectedEnvironment = 0;
+  bool incrementalIBL = true;  // filter over several frames instead of waiting for the device and regenerating in place
+  void switchEnvironment(const std::string& filename);
+  void updateEnvironmentDescriptors(uint32_t frame);
+
+  // ============= Texture streaming =============
+  // Scene textures keep only their mip tail resident, larger levels follow the screen size (see TextureStreamer)
+  bool textureStreaming = true;  // read at load time
+  std::unique_ptr<TextureStreamer> textureStreamer;
+  std::vector<uint32_t> boundTextureVersions;  // One per frame, TextureStreamer::version the material sets were written with
+  void writeMaterialDescriptors(uint32_t frame);
+
+  // ============= Mesh LOD =============
+  // Per primitive level picked from the projected simplification error of tak::Primitive::lods
+  bool meshLodEnabled = true;
+  float lodErrorThreshold = 1.0f;  // pixels
+  float lodHysteresis = 0.25f;     // a coarser level has to be this much below the threshold before switching to it
+  uint32_t renderedTriangles = 0;  // scene triangles of the last recorded frame, with and without LOD
+  uint32_t fullTriangles = 0;
+  uint32_t selectLod(const tak::Node* node, tak::Primitive* primitive);
+
+  // ============= Meshlet culling =============
+  // Compute pass before the render pass: frustum and normal cone tests per meshlet of the selected LOD, surviving
+  // index ranges are compacted into a per-frame index buffer and drawn with one vkCmdDrawIndexedIndirect per primitive
+  struct MeshletCullPushConstantBlock {
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPos;
+    uint32_t meshletCount;
+  };
+  struct MeshletCulling {
+    bool enabled = true;
+    std::vector<BufferManager::Buffer> indexBuffers;    // copy of the model indices, culled ranges rewritten every frame
+    std::vector<BufferManager::Buffer> drawBuffers;     // VkDrawIndexedIndirectCommand per culled primitive, host visible for stats
+    std::vector<BufferManager::Buffer> controlBuffers;  // visible meshlet counter + selected LOD per draw, host visible
+    std::vector<bool> recorded;                         // frame slot holds results of a culled frame
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> descriptorSets;  // One per frame
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline pipeline{VK_NULL_HANDLE};
+    uint32_t visibleMeshlets = 0;  // results of the last completed use of the frame slot
+    uint32_t culledTriangles = 0;  // triangles drawn through the indirect path
+  } meshletCulling;
+  void createMeshletCulling();
+  void createMeshletCullingPipeline();
+  void recordMeshletCulling(VkCommandBuffer commandBuffer);
+
+  // ============= Depth pre-pass =============
+  // Opaque and masked primitives are drawn depth-only first ("depth" pipelines: position and skin streams only, alpha test
+  // for masked materials), the shaded draws then test with EQUAL without writing depth ("_depth_equal" pipelines) so
+  // material_pbr.frag runs once per visible pixel instead of once per overdrawn fragment
+  struct DepthPrepass {
+    bool enabled = true;
+    std::vector<bool> recordedWithPrepass;  // mode each frame in flight was recorded with
+    // Fragment shader invocations of the shaded opaque and masked draws, one pipeline statistics query per frame in flight
+    VkQueryPool queryPool{VK_NULL_HANDLE};
+    uint64_t shadedFragments = 0;         // last completed frame recorded with the pre-pass
+    uint64_t shadedFragmentsWithout = 0;  // and without
+  } depthPrepass;
+  void createDepthPrepass();
+  // shadowCaster: the same pipelines for ShadowCascades::renderPass() ("shadow" pipelines, no culling, depth bias)
+  void addDepthPrepassPipelines(const std::string prefix, bool preSkinned = false, bool packed = false, bool shadowCaster = false);
+  void readPrepassStatistics();
+
+  // ============= Shadow cascades =============
+  // Sun shadows of the opaque and masked primitives (see ShadowCascades), blended ones do not cast. Skinned meshes and
+  // nodes moved by the running animation are dynamic casters, everything else is drawn into the cached static cascades
+  std::unique_ptr<ShadowCascades> shadowCascades;
+  std::vector<BufferManager::Buffer> shadowUniformBuffers;  // One per frame, ShadowCascades::UniformData
+  std::unordered_set<const tak::Node*> animatedNodes;       // channel targets of shadowAnimation
+  int32_t shadowAnimation = -1;                             // animation the static casters were split for, -1 if none runs
+  void createShadowCascades();
+  void updateShadowCascades();
+  void recordShadowCascades(VkCommandBuffer commandBuffer);
+  void recordShadowCasters(VkCommandBuffer commandBuffer, uint32_t cascade, bool staticCasters);
+  void renderShadowNode(VkCommandBuffer commandBuffer, tak::Node* node, uint32_t cascade, bool staticCasters, bool animated);
+  uint32_t dynamicShadowCascades(tak::Node* node, bool animated) const;
+
+  // ============= Transparency =============
+  // Blended primitives are drawn after the opaque ones, either sorted back to front by the view depth of their bounding
+  // box center, or unsorted into the weighted blended OIT targets of subpass 1 and composited over the scene in
+  // subpass 2 (see VulkanBase::transparencySubpasses), which needs no sorting at all
+  struct TransparentDraw {
+    float viewDepth;
+    tak::Node* node;
+    tak::Primitive* primitive;
+  };
+  struct Transparency {
+    bool weightedOIT = false;
+    std::vector<TransparentDraw> draws;  // blended primitives of the last recorded frame
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};  // input attachments, rewritten when the swapchain is recreated
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline compositePipeline{VK_NULL_HANDLE};
+  } transparency;
+  void createTransparencyComposite();
+  void writeTransparencyDescriptors();
+  void collectTransparentDraws(tak::Node* node, const glm::mat4& viewFromModel);
+  // Starts in the scene subpass and ends in the composite subpass
+  void recordTransparency(VkCommandBuffer commandBuffer);
+
+  // ============= Compute skinning =============
+  // Optional pre-pass: skinned vertices are skinned once per frame into a per-frame vertex buffer,
+  // every later draw of the scene then fetches them as static geometry ("_preskinned" pipelines)
+  struct SkinningPushConstantBlock {
+    uint32_t meshIndex;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t skinned;  // 0 only decodes the packed streams
+    // tak::Vertex layout in floats
+    uint32_t vertexStride;
+    uint32_t posOffset;
+    uint32_t normalOffset;
+    uint32_t uv0Offset;
+    uint32_t uv1Offset;
+    uint32_t jointOffset;
+    uint32_t weightOffset;
+    uint32_t colorOffset;
+    uint32_t tangentOffset;
+    // Packed skin and color streams in elements, 0 when they hold the single default element
+    uint32_t skinStride;
+    uint32_t colorStride;
+  };
+  struct ComputeSkinning {
+    bool enabled = false;
+    std::vector<bool> recordedWithCompute;             // mode each frame in flight was recorded with
+    std::vector<BufferManager::Buffer> vertexBuffers;  // skinned output, one per frame, only while enabled
+    std::vector<std::pair<tak::Mesh*, tak::Primitive*>> primitives;  // skinned primitives to dispatch
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> descriptorSets;  // One per frame
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline pipeline{VK_NULL_HANDLE};
+    // GPU time from before skinning to the end of the scene draws, averaged per mode
+    VkQueryPool queryPool{VK_NULL_HANDLE};
+    float computeSkinningMs = 0.0f;
+    float vertexSkinningMs = 0.0f;
+  } computeSkinning;
+  void createComputeSkinning();
+  void createComputeSkinningPipeline();
+  SkinningPushConstantBlock skinningPushConstants() const;
+  void createSkinnedVertexBuffers();
+  void destroySkinnedVertexBuffers();
+  void recordComputeSkinning(VkCommandBuffer commandBuffer);
+  void readSkinningTimings();
+
   // ============= Animation =============
   int32_t animationIndex = 0;
   float animationTimer = 0.0f;
   bool animate = true;
+  bool animationLodEnabled = true;
+  ModelManager::AnimationLodSettings animationLodSettings;
+  ModelManager::AnimationLodState animationLod;
+  glm::mat4 sceneClipFromModel(const glm::mat4& instance = glm::mat4(1.0f)) const;
+  // CPU cost of animating many instances of the scene model, each with its own time offset and grid position,
+  // evaluated once at full rate and once through the animation LOD path (nothing is drawn for the instances)
+  struct CrowdBenchmark {
+    int32_t instanceCount = 256;
+    uint32_t frames = 120;
+    float fullRateMs = 0.0f;  // average CPU time per simulated frame
+    float lodMs = 0.0f;
+    uint32_t evaluated = 0;  // instance updates the LOD path actually evaluated over all frames
+    uint32_t offScreen = 0;  // instances off-screen / on the reduced joint set in the last frame
+    uint32_t reducedJoints = 0;
+  } crowdBenchmark;
+  void runCrowdBenchmark();
   // ui
   UI* ui{nullptr};
   void updateOverlay(float deltaTime);
@@ -150,7 +323,7 @@ class TAK_API PBRIBLScene : public VulkanBase {
   float fps = 0.0f;
   float fpsTimer = 0.0f;
   uint32_t frameCounter = 0;
-  std::vector<ImTextureID> imguiTexId;
+  std::vector<std::vector<ImTextureID>> imguiTexIds;  // per frame, shared ids unless the textures are streamed
   // ============= defines =============
   enum PBRWorkflows { PBR_WORKFLOW_METALLIC_ROUGHNESS = 0, PBR_WORKFLOW_SPECULAR_GLOSSINESS = 1 };
   // List of glTF extensions supported by this application
@@ -168,6 +341,12 @@ class TAK_API PBRIBLScene : public VulkanBase {
   void updateParams();
   void updateMeshDataBuffer(uint32_t index);
   void setupDescriptors();
-  void addPipelineSet(const std::string prefix, const std::string vertexShader, const std::string fragmentShader);
-  void renderNode(VkCommandBuffer cmdBuffer, tak::Node* node, uint32_t ImageIndex, tak::Material::AlphaMode alphaMode);
+  void addPipelineSet(const std::string prefix, const std::string vertexShader, const std::string fragmentShader, bool preSkinned = false,
+                      bool packed = false);
+  // Vertex and index buffers the scene primitives draw from (packed, pre-skinned or full, meshlet or model indices)
+  void bindSceneBuffers(VkCommandBuffer commandBuffer);
+  void renderNode(VkCommandBuffer cmdBuffer, tak::Node* node, uint32_t ImageIndex, tak::Material::AlphaMode alphaMode,
+                  bool depthOnly = false);
+  void drawPrimitive(VkCommandBuffer cmdBuffer, tak::Node* node, tak::Primitive* primitive, tak::Material::AlphaMode alphaMode,
+                     bool depthOnly = false);
 };
\ No newline at end of file
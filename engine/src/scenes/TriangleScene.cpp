@@ -119,7 +119,7 @@ void TriangleScene::createPipeline() {
   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
   depthStencil.depthTestEnable = VK_TRUE;
   depthStencil.depthWriteEnable = VK_TRUE;
-  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_GREATER;  // reverse-Z
   depthStencil.depthBoundsTestEnable = VK_FALSE;
   depthStencil.stencilTestEnable = VK_FALSE;
 
@@ -191,9 +191,9 @@ void TriangleScene::createSkyboxPipeline() {
 
   VkPipelineDepthStencilStateCreateInfo depthStencilStateCI{};
   depthStencilStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-  depthStencilStateCI.depthTestEnable = VK_FALSE;
+  depthStencilStateCI.depthTestEnable = VK_TRUE;
   depthStencilStateCI.depthWriteEnable = VK_FALSE;
-  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  depthStencilStateCI.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;  // sky depth is 0, passes only where nothing was drawn
   depthStencilStateCI.depthBoundsTestEnable = VK_FALSE;
   depthStencilStateCI.stencilTestEnable = VK_FALSE;
 
@@ -514,16 +514,6 @@ void TriangleScene::recordRenderCommands(VkCommandBuffer commandBuffer, uint32_t
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
   VkDeviceSize offsets[] = {0};
 
-  // draw skybox TODO: fix shader to ensure depth to maximum (1.0) so we can draw after anyobjs
-  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipelineLayout, 0, 1,
-                          &skyboxDescriptorSets[currentFrame], 0, nullptr);
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
-  const VkDeviceSize offsetSkybox[1] = {0};
-  for (tak::Node* node : skybox.nodes) {
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &skybox.vertices.buffer, offsetSkybox);
-    vkCmdBindIndexBuffer(commandBuffer, skybox.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-    modelManager->drawNode(node, commandBuffer);
-  }
   // scene obj
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
@@ -534,6 +524,17 @@ void TriangleScene::recordRenderCommands(VkCommandBuffer commandBuffer, uint32_t
                           &descriptorSets[currentFrame], 0, nullptr);
   vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
 
+  // draw skybox after the objects, it sits at depth 0 (reverse-Z) and only shades the pixels they left empty
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipelineLayout, 0, 1,
+                          &skyboxDescriptorSets[currentFrame], 0, nullptr);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
+  const VkDeviceSize offsetSkybox[1] = {0};
+  for (tak::Node* node : skybox.nodes) {
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &skybox.vertices.buffer, offsetSkybox);
+    vkCmdBindIndexBuffer(commandBuffer, skybox.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+    modelManager->drawNode(node, commandBuffer);
+  }
+
   ui->draw(commandBuffer);
 }
 
@@ -1,10 +1,23 @@
 // ModelTest.cpp
 #include "ModelTest.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <random>
+
+#include "renderer/BlockCompressor.hpp"
+#include "renderer/EquirectConverter.hpp"
+#include "renderer/ShadowCascades.hpp"
+
 ModelTest::ModelTest() {
   spdlog::info("ModelTest constructor called");
   modelFilePath = std::string(MODEL_DIR) + "/buster_drone/scene.gltf";
   spdlog::info("Model path: {}", modelFilePath);
+  // Any KHR_texture_basisu model placed here is used for the transcoding benchmark, the test model otherwise
+  basisuModelPath = std::string(MODEL_DIR) + "/basisu/scene.gltf";
   title = "Model Loader Test";
   name = "ModelTest";
 
@@ -284,10 +297,280 @@ void ModelTest::loadResources() {
     }
   }
 
-  // 8. Final Summary
+  // 8. Mesh optimization (load-time reordering of the model + a shuffled grid with known geometry)
+  spdlog::info("\n=== Mesh Optimization Validation ===");
+  int meshOptimizationErrors = 0;
+  const auto& optimization = testModel.optimization;
+  spdlog::info("Model{}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", optimization.fromCache ? " (cached)" : "", optimization.before.acmr,
+               optimization.after.acmr, optimization.before.atvr, optimization.after.atvr);
+  if (!optimization.geometryPreserved) {
+    spdlog::error("ERROR: Mesh optimization changed the model's triangles");
+    meshOptimizationErrors++;
+  }
+  if (optimization.after.acmr > optimization.before.acmr) {
+    spdlog::error("ERROR: Mesh optimization made the model's ACMR worse");
+    meshOptimizationErrors++;
+  }
+  {
+    const uint32_t gridSize = 64;
+    std::vector<glm::vec3> positions;
+    for (uint32_t y = 0; y <= gridSize; y++) {
+      for (uint32_t x = 0; x <= gridSize; x++) {
+        positions.push_back(glm::vec3(x, y, std::sin(x * 0.2f) * std::cos(y * 0.2f)));
+      }
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < gridSize; y++) {
+      for (uint32_t x = 0; x < gridSize; x++) {
+        uint32_t i0 = y * (gridSize + 1) + x;
+        uint32_t i1 = i0 + gridSize + 1;
+        triangles.push_back({i0, i0 + 1, i1 + 1});
+        triangles.push_back({i0, i1 + 1, i1});
+      }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+    std::vector<uint32_t> original;
+    for (const auto& triangle : triangles) {
+      original.insert(original.end(), triangle.begin(), triangle.end());
+    }
+    const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    std::vector<uint32_t> optimized = original;
+    MeshOptimizer::optimizeVertexCache(optimized, vertexCount);
+    MeshOptimizer::optimizeOverdraw(optimized, positions);
+    std::vector<uint32_t> remap = MeshOptimizer::optimizeVertexFetch(optimized, vertexCount);
+    MeshOptimizer::VertexCacheStats before = MeshOptimizer::analyzeVertexCache(original, vertexCount);
+    MeshOptimizer::VertexCacheStats after = MeshOptimizer::analyzeVertexCache(optimized, vertexCount);
+    spdlog::info("Shuffled {}x{} grid: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", gridSize, gridSize, before.acmr, after.acmr, before.atvr, after.atvr);
+    if (!MeshOptimizer::sameTriangles(original, optimized, remap)) {
+      spdlog::error("ERROR: Grid triangles changed during optimization");
+      meshOptimizationErrors++;
+    }
+    if (after.acmr >= before.acmr * 0.5f) {
+      spdlog::error("ERROR: Grid ACMR did not improve by at least 2x");
+      meshOptimizationErrors++;
+    }
+    // First-use order: the optimized index stream never jumps more than one past the highest vertex seen so far
+    uint32_t highest = 0;
+    for (uint32_t index : optimized) {
+      if (index > highest + 1) {
+        spdlog::error("ERROR: Vertex fetch order is not first-use order");
+        meshOptimizationErrors++;
+        break;
+      }
+      highest = std::max(highest, index);
+    }
+  }
+  if (meshOptimizationErrors == 0) {
+    spdlog::info("✓ Mesh optimization preserves geometry and improves vertex cache usage");
+  }
+
+  // 9. Equirect Conversion Validation
+  spdlog::info("\n=== Equirect Conversion Validation ===");
+  int equirectConversionErrors = 0;
+  {
+    // Smooth gradients plus hard checker edges, compared against the scalar reference for both pixel formats
+    const int srcWidth = 1024, srcHeight = 512, faceSize = 256;
+    const float tolerance = 0.005f;  // of the source range, the polynomial atan2 moves taps by ~0.003 texels
+    const size_t facePixels = static_cast<size_t>(faceSize) * faceSize;
+    std::vector<float> hdrSource(static_cast<size_t>(srcWidth) * srcHeight * 4);
+    std::vector<uint8_t> ldrSource(hdrSource.size());
+    for (int y = 0; y < srcHeight; y++) {
+      for (int x = 0; x < srcWidth; x++) {
+        for (int c = 0; c < 4; c++) {
+          float value = 2.0f + std::sin(x * 0.01f * (c + 1)) * std::cos(y * 0.02f) + (((x / 64) + (y / 64)) % 2) * 5.0f;
+          size_t i = (static_cast<size_t>(y) * srcWidth + x) * 4 + c;
+          hdrSource[i] = value;
+          ldrSource[i] = static_cast<uint8_t>(std::min(value * 30.0f, 255.0f));
+        }
+      }
+    }
+    for (bool isHDR : {true, false}) {
+      const void* source = isHDR ? static_cast<const void*>(hdrSource.data()) : ldrSource.data();
+      size_t faceBytes = facePixels * (isHDR ? sizeof(float) * 4 : 4);
+      std::vector<uint8_t> reference(faceBytes * 6), result(faceBytes * 6);
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int face = 0; face < 6; face++) {
+        EquirectConverter::convertFaceScalar(source, srcWidth, srcHeight, reference.data() + face * faceBytes, face, faceSize, isHDR);
+      }
+      auto scalarEnd = std::chrono::high_resolution_clock::now();
+      EquirectConverter::convertCubemap(source, srcWidth, srcHeight, result.data(), faceSize, isHDR);
+      auto parallelEnd = std::chrono::high_resolution_clock::now();
+      float error = EquirectConverter::maxRelativeError(reference.data(), result.data(), facePixels * 6, isHDR);
+      spdlog::info("{}: scalar {:.2f} ms, {}-wide SIMD + threads {:.2f} ms, max error {:.5f}", isHDR ? "HDR" : "LDR",
+                   std::chrono::duration<float, std::milli>(scalarEnd - start).count(), EquirectConverter::simdWidth(),
+                   std::chrono::duration<float, std::milli>(parallelEnd - scalarEnd).count(), error);
+      if (error > tolerance) {
+        spdlog::error("ERROR: {} equirect conversion differs from the scalar reference by {:.5f} (tolerance {})", isHDR ? "HDR" : "LDR", error,
+                      tolerance);
+        equirectConversionErrors++;
+      }
+
+      // equirect2cube.comp, faces read back from the GPU
+      std::fill(result.begin(), result.end(), uint8_t(0));
+      if (!textureManager->convertEquirectToFacesOnGPU(source, srcWidth, srcHeight, faceSize, isHDR, result.data())) {
+        spdlog::warn("{} cubemap format has no storage image support, GPU conversion skipped", isHDR ? "HDR" : "LDR");
+        continue;
+      }
+      float gpuError = EquirectConverter::maxRelativeError(reference.data(), result.data(), facePixels * 6, isHDR);
+      spdlog::info("{}: GPU compute max error {:.5f}", isHDR ? "HDR" : "LDR", gpuError);
+      if (gpuError > tolerance) {
+        spdlog::error("ERROR: {} GPU equirect conversion differs from the scalar reference by {:.5f} (tolerance {})", isHDR ? "HDR" : "LDR",
+                      gpuError, tolerance);
+        equirectConversionErrors++;
+      }
+    }
+  }
+  if (equirectConversionErrors == 0) {
+    spdlog::info("✓ SIMD and GPU equirect conversions match the scalar reference");
+  }
+
+  // 10. Texture transcoding: serial baseline against the transcode workers on the same model
+  spdlog::info("\n=== Texture Transcoding ===");
+  int textureTranscodeErrors = 0;
+  {
+    const std::string transcodeModelPath = std::filesystem::exists(basisuModelPath) ? basisuModelPath : modelFilePath;
+    // Streaming keeps the CPU mip chains of the model, their texels are compared below
+    const uint32_t configuredThreads = modelManager->transcodeThreads;
+    const bool configuredStreaming = modelManager->streamTextures;
+    modelManager->streamTextures = true;
+    modelManager->transcodeThreads = 1;
+    ModelManager::Model serial = modelManager->createModelFromFile(transcodeModelPath, 1.0f);
+    modelManager->transcodeThreads = configuredThreads;
+    ModelManager::Model parallel = modelManager->createModelFromFile(transcodeModelPath, 1.0f);
+    modelManager->streamTextures = configuredStreaming;
+    spdlog::info("{}: {} textures, {} transcode jobs", transcodeModelPath, parallel.textures.size(), parallel.textureLoad.transcodeJobs);
+    spdlog::info("Serial {:.1f} ms, {} threads {:.1f} ms ({:.2f}x)", serial.textureLoad.milliseconds, parallel.textureLoad.threads,
+                 parallel.textureLoad.milliseconds, serial.textureLoad.milliseconds / std::max(parallel.textureLoad.milliseconds, 0.001f));
+    if (parallel.textureLoad.transcodeJobs == 0) {
+      spdlog::warn("No KTX2 images in {}, nothing was transcoded", transcodeModelPath);
+    }
+    if (serial.textures.size() != parallel.textures.size()) {
+      spdlog::error("ERROR: Serial and parallel loads created {} and {} textures", serial.textures.size(), parallel.textures.size());
+      textureTranscodeErrors++;
+    } else {
+      for (size_t i = 0; i < parallel.textures.size(); i++) {
+        const auto& a = serial.textures[i];
+        const auto& b = parallel.textures[i];
+        if (a.format != b.format || a.mipLevels != b.mipLevels || a.extent.width != b.extent.width || a.extent.height != b.extent.height) {
+          spdlog::error("ERROR: Texture {} differs between serial and parallel transcoding", i);
+          textureTranscodeErrors++;
+          continue;
+        }
+        // Transcoding is deterministic, every level has to match byte for byte
+        const TextureManager::MipChain& chainA = serial.textureMipChains[i];
+        const TextureManager::MipChain& chainB = parallel.textureMipChains[i];
+        if (chainA.format != chainB.format || chainA.levels.size() != chainB.levels.size()) {
+          spdlog::error("ERROR: Texture {} mip chains differ between serial and parallel transcoding", i);
+          textureTranscodeErrors++;
+          continue;
+        }
+        for (size_t level = 0; level < chainA.levels.size(); level++) {
+          if (chainA.levels[level] != chainB.levels[level]) {
+            spdlog::error("ERROR: Texture {} level {} texels differ between serial and parallel transcoding", i, level);
+            textureTranscodeErrors++;
+            break;
+          }
+        }
+      }
+    }
+    modelManager->destroyModel(serial);
+    modelManager->destroyModel(parallel);
+  }
+  if (textureTranscodeErrors == 0) {
+    spdlog::info("✓ Parallel transcoding matches the serial textures");
+  }
+
+  // 11. Block compression: round trip error per format, single thread against all threads
+  spdlog::info("\n=== Block Compression ===");
+  int blockCompressionErrors = 0;
+  {
+    // Gradients, a smooth normal field and hard edges, odd size to cover partial blocks
+    const uint32_t width = 1021, height = 509;
+    std::vector<uint8_t> source(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+      for (uint32_t x = 0; x < width; x++) {
+        const float nx = std::sin(x * 0.02f) * 0.6f, ny = std::cos(y * 0.03f) * 0.6f;
+        uint8_t* texel = &source[(static_cast<size_t>(y) * width + x) * 4];
+        texel[0] = static_cast<uint8_t>((nx * 0.5f + 0.5f) * 255.0f + 0.5f);
+        texel[1] = static_cast<uint8_t>((ny * 0.5f + 0.5f) * 255.0f + 0.5f);
+        texel[2] = static_cast<uint8_t>((((x / 32) + (y / 32)) % 2) * 200 + 20);
+        texel[3] = static_cast<uint8_t>(255 - (x * 255) / width);
+      }
+    }
+    struct Case {
+      BlockCompressor::Format format;
+      const char* name;
+      float tolerance;  // rms in 8 bit units over the stored channels
+    };
+    for (const Case& test : {Case{BlockCompressor::Format::BC4, "BC4", 2.0f}, Case{BlockCompressor::Format::BC5, "BC5", 2.0f},
+                             Case{BlockCompressor::Format::BC7, "BC7", 6.0f}}) {
+      auto start = std::chrono::high_resolution_clock::now();
+      std::vector<uint8_t> serial = BlockCompressor::compressImage(source.data(), width, height, test.format, 1);
+      auto serialEnd = std::chrono::high_resolution_clock::now();
+      std::vector<uint8_t> parallel = BlockCompressor::compressImage(source.data(), width, height, test.format);
+      auto parallelEnd = std::chrono::high_resolution_clock::now();
+      std::vector<uint8_t> decoded = BlockCompressor::decompressImage(parallel.data(), width, height, test.format);
+      const float error = BlockCompressor::rmsError(source.data(), decoded.data(), static_cast<size_t>(width) * height, test.format);
+      spdlog::info("{}: 1 thread {:.2f} ms, all threads {:.2f} ms ({}-wide SIMD), {:.1f} MB -> {:.1f} MB, rms error {:.2f}", test.name,
+                   std::chrono::duration<float, std::milli>(serialEnd - start).count(),
+                   std::chrono::duration<float, std::milli>(parallelEnd - serialEnd).count(), BlockCompressor::simdWidth(),
+                   source.size() / (1024.0f * 1024.0f), parallel.size() / (1024.0f * 1024.0f), error);
+      if (serial != parallel) {
+        spdlog::error("ERROR: {} blocks differ between single and multi threaded compression", test.name);
+        blockCompressionErrors++;
+      }
+      if (parallel.size() != BlockCompressor::compressedSize(width, height, test.format) || error > test.tolerance) {
+        spdlog::error("ERROR: {} round trip error {:.2f} exceeds {} (or wrong size {})", test.name, error, test.tolerance, parallel.size());
+        blockCompressionErrors++;
+      }
+    }
+    if (testModel.textureLoad.blockCompressed > 0) {
+      spdlog::info("Test model: {} textures block compressed ({} from cache), {:.1f} MB instead of {:.1f} MB", testModel.textureLoad.blockCompressed,
+                   testModel.textureLoad.compressedFromCache, testModel.textureLoad.compressedBytes / (1024.0f * 1024.0f),
+                   testModel.textureLoad.uncompressedBytes / (1024.0f * 1024.0f));
+    }
+  }
+  if (blockCompressionErrors == 0) {
+    spdlog::info("✓ BC4/BC5/BC7 encoders round trip within tolerance");
+  }
+
+  // 12. Shadow cascades: the light space depth range has to map to [0, 1], shadow_cascades.glsl and the caster pipelines expect it
+  spdlog::info("\n=== Shadow Cascade Depth Range ===");
+  int shadowDepthErrors = 0;
+  {
+    ShadowCascades::Settings shadowSettings;
+    shadowSettings.resolution = 256;
+    ShadowCascades shadows(context, cmdUtils, textureManager, 1, shadowSettings);
+    shadows.setCasterBounds(glm::vec3(-10.0f, -10.0f, -1.0f), glm::vec3(10.0f, 10.0f, 5.0f));
+    const glm::mat4 view = glm::lookAt(glm::vec3(4.0f, -6.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    shadows.update(view, glm::radians(60.0f), 16.0f / 9.0f, 0.1f, glm::normalize(glm::vec3(0.3f, 0.2f, -1.0f)));
+    const glm::mat4 worldFromLight = glm::inverse(shadows.lightFromWorld());
+    const float tolerance = 1e-4f;
+    for (uint32_t i = 0; i < ShadowCascades::CASCADE_COUNT; i++) {
+      const ShadowCascades::Cascade& cascade = shadows.cascade(i);
+      const glm::vec2 center = (glm::vec2(cascade.lightMin) + glm::vec2(cascade.lightMax)) * 0.5f;
+      // Nearest caster (largest light space z) at depth 0, farthest at depth 1
+      const glm::vec4 nearCaster = cascade.viewProj * worldFromLight * glm::vec4(center, cascade.lightMax.z, 1.0f);
+      const glm::vec4 farCaster = cascade.viewProj * worldFromLight * glm::vec4(center, cascade.lightMin.z, 1.0f);
+      const float nearDepth = nearCaster.z / nearCaster.w;
+      const float farDepth = farCaster.z / farCaster.w;
+      spdlog::info("Cascade {}: nearest caster depth {:.5f}, farthest {:.5f}", i, nearDepth, farDepth);
+      if (std::abs(nearDepth) > tolerance || std::abs(farDepth - 1.0f) > tolerance) {
+        spdlog::error("ERROR: Cascade {} maps its caster range to [{}, {}] instead of [0, 1]", i, nearDepth, farDepth);
+        shadowDepthErrors++;
+      }
+    }
+  }
+  if (shadowDepthErrors == 0) {
+    spdlog::info("✓ Shadow cascades map their caster range to [0, 1]");
+  }
+
+  // 13. Final Summary
   spdlog::info("\n=== Loading Summary ===");
 
-  int totalErrors = invalidTextureReferences + invalidMaterialReferences + invalidMeshIndices + invalidTextures + degenerateMatrices;
+  int totalErrors = invalidTextureReferences + invalidMaterialReferences + invalidMeshIndices + invalidTextures + degenerateMatrices +
+                    meshOptimizationErrors + equirectConversionErrors + textureTranscodeErrors + blockCompressionErrors +
+                    shadowDepthErrors;
 
   if (totalErrors > 0) {
     spdlog::error("FAILED: Found {} total errors!", totalErrors);
@@ -296,6 +579,11 @@ void ModelTest::loadResources() {
     spdlog::error("  - Invalid mesh indices: {}", invalidMeshIndices);
     spdlog::error("  - Invalid texture Vulkan handles: {}", invalidTextures);
     spdlog::error("  - Degenerate matrices after update: {}", degenerateMatrices);
+    spdlog::error("  - Mesh optimization failures: {}", meshOptimizationErrors);
+    spdlog::error("  - Equirect conversion mismatches: {}", equirectConversionErrors);
+    spdlog::error("  - Serial/parallel texture mismatches: {}", textureTranscodeErrors);
+    spdlog::error("  - Block compression failures: {}", blockCompressionErrors);
+    spdlog::error("  - Shadow cascade depth range failures: {}", shadowDepthErrors);
   } else {
     spdlog::info("✓✓✓ ALL VALIDATIONS PASSED ✓✓✓");
   }
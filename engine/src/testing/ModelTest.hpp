@@ -21,5 +21,6 @@ class TAK_API ModelTest : public VulkanBase {
  private:
   ModelManager::Model testModel;
   std::string modelFilePath;
+  std::string basisuModelPath;
   void printNodeHierarchy(tak::Node* node, int depth, int& printCount);
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 @echo off
+:: Manual build of the shaders, CMake compiles the same list (shaders/CMakeLists.txt), keep both in sync
 echo Compiling shaders...
 
 if not defined VULKAN_SDK (
@@ -41,6 +42,48 @@ if errorlevel 1 (
     exit /b 1
 )
 
+"%GLSLC%" -DPACKED_VERTICES pbrIbl.vert -o "pbrIbl_packed.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile pbrIbl.vert [PACKED_VERTICES]
+    pause
+    exit /b 1
+)
+
+"%GLSLC%" depth_prepass.vert -o "depth_prepass.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile depth_prepass.vert
+    pause
+    exit /b 1
+)
+
+"%GLSLC%" -DALPHA_MASK depth_prepass.vert -o "depth_prepass_mask.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile depth_prepass.vert [ALPHA_MASK]
+    pause
+    exit /b 1
+)
+
+"%GLSLC%" depth_prepass_mask.frag -o "depth_prepass_mask.frag.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile depth_prepass_mask.frag
+    pause
+    exit /b 1
+)
+
+"%GLSLC%" -DSHADOW_CASTER depth_prepass.vert -o "shadow_caster.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile depth_prepass.vert [SHADOW_CASTER]
+    pause
+    exit /b 1
+)
+
+"%GLSLC%" -DSHADOW_CASTER -DALPHA_MASK depth_prepass.vert -o "shadow_caster_mask.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile depth_prepass.vert [SHADOW_CASTER ALPHA_MASK]
+    pause
+    exit /b 1
+)
+
 "%GLSLC%" pbr.frag -o "pbr.frag.spv"
 if errorlevel 1 (
     echo ERROR: Failed to compile pbr.frag
@@ -107,6 +150,48 @@ if errorlevel 1 (
     pause
     exit /b 1
 )
+"%GLSLC%" filtercube.comp -o "prefiltercube.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile filtercube.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DIRRADIANCE filtercube.comp -o "irradiancecube.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile filtercube.comp IRRADIANCE variant
+    pause
+    exit /b 1
+)
+"%GLSLC%" skinning.comp -o "skinning.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile skinning.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DPACKED_VERTICES skinning.comp -o "skinning_packed.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile skinning.comp PACKED_VERTICES variant
+    pause
+    exit /b 1
+)
+"%GLSLC%" meshletcull.comp -o "meshletcull.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile meshletcull.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" equirect2cube.comp -o "equirect2cube.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile equirect2cube.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DLDR equirect2cube.comp -o "equirect2cube_ldr.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile equirect2cube.comp LDR variant
+    pause
+    exit /b 1
+)
 "%GLSLC%" material_pbr.frag -o "material_pbr.frag.spv"
 if errorlevel 1 (
     echo ERROR: Failed to compile "material_pbr.frag
@@ -119,6 +204,30 @@ if errorlevel 1 (
     pause
     exit /b 1
 )
+"%GLSLC%" -DWEIGHTED_OIT material_pbr.frag -o "material_pbr_oit.frag.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile material_pbr.frag [WEIGHTED_OIT]
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DWEIGHTED_OIT material_unlit.frag -o "material_unlit_oit.frag.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile material_unlit.frag [WEIGHTED_OIT]
+    pause
+    exit /b 1
+)
+"%GLSLC%" oit_composite.frag -o "oit_composite.frag.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile oit_composite.frag
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DMULTISAMPLED oit_composite.frag -o "oit_composite_ms.frag.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile oit_composite.frag [MULTISAMPLED]
+    pause
+    exit /b 1
+)
 
 echo Compiling UI shaders...
 "%GLSLC%" ui.vert -o "ui.vert.spv"
@@ -147,27 +256,51 @@ if errorlevel 1 (
     pause
     exit /b 1
 )
-"%GLSLC%" ./deferredShaders/ssao.vert -o "deferredShaders/ssao.vert.spv"
+"%GLSLC%" ./deferredShaders/deferred_prepass.frag -o "deferredShaders/deferred_prepass.frag.spv"
 if errorlevel 1 (
-    echo ERROR: Failed to compile ssao.vert
+    echo ERROR: Failed to compile deferred_prepass.frag
     pause
     exit /b 1
 )
-"%GLSLC%" ./deferredShaders/ssao.frag -o "deferredShaders/ssao.frag.spv"
+"%GLSLC%" ./deferredShaders/ssao_downsample.comp -o "deferredShaders/ssao_downsample.comp.spv"
 if errorlevel 1 (
-    echo ERROR: Failed to compile ssao.frag
+    echo ERROR: Failed to compile ssao_downsample.comp
     pause
     exit /b 1
 )
-"%GLSLC%" ./deferredShaders/ssao_blur.vert -o "deferredShaders/ssao_blur.vert.spv"
+"%GLSLC%" ./deferredShaders/ssao.comp -o "deferredShaders/ssao.comp.spv"
 if errorlevel 1 (
-    echo ERROR: Failed to compile ssao_blur.vert
+    echo ERROR: Failed to compile ssao.comp
     pause
     exit /b 1
 )
-"%GLSLC%" ./deferredShaders/ssao_blur.frag -o "deferredShaders/ssao_blur.frag.spv"
+"%GLSLC%" -DSSAO_RGBA8 ./deferredShaders/ssao.comp -o "deferredShaders/ssao_rgba8.comp.spv"
 if errorlevel 1 (
-    echo ERROR: Failed to compile ssao_blur.frag
+    echo ERROR: Failed to compile ssao.comp SSAO_RGBA8 variant
+    pause
+    exit /b 1
+)
+"%GLSLC%" ./deferredShaders/ssao_upsample.comp -o "deferredShaders/ssao_upsample.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile ssao_upsample.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DSSAO_RGBA8 ./deferredShaders/ssao_upsample.comp -o "deferredShaders/ssao_upsample_rgba8.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile ssao_upsample.comp SSAO_RGBA8 variant
+    pause
+    exit /b 1
+)
+"%GLSLC%" ./deferredShaders/ssao_blur.comp -o "deferredShaders/ssao_blur.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile ssao_blur.comp
+    pause
+    exit /b 1
+)
+"%GLSLC%" -DSSAO_RGBA8 ./deferredShaders/ssao_blur.comp -o "deferredShaders/ssao_blur_rgba8.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile ssao_blur.comp SSAO_RGBA8 variant
     pause
     exit /b 1
 )
@@ -185,6 +318,12 @@ if errorlevel 1 (
     pause
     exit /b 1
 )
+"%GLSLC%" ./deferredShaders/light_cull.comp -o "deferredShaders/light_cull.comp.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile light_cull.comp
+    pause
+    exit /b 1
+)
 
 "%GLSLC%" ./deferredShaders/fullscreen.vert -o "deferredShaders/fullscreen.vert.spv"
 if errorlevel 1 (
@@ -192,6 +331,13 @@ if errorlevel 1 (
     pause
     exit /b 1
 )
+
+"%GLSLC%" ./deferredShaders/shadow_caster.vert -o "deferredShaders/shadow_caster.vert.spv"
+if errorlevel 1 (
+    echo ERROR: Failed to compile shadow_caster.vert
+    pause
+    exit /b 1
+)
 echo.
 echo ===================================
 echo All shaders compiled successfully!
@@ -8,26 +8,26 @@ layout(location = 2) in vec3 fragPosView;
 // Texture sampler
 layout(set = 0, binding = 1) uniform sampler2D albedoSampler;
 
-// G-Buffer outputs (MRT)
-layout(location = 0) out vec4 outNormal;    // RGB=normal (view-space), A=metallic
-layout(location = 1) out vec4 outAlbedo;    // RGB=albedo, A=AO
-layout(location = 2) out vec4 outMaterial;  // R=roughness, GBA=emissive
+// G-Buffer outputs (MRT), transient attachments read by the lighting subpass
+// The normal comes from deferred_prepass.frag, this pass only runs for the surviving fragment (depth EQUAL)
+layout(location = 0) out vec4 outAlbedo;    // R8G8B8A8_SRGB: RGB=albedo, A=AO
+layout(location = 1) out vec4 outMaterial;  // R=metallic, G=roughness, B=emissive strength
+
+// material.b = 1 is an emissive color of albedo * EMISSIVE_RANGE, must match deferred_lighting.frag
+// There is no separate emissive color: surfaces can only glow in their albedo
+const float EMISSIVE_RANGE = 8.0;
 
 void main() {
     // Sample albedo texture
     vec3 albedo = texture(albedoSampler, fragTexCoord).rgb;
 
-    // Normalize view-space normal (NO encoding - SFLOAT stores [-1,1] directly)
-    vec3 N = normalize(fragNormalView);
-
     // Material properties (hardcoded for demo)
     float metallic = 0.0;
     float roughness = 0.5;
     float ao = 1.0;
-    vec3 emissive = vec3(0.0);
+    float emissiveStrength = 0.0;
 
     // Write to G-Buffer
-    outNormal = vec4(N, metallic);
     outAlbedo = vec4(albedo, ao);
-    outMaterial = vec4(roughness, emissive);
+    outMaterial = vec4(metallic, roughness, emissiveStrength / EMISSIVE_RANGE, 0.0);
 }
@@ -18,6 +18,9 @@ layout(location = 0) out vec3 fragNormalView; //viewspace normal
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragPosView; //viewspace position
 
+// The prepass and the geometry subpass must produce bit identical depth for the EQUAL test
+invariant gl_Position;
+
 void main() {
     vec4 worldPos = ubo.model * vec4(inPosition, 1.0);
 
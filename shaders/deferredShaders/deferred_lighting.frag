@@ -1,16 +1,18 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec2 fragUV;
 layout(location = 0) out vec4 outColor;
 
 // G-Buffer inputs
-layout(binding = 0) uniform sampler2D gNormalMetallic;   // RGB=normal (view-space), A=metallic
-layout(binding = 1) uniform sampler2D gAlbedoAO;         // RGB=albedo, A=AO
-layout(binding = 2) uniform sampler2D gMaterial;          // R=roughness, GBA=emissive
-layout(binding = 3) uniform sampler2D gDepth;             // Depth buffer
-layout(binding = 4) uniform sampler2D gSSAO;              // Blurred SSAO
+// Albedo, material and depth are attachments of the geometry subpass, read at this pixel without leaving tile memory
+layout(binding = 0) uniform sampler2D gNormal;                                   // RG=octahedral normal (view-space), from the prepass
+layout(input_attachment_index = 0, binding = 1) uniform subpassInput gAlbedoAO;  // RGB=albedo (sRGB target, read linear), A=AO
+layout(input_attachment_index = 1, binding = 2) uniform subpassInput gMaterial;  // R=metallic, G=roughness, B=emissive strength
+layout(input_attachment_index = 2, binding = 3) uniform subpassInput gDepth;     // Depth buffer
+layout(binding = 4) uniform sampler2D gSSAO;                                     // Upsampled SSAO
 
-#define MAX_POINT_LIGHTS 32
+#define MAX_LIGHTS_PER_CLUSTER 256  // VulkanDeferredBase::LightingPass::MAX_LIGHTS_PER_CLUSTER
 
 struct PointLight {
     vec4 position;   // xyz=pos, w=radius
@@ -25,25 +27,59 @@ struct DirectionalLight {
 layout(binding = 5) uniform LightUBO {
     mat4 invView;
     mat4 invProj;
+    mat4 view;
     vec4 cameraPos;
     DirectionalLight sunLight;
-    PointLight pointLights[MAX_POINT_LIGHTS];
+    uvec4 clusterGrid;   // screen tiles x, y, depth slices
+    vec4 clusterDepth;   // near, far, slice = log(viewDepth) * z + w
     int numPointLights;
     float ambientIntensity;
     float ssaoStrength;
-    float padding;
+    int clusterHeatmap;
 } lights;
 
+layout(std430, binding = 6) readonly buffer PointLights {
+    PointLight pointLights[];
+};
+
+// Written by light_cull.comp, per cluster: light count, then MAX_LIGHTS_PER_CLUSTER light indices
+layout(std430, binding = 7) readonly buffer Clusters {
+    uint clusterData[];
+};
+
+// 8: ShadowUBO, 9: shadow map (comparison), 10: shadow map depth
+#define SHADOW_SET 0
+#define SHADOW_BINDING 8
+#include "../shadow_cascades.glsl"
+
 const float PI = 3.14159265359;
+// material.b = 1 is an emissive color of albedo * EMISSIVE_RANGE, must match deferred_geometry.frag
+const float EMISSIVE_RANGE = 8.0;
+
+// Inverse of octEncode in deferred_prepass.frag
+vec3 octDecode(vec2 e) {
+    vec2 f = e * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
-// Reconstruct world position from depth
-vec3 reconstructWorldPos(vec2 uv, float depth) {
+// Reconstruct view-space position from depth
+vec3 reconstructViewPos(vec2 uv, float depth) {
     // UV to NDC: [0,1] -> [-1,1]
     vec4 clipPos = vec4(uv * 2.0 - 1.0, depth, 1.0);
     vec4 viewPos = lights.invProj * clipPos;
-    viewPos /= viewPos.w;
-    vec4 worldPos = lights.invView * viewPos;
-    return worldPos.xyz;
+    return viewPos.xyz / viewPos.w;
+}
+
+// Offset of the light list in clusterData, same tiling and slicing as light_cull.comp
+uint clusterBase(vec2 uv, float viewDepth) {
+    uvec3 grid = lights.clusterGrid.xyz;
+    uvec2 tile = min(uvec2(uv * vec2(grid.xy)), grid.xy - 1);
+    uint slice = uint(clamp(log(viewDepth) * lights.clusterDepth.z + lights.clusterDepth.w, 0.0, float(grid.z - 1)));
+    return ((slice * grid.y + tile.y) * grid.x + tile.x) * (MAX_LIGHTS_PER_CLUSTER + 1);
 }
 
 // PBR functions
@@ -92,34 +128,33 @@ vec3 computeLight(vec3 L, vec3 radiance, vec3 N, vec3 V,
 
 void main() {
     // Sample G-Buffer
-    vec4 normalMetallic = texture(gNormalMetallic, fragUV);
-    vec4 albedoAO = texture(gAlbedoAO, fragUV);
-    vec4 materialData = texture(gMaterial, fragUV);
-    float depth = texture(gDepth, fragUV).r;
+    vec2 normalOct = texture(gNormal, fragUV).rg;
+    vec4 albedoAO = subpassLoad(gAlbedoAO);
+    vec4 materialData = subpassLoad(gMaterial);
+    float depth = subpassLoad(gDepth).r;
     float ssao = texture(gSSAO, fragUV).r;
 
-    // Early out for sky pixels (depth == 1.0 means nothing was drawn)
-    if (depth >= 1.0) {
+    // Early out for sky pixels (reverse-Z: depth == 0.0 means nothing was drawn)
+    if (depth <= 0.0) {
         outColor = vec4(0.02, 0.02, 0.03, 1.0);  // background color
         return;
     }
 
     // Unpack G-Buffer
-    // FIX: Normals are stored in R16G16B16A16_SFLOAT which natively holds [-1,1].
-    //      No decode needed — just normalize to handle interpolation artifacts.
-    vec3 viewN = normalize(normalMetallic.rgb);
-    float metallic = normalMetallic.a;
+    vec3 viewN = octDecode(normalOct);
     vec3 albedo = albedoAO.rgb;
     float ao = albedoAO.a;
-    float roughness = materialData.r;
-    vec3 emissive = materialData.gba;
+    float metallic = materialData.r;
+    float roughness = materialData.g;
+    vec3 emissive = albedo * materialData.b * EMISSIVE_RANGE;
 
     // FIX: Transform normal from view space to world space so it matches
     //      world-space light directions and camera position.
     vec3 N = normalize(mat3(lights.invView) * viewN);
 
     // Reconstruct world position
-    vec3 worldPos = reconstructWorldPos(fragUV, depth);
+    vec3 viewPos = reconstructViewPos(fragUV, depth);
+    vec3 worldPos = (lights.invView * vec4(viewPos, 1.0)).xyz;
     vec3 V = normalize(lights.cameraPos.xyz - worldPos);
 
     // Base reflectance (dielectric = 0.04, metallic = albedo)
@@ -130,19 +165,29 @@ void main() {
 
     vec3 Lo = vec3(0.0);
 
-    // Directional light (sun)
+    // Directional light (sun), shadowed by the cascades
     {
         vec3 L = normalize(-lights.sunLight.direction.xyz);
         vec3 radiance = lights.sunLight.color.rgb * lights.sunLight.color.w;
-        Lo += computeLight(L, radiance, N, V, albedo, metallic, roughness, F0);
+        float lit = sampleShadow(worldPos, N, -viewPos.z, gl_FragCoord.xy);
+        Lo += computeLight(L, radiance, N, V, albedo, metallic, roughness, F0) * lit;
     }
 
-    // Point lights
-    for (int i = 0; i < lights.numPointLights; i++) {
-        vec3 lightPos = lights.pointLights[i].position.xyz;
-        float radius = lights.pointLights[i].position.w;
-        vec3 lightColor = lights.pointLights[i].color.rgb;
-        float intensity = lights.pointLights[i].color.w;
+    // Point lights of this pixel's cluster
+    uint base = clusterBase(fragUV, -viewPos.z);
+    uint clusterLights = clusterData[base];
+    if (lights.clusterHeatmap != 0) {
+        // Blue (no lights) over green to red (64 and more)
+        float load = clamp(float(clusterLights) / 64.0, 0.0, 1.0);
+        outColor = vec4(clamp(vec3(2.0 * load - 1.0, 1.0 - abs(2.0 * load - 1.0), 1.0 - 2.0 * load), 0.0, 1.0), 1.0);
+        return;
+    }
+    for (uint i = 0; i < clusterLights; i++) {
+        PointLight light = pointLights[clusterData[base + 1 + i]];
+        vec3 lightPos = light.position.xyz;
+        float radius = light.position.w;
+        vec3 lightColor = light.color.rgb;
+        float intensity = light.color.w;
 
         vec3 L = lightPos - worldPos;
         float dist = length(L);
@@ -161,6 +206,9 @@ void main() {
     vec3 ambient = lights.ambientIntensity * albedo * combinedAO;
 
     vec3 color = ambient + Lo + emissive;
+    if (shadow.showCascades != 0) {
+        color *= shadowCascadeColor(-viewPos.z);
+    }
 
     // Tone mapping (Reinhard)
     color = color / (color + vec3(1.0));
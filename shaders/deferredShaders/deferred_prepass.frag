@@ -0,0 +1,21 @@
+#version 450
+
+// Depth/normal prepass: depth for the SSAO passes and the EQUAL test of the geometry subpass,
+// normals for SSAO and the lighting subpass
+layout(location = 0) in vec3 fragNormalView;
+
+layout(location = 0) out vec2 outNormal;  // R16G16_UNORM (R16G16_SFLOAT fallback): octahedral normal (view-space)
+
+// Unit vector onto the octahedron, folded into [0,1]^2
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 p = n.xy;
+    if (n.z < 0.0) {
+        p = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return p * 0.5 + 0.5;
+}
+
+void main() {
+    outNormal = octEncode(normalize(fragNormalView));
+}
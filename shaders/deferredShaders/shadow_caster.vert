@@ -0,0 +1,12 @@
+#version 450
+
+// Depth-only caster of the shadow cascades, position only
+layout(location = 0) in vec3 inPosition;
+
+layout(push_constant) uniform Push {
+    mat4 clipFromModel;  // cascade viewProj * model
+} push;
+
+void main() {
+    gl_Position = push.clipFromModel * vec4(inPosition, 1.0);
+}
@@ -1,12 +0,0 @@
-#version 450
-
-// Fullscreen quad vertices
-layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec2 inTexCoord;
-
-layout(location = 0) out vec2 fragTexCoord;
-
-void main() {
-    fragTexCoord = inTexCoord;
-    gl_Position = vec4(inPosition, 0.0, 1.0);
-}
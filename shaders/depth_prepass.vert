@@ -0,0 +1,93 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Depth-only pre-pass of the forward PBR path: fetches position (and the skin stream for skinned meshes) only,
+// ALPHA_MASK adds the uvs for the alpha test of masked materials.
+// SHADOW_CASTER draws into cascade pushConstants.cascade of the shadow map instead (shadow_caster*.vert.spv), the
+// invariance only matters for the camera pass.
+// gl_Position has to match pbrIbl.vert bit for bit, the main pass tests against this depth with EQUAL:
+// same expressions in the same order, and invariant in both shaders.
+
+layout (location = 0) in vec3 inPos;
+#ifdef ALPHA_MASK
+layout (location = 2) in vec2 inUV0;
+layout (location = 3) in vec2 inUV1;
+#endif
+layout (location = 4) in uvec4 inJoint0;
+layout (location = 5) in vec4 inWeight0;
+
+layout (set = 0, binding = 0) uniform UBO 
+{
+	mat4 projection;
+	mat4 model;
+	mat4 view;
+	vec3 camPos;
+} ubo;
+
+#ifdef SHADOW_CASTER
+#define SHADOW_UBO_ONLY
+#define SHADOW_SET 0
+#define SHADOW_BINDING 5
+#include "shadow_cascades.glsl"
+#endif
+
+layout (constant_id = 0) const bool PRE_SKINNED = false;
+
+struct MeshShaderDataBlock {
+	mat4 matrix;
+	uint jointOffset;
+	uint jointCount;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer SSBO
+{
+   MeshShaderDataBlock meshData[];
+};
+
+layout(std430, set = 2, binding = 1) readonly buffer JointSSBO
+{
+   mat4 jointMatrices[];
+};
+
+layout (push_constant) uniform PushConstants {
+	int meshIndex;
+	int materialIndex;
+#ifdef SHADOW_CASTER
+	int cascade;
+#endif
+} pushConstants;
+
+#ifdef ALPHA_MASK
+layout (location = 0) out vec2 outUV0;
+layout (location = 1) out vec2 outUV1;
+#endif
+
+invariant gl_Position;
+
+void main() 
+{
+	vec4 locPos;
+	if (!PRE_SKINNED && meshData[pushConstants.meshIndex].jointCount > 0) {
+		uint jointOffset = meshData[pushConstants.meshIndex].jointOffset;
+		mat4 skinMat = 
+			inWeight0.x * jointMatrices[jointOffset + inJoint0.x] +
+			inWeight0.y * jointMatrices[jointOffset + inJoint0.y] +
+			inWeight0.z * jointMatrices[jointOffset + inJoint0.z] +
+			inWeight0.w * jointMatrices[jointOffset + inJoint0.w];
+
+		locPos = ubo.model * meshData[pushConstants.meshIndex].matrix * skinMat * vec4(inPos, 1.0);
+	} else {
+		locPos = ubo.model * meshData[pushConstants.meshIndex].matrix * vec4(inPos, 1.0);
+	}
+	locPos.y = -locPos.y;
+	vec3 worldPos = locPos.xyz / locPos.w;
+#ifdef ALPHA_MASK
+	outUV0 = inUV0;
+	outUV1 = inUV1;
+#endif
+#ifdef SHADOW_CASTER
+	gl_Position = shadow.casterViewProj[pushConstants.cascade] * vec4(worldPos, 1.0);
+#else
+	gl_Position =  ubo.projection * ubo.view * vec4(worldPos, 1.0);
+#endif
+}
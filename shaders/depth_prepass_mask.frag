@@ -0,0 +1,49 @@
+#version 450
+
+// Alpha test of masked materials for the depth pre-pass, same cutoff test as material_pbr.frag
+// (the sRGB conversion there leaves alpha untouched)
+
+layout (location = 0) in vec2 inUV0;
+layout (location = 1) in vec2 inUV1;
+
+layout (set = 1, binding = 0) uniform sampler2D colorMap;
+
+struct ShaderMaterial {
+	vec4 baseColorFactor;
+	vec4 emissiveFactor;
+	vec4 diffuseFactor;
+	vec4 specularFactor;
+	float workflow;
+	int baseColorTextureSet;
+	int physicalDescriptorTextureSet;
+	int normalTextureSet;	
+	int occlusionTextureSet;
+	int emissiveTextureSet;
+	float metallicFactor;	
+	float roughnessFactor;	
+	float alphaMask;	
+	float alphaMaskCutoff;
+	float emissiveStrength;
+};
+
+layout(std430, set = 3, binding = 0) readonly buffer SSBO
+{
+   ShaderMaterial materials[ ];
+};
+
+layout (push_constant) uniform PushConstants {
+	int meshIndex;
+	int materialIndex;
+} pushConstants;
+
+void main()
+{
+	ShaderMaterial material = materials[pushConstants.materialIndex];
+	float alpha = material.baseColorFactor.a;
+	if (material.baseColorTextureSet > -1) {
+		alpha *= texture(colorMap, material.baseColorTextureSet == 0 ? inUV0 : inUV1).a;
+	}
+	if (alpha < material.alphaMaskCutoff) {
+		discard;
+	}
+}
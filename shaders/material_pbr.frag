@@ -29,6 +29,9 @@ layout (set = 0, binding = 1) uniform UBOParams {
 layout (set = 0, binding = 2) uniform samplerCube samplerIrradiance;
 layout (set = 0, binding = 3) uniform samplerCube prefilteredMap;
 layout (set = 0, binding = 4) uniform sampler2D samplerBRDFLUT;
+#define SHADOW_SET 0
+#define SHADOW_BINDING 5
+#include "shadow_cascades.glsl"
 
 // Material bindings
 
@@ -70,7 +73,12 @@ layout (push_constant) uniform PushConstants {
 	int materialIndex;
 } pushConstants;
 
+#ifdef WEIGHTED_OIT
+#include "weighted_oit.glsl"
+vec4 outColor;  // shaded result, handed to writeWeightedOIT at the end of main
+#else
 layout (location = 0) out vec4 outColor;
+#endif
 
 // Encapsulate the various inputs used by the various functions in the shading equation
 // We store values in this struct to simplify the integration of alternative implementations
@@ -137,7 +145,10 @@ vec4 tonemap(vec4 color)
 vec3 getNormal(ShaderMaterial material)
 {
 	// Perturb normal, see http://www.thetenthplanet.de/archives/1180
-	vec3 tangentNormal = texture(normalMap, material.normalTextureSet == 0 ? inUV0 : inUV1).xyz * 2.0 - 1.0;
+	vec3 tangentNormal;
+	tangentNormal.xy = texture(normalMap, material.normalTextureSet == 0 ? inUV0 : inUV1).xy * 2.0 - 1.0;
+	// z from the unit length, BC5 normal maps store only x and y
+	tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
 	vec3 q1 = dFdx(inWorldPos);
 	vec3 q2 = dFdy(inWorldPos);
@@ -360,6 +371,8 @@ void main()
 	vec3 specContrib = F * G * D / (4.0 * NdotL * NdotV);
 	// Obtain final intensity as reflectance (BRDF) scaled by the energy of the light (cosine law)
 	vec3 color = NdotL * u_LightColor * (diffuseContrib + specContrib);
+	float viewDepth = -(ubo.view * vec4(inWorldPos, 1.0)).z;
+	color *= sampleShadow(inWorldPos, n, viewDepth, gl_FragCoord.xy);
 
 	// Calculate lighting contribution from image based lighting source (IBL)
 	color += getIBLContribution(pbrInputs, n, reflection);
@@ -376,6 +389,9 @@ void main()
 		emissive *= SRGBtoLINEAR(texture(emissiveMap, material.emissiveTextureSet == 0 ? inUV0 : inUV1)).rgb;
 	};
 	color += emissive;
+	if (shadow.showCascades != 0) {
+		color *= shadowCascadeColor(viewDepth);
+	}
 	
 	outColor = vec4(color, baseColor.a);
 
@@ -428,4 +444,7 @@ void main()
 		}
 	}
 
+#ifdef WEIGHTED_OIT
+	writeWeightedOIT(outColor);
+#endif
 }
@@ -1,4 +1,3 @@
-
 #version 450
 #extension GL_GOOGLE_include_directive : require
 
@@ -71,7 +70,12 @@ layout (push_constant) uniform PushConstants {
 	int materialIndex;
 } pushConstants;
 
+#ifdef WEIGHTED_OIT
+#include "weighted_oit.glsl"
+vec4 outColor;  // shaded result, handed to writeWeightedOIT at the end of main
+#else
 layout (location = 0) out vec4 outColor;
+#endif
 
 vec4 SRGBtoLINEAR(vec4 srgbIn)
 {
@@ -105,4 +109,8 @@ void main()
 	}
 
 	outColor = baseColor;
+
+#ifdef WEIGHTED_OIT
+	writeWeightedOIT(outColor);
+#endif
 }
@@ -0,0 +1,42 @@
+#version 450
+
+// Resolves the weighted blended transparency accumulation over the scene color
+// Blended with (ONE_MINUS_SRC_ALPHA, SRC_ALPHA): scene * revealage + average transparent color * (1 - revealage)
+// MULTISAMPLED averages the samples of the accumulation targets, the result is written to every covered sample
+
+#ifdef MULTISAMPLED
+layout (constant_id = 0) const int SAMPLE_COUNT = 4;
+layout (input_attachment_index = 0, binding = 0) uniform subpassInputMS inputAccum;
+layout (input_attachment_index = 1, binding = 1) uniform subpassInputMS inputRevealage;
+#else
+layout (input_attachment_index = 0, binding = 0) uniform subpassInput inputAccum;
+layout (input_attachment_index = 1, binding = 1) uniform subpassInput inputRevealage;
+#endif
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+#ifdef MULTISAMPLED
+	vec4 accum = vec4(0.0);
+	float revealage = 0.0;
+	for (int i = 0; i < SAMPLE_COUNT; i++) {
+		accum += subpassLoad(inputAccum, i);
+		revealage += subpassLoad(inputRevealage, i).r;
+	}
+	accum /= float(SAMPLE_COUNT);
+	revealage /= float(SAMPLE_COUNT);
+#else
+	vec4 accum = subpassLoad(inputAccum);
+	float revealage = subpassLoad(inputRevealage).r;
+#endif
+	// Nothing transparent covers this pixel
+	if (revealage >= 1.0) {
+		discard;
+	}
+	// Weighted sums can overflow half floats on very bright surfaces
+	if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b)))) {
+		accum.rgb = vec3(accum.a);
+	}
+	outColor = vec4(accum.rgb / max(accum.a, 1e-5), revealage);
+}
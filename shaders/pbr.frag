@@ -101,7 +101,10 @@ vec4 SRGBtoLINEAR(vec4 srgbIn) {
 
 // Find the normal for this fragment
 vec3 getNormal(ShaderMaterial material) {
-	vec3 tangentNormal = texture(normalMap, material.normalTextureSet == 0 ? inUV0 : inUV1).xyz * 2.0 - 1.0;
+	vec3 tangentNormal;
+	tangentNormal.xy = texture(normalMap, material.normalTextureSet == 0 ? inUV0 : inUV1).xy * 2.0 - 1.0;
+	// z from the unit length, BC5 normal maps store only x and y
+	tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
 	vec3 q1 = dFdx(inWorldPos);
 	vec3 q2 = dFdy(inWorldPos);
@@ -18,18 +18,21 @@ layout(set = 0, binding = 0) uniform UBO {
     vec3 camPos;
 } ubo;
 
-#define MAX_NUM_JOINTS 128
-
 struct MeshDataBlock {
     mat4 matrix;
-    mat4 jointMatrix[MAX_NUM_JOINTS];
+    uint jointOffset;
     uint jointCount;
 };
 
-layout(set = 2, binding = 0) readonly buffer SSBO {
+layout(std430, set = 2, binding = 0) readonly buffer SSBO {
     MeshDataBlock meshData[];
 };
 
+// Joint palettes of all skinned meshes, packed back to back
+layout(std430, set = 2, binding = 1) readonly buffer JointSSBO {
+    mat4 jointMatrices[];
+};
+
 layout (push_constant) uniform PushConstants {
 	int meshIndex;
 	int materialIndex;
@@ -50,11 +53,12 @@ void main() {
     vec4 locPos;
     if (meshData[pushConstants.meshIndex].jointCount > 0) {
         // Mesh is skinned
+        uint jointOffset = meshData[pushConstants.meshIndex].jointOffset;
         mat4 skinMat = 
-            inWeight0.x * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.x] +
-            inWeight0.y * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.y] +
-            inWeight0.z * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.z] +
-            inWeight0.w * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.w];
+            inWeight0.x * jointMatrices[jointOffset + inJoint0.x] +
+            inWeight0.y * jointMatrices[jointOffset + inJoint0.y] +
+            inWeight0.z * jointMatrices[jointOffset + inJoint0.z] +
+            inWeight0.w * jointMatrices[jointOffset + inJoint0.w];
         locPos = ubo.model * meshData[pushConstants.meshIndex].matrix * skinMat * vec4(inPos, 1.0);
         outNormal = normalize(transpose(inverse(mat3(ubo.model * meshData[pushConstants.meshIndex].matrix * skinMat))) * inNormal);
     } else {
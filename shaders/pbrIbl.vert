@@ -1,13 +1,20 @@
 #version 450
 
 layout (location = 0) in vec3 inPos;
+#ifdef PACKED_VERTICES
+// tak::PackedVertex: octahedral normal in xy (tangent in zw is unused here)
+layout (location = 1) in ivec4 inNormalTangent;
+#else
 layout (location = 1) in vec3 inNormal;
+#endif
 layout (location = 2) in vec2 inUV0;
 layout (location = 3) in vec2 inUV1;
 layout (location = 4) in uvec4 inJoint0;
 layout (location = 5) in vec4 inWeight0;
 layout (location = 6) in vec4 inColor0;
+#ifndef PACKED_VERTICES
 layout (location = 7) in vec4 inTangent;
+#endif
 
 layout (set = 0, binding = 0) uniform UBO 
 {
@@ -17,11 +24,12 @@ layout (set = 0, binding = 0) uniform UBO
 	vec3 camPos;
 } ubo;
 
-#define MAX_NUM_JOINTS 128
+// Set for pipelines that draw vertices already skinned by skinning.comp
+layout (constant_id = 0) const bool PRE_SKINNED = false;
 
 struct MeshShaderDataBlock {
 	mat4 matrix;
-	mat4 jointMatrix[MAX_NUM_JOINTS];
+	uint jointOffset;
 	uint jointCount;
 };
 
@@ -30,6 +38,12 @@ layout(std430, set = 2, binding = 0) readonly buffer SSBO
    MeshShaderDataBlock meshData[];
 };
 
+// Joint palettes of all skinned meshes, packed back to back
+layout(std430, set = 2, binding = 1) readonly buffer JointSSBO
+{
+   mat4 jointMatrices[];
+};
+
 layout (push_constant) uniform PushConstants {
 	int meshIndex;
 	int materialIndex;
@@ -41,18 +55,34 @@ layout (location = 2) out vec2 outUV0;
 layout (location = 3) out vec2 outUV1;
 layout (location = 4) out vec4 outColor0;
 
+// Opaque and masked draws depth test with EQUAL against depth_prepass.vert when the pre-pass is on
+invariant gl_Position;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
 void main() 
 {
+#ifdef PACKED_VERTICES
+	vec3 inNormal = octDecode(vec2(inNormalTangent.xy) / 32767.0);
+#endif
 	outColor0 = inColor0;
 
 	vec4 locPos;
-	if (meshData[pushConstants.meshIndex].jointCount > 0) {
+	if (!PRE_SKINNED && meshData[pushConstants.meshIndex].jointCount > 0) {
 		// Mesh is skinned
+		uint jointOffset = meshData[pushConstants.meshIndex].jointOffset;
 		mat4 skinMat = 
-			inWeight0.x * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.x] +
-			inWeight0.y * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.y] +
-			inWeight0.z * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.z] +
-			inWeight0.w * meshData[pushConstants.meshIndex].jointMatrix[inJoint0.w];
+			inWeight0.x * jointMatrices[jointOffset + inJoint0.x] +
+			inWeight0.y * jointMatrices[jointOffset + inJoint0.y] +
+			inWeight0.z * jointMatrices[jointOffset + inJoint0.z] +
+			inWeight0.w * jointMatrices[jointOffset + inJoint0.w];
 
 		locPos = ubo.model * meshData[pushConstants.meshIndex].matrix * skinMat * vec4(inPos, 1.0);
 		outNormal = normalize(transpose(inverse(mat3(ubo.model * meshData[pushConstants.meshIndex].matrix * skinMat))) * inNormal);
@@ -0,0 +1,115 @@
+// Cascaded shadow map of the directional light, written by ShadowCascades (2x2 atlas, one tile per cascade)
+// Includers define SHADOW_SET and SHADOW_BINDING: ShadowUBO at SHADOW_BINDING, the comparison sampler at SHADOW_BINDING + 1
+// and the plain depth sampler (PCSS blocker search) at SHADOW_BINDING + 2. Positions and normals are in the space the
+// cascades were fit in, sampleShadow returns 1 for lit and 0 for shadowed.
+// Caster shaders define SHADOW_UBO_ONLY and draw cascade i with casterViewProj[i].
+
+#define SHADOW_CASCADES 4  // ShadowCascades::CASCADE_COUNT
+#define SHADOW_FILTER_HARD 0
+#define SHADOW_FILTER_PCF 1
+#define SHADOW_FILTER_PCSS 2
+
+layout (set = SHADOW_SET, binding = SHADOW_BINDING) uniform ShadowUBO {
+	mat4 atlasFromWorld[SHADOW_CASCADES];
+	mat4 casterViewProj[SHADOW_CASCADES];
+	vec4 splitDepth;  // view depth each cascade ends at
+	vec4 texelSize;   // world units per texel
+	vec4 depthRange;  // world units between the cascade's near and far plane
+	int filterMode;
+	float tanLightAngle;
+	float normalOffset;
+	int showCascades;
+} shadow;
+
+#ifndef SHADOW_UBO_ONLY
+layout (set = SHADOW_SET, binding = SHADOW_BINDING + 1) uniform sampler2DShadow shadowMap;
+layout (set = SHADOW_SET, binding = SHADOW_BINDING + 2) uniform sampler2D shadowDepth;
+
+const vec2 SHADOW_POISSON[16] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725), vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464), vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420), vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590), vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790));
+// PCSS footprints are clamped to this many texels of the cascade
+const float SHADOW_MAX_SEARCH_TEXELS = 24.0;
+
+int shadowCascadeIndex(float viewDepth)
+{
+	for (int i = 0; i < SHADOW_CASCADES - 1; i++) {
+		if (viewDepth < shadow.splitDepth[i]) {
+			return i;
+		}
+	}
+	return SHADOW_CASCADES - 1;
+}
+
+// Debug tint of the cascade a pixel reads
+vec3 shadowCascadeColor(float viewDepth)
+{
+	const vec3 colors[SHADOW_CASCADES] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+	return viewDepth < shadow.splitDepth[SHADOW_CASCADES - 1] ? colors[shadowCascadeIndex(viewDepth)] : vec3(1.0);
+}
+
+// Per pixel rotation of the tap pattern, turns banding into noise
+mat2 shadowTapRotation(vec2 pixel)
+{
+	float angle = 6.28318530 * fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+	float s = sin(angle);
+	float c = cos(angle);
+	return mat2(c, s, -s, c);
+}
+
+// Taps stay inside the cascade's tile, the neighbouring tiles belong to other projections
+float shadowPCF(vec3 coord, float radius, vec4 tile, mat2 rotation)
+{
+	float lit = 0.0;
+	for (int i = 0; i < 16; i++) {
+		vec2 uv = clamp(coord.xy + rotation * SHADOW_POISSON[i] * radius, tile.xy, tile.zw);
+		lit += texture(shadowMap, vec3(uv, coord.z));
+	}
+	return lit / 16.0;
+}
+
+float sampleShadow(vec3 worldPos, vec3 worldNormal, float viewDepth, vec2 pixel)
+{
+	if (viewDepth >= shadow.splitDepth[SHADOW_CASCADES - 1]) {
+		return 1.0;
+	}
+	int cascade = shadowCascadeIndex(viewDepth);
+	vec3 position = worldPos + worldNormal * (shadow.normalOffset * shadow.texelSize[cascade]);
+	vec3 coord = (shadow.atlasFromWorld[cascade] * vec4(position, 1.0)).xyz;
+	coord.z = min(coord.z, 1.0);  // receivers behind every caster still pass against the cleared depth
+
+	float atlasTexel = 1.0 / float(textureSize(shadowDepth, 0).x);
+	vec2 tileMin = vec2(cascade % 2, cascade / 2) * 0.5;
+	vec4 tile = vec4(tileMin + 0.5 * atlasTexel, tileMin + 0.5 - 0.5 * atlasTexel);
+	if (shadow.filterMode == SHADOW_FILTER_HARD) {
+		return texture(shadowMap, vec3(clamp(coord.xy, tile.xy, tile.zw), coord.z));
+	}
+	mat2 rotation = shadowTapRotation(pixel);
+	if (shadow.filterMode == SHADOW_FILTER_PCF) {
+		return shadowPCF(coord, 1.5 * atlasTexel, tile, rotation);
+	}
+
+	// PCSS: blockers closer to the light than the receiver, searched over the widest penumbra the light angle allows
+	float worldToUv = atlasTexel / shadow.texelSize[cascade];
+	float maxRadius = SHADOW_MAX_SEARCH_TEXELS * atlasTexel;
+	float searchRadius = clamp(coord.z * shadow.depthRange[cascade] * shadow.tanLightAngle * worldToUv, atlasTexel, maxRadius);
+	float blockerSum = 0.0;
+	float blockers = 0.0;
+	for (int i = 0; i < 16; i++) {
+		vec2 uv = clamp(coord.xy + rotation * SHADOW_POISSON[i] * searchRadius, tile.xy, tile.zw);
+		float depth = textureLod(shadowDepth, uv, 0.0).r;
+		if (depth < coord.z) {
+			blockerSum += depth;
+			blockers += 1.0;
+		}
+	}
+	if (blockers == 0.0) {
+		return 1.0;
+	}
+	float blockerDistance = (coord.z - blockerSum / blockers) * shadow.depthRange[cascade];
+	float penumbra = clamp(blockerDistance * shadow.tanLightAngle * worldToUv, atlasTexel, maxRadius);
+	return shadowPCF(coord, penumbra, tile, rotation);
+}
+#endif
@@ -24,4 +24,6 @@ void main()
 {
 	outUVW = inPos;
 	gl_Position = ubo.projection * ubo.model * vec4(inPos.xyz, 1.0);
+	// Infinitely far in reverse-Z, drawn after the scene with a GREATER_OR_EQUAL test against the cleared depth
+	gl_Position.z = 0.0;
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+// Weighted blended order-independent transparency (McGuire and Bavoil 2013)
+// Material shaders compiled with -DWEIGHTED_OIT write here instead of outColor, the accumulation pipelines add
+// outAccum (ONE, ONE) and multiply the framebuffer by 1 - alpha through outRevealage (ZERO, ONE_MINUS_SRC_COLOR).
+// Needs the scene ubo (projection) declared before the include
+
+layout (location = 0) out vec4 outAccum;
+layout (location = 1) out float outRevealage;
+
+void writeWeightedOIT(vec4 color)
+{
+	float alpha = clamp(color.a, 0.0, 1.0);
+	// Closer and more opaque surfaces dominate the average (paper eq. 7), clamped to stay inside half float range.
+	// The weight needs view distance: reverse-Z window depth is near / distance and falls under the clamp a few units out.
+	// depth = -P[2][2] + P[3][2] / distance for any perspective projection, near / depth for the infinite reverse-Z one
+	float viewDepth = ubo.projection[3][2] / max(gl_FragCoord.z + ubo.projection[2][2], 1e-6);
+	float weight = alpha * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+	outAccum = vec4(color.rgb * alpha, alpha) * weight;
+	outRevealage = alpha;
+}